@@ -33,6 +33,25 @@ bool CNodeRoleManager::IsInCharge(int TradePairID, infinidex_node_role_enum Role
 	return false;
 }
 
+//masternode whose signature is accepted for a role of a trade pair
+bool CNodeRoleManager::GetInChargePubKey(int TradePairID, infinidex_node_role_enum RoleType, std::string& PubKey)
+{
+	if (!mapTradePairNodeRole.count(TradePairID))
+	{
+		return false;
+	}
+
+	for (auto& a : mapTradePairNodeRole[TradePairID])
+	{
+		if (a->NodeRole == RoleType && a->IsValid)
+		{
+			PubKey = a->NodePubKey;
+			return true;
+		}
+	}
+	return false;
+}
+
 bool CNodeRoleManager::UpdateRole(CNodeRole Role)
 {
 	if (!Role.VerifySignature())
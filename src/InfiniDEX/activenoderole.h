@@ -21,6 +21,7 @@ class CNodeRoleManager
 {
 public:
 	bool IsInCharge(int TradePairID, infinidex_node_role_enum RoleType);
+	bool GetInChargePubKey(int TradePairID, infinidex_node_role_enum RoleType, std::string& PubKey);
 	bool UpdateRole(CNodeRole Role);
 	bool RemoveRole(int TradePairID, int NodeRoleID);
 };
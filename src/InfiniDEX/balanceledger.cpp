@@ -0,0 +1,563 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "balanceledger.h"
+#include "clientversion.h"
+#include "crypto/common.h"
+#include "hash.h"
+#include "memusage.h"
+#include "streams.h"
+#include "traderregistry.h"
+#include "userbalance.h"
+#include "util.h"
+
+#include <boost/filesystem.hpp>
+
+class CBalanceLedger;
+
+CBalanceLedger balanceLedger;
+
+static const unsigned int SET_BALANCE_VALUE_COUNT = BALANCE_COLUMN_COUNT + 5;
+
+void CBalanceLedger::CCoinColumns::Resize(size_t nSize)
+{
+	if (vExists.size() >= nSize)
+		return;
+
+	vExists.resize(nSize, 0);
+	for (int i = 0; i < BALANCE_COLUMN_COUNT; i++)
+		vBalance[i].resize(nSize, 0);
+	vLastDepositID.resize(nSize, 0);
+	vLastWithdrawID.resize(nSize, 0);
+	vLastActualTradeID.resize(nSize, 0);
+	vLastUserTradeID.resize(nSize, 0);
+	vLastUpdateTime.resize(nSize, 0);
+}
+
+size_t CBalanceLedger::CCoinColumns::DynamicMemoryUsage() const
+{
+	size_t nUsage = memusage::DynamicUsage(vExists);
+	for (int i = 0; i < BALANCE_COLUMN_COUNT; i++)
+		nUsage += memusage::DynamicUsage(vBalance[i]);
+	return nUsage + memusage::DynamicUsage(vLastDepositID) + memusage::DynamicUsage(vLastWithdrawID) + memusage::DynamicUsage(vLastActualTradeID) +
+		memusage::DynamicUsage(vLastUserTradeID) + memusage::DynamicUsage(vLastUpdateTime);
+}
+
+bool CBalanceLedger::FindAccount(const std::string& UserPubKey, uint32_t& nAccountID) const
+{
+	uint32_t TraderID = traderRegistry.FindTraderID(UserPubKey);
+	if (TraderID >= vTraderAccount.size() || vTraderAccount[TraderID] == LEDGER_ACCOUNT_NONE)
+		return false;
+
+	nAccountID = vTraderAccount[TraderID];
+	return true;
+}
+
+//new accounts are logged on their own, so the ID is known before the update using it is written,
+//LEDGER_ACCOUNT_NONE makes that update fail when the account could not be logged
+uint32_t CBalanceLedger::InternAccount(const std::string& UserPubKey)
+{
+	uint32_t nAccountID;
+	if (FindAccount(UserPubKey, nAccountID))
+		return nAccountID;
+
+	CBalanceLedgerRecord record;
+	nAccountID = vAccountTrader.size();
+	record.vOp.push_back(CBalanceLedgerOp(LEDGER_NEW_ACCOUNT, 0, nAccountID));
+	record.vOp.back().nUserPubKey = UserPubKey;
+	if (!Commit(record))
+		return LEDGER_ACCOUNT_NONE;
+	return nAccountID;
+}
+
+const CBalanceLedger::CCoinColumns* CBalanceLedger::FindColumns(int CoinID, uint32_t nAccountID) const
+{
+	auto it = mapCoinColumns.find(CoinID);
+	if (it == mapCoinColumns.end() || nAccountID >= it->second.vExists.size() || !it->second.vExists[nAccountID])
+		return NULL;
+	return &it->second;
+}
+
+bool CBalanceLedger::ApplyOp(const CBalanceLedgerOp& op)
+{
+	if (op.nType == LEDGER_NEW_ACCOUNT)
+	{
+		uint32_t TraderID = traderRegistry.GetTraderID(op.nUserPubKey);
+		if (TraderID == TRADER_ID_NONE || op.nAccountID != vAccountTrader.size())
+			return false;
+		if (TraderID >= vTraderAccount.size())
+			vTraderAccount.resize(TraderID + 1, LEDGER_ACCOUNT_NONE);
+		else if (vTraderAccount[TraderID] != LEDGER_ACCOUNT_NONE)
+			return false;
+		vTraderAccount[TraderID] = op.nAccountID;
+		vAccountTrader.push_back(TraderID);
+		return true;
+	}
+
+	if (op.nAccountID >= vAccountTrader.size())
+		return false;
+
+	CCoinColumns& columns = mapCoinColumns[op.nCoinID];
+	columns.Resize(vAccountTrader.size());
+	uint32_t id = op.nAccountID;
+	if (op.nType == LEDGER_ADJUST_BALANCE)
+	{
+		if (op.vValue.size() % 2)
+			return false;
+		for (size_t i = 0; i < op.vValue.size(); i += 2)
+		{
+			if (op.vValue[i] < 0 || op.vValue[i] >= BALANCE_COLUMN_COUNT)
+				return false;
+			columns.vBalance[op.vValue[i]][id] += op.vValue[i + 1];
+		}
+	}
+	else if (op.nType == LEDGER_SET_BALANCE)
+	{
+		if (op.vValue.size() != SET_BALANCE_VALUE_COUNT)
+			return false;
+		for (int i = 0; i < BALANCE_COLUMN_COUNT; i++)
+			columns.vBalance[i][id] = op.vValue[i];
+		columns.vLastDepositID[id] = op.vValue[BALANCE_COLUMN_COUNT];
+		columns.vLastWithdrawID[id] = op.vValue[BALANCE_COLUMN_COUNT + 1];
+		columns.vLastActualTradeID[id] = op.vValue[BALANCE_COLUMN_COUNT + 2];
+		columns.vLastUserTradeID[id] = op.vValue[BALANCE_COLUMN_COUNT + 3];
+		columns.vLastUpdateTime[id] = op.vValue[BALANCE_COLUMN_COUNT + 4];
+	}
+	else
+		return false;
+
+	columns.vExists[id] = 1;
+	return true;
+}
+
+//same checks as ApplyOp without changing anything, nAccountCount counts the accounts added by earlier ops of the record
+bool CBalanceLedger::CheckOp(const CBalanceLedgerOp& op, size_t& nAccountCount) const
+{
+	if (op.nType == LEDGER_NEW_ACCOUNT)
+	{
+		if (op.nUserPubKey.empty() || op.nAccountID != nAccountCount)
+			return false;
+		uint32_t TraderID = traderRegistry.FindTraderID(op.nUserPubKey);
+		if (TraderID != TRADER_ID_NONE && TraderID < vTraderAccount.size() && vTraderAccount[TraderID] != LEDGER_ACCOUNT_NONE)
+			return false;
+		++nAccountCount;
+		return true;
+	}
+
+	if (op.nAccountID >= nAccountCount)
+		return false;
+
+	if (op.nType == LEDGER_ADJUST_BALANCE)
+	{
+		if (op.vValue.size() % 2)
+			return false;
+		for (size_t i = 0; i < op.vValue.size(); i += 2)
+		{
+			if (op.vValue[i] < 0 || op.vValue[i] >= BALANCE_COLUMN_COUNT)
+				return false;
+		}
+		return true;
+	}
+	return op.nType == LEDGER_SET_BALANCE && op.vValue.size() == SET_BALANCE_VALUE_COUNT;
+}
+
+bool CBalanceLedger::Commit(CBalanceLedgerRecord& record)
+{
+	//a logged record has to replay, so one that would not apply is refused before it is written
+	size_t nAccountCount = vAccountTrader.size();
+	for (size_t i = 0; i < record.vOp.size(); i++)
+	{
+		if (!CheckOp(record.vOp[i], nAccountCount))
+		{
+			LogPrintf("CBalanceLedger::Commit -- refusing record with invalid operation %d\n", i);
+			return false;
+		}
+	}
+
+	record.nSequence = nSequence + 1;
+	if (fileLog && !WriteRecord(record))
+		return false;
+	nSequence = record.nSequence;
+
+	for (size_t i = 0; i < record.vOp.size(); i++)
+	{
+		if (!ApplyOp(record.vOp[i]))
+			LogPrintf("CBalanceLedger::Commit -- operation %d of record %d failed after the check\n", i, record.nSequence);
+	}
+
+	if (fileLog && nSequence - nSnapshotSequence >= nSnapshotInterval)
+		WriteSnapshot();
+	return true;
+}
+
+//size, record and a 32 bit checksum of the record, synced to disk before the record is applied
+bool CBalanceLedger::WriteRecord(const CBalanceLedgerRecord& record)
+{
+	CDataStream ss(SER_DISK, CLIENT_VERSION);
+	ss << record;
+
+	unsigned char buf[4];
+	WriteLE32(buf, ss.size());
+	std::vector<char> vData(buf, buf + 4);
+	vData.insert(vData.end(), ss.begin(), ss.end());
+	WriteLE32(buf, (uint32_t)Hash(ss.begin(), ss.end()).GetCheapHash());
+	vData.insert(vData.end(), buf, buf + 4);
+
+	if (fwrite(&vData[0], 1, vData.size(), fileLog) != vData.size() || fflush(fileLog) != 0)
+	{
+		LogPrintf("CBalanceLedger::WriteRecord -- write to %s failed\n", pathDir.string());
+		return false;
+	}
+	//the balance change is acknowledged once Commit returns, it has to survive a power loss
+	FileCommit(fileLog);
+	return true;
+}
+
+//applies the log records written after the snapshot, a torn or corrupted tail is cut off
+bool CBalanceLedger::ReplayLog()
+{
+	boost::filesystem::path pathLog = pathDir / "balances.log";
+	if (!boost::filesystem::exists(pathLog))
+		return true;
+
+	std::vector<char> vData(boost::filesystem::file_size(pathLog));
+	FILE* file = fopen(pathLog.string().c_str(), "rb");
+	if (!file)
+		return false;
+	bool fRead = vData.empty() || fread(&vData[0], 1, vData.size(), file) == vData.size();
+	fclose(file);
+	if (!fRead)
+		return false;
+
+	size_t nOffset = 0;
+	int nReplayed = 0;
+	while (nOffset + 8 <= vData.size())
+	{
+		const char* pBegin = &vData[nOffset];
+		uint32_t nSize = ReadLE32((const unsigned char*)pBegin);
+		if (nSize > BALANCE_LEDGER_MAX_RECORD_SIZE || nOffset + 8 + nSize > vData.size())
+			break;
+		if (ReadLE32((const unsigned char*)(pBegin + 4 + nSize)) != (uint32_t)Hash(pBegin + 4, pBegin + 4 + nSize).GetCheapHash())
+			break;
+
+		CBalanceLedgerRecord record;
+		try {
+			CDataStream ss(pBegin + 4, pBegin + 4 + nSize, SER_DISK, CLIENT_VERSION);
+			ss >> record;
+		} catch (const std::exception& e) {
+			break;
+		}
+
+		//records already in the snapshot are left when a crash hits between snapshot and log reset
+		if (record.nSequence > nSequence)
+		{
+			for (size_t i = 0; i < record.vOp.size(); i++)
+			{
+				if (!ApplyOp(record.vOp[i]))
+					LogPrintf("CBalanceLedger::ReplayLog -- invalid operation in record %d\n", record.nSequence);
+			}
+			nSequence = record.nSequence;
+			++nReplayed;
+		}
+		nOffset += 8 + nSize;
+	}
+
+	if (nOffset < vData.size())
+	{
+		LogPrintf("CBalanceLedger::ReplayLog -- truncating %s from %u to %u bytes\n", pathLog.string(), vData.size(), nOffset);
+		boost::filesystem::resize_file(pathLog, nOffset);
+	}
+	LogPrint("infinidex", "CBalanceLedger::ReplayLog -- replayed %d records\n", nReplayed);
+	return true;
+}
+
+bool CBalanceLedger::ReadSnapshot()
+{
+	boost::filesystem::path pathSnapshot = pathDir / "balances.dat";
+	if (!boost::filesystem::exists(pathSnapshot))
+		return true;
+
+	CAutoFile filein(fopen(pathSnapshot.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+	if (filein.IsNull())
+		return false;
+
+	uint64_t nFileSize = boost::filesystem::file_size(pathSnapshot);
+	if (nFileSize < sizeof(uint256))
+		return false;
+	std::vector<unsigned char> vData(nFileSize - sizeof(uint256));
+	uint256 hashIn;
+	std::vector<std::string> vPubKey;
+	try {
+		filein.read((char*)&vData[0], vData.size());
+		filein >> hashIn;
+		if (hashIn != Hash(vData.begin(), vData.end()))
+		{
+			LogPrintf("CBalanceLedger::ReadSnapshot -- checksum mismatch in %s\n", pathSnapshot.string());
+			return false;
+		}
+
+		CDataStream ss(vData, SER_DISK, CLIENT_VERSION);
+		ss >> nSequence >> vPubKey >> mapCoinColumns;
+	} catch (const std::exception& e) {
+		LogPrintf("CBalanceLedger::ReadSnapshot -- unable to read %s: %s\n", pathSnapshot.string(), e.what());
+		return false;
+	}
+
+	for (size_t i = 0; i < vPubKey.size(); i++)
+	{
+		CBalanceLedgerOp op(LEDGER_NEW_ACCOUNT, 0, i);
+		op.nUserPubKey = vPubKey[i];
+		if (!ApplyOp(op))
+		{
+			LogPrintf("CBalanceLedger::ReadSnapshot -- invalid account %u in %s\n", i, pathSnapshot.string());
+			return false;
+		}
+	}
+	for (auto& it : mapCoinColumns)
+		it.second.Resize(vAccountTrader.size());
+	nSnapshotSequence = nSequence;
+	return true;
+}
+
+//writes the whole ledger to a new snapshot and starts the log over
+bool CBalanceLedger::WriteSnapshot()
+{
+	std::vector<std::string> vPubKey;
+	vPubKey.reserve(vAccountTrader.size());
+	for (size_t i = 0; i < vAccountTrader.size(); i++)
+		vPubKey.push_back(traderRegistry.GetPubKey(vAccountTrader[i]));
+
+	CDataStream ss(SER_DISK, CLIENT_VERSION);
+	ss << nSequence << vPubKey << mapCoinColumns;
+	uint256 hash = Hash(ss.begin(), ss.end());
+	ss << hash;
+
+	boost::filesystem::path pathSnapshot = pathDir / "balances.dat";
+	boost::filesystem::path pathTemp = pathDir / "balances.dat.new";
+	{
+		CAutoFile fileout(fopen(pathTemp.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+		if (fileout.IsNull())
+			return false;
+		fileout.write(&ss[0], ss.size());
+		FileCommit(fileout.Get());
+	}
+	if (!RenameOver(pathTemp, pathSnapshot))
+		return false;
+	nSnapshotSequence = nSequence;
+
+	if (fileLog)
+		fclose(fileLog);
+	fileLog = fopen((pathDir / "balances.log").string().c_str(), "wb");
+	LogPrint("infinidex", "CBalanceLedger::WriteSnapshot -- %u accounts, sequence %d\n", vAccountTrader.size(), nSequence);
+	return fileLog != NULL;
+}
+
+bool CBalanceLedger::Open(const boost::filesystem::path& path, uint64_t nSnapshotIntervalIn)
+{
+	LOCK(cs);
+	if (fileLog)
+		return true;
+
+	pathDir = path;
+	nSnapshotInterval = nSnapshotIntervalIn;
+	try {
+		boost::filesystem::create_directories(pathDir);
+		if (!ReadSnapshot() || !ReplayLog())
+		{
+			LogPrintf("CBalanceLedger::Open -- unable to load balances from %s\n", pathDir.string());
+			return false;
+		}
+	} catch (const std::exception& e) {
+		LogPrintf("CBalanceLedger::Open -- unable to open %s: %s\n", pathDir.string(), e.what());
+		return false;
+	}
+
+	fileLog = fopen((pathDir / "balances.log").string().c_str(), "ab");
+	if (!fileLog)
+		return false;
+	LogPrintf("CBalanceLedger::Open -- %u accounts, %u coins, sequence %d\n", vAccountTrader.size(), mapCoinColumns.size(), nSequence);
+	return true;
+}
+
+void CBalanceLedger::Close()
+{
+	LOCK(cs);
+	if (fileLog && nSequence != nSnapshotSequence)
+		WriteSnapshot();
+	if (fileLog)
+	{
+		FileCommit(fileLog);
+		fclose(fileLog);
+		fileLog = NULL;
+	}
+	vAccountTrader.clear();
+	vTraderAccount.clear();
+	mapCoinColumns.clear();
+	nSequence = 0;
+	nSnapshotSequence = 0;
+}
+
+void CBalanceLedger::Flush()
+{
+	LOCK(cs);
+	if (fileLog)
+		FileCommit(fileLog);
+}
+
+bool CBalanceLedger::Snapshot()
+{
+	LOCK(cs);
+	if (!fileLog)
+		return false;
+	return WriteSnapshot();
+}
+
+void CBalanceLedger::InitCoin(int CoinID)
+{
+	LOCK(cs);
+	mapCoinColumns[CoinID];
+}
+
+bool CBalanceLedger::IsCoinExist(int CoinID) const
+{
+	LOCK(cs);
+	return mapCoinColumns.count(CoinID);
+}
+
+bool CBalanceLedger::IsBalanceExist(int CoinID, const std::string& UserPubKey) const
+{
+	LOCK(cs);
+	uint32_t nAccountID;
+	return FindAccount(UserPubKey, nAccountID) && FindColumns(CoinID, nAccountID);
+}
+
+size_t CBalanceLedger::GetAccountCount() const
+{
+	LOCK(cs);
+	return vAccountTrader.size();
+}
+
+size_t CBalanceLedger::DynamicMemoryUsage() const
+{
+	LOCK(cs);
+	size_t nUsage = memusage::DynamicUsage(vAccountTrader) + memusage::DynamicUsage(vTraderAccount);
+	for (auto& it : mapCoinColumns)
+		nUsage += memusage::MallocUsage(sizeof(CCoinColumns) + 4 * sizeof(void*)) + it.second.DynamicMemoryUsage();
+	return nUsage;
+}
+
+int64_t CBalanceLedger::GetBalance(int CoinID, const std::string& UserPubKey, int nColumn) const
+{
+	LOCK(cs);
+	uint32_t nAccountID;
+	if (nColumn < 0 || nColumn >= BALANCE_COLUMN_COUNT || !FindAccount(UserPubKey, nAccountID))
+		return 0;
+
+	const CCoinColumns* columns = FindColumns(CoinID, nAccountID);
+	return columns ? columns->vBalance[nColumn][nAccountID] : 0;
+}
+
+int CBalanceLedger::GetLastDepositID(int CoinID, const std::string& UserPubKey) const
+{
+	LOCK(cs);
+	uint32_t nAccountID;
+	if (!FindAccount(UserPubKey, nAccountID))
+		return 0;
+
+	const CCoinColumns* columns = FindColumns(CoinID, nAccountID);
+	return columns ? columns->vLastDepositID[nAccountID] : 0;
+}
+
+bool CBalanceLedger::GetUserBalance(int CoinID, const std::string& UserPubKey, CUserBalance& UserBalance) const
+{
+	LOCK(cs);
+	uint32_t nAccountID;
+	if (!FindAccount(UserPubKey, nAccountID))
+		return false;
+
+	const CCoinColumns* columns = FindColumns(CoinID, nAccountID);
+	if (!columns)
+		return false;
+
+	UserBalance = CUserBalance(UserPubKey, CoinID);
+	UserBalance.nAvailableBalance = columns->vBalance[BALANCE_AVAILABLE][nAccountID];
+	UserBalance.nInExchangeBalance = columns->vBalance[BALANCE_IN_EXCHANGE][nAccountID];
+	UserBalance.nInDisputeBalance = columns->vBalance[BALANCE_IN_DISPUTE][nAccountID];
+	UserBalance.nPendingDepositBalance = columns->vBalance[BALANCE_PENDING_DEPOSIT][nAccountID];
+	UserBalance.nPendingWithdrawalBalance = columns->vBalance[BALANCE_PENDING_WITHDRAWAL][nAccountID];
+	UserBalance.nTotalBalance = UserBalance.nAvailableBalance + UserBalance.nInExchangeBalance + UserBalance.nInDisputeBalance;
+	UserBalance.nLastDepositID = columns->vLastDepositID[nAccountID];
+	UserBalance.nLastWithdrawID = columns->vLastWithdrawID[nAccountID];
+	UserBalance.nLastActualTradeID = columns->vLastActualTradeID[nAccountID];
+	UserBalance.nLastUserTradeID = columns->vLastUserTradeID[nAccountID];
+	UserBalance.nLastUpdateTime = columns->vLastUpdateTime[nAccountID];
+	return true;
+}
+
+bool CBalanceLedger::OpenBalance(int CoinID, const std::string& UserPubKey)
+{
+	LOCK(cs);
+	uint32_t nAccountID = InternAccount(UserPubKey);
+	if (FindColumns(CoinID, nAccountID))
+		return true;
+
+	//an adjustment without changes only opens the balance
+	CBalanceLedgerRecord record;
+	record.vOp.push_back(CBalanceLedgerOp(LEDGER_ADJUST_BALANCE, CoinID, nAccountID));
+	return Commit(record);
+}
+
+bool CBalanceLedger::Adjust(const std::vector<CBalanceChange>& vChange)
+{
+	LOCK(cs);
+	CBalanceLedgerRecord record;
+	for (size_t i = 0; i < vChange.size(); i++)
+	{
+		const CBalanceChange& change = vChange[i];
+		if (change.nColumn < 0 || change.nColumn >= BALANCE_COLUMN_COUNT)
+			return false;
+
+		CBalanceLedgerOp op(LEDGER_ADJUST_BALANCE, change.nCoinID, InternAccount(change.nUserPubKey));
+		op.vValue.push_back(change.nColumn);
+		op.vValue.push_back(change.nAmount);
+		record.vOp.push_back(op);
+	}
+	return Commit(record);
+}
+
+bool CBalanceLedger::Adjust(int CoinID, const std::string& UserPubKey, int nColumn, int64_t nAmount)
+{
+	return Adjust(std::vector<CBalanceChange>(1, CBalanceChange(CoinID, UserPubKey, nColumn, nAmount)));
+}
+
+bool CBalanceLedger::Move(int CoinID, const std::string& UserPubKey, int nFromColumn, int64_t nFromAmount, int nToColumn, int64_t nToAmount, bool fCheck)
+{
+	LOCK(cs);
+	if (fCheck && GetBalance(CoinID, UserPubKey, nFromColumn) < nFromAmount)
+		return false;
+
+	std::vector<CBalanceChange> vChange;
+	vChange.push_back(CBalanceChange(CoinID, UserPubKey, nFromColumn, 0 - nFromAmount));
+	vChange.push_back(CBalanceChange(CoinID, UserPubKey, nToColumn, nToAmount));
+	return Adjust(vChange);
+}
+
+bool CBalanceLedger::SetUserBalance(const CUserBalance& UserBalance)
+{
+	LOCK(cs);
+	CBalanceLedgerRecord record;
+	record.vOp.push_back(CBalanceLedgerOp(LEDGER_SET_BALANCE, UserBalance.nCoinID, InternAccount(UserBalance.nUserPubKey)));
+	std::vector<int64_t>& vValue = record.vOp.back().vValue;
+	vValue.push_back(UserBalance.nAvailableBalance);
+	vValue.push_back(UserBalance.nInExchangeBalance);
+	vValue.push_back(UserBalance.nInDisputeBalance);
+	vValue.push_back(UserBalance.nPendingDepositBalance);
+	vValue.push_back(UserBalance.nPendingWithdrawalBalance);
+	vValue.push_back(UserBalance.nLastDepositID);
+	vValue.push_back(UserBalance.nLastWithdrawID);
+	vValue.push_back(UserBalance.nLastActualTradeID);
+	vValue.push_back(UserBalance.nLastUserTradeID);
+	vValue.push_back(UserBalance.nLastUpdateTime);
+	return Commit(record);
+}
@@ -0,0 +1,206 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BALANCELEDGER_H
+#define BALANCELEDGER_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "serialize.h"
+#include "sync.h"
+
+#include <boost/filesystem/path.hpp>
+
+class CBalanceChange;
+class CBalanceLedger;
+class CBalanceLedgerOp;
+class CBalanceLedgerRecord;
+class CUserBalance;
+
+extern CBalanceLedger balanceLedger;
+
+static const uint64_t DEFAULT_BALANCE_LEDGER_SNAPSHOT_INTERVAL = 100000; //log records between snapshots
+static const unsigned int BALANCE_LEDGER_MAX_RECORD_SIZE = 1024 * 1024;
+static const uint32_t LEDGER_ACCOUNT_NONE = 0xFFFFFFFF;
+
+enum balance_column_enum_t {
+	BALANCE_AVAILABLE = 0,
+	BALANCE_IN_EXCHANGE = 1,
+	BALANCE_IN_DISPUTE = 2,
+	BALANCE_PENDING_DEPOSIT = 3,
+	BALANCE_PENDING_WITHDRAWAL = 4,
+	BALANCE_COLUMN_COUNT = 5
+};
+
+enum balance_ledger_op_enum_t {
+	LEDGER_NEW_ACCOUNT = 0,
+	LEDGER_ADJUST_BALANCE = 1,
+	LEDGER_SET_BALANCE = 2
+};
+
+//one balance change of a ledger update, applied together with the others of the same update
+class CBalanceChange
+{
+public:
+	int nCoinID;
+	std::string nUserPubKey;
+	int nColumn;
+	int64_t nAmount;
+
+	CBalanceChange(int nCoinID, const std::string& nUserPubKey, int nColumn, int64_t nAmount) :
+		nCoinID(nCoinID),
+		nUserPubKey(nUserPubKey),
+		nColumn(nColumn),
+		nAmount(nAmount)
+	{}
+};
+
+class CBalanceLedgerOp
+{
+public:
+	unsigned char nType;
+	int nCoinID;
+	uint32_t nAccountID;
+	std::vector<int64_t> vValue; //column and amount pairs to adjust, or the full row to set
+	std::string nUserPubKey; //new accounts only
+
+	CBalanceLedgerOp(unsigned char nType, int nCoinID, uint32_t nAccountID) :
+		nType(nType),
+		nCoinID(nCoinID),
+		nAccountID(nAccountID)
+	{}
+
+	CBalanceLedgerOp() :
+		nType(0),
+		nCoinID(0),
+		nAccountID(0)
+	{}
+
+	ADD_SERIALIZE_METHODS;
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+		READWRITE(this->nType);
+		READWRITE(nCoinID);
+		READWRITE(nAccountID);
+		READWRITE(vValue);
+		if (this->nType == LEDGER_NEW_ACCOUNT)
+			READWRITE(nUserPubKey);
+	}
+};
+
+//unit of the write-ahead log, applied as a whole or not at all
+class CBalanceLedgerRecord
+{
+public:
+	uint64_t nSequence;
+	std::vector<CBalanceLedgerOp> vOp;
+
+	CBalanceLedgerRecord() : nSequence(0) {}
+
+	ADD_SERIALIZE_METHODS;
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+		READWRITE(nSequence);
+		READWRITE(vOp);
+	}
+};
+
+/**
+ * User balances of every coin, stored by column.
+ *
+ * Accounts get dense account IDs through the trader registry, and each coin keeps one
+ * array per balance field indexed by account ID, so a balance costs a few words instead of
+ * two map nodes and a shared object per account and coin. Every update is checked, written
+ * to a write-ahead log and synced to disk before it is applied; every nSnapshotInterval
+ * records the whole ledger is written to a snapshot and the log starts over. Opening the
+ * ledger loads the snapshot and replays the log records written after it.
+ *
+ * Without Open the ledger is kept in memory only.
+ */
+class CBalanceLedger
+{
+private:
+	struct CCoinColumns
+	{
+		std::vector<unsigned char> vExists;
+		std::vector<int64_t> vBalance[BALANCE_COLUMN_COUNT];
+		std::vector<int> vLastDepositID;
+		std::vector<int> vLastWithdrawID;
+		std::vector<int> vLastActualTradeID;
+		std::vector<int> vLastUserTradeID;
+		std::vector<uint64_t> vLastUpdateTime;
+
+		void Resize(size_t nSize);
+		size_t DynamicMemoryUsage() const;
+
+		ADD_SERIALIZE_METHODS;
+		template <typename Stream, typename Operation>
+		inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+			READWRITE(vExists);
+			for (int i = 0; i < BALANCE_COLUMN_COUNT; i++)
+				READWRITE(vBalance[i]);
+			READWRITE(vLastDepositID);
+			READWRITE(vLastWithdrawID);
+			READWRITE(vLastActualTradeID);
+			READWRITE(vLastUserTradeID);
+			READWRITE(vLastUpdateTime);
+		}
+	};
+
+	std::vector<uint32_t> vAccountTrader; //trader ID by account ID
+	std::vector<uint32_t> vTraderAccount; //account ID by trader ID, LEDGER_ACCOUNT_NONE if none
+	std::map<int, CCoinColumns> mapCoinColumns;
+	boost::filesystem::path pathDir;
+	FILE* fileLog;
+	uint64_t nSequence;
+	uint64_t nSnapshotSequence;
+	uint64_t nSnapshotInterval;
+
+	bool FindAccount(const std::string& UserPubKey, uint32_t& nAccountID) const;
+	uint32_t InternAccount(const std::string& UserPubKey);
+	const CCoinColumns* FindColumns(int CoinID, uint32_t nAccountID) const;
+	bool CheckOp(const CBalanceLedgerOp& op, size_t& nAccountCount) const;
+	bool ApplyOp(const CBalanceLedgerOp& op);
+	bool Commit(CBalanceLedgerRecord& record);
+	bool WriteRecord(const CBalanceLedgerRecord& record);
+	bool ReplayLog();
+	bool ReadSnapshot();
+	bool WriteSnapshot();
+
+public:
+	mutable CCriticalSection cs;
+
+	CBalanceLedger() :
+		fileLog(NULL),
+		nSequence(0),
+		nSnapshotSequence(0),
+		nSnapshotInterval(DEFAULT_BALANCE_LEDGER_SNAPSHOT_INTERVAL)
+	{}
+
+	~CBalanceLedger() { Close(); }
+
+	bool Open(const boost::filesystem::path& path, uint64_t nSnapshotIntervalIn = DEFAULT_BALANCE_LEDGER_SNAPSHOT_INTERVAL);
+	void Close();
+	void Flush();
+	bool Snapshot();
+
+	void InitCoin(int CoinID);
+	bool IsCoinExist(int CoinID) const;
+	bool IsBalanceExist(int CoinID, const std::string& UserPubKey) const;
+	size_t GetAccountCount() const;
+	size_t DynamicMemoryUsage() const;
+	int64_t GetBalance(int CoinID, const std::string& UserPubKey, int nColumn) const;
+	int GetLastDepositID(int CoinID, const std::string& UserPubKey) const;
+	bool GetUserBalance(int CoinID, const std::string& UserPubKey, CUserBalance& UserBalance) const;
+
+	bool OpenBalance(int CoinID, const std::string& UserPubKey);
+	bool Adjust(const std::vector<CBalanceChange>& vChange);
+	bool Adjust(int CoinID, const std::string& UserPubKey, int nColumn, int64_t nAmount);
+	//moves between two columns of one balance, fails when fCheck is set and the source is short
+	bool Move(int CoinID, const std::string& UserPubKey, int nFromColumn, int64_t nFromAmount, int nToColumn, int64_t nToAmount, bool fCheck);
+	bool SetUserBalance(const CUserBalance& UserBalance);
+};
+
+#endif
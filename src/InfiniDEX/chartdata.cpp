@@ -6,23 +6,30 @@
 #include "messagesigner.h"
 #include "timedata.h"
 #include "chartdata.h"
+#include "dexverifier.h"
 #include "tradepair.h"
 #include <boost/lexical_cast.hpp>
 
+#include <algorithm>
+
 class CChartData;
+class CChartDataSeries;
 class CChartDataManager;
 
-std::map<int, mapPeriodTimeData> mapChartData;
+std::map<int, CChartDataSeries> mapChartData;
 std::map<int, CChartDataSetting> mapChartDataSetting;
 CChartDataManager ChartDataManager;
 
 bool CChartDataManager::IsInChargeOfChartData(int TradePairID)
 {
-	return mapChartDataSetting[TradePairID].IsInChargeOfChartData;
+	LOCK(cs);
+	std::map<int, CChartDataSetting>::const_iterator it = mapChartDataSetting.find(TradePairID);
+	return it != mapChartDataSetting.end() && it->second.IsInChargeOfChartData;
 }
 
 bool CChartDataManager::IsTradePairInList(int TradePairID)
 {
+	LOCK(cs);
 	return mapChartData.count(TradePairID);
 }
 
@@ -31,149 +38,148 @@ bool CChartDataManager::InitTradePair(int TradePairID)
 	if (!tradePairManager.IsValidTradePairID(TradePairID))
 		return false;
 
+	LOCK(cs);
 	if (!IsTradePairInList(TradePairID))
-	{
-		mapPeriodTimeData init;
-		init.insert(std::make_pair(MINUTE_CHART_DATA, mapTimeData()));
-		init.insert(std::make_pair(HOUR_CHART_DATA, mapTimeData()));
-		init.insert(std::make_pair(DAY_CHART_DATA, mapTimeData()));
-		mapChartData.insert(std::make_pair(TradePairID, init));
-		return true;
-	}
-	if (!mapChartData[TradePairID].count(MINUTE_CHART_DATA))
-	{
-		mapChartData[TradePairID].insert(std::make_pair(MINUTE_CHART_DATA, mapTimeData()));
-	}
-	if (!mapChartData[TradePairID].count(HOUR_CHART_DATA))
-	{
-		mapChartData[TradePairID].insert(std::make_pair(HOUR_CHART_DATA, mapTimeData()));
-	}
-	if (!mapChartData[TradePairID].count(DAY_CHART_DATA))
-	{
-		mapChartData[TradePairID].insert(std::make_pair(DAY_CHART_DATA, mapTimeData()));
-	}
+		mapChartData.insert(std::make_pair(TradePairID, CChartDataSeries(TradePairID)));
 	return true;
 }
 
 void CChartDataManager::InputNewTrade(int TradePairID, uint64_t Price, uint64_t Qty, uint64_t TradeTime)
 {
+	LOCK(cs);
 	if (!IsTradePairInList(TradePairID))
 	{
 		//check if current node is assigned to process
 		//if true
-		InitTradePair(TradePairID);
+		if (!InitTradePair(TradePairID))
+			return;
 	}
 
-	//process minute range
-	auto& a = mapChartData[TradePairID][MINUTE_CHART_DATA];
-	mapTimeData::reverse_iterator ri = a.rbegin();
-	if (ri == a.rend())
-	{
-		int TimeRoundDown = TradeTime % 60000;
-		uint64_t newMinuteStart = TradeTime - TimeRoundDown;
-		uint64_t newMinuteEnd = newMinuteStart + 60000;
-		TimeRange tr = std::make_pair(newMinuteStart, newMinuteEnd);
-		CChartData cd(TradePairID, newMinuteStart, newMinuteEnd, Price, Price, Price, Price, Price * Qty, Qty, 1, GetAdjustedTime(), MNPubKey);
-		a.insert(std::make_pair(tr, cd));
-	}
-	else
+	mapChartData[TradePairID].InputNewTrade(Price, Qty, TradeTime, GetAdjustedTime());
+}
+
+bool CChartDataManager::GetLastChartData(int TradePairID, chart_period_enum Period, CChartData& chartData)
+{
+	LOCK(cs);
+	if (!IsTradePairInList(TradePairID))
+		return false;
+
+	return mapChartData[TradePairID].GetLastChartData(Period, chartData);
+}
+
+size_t CChartDataManager::GetChartData(int TradePairID, chart_period_enum Period, uint64_t FromTime, uint64_t ToTime, std::vector<CChartData>& vChartData)
+{
+	LOCK(cs);
+	if (!IsTradePairInList(TradePairID))
+		return 0;
+
+	return mapChartData[TradePairID].GetChartData(Period, FromTime, ToTime, vChartData);
+}
+
+CChartDataSeries::CChartDataSeries(int nTradePairID) :
+	nTradePairID(nTradePairID)
+{
+	for (int i = 0; i < CHART_PERIOD_COUNT; i++)
 	{
-		uint64_t lastMinuteEnd = ri->first.second;
-		if (lastMinuteEnd >= TradeTime)
-		{
-			++ri->second.nNoOfTrades;
-			ri->second.nQty += Qty;
-			ri->second.nAmount += (Qty * Price);
-			ri->second.nClosePrice = Price;
-			if (Price > ri->second.nHighPrice)
-				ri->second.nHighPrice = Price;
-			else if (Price < ri->second.nLowPrice || ri->second.nLowPrice == 0)
-				ri->second.nLowPrice = Price;
-			ri->second.nLastUpdate = GetAdjustedTime();
-		}
-		else
-		{
-			uint64_t newMinuteStart = lastMinuteEnd + 1;
-			uint64_t newMinuteEnd = lastMinuteEnd + 60000;
-			TimeRange tr = std::make_pair(newMinuteStart, newMinuteEnd);
-			CChartData cd(TradePairID, newMinuteStart, newMinuteEnd, Price, Price, Price, Price, Price * Qty, Qty, 1, GetAdjustedTime(), MNPubKey);
-			a.insert(std::make_pair(tr, cd));
-		}
+		vCandles[i].resize(vChartPeriods[i].nRetention);
+		nLastStartTime[i] = 0;
 	}
+}
+
+CChartDataSeries::CChartDataSeries() :
+	CChartDataSeries(0)
+{}
 
-	//process hour range
-	auto& b = mapChartData[TradePairID][HOUR_CHART_DATA];
-	mapTimeData::reverse_iterator ri2 = b.rbegin();
-	if (ri2 == b.rend())
+int CChartDataSeries::GetPeriodIndex(chart_period_enum Period)
+{
+	for (int i = 0; i < CHART_PERIOD_COUNT; i++)
 	{
-		int TimeRoundDown = TradeTime % 3600000;
-		uint64_t newHourStart = TradeTime - TimeRoundDown;
-		uint64_t newHourEnd = newHourStart + 3600000;
-		TimeRange tr = std::make_pair(newHourStart, newHourEnd);
-		CChartData cd(TradePairID, newHourStart, newHourEnd, Price, Price, Price, Price, Price * Qty, Qty, 1, GetAdjustedTime(), MNPubKey);
-		b.insert(std::make_pair(tr, cd));
+		if (vChartPeriods[i].nPeriod == Period)
+			return i;
 	}
-	else
+	return -1;
+}
+
+void CChartDataSeries::InputNewTrade(uint64_t Price, uint64_t Qty, uint64_t TradeTime, uint64_t UpdateTime)
+{
+	for (int i = 0; i < CHART_PERIOD_COUNT; i++)
 	{
-		uint64_t lastHourEnd = ri2->first.second;
-		if (lastHourEnd >= TradeTime)
-		{
-			++ri2->second.nNoOfTrades;
-			ri2->second.nQty += Qty;
-			ri2->second.nAmount += (Qty * Price);
-			ri2->second.nClosePrice = Price;
-			if (Price > ri2->second.nHighPrice)
-				ri2->second.nHighPrice = Price;
-			else if (Price < ri2->second.nLowPrice || ri->second.nLowPrice == 0)
-				ri2->second.nLowPrice = Price;
-			ri->second.nLastUpdate = GetAdjustedTime();
-		}
-		else
+		const CChartPeriodInfo& info = vChartPeriods[i];
+		uint64_t StartTime = TradeTime - (TradeTime % info.nLength);
+		if (nLastStartTime[i] >= (uint64_t)info.nRetention * info.nLength && StartTime <= nLastStartTime[i] - (uint64_t)info.nRetention * info.nLength)
+			continue; //already dropped out of the ring
+
+		CChartCandle& candle = vCandles[i][(StartTime / info.nLength) % info.nRetention];
+		if (candle.nNoOfTrades == 0 || candle.nStartTime != StartTime)
 		{
-			uint64_t newHourStart = lastHourEnd + 1;
-			uint64_t newHourEnd = newHourStart + 3600000;
-			TimeRange tr = std::make_pair(newHourStart, newHourEnd);
-			CChartData cd(TradePairID, newHourStart, newHourEnd, Price, Price, Price, Price, Price * Qty, Qty, 1, GetAdjustedTime(), MNPubKey);
-			b.insert(std::make_pair(tr, cd));
+			candle = CChartCandle();
+			candle.nStartTime = StartTime;
+			candle.nOpenPrice = Price;
+			candle.nHighPrice = Price;
+			candle.nLowPrice = Price;
 		}
-	}
+		else if (Price > candle.nHighPrice)
+			candle.nHighPrice = Price;
+		else if (Price < candle.nLowPrice)
+			candle.nLowPrice = Price;
 
-	//process day range
-	auto& c = mapChartData[TradePairID][DAY_CHART_DATA];
-	mapTimeData::reverse_iterator ri3 = c.rbegin();
-	if (ri3 == c.rend())
-	{
-		int TimeRoundDown = TradeTime % 86400000;
-		uint64_t newDayStart = TradeTime - TimeRoundDown;
-		uint64_t newDayEnd = newDayStart + 86400000;
-		TimeRange tr = std::make_pair(newDayStart, newDayEnd);
-		CChartData cd(TradePairID, newDayStart, newDayEnd, Price, Price, Price, Price, Price * Qty, Qty, 1, GetAdjustedTime(), MNPubKey);
-		c.insert(std::make_pair(tr, cd));
+		candle.nClosePrice = Price;
+		candle.nAmount += Price * Qty;
+		candle.nQty += Qty;
+		++candle.nNoOfTrades;
+		candle.nLastUpdate = UpdateTime;
+		if (StartTime > nLastStartTime[i])
+			nLastStartTime[i] = StartTime;
 	}
-	else
+}
+
+void CChartDataSeries::FillChartData(int PeriodIndex, const CChartCandle& candle, CChartData& chartData) const
+{
+	chartData = CChartData(nTradePairID, candle.nStartTime, candle.nStartTime + vChartPeriods[PeriodIndex].nLength, candle.nOpenPrice, candle.nHighPrice,
+		candle.nLowPrice, candle.nClosePrice, candle.nAmount, candle.nQty, candle.nNoOfTrades, candle.nLastUpdate, MNPubKey);
+}
+
+bool CChartDataSeries::GetLastChartData(chart_period_enum Period, CChartData& chartData) const
+{
+	int i = GetPeriodIndex(Period);
+	if (i < 0)
+		return false;
+
+	const CChartPeriodInfo& info = vChartPeriods[i];
+	const CChartCandle& candle = vCandles[i][(nLastStartTime[i] / info.nLength) % info.nRetention];
+	if (candle.nNoOfTrades == 0)
+		return false;
+
+	FillChartData(i, candle, chartData);
+	return true;
+}
+
+//appends the candles with trades covering [FromTime, ToTime], oldest first
+size_t CChartDataSeries::GetChartData(chart_period_enum Period, uint64_t FromTime, uint64_t ToTime, std::vector<CChartData>& vChartData) const
+{
+	int i = GetPeriodIndex(Period);
+	if (i < 0 || FromTime > ToTime)
+		return 0;
+
+	const CChartPeriodInfo& info = vChartPeriods[i];
+	uint64_t nOldestStartTime = 0;
+	if (nLastStartTime[i] >= (uint64_t)(info.nRetention - 1) * info.nLength)
+		nOldestStartTime = nLastStartTime[i] - (uint64_t)(info.nRetention - 1) * info.nLength;
+
+	uint64_t StartTime = std::max(FromTime - (FromTime % info.nLength), nOldestStartTime);
+	uint64_t EndTime = std::min(ToTime, nLastStartTime[i]);
+	size_t nCount = 0;
+	for (; StartTime <= EndTime; StartTime += info.nLength)
 	{
-		uint64_t lastDayEnd = ri3->first.second;
-		if (lastDayEnd >= TradeTime)
-		{
-			++ri3->second.nNoOfTrades;
-			ri3->second.nQty += Qty;
-			ri3->second.nAmount += (Qty * Price);
-			ri3->second.nClosePrice = Price;
-			if (Price > ri3->second.nHighPrice)
-				ri3->second.nHighPrice = Price;
-			else if (Price < ri3->second.nLowPrice || ri->second.nLowPrice == 0)
-				ri3->second.nLowPrice = Price;
-			ri->second.nLastUpdate = GetAdjustedTime();
-		}
-		else
-		{
-			uint64_t newDayStart = lastDayEnd + 1;
-			uint64_t newDayEnd = newDayStart + 86400000;
-			TimeRange tr = std::make_pair(newDayStart, newDayEnd);
-			CChartData cd(TradePairID, newDayStart, newDayEnd, Price, Price, Price, Price, Price * Qty, Qty, 1, GetAdjustedTime(), MNPubKey);
-			c.insert(std::make_pair(tr, cd));
-		}
+		const CChartCandle& candle = vCandles[i][(StartTime / info.nLength) % info.nRetention];
+		if (candle.nNoOfTrades == 0 || candle.nStartTime != StartTime)
+			continue;
+
+		vChartData.push_back(CChartData());
+		FillChartData(i, candle, vChartData.back());
+		++nCount;
 	}
+	return nCount;
 }
 
 bool CChartData::VerifySignature()
@@ -184,7 +190,7 @@ bool CChartData::VerifySignature()
 		+ boost::lexical_cast<std::string>(nClosePrice) + boost::lexical_cast<std::string>(nAmount) + boost::lexical_cast<std::string>(nQty)
 		+ boost::lexical_cast<std::string>(nNoOfTrades) + boost::lexical_cast<std::string>(nLastUpdate) + nMNPubKey;
 	CPubKey pubkey(ParseHex(nMNPubKey));
-	if (!CMessageSigner::VerifyMessage(pubkey, vchSig, strMessage, strError)) {
+	if (!dexVerifier.VerifyMessage(pubkey, vchSig, strMessage, strError)) {
 		LogPrintf("CChartData::VerifySignature -- VerifyMessage() failed, error: %s\n", strError);
 		return false;
 	}
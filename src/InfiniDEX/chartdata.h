@@ -10,22 +10,45 @@
 #include <map>
 #include "hash.h"
 #include "net.h"
+#include "sync.h"
 #include "utilstrencodings.h"
 
 class CChartData;
+class CChartCandle;
+class CChartDataSeries;
 class CChartDataManager;
 class CChartDataSetting;
 
 enum chart_period_enum {
 	MINUTE_CHART_DATA = 1,
 	HOUR_CHART_DATA = 2,
-	DAY_CHART_DATA = 3
+	DAY_CHART_DATA = 3,
+	FIVE_MINUTE_CHART_DATA = 4,
+	FIFTEEN_MINUTE_CHART_DATA = 5,
+	FOUR_HOUR_CHART_DATA = 6
 };
 
-typedef std::pair<uint64_t, uint64_t> TimeRange;
-typedef std::map<TimeRange, CChartData> mapTimeData;
-typedef std::map<chart_period_enum, mapTimeData> mapPeriodTimeData;
-extern std::map<int, mapPeriodTimeData> mapChartData;
+static const int CHART_PERIOD_COUNT = 6;
+
+struct CChartPeriodInfo
+{
+	chart_period_enum nPeriod;
+	uint64_t nLength; //seconds, like the trade times
+	uint32_t nRetention; //number of candles kept
+};
+
+//finest to coarsest, retention covers 1 day, 1 week, 1 month, 3 months, 1 year and 5 years
+static const CChartPeriodInfo vChartPeriods[CHART_PERIOD_COUNT] = {
+	{ MINUTE_CHART_DATA, 60, 1440 },
+	{ FIVE_MINUTE_CHART_DATA, 300, 2016 },
+	{ FIFTEEN_MINUTE_CHART_DATA, 900, 2880 },
+	{ HOUR_CHART_DATA, 3600, 2160 },
+	{ FOUR_HOUR_CHART_DATA, 14400, 2190 },
+	{ DAY_CHART_DATA, 86400, 1825 }
+};
+
+//written by the pair workers, read by RPC and the market overview, guarded by ChartDataManager.cs
+extern std::map<int, CChartDataSeries> mapChartData;
 extern std::map<int, CChartDataSetting> mapChartDataSetting;
 extern CChartDataManager ChartDataManager;
 
@@ -101,14 +124,74 @@ public:
 	bool Sign();
 };
 
+//one candle slot of a ring buffer, nNoOfTrades is 0 for a slot not used yet
+class CChartCandle
+{
+public:
+	uint64_t nStartTime;
+	uint64_t nOpenPrice;
+	uint64_t nHighPrice;
+	uint64_t nLowPrice;
+	uint64_t nClosePrice;
+	uint64_t nAmount;
+	uint64_t nQty;
+	uint64_t nNoOfTrades;
+	uint64_t nLastUpdate;
+
+	CChartCandle() :
+		nStartTime(0),
+		nOpenPrice(0),
+		nHighPrice(0),
+		nLowPrice(0),
+		nClosePrice(0),
+		nAmount(0),
+		nQty(0),
+		nNoOfTrades(0),
+		nLastUpdate(0)
+	{}
+};
+
+/**
+ * Candles of one trade pair for every chart period.
+ *
+ * Each period keeps a fixed number of candles in a ring buffer indexed by the candle
+ * start time, so a trade updates every period in constant time and the memory used
+ * per pair never grows. A trade older than the retention of a period is ignored for
+ * that period.
+ */
+class CChartDataSeries
+{
+private:
+	std::vector<CChartCandle> vCandles[CHART_PERIOD_COUNT];
+	uint64_t nLastStartTime[CHART_PERIOD_COUNT];
+
+	static int GetPeriodIndex(chart_period_enum Period);
+	void FillChartData(int PeriodIndex, const CChartCandle& candle, CChartData& chartData) const;
+
+public:
+	int nTradePairID;
+
+	CChartDataSeries(int nTradePairID);
+	CChartDataSeries();
+
+	void InputNewTrade(uint64_t Price, uint64_t Qty, uint64_t TradeTime, uint64_t UpdateTime);
+	bool GetLastChartData(chart_period_enum Period, CChartData& chartData) const;
+	size_t GetChartData(chart_period_enum Period, uint64_t FromTime, uint64_t ToTime, std::vector<CChartData>& vChartData) const;
+};
+
 class CChartDataManager
 {
 public:
+	//protects mapChartData and mapChartDataSetting
+	CCriticalSection cs;
+
 	CChartDataManager() {}
 	bool IsInChargeOfChartData(int TradePairID);
 	bool IsTradePairInList(int TradePairID);
 	bool InitTradePair(int TradePairID);
 	void InputNewTrade(int TradePairID, uint64_t Price, uint64_t Qty, uint64_t TradeTime);
+	bool GetLastChartData(int TradePairID, chart_period_enum Period, CChartData& chartData);
+	size_t GetChartData(int TradePairID, chart_period_enum Period, uint64_t FromTime, uint64_t ToTime, std::vector<CChartData>& vChartData);
 };
 
 class CChartDataSetting 
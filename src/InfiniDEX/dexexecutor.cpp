@@ -0,0 +1,135 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "dexexecutor.h"
+#include "tinyformat.h"
+#include "util.h"
+
+class CDEXWorker;
+class CDEXExecutor;
+
+CDEXExecutor dexExecutor;
+
+void CDEXWorker::ThreadWorker(std::string strName)
+{
+	RenameThread(strName.c_str());
+
+	std::function<void()> task;
+	while (true)
+	{
+		if (queue.Pop(task))
+		{
+			try {
+				task();
+			} catch (const std::exception& e) {
+				PrintExceptionContinue(&e, strName.c_str());
+			} catch (...) {
+				PrintExceptionContinue(NULL, strName.c_str());
+			}
+			task = nullptr;
+			continue;
+		}
+
+		//queue drained, stop here so tasks posted before Stop are not lost
+		if (fInterrupt)
+			break;
+
+		//a producer only notifies after seeing fSleeping, so it has to be set before
+		//the queue is checked for the last time
+		std::unique_lock<std::mutex> lock(mutex);
+		fSleeping = true;
+		if (queue.Empty() && !fInterrupt)
+			cond.wait(lock);
+		fSleeping = false;
+	}
+}
+
+void CDEXWorker::Start(const std::string& strName)
+{
+	fInterrupt = false;
+	thread = std::thread(&CDEXWorker::ThreadWorker, this, strName);
+}
+
+void CDEXWorker::Post(std::function<void()> task)
+{
+	queue.Push(std::move(task));
+	if (fSleeping)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		cond.notify_one();
+	}
+}
+
+void CDEXWorker::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		fInterrupt = true;
+		cond.notify_one();
+	}
+	if (thread.joinable())
+		thread.join();
+}
+
+void CDEXExecutor::Start(int nPairThreads)
+{
+	if (fRunning)
+		return;
+
+	if (nPairThreads <= 0)
+		nPairThreads += GetNumCores();
+	if (nPairThreads < 1)
+		nPairThreads = 1;
+	else if (nPairThreads > MAX_DEX_THREADS)
+		nPairThreads = MAX_DEX_THREADS;
+
+	for (int i = 0; i < nPairThreads; i++)
+	{
+		vPairWorkers.emplace_back(new CDEXWorker());
+		vPairWorkers.back()->Start(strprintf("infinex-dex%d", i));
+	}
+	userWorker.reset(new CDEXWorker());
+	userWorker->Start("infinex-dexuser");
+
+	LogPrintf("CDEXExecutor::Start -- %d trade pair threads\n", nPairThreads);
+	fRunning = true;
+}
+
+void CDEXExecutor::Stop()
+{
+	if (!fRunning)
+		return;
+
+	//pair tasks hand work over to the user worker, so drain them first
+	for (size_t i = 0; i < vPairWorkers.size(); i++)
+		vPairWorkers[i]->Stop();
+	userWorker->Stop();
+	fRunning = false;
+
+	vPairWorkers.clear();
+	userWorker.reset();
+}
+
+void CDEXExecutor::PostTradePairTask(int TradePairID, std::function<void()> task)
+{
+	if (!fRunning)
+	{
+		task();
+		return;
+	}
+
+	unsigned int nIndex = (unsigned int)TradePairID % vPairWorkers.size();
+	vPairWorkers[nIndex]->Post(std::move(task));
+}
+
+void CDEXExecutor::PostUserTask(std::function<void()> task)
+{
+	if (!fRunning)
+	{
+		task();
+		return;
+	}
+
+	userWorker->Post(std::move(task));
+}
@@ -0,0 +1,150 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DEXEXECUTOR_H
+#define DEXEXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CDEXWorker;
+class CDEXExecutor;
+
+extern CDEXExecutor dexExecutor;
+
+static const int DEFAULT_DEX_THREADS = 0;
+static const int MAX_DEX_THREADS = 16;
+
+/**
+ * Unbounded multi-producer single-consumer queue.
+ *
+ * Producers link a new node with one atomic exchange on the head, the single consumer
+ * walks the tail without any lock. A pop may miss an element whose producer has not
+ * finished linking it yet, the consumer simply sees it on the next pop.
+ */
+template <typename T>
+class CMPSCQueue
+{
+private:
+	struct CNode
+	{
+		std::atomic<CNode*> next;
+		T value;
+
+		CNode() : next(nullptr) {}
+		CNode(T&& valueIn) : next(nullptr), value(std::move(valueIn)) {}
+	};
+
+	std::atomic<CNode*> head; //last pushed node, shared by producers
+	CNode* tail; //consumed stub node, owned by the consumer
+
+public:
+	CMPSCQueue() :
+		head(new CNode()),
+		tail(head.load())
+	{}
+
+	~CMPSCQueue()
+	{
+		while (tail)
+		{
+			CNode* next = tail->next.load();
+			delete tail;
+			tail = next;
+		}
+	}
+
+	CMPSCQueue(const CMPSCQueue&) = delete;
+	CMPSCQueue& operator=(const CMPSCQueue&) = delete;
+
+	void Push(T value)
+	{
+		CNode* node = new CNode(std::move(value));
+		CNode* prev = head.exchange(node, std::memory_order_acq_rel);
+		prev->next.store(node);
+	}
+
+	//consumer only
+	bool Pop(T& value)
+	{
+		CNode* next = tail->next.load();
+		if (!next)
+			return false;
+		value = std::move(next->value);
+		delete tail;
+		tail = next;
+		return true;
+	}
+
+	//consumer only
+	bool Empty() const
+	{
+		return tail->next.load() == nullptr;
+	}
+};
+
+/** One execution thread draining its own task queue in submission order. */
+class CDEXWorker
+{
+private:
+	CMPSCQueue<std::function<void()>> queue;
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::atomic<bool> fSleeping;
+	std::atomic<bool> fInterrupt;
+	std::thread thread;
+
+	void ThreadWorker(std::string strName);
+
+public:
+	CDEXWorker() :
+		fSleeping(false),
+		fInterrupt(false)
+	{}
+
+	void Start(const std::string& strName);
+	void Post(std::function<void()> task);
+	void Stop();
+};
+
+/**
+ * Executes InfiniDEX work outside of the message handler thread.
+ *
+ * Every trade pair is owned by exactly one pair worker (pair ID modulo the number of
+ * workers), which alone touches that pair's user trade book, trade setting (role flags
+ * included) and actual trades, so pairs on different workers are matched in parallel
+ * without locks; only adding a pair to the per pair maps takes cs_mapTradePair. State
+ * keyed by user rather than by pair (balances, submitted user trades, trade history)
+ * is owned by a single user worker; pair workers hand balance changes caused by a
+ * trade over to it instead of touching them directly.
+ *
+ * Tasks posted before Start or after Stop run synchronously in the caller.
+ */
+class CDEXExecutor
+{
+private:
+	std::vector<std::unique_ptr<CDEXWorker>> vPairWorkers;
+	std::unique_ptr<CDEXWorker> userWorker;
+	std::atomic<bool> fRunning;
+
+public:
+	CDEXExecutor() :
+		fRunning(false)
+	{}
+
+	void Start(int nPairThreads);
+	void Stop();
+	bool IsRunning() const { return fRunning; }
+	int GetPairThreadCount() const { return vPairWorkers.size(); }
+	void PostTradePairTask(int TradePairID, std::function<void()> task);
+	void PostUserTask(std::function<void()> task);
+};
+
+#endif
@@ -0,0 +1,224 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "dexverifier.h"
+#include "hash.h"
+#include "messagesigner.h"
+#include "random.h"
+#include "tinyformat.h"
+#include "util.h"
+
+class CDEXVerifier;
+
+CDEXVerifier dexVerifier;
+
+CDEXVerifier::CDEXVerifier() :
+	nUnstarted(0),
+	fDelivering(false),
+	fInterrupt(false),
+	fRunning(false),
+	nMaxCacheSize(DEFAULT_DEX_SIGCACHE_SIZE),
+	nCacheHits(0),
+	nCacheMisses(0)
+{
+	GetRandBytes(nonce.begin(), 32);
+}
+
+void CDEXVerifier::ThreadVerify(int nThread)
+{
+	std::string strName = strprintf("infinex-dexverify%d", nThread);
+	RenameThread(strName.c_str());
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		while (nUnstarted == 0 && !fInterrupt)
+			cond.wait(lock);
+		if (nUnstarted == 0)
+			break;
+
+		//jobs are started in submission order, the unstarted ones are at the back
+		std::shared_ptr<CJob> job = vJob[vJob.size() - nUnstarted];
+		job->fStarted = true;
+		--nUnstarted;
+		lock.unlock();
+
+		bool fValid = false;
+		try {
+			fValid = job->verify();
+		} catch (const std::exception& e) {
+			PrintExceptionContinue(&e, strName.c_str());
+		} catch (...) {
+			PrintExceptionContinue(NULL, strName.c_str());
+		}
+
+		lock.lock();
+		job->fValid = fValid;
+		job->fDone = true;
+		DeliverDone(lock);
+	}
+}
+
+//delivers the finished jobs at the front, only one thread delivers at a time to keep the order
+void CDEXVerifier::DeliverDone(std::unique_lock<std::mutex>& lock)
+{
+	if (fDelivering)
+		return;
+
+	fDelivering = true;
+	while (!vJob.empty() && vJob.front()->fDone)
+	{
+		std::shared_ptr<CJob> job = vJob.front();
+		vJob.pop_front();
+		auto it = mapPeerJobs.find(job->nodeid);
+		if (it != mapPeerJobs.end() && --it->second == 0)
+			mapPeerJobs.erase(it);
+		lock.unlock();
+		try {
+			job->deliver(job->fValid);
+		} catch (const std::exception& e) {
+			PrintExceptionContinue(&e, "CDEXVerifier::DeliverDone");
+		} catch (...) {
+			PrintExceptionContinue(NULL, "CDEXVerifier::DeliverDone");
+		}
+		lock.lock();
+	}
+	fDelivering = false;
+}
+
+void CDEXVerifier::Start(int nThreads, size_t nMaxCacheSizeIn)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (fRunning)
+		return;
+
+	if (nThreads <= 0)
+		nThreads += GetNumCores();
+	if (nThreads < 1)
+		nThreads = 1;
+	else if (nThreads > MAX_DEX_VERIFY_THREADS)
+		nThreads = MAX_DEX_VERIFY_THREADS;
+
+	{
+		std::lock_guard<std::mutex> lockCache(mutexCache);
+		nMaxCacheSize = nMaxCacheSizeIn;
+	}
+	fInterrupt = false;
+	for (int i = 0; i < nThreads; i++)
+		vThread.push_back(std::thread(&CDEXVerifier::ThreadVerify, this, i));
+
+	LogPrintf("CDEXVerifier::Start -- %d signature verification threads\n", nThreads);
+	fRunning = true;
+}
+
+void CDEXVerifier::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!fRunning)
+			return;
+		fInterrupt = true;
+		cond.notify_all();
+	}
+
+	//submitted jobs are still verified and delivered before the threads exit
+	for (size_t i = 0; i < vThread.size(); i++)
+		vThread[i].join();
+	vThread.clear();
+
+	LogPrint("infinidex", "CDEXVerifier::Stop -- signature cache hits %d, misses %d\n", nCacheHits, nCacheMisses);
+	std::lock_guard<std::mutex> lock(mutex);
+	fRunning = false;
+}
+
+//false when the queue or the peer's share of it is full, the message is then dropped
+bool CDEXVerifier::Submit(NodeId nodeid, std::function<bool()> verify, std::function<void(bool)> deliver)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (fRunning && !fInterrupt)
+		{
+			size_t& nPeerJobs = mapPeerJobs[nodeid];
+			if (vJob.size() >= MAX_DEX_VERIFY_QUEUE || nPeerJobs >= MAX_DEX_VERIFY_QUEUE_PER_PEER)
+			{
+				if (nPeerJobs == 0)
+					mapPeerJobs.erase(nodeid);
+				return false;
+			}
+
+			std::shared_ptr<CJob> job = std::make_shared<CJob>();
+			job->verify = std::move(verify);
+			job->deliver = std::move(deliver);
+			job->nodeid = nodeid;
+			vJob.push_back(job);
+			++nPeerJobs;
+			++nUnstarted;
+			cond.notify_one();
+			return true;
+		}
+	}
+
+	deliver(verify());
+	return true;
+}
+
+bool CDEXVerifier::IsVerified(const uint256& entry)
+{
+	std::lock_guard<std::mutex> lock(mutexCache);
+	if (!setVerified.count(entry))
+	{
+		++nCacheMisses;
+		return false;
+	}
+	++nCacheHits;
+	return true;
+}
+
+void CDEXVerifier::AddVerified(const uint256& entry)
+{
+	std::lock_guard<std::mutex> lock(mutexCache);
+	if (nMaxCacheSize == 0 || !setVerified.insert(entry).second)
+		return;
+
+	vVerifiedOrder.push_back(entry);
+	while (vVerifiedOrder.size() > nMaxCacheSize)
+	{
+		setVerified.erase(vVerifiedOrder.front());
+		vVerifiedOrder.pop_front();
+	}
+}
+
+//the signature is part of the entry, a different signature for a known message is verified again
+uint256 CDEXVerifier::ComputeEntry(unsigned char chType, const uint256& hash, const CPubKey& pubkey, const std::vector<unsigned char>& vchSig) const
+{
+	CHashWriter ss(SER_GETHASH, 0);
+	ss << nonce << chType << hash << pubkey << vchSig;
+	return ss.GetHash();
+}
+
+bool CDEXVerifier::VerifyMessage(const CPubKey& pubkey, const std::vector<unsigned char>& vchSig, const std::string& strMessage, std::string& strErrorRet)
+{
+	CHashWriter ss(SER_GETHASH, 0);
+	ss << strMessage;
+	uint256 entry = ComputeEntry('m', ss.GetHash(), pubkey, vchSig);
+	if (IsVerified(entry))
+		return true;
+
+	if (!CMessageSigner::VerifyMessage(pubkey, vchSig, strMessage, strErrorRet))
+		return false;
+	AddVerified(entry);
+	return true;
+}
+
+bool CDEXVerifier::VerifyHash(const uint256& hash, const CPubKey& pubkey, const std::vector<unsigned char>& vchSig, std::string& strErrorRet)
+{
+	uint256 entry = ComputeEntry('h', hash, pubkey, vchSig);
+	if (IsVerified(entry))
+		return true;
+
+	if (!CHashSigner::VerifyHash(hash, pubkey, vchSig, strErrorRet))
+		return false;
+	AddVerified(entry);
+	return true;
+}
@@ -0,0 +1,116 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DEXVERIFIER_H
+#define DEXVERIFIER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "net.h"
+#include "uint256.h"
+
+class CDEXVerifier;
+class CPubKey;
+
+extern CDEXVerifier dexVerifier;
+
+static const int DEFAULT_DEX_VERIFY_THREADS = 0;
+static const int MAX_DEX_VERIFY_THREADS = 16;
+static const size_t DEFAULT_DEX_SIGCACHE_SIZE = 100000; //verified signatures kept
+static const size_t MAX_DEX_VERIFY_QUEUE = 20000; //jobs waiting for verification or delivery
+static const size_t MAX_DEX_VERIFY_QUEUE_PER_PEER = 2000;
+
+/**
+ * Signature verification stage in front of the InfiniDEX managers.
+ *
+ * Messages are submitted with a verification function and a delivery function. The
+ * verification functions run in parallel on a pool of threads, the delivery functions
+ * run one at a time in submission order, each as soon as its own and all earlier
+ * verifications are done, so managers see verified messages in arrival order. The
+ * delivery only hands the message over (usually to the DEX executor) and should not
+ * do more.
+ *
+ * The queue is bounded in total and per sending peer. A message that does not fit is
+ * dropped and Submit returns false, so a flooding peer loses its own messages instead
+ * of delaying everyone else's.
+ *
+ * Verified signatures are remembered, so the same message checked again, e.g. by a
+ * manager or after a relay, does not cost another signature verification. Masternode
+ * pings and governance votes use the same cache, their handlers verify the signature
+ * before taking cs_main and the check repeated under the lock is a lookup. Cache
+ * entries are salted with a per process nonce, so peers cannot predict where their
+ * entries land.
+ *
+ * Messages submitted while the pool is not running are verified and delivered in the
+ * caller.
+ */
+class CDEXVerifier
+{
+private:
+	struct CJob
+	{
+		std::function<bool()> verify;
+		std::function<void(bool)> deliver;
+		NodeId nodeid;
+		bool fStarted;
+		bool fDone;
+		bool fValid;
+
+		CJob() : nodeid(-1), fStarted(false), fDone(false), fValid(false) {}
+	};
+
+	struct CSignatureHasher
+	{
+		size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
+	};
+
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::deque<std::shared_ptr<CJob>> vJob; //submission order, delivered jobs are popped
+	std::map<NodeId, size_t> mapPeerJobs; //jobs in vJob by sending peer
+	size_t nUnstarted;
+	bool fDelivering;
+	bool fInterrupt;
+	std::vector<std::thread> vThread;
+	std::atomic<bool> fRunning;
+
+	std::mutex mutexCache;
+	uint256 nonce; //salts the cache entries
+	std::unordered_set<uint256, CSignatureHasher> setVerified;
+	std::deque<uint256> vVerifiedOrder; //eviction order
+	size_t nMaxCacheSize;
+	std::atomic<uint64_t> nCacheHits;
+	std::atomic<uint64_t> nCacheMisses;
+
+	void ThreadVerify(int nThread);
+	void DeliverDone(std::unique_lock<std::mutex>& lock);
+	uint256 ComputeEntry(unsigned char chType, const uint256& hash, const CPubKey& pubkey, const std::vector<unsigned char>& vchSig) const;
+	bool IsVerified(const uint256& entry);
+	void AddVerified(const uint256& entry);
+
+public:
+	CDEXVerifier();
+
+	void Start(int nThreads, size_t nMaxCacheSizeIn = DEFAULT_DEX_SIGCACHE_SIZE);
+	void Stop();
+	bool IsRunning() const { return fRunning; }
+	bool Submit(NodeId nodeid, std::function<bool()> verify, std::function<void(bool)> deliver);
+
+	//cached versions of CMessageSigner::VerifyMessage and CHashSigner::VerifyHash
+	bool VerifyMessage(const CPubKey& pubkey, const std::vector<unsigned char>& vchSig, const std::string& strMessage, std::string& strErrorRet);
+	bool VerifyHash(const uint256& hash, const CPubKey& pubkey, const std::vector<unsigned char>& vchSig, std::string& strErrorRet);
+	uint64_t GetCacheHits() const { return nCacheHits; }
+	uint64_t GetCacheMisses() const { return nCacheMisses; }
+};
+
+#endif
@@ -0,0 +1,350 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "activemasternode.h"
+#include "dexverifier.h"
+#include "marketoverview.h"
+#include "masternodeman.h"
+#include "messagesigner.h"
+#include "net_processing.h"
+#include "timedata.h"
+#include "userconnection.h"
+#include "util.h"
+#include "validation.h"
+
+#include <algorithm>
+
+class CMarketTickerWindow;
+class CMarketOverview;
+class CMarketOverviewManager;
+
+CMarketOverviewManager marketOverviewManager;
+
+int64_t CMarketTicker::GetChange() const
+{
+	if (nNoOfTrades == 0 || nOpenPrice == 0)
+		return 0;
+	return ((int64_t)nLastPrice - (int64_t)nOpenPrice) * 10000 / (int64_t)nOpenPrice;
+}
+
+CMarketTickerWindow::CMarketTickerWindow(int nTradePairID) :
+	nOldestStartTime(0),
+	nNewestStartTime(0),
+	nLastPrice(0),
+	nLastTradeTime(0),
+	nHighPrice(0),
+	nLowPrice(0),
+	nQty(0),
+	nAmount(0),
+	nNoOfTrades(0),
+	fRescanExtremes(false),
+	nTradePairID(nTradePairID)
+{
+	vBuckets.resize(MARKET_TICKER_BUCKETS);
+}
+
+CMarketTickerWindow::CMarketTickerWindow() :
+	CMarketTickerWindow(0)
+{}
+
+void CMarketTickerWindow::ExpireBucket(CMarketTickerBucket& bucket)
+{
+	nQty -= bucket.nQty;
+	nAmount -= bucket.nAmount;
+	nNoOfTrades -= bucket.nNoOfTrades;
+	if (bucket.nHighPrice >= nHighPrice || bucket.nLowPrice <= nLowPrice)
+		fRescanExtremes = true;
+	bucket = CMarketTickerBucket();
+}
+
+//every bucket left holds trades inside the window
+void CMarketTickerWindow::RescanExtremes()
+{
+	fRescanExtremes = false;
+	nHighPrice = 0;
+	nLowPrice = 0;
+	for (const CMarketTickerBucket& bucket : vBuckets)
+	{
+		if (bucket.nNoOfTrades == 0)
+			continue;
+		if (nHighPrice == 0 || bucket.nHighPrice > nHighPrice)
+			nHighPrice = bucket.nHighPrice;
+		if (nLowPrice == 0 || bucket.nLowPrice < nLowPrice)
+			nLowPrice = bucket.nLowPrice;
+	}
+}
+
+//moves the window to end at Time, returns true when trades aged out
+bool CMarketTickerWindow::Advance(uint64_t Time)
+{
+	uint64_t StartTime = Time - (Time % MARKET_TICKER_BUCKET_LENGTH);
+	if (StartTime > nNewestStartTime)
+		nNewestStartTime = StartTime;
+
+	uint64_t nWindowLength = (uint64_t)(MARKET_TICKER_BUCKETS - 1) * MARKET_TICKER_BUCKET_LENGTH;
+	uint64_t nCutoff = nNewestStartTime >= nWindowLength ? nNewestStartTime - nWindowLength : 0;
+	bool fExpired = false;
+	while (nNoOfTrades > 0 && nOldestStartTime < nCutoff)
+	{
+		CMarketTickerBucket& bucket = GetBucket(nOldestStartTime);
+		if (bucket.nNoOfTrades > 0 && bucket.nStartTime == nOldestStartTime)
+		{
+			ExpireBucket(bucket);
+			fExpired = true;
+		}
+		nOldestStartTime += MARKET_TICKER_BUCKET_LENGTH;
+	}
+
+	if (nNoOfTrades == 0)
+	{
+		nOldestStartTime = nCutoff;
+		return fExpired;
+	}
+
+	//keep the oldest bucket with trades at the front, its open price opens the window
+	while (GetBucket(nOldestStartTime).nNoOfTrades == 0)
+		nOldestStartTime += MARKET_TICKER_BUCKET_LENGTH;
+	return fExpired;
+}
+
+void CMarketTickerWindow::InputNewTrade(uint64_t Price, uint64_t Qty, uint64_t TradeTime)
+{
+	Advance(TradeTime);
+
+	uint64_t StartTime = TradeTime - (TradeTime % MARKET_TICKER_BUCKET_LENGTH);
+	uint64_t nWindowLength = (uint64_t)(MARKET_TICKER_BUCKETS - 1) * MARKET_TICKER_BUCKET_LENGTH;
+	if (nNewestStartTime >= nWindowLength && StartTime < nNewestStartTime - nWindowLength)
+		return; //already aged out of the window
+
+	CMarketTickerBucket& bucket = GetBucket(StartTime);
+	if (bucket.nNoOfTrades == 0)
+	{
+		bucket.nStartTime = StartTime;
+		bucket.nOpenPrice = Price;
+		bucket.nHighPrice = Price;
+		bucket.nLowPrice = Price;
+	}
+	else if (Price > bucket.nHighPrice)
+		bucket.nHighPrice = Price;
+	else if (Price < bucket.nLowPrice)
+		bucket.nLowPrice = Price;
+	bucket.nQty += Qty;
+	bucket.nAmount += Price * Qty;
+	++bucket.nNoOfTrades;
+
+	if (nNoOfTrades == 0)
+	{
+		nHighPrice = Price;
+		nLowPrice = Price;
+		nOldestStartTime = StartTime;
+	}
+	else
+	{
+		if (Price > nHighPrice)
+			nHighPrice = Price;
+		if (Price < nLowPrice)
+			nLowPrice = Price;
+		if (StartTime < nOldestStartTime)
+			nOldestStartTime = StartTime;
+	}
+	nQty += Qty;
+	nAmount += Price * Qty;
+	++nNoOfTrades;
+
+	if (TradeTime >= nLastTradeTime)
+	{
+		nLastPrice = Price;
+		nLastTradeTime = TradeTime;
+	}
+}
+
+//the last price is kept after the window ran empty
+void CMarketTickerWindow::GetTicker(CMarketTicker& ticker)
+{
+	if (fRescanExtremes)
+		RescanExtremes();
+
+	ticker = CMarketTicker();
+	ticker.nTradePairID = nTradePairID;
+	ticker.nLastPrice = nLastPrice;
+	ticker.nLastTradeTime = nLastTradeTime;
+	if (nNoOfTrades == 0)
+		return;
+
+	ticker.nOpenPrice = GetBucket(nOldestStartTime).nOpenPrice;
+	ticker.nHighPrice = nHighPrice;
+	ticker.nLowPrice = nLowPrice;
+	ticker.nQty = nQty;
+	ticker.nAmount = nAmount;
+	ticker.nNoOfTrades = nNoOfTrades;
+}
+
+uint256 CMarketOverview::GetSignatureHash() const
+{
+	CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+	ss << nLastUpdateTime << vTickers << nMNPubKey;
+	return ss.GetHash();
+}
+
+bool CMarketOverview::VerifySignature()
+{
+	std::string strError = "";
+	CPubKey pubkey(ParseHex(nMNPubKey));
+	if (!dexVerifier.VerifyHash(GetSignatureHash(), pubkey, vchSig, strError)) {
+		LogPrintf("CMarketOverview::VerifySignature -- VerifyHash() failed, error: %s\n", strError);
+		return false;
+	}
+	return true;
+}
+
+bool CMarketOverview::Sign()
+{
+	std::string strError = "";
+	uint256 hash = GetSignatureHash();
+	if (!CHashSigner::SignHash(hash, activeMasternode.keyMasternode, vchSig)) {
+		LogPrintf("CMarketOverview::Sign -- SignHash() failed\n");
+		return false;
+	}
+	if (!CHashSigner::VerifyHash(hash, activeMasternode.pubKeyMasternode, vchSig, strError)) {
+		LogPrintf("CMarketOverview::Sign -- VerifyHash() failed, error: %s\n", strError);
+		return false;
+	}
+	return true;
+}
+
+void CMarketOverviewManager::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman)
+{
+	if (strCommand == NetMsgType::DEXMARKETOVERVIEW)
+	{
+		std::shared_ptr<CMarketOverview> overview = std::make_shared<CMarketOverview>();
+		vRecv >> *overview;
+
+		if (overview->vTickers.size() > MAX_MARKET_OVERVIEW_PAIRS) {
+			LogPrintf("CMarketOverviewManager::ProcessMessage -- malformed market overview, peer=%d\n", pfrom->id);
+			LOCK(cs_main);
+			Misbehaving(pfrom->GetId(), 20);
+			return;
+		}
+
+		//a timestamp from the future would hold back every later overview of the pairs
+		if ((int64_t)overview->nLastUpdateTime > GetAdjustedTime() + MAX_MARKET_OVERVIEW_FUTURE_SECONDS) {
+			LogPrint("infinidex", "CMarketOverviewManager::ProcessMessage -- market overview too far in the future, peer=%d\n", pfrom->id);
+			return;
+		}
+
+		//only masternodes publish overviews, our list may lag behind so this is not misbehaviour
+		masternode_info_t mnInfo;
+		if (!mnodeman.GetMasternodeInfo(CPubKey(ParseHex(overview->nMNPubKey)), mnInfo)) {
+			LogPrint("infinidex", "CMarketOverviewManager::ProcessMessage -- market overview from unknown masternode, peer=%d\n", pfrom->id);
+			return;
+		}
+
+		NodeId nodeid = pfrom->GetId();
+		if (!dexVerifier.Submit(nodeid, [overview]() { return overview->VerifySignature(); }, [overview, nodeid](bool fValid) {
+			if (!fValid) {
+				LogPrintf("CMarketOverviewManager::ProcessMessage -- invalid signature, peer=%d\n", nodeid);
+				LOCK(cs_main);
+				Misbehaving(nodeid, 100);
+				return;
+			}
+			marketOverviewManager.InputMarketOverview(*overview);
+		}))
+			LogPrint("infinidex", "CMarketOverviewManager::ProcessMessage -- verification queue full, dropping market overview, peer=%d\n", nodeid);
+	}
+}
+
+void CMarketOverviewManager::InputMarketOverview(const CMarketOverview& overview)
+{
+	LOCK(cs);
+	for (const CMarketTicker& ticker : overview.vTickers)
+	{
+		std::pair<uint64_t, CMarketTicker>& received = mapReceivedTicker[ticker.nTradePairID];
+		if (overview.nLastUpdateTime < received.first)
+			continue;
+		received.first = overview.nLastUpdateTime;
+		received.second = ticker;
+	}
+}
+
+void CMarketOverviewManager::InputNewTrade(int TradePairID, uint64_t Price, uint64_t Qty, uint64_t TradeTime)
+{
+	LOCK(cs);
+	if (!mapMarketTicker.count(TradePairID))
+		mapMarketTicker.insert(std::make_pair(TradePairID, CMarketTickerWindow(TradePairID)));
+
+	mapMarketTicker[TradePairID].InputNewTrade(Price, Qty, TradeTime);
+	fChanged = true;
+}
+
+//a pair this node keeps statistics for is answered from its own window
+bool CMarketOverviewManager::GetMarketTicker(int TradePairID, CMarketTicker& ticker)
+{
+	LOCK(cs);
+	if (mapMarketTicker.count(TradePairID))
+	{
+		CMarketTickerWindow& window = mapMarketTicker[TradePairID];
+		if (window.Advance(GetAdjustedTime()))
+			fChanged = true;
+		window.GetTicker(ticker);
+		return true;
+	}
+
+	if (!mapReceivedTicker.count(TradePairID))
+		return false;
+
+	ticker = mapReceivedTicker[TradePairID].second;
+	return true;
+}
+
+bool CMarketOverviewManager::GetMarketOverview(uint64_t Time, CMarketOverview& overview)
+{
+	LOCK(cs);
+	overview = CMarketOverview(Time, MNPubKey);
+	for (auto& it : mapMarketTicker)
+	{
+		if (it.second.Advance(Time))
+			fChanged = true;
+		overview.vTickers.push_back(CMarketTicker());
+		it.second.GetTicker(overview.vTickers.back());
+	}
+	return !overview.vTickers.empty();
+}
+
+//all pairs go out under one signature, and only when a trade came in or aged out since the last tick
+void CMarketOverviewManager::BroadcastMarketOverview(CConnman& connman)
+{
+	CMarketOverview overview;
+	{
+		LOCK(cs);
+		if (!GetMarketOverview(GetAdjustedTime(), overview) || !fChanged)
+			return;
+		fChanged = false;
+	}
+
+	if (!overview.Sign())
+		return;
+
+	CSerializedNetMsg msg = connman.MakeMessage(PROTOCOL_VERSION, NetMsgType::DEXMARKETOVERVIEW, overview);
+	connman.ForEachNode([&connman, &msg](CNode* pnode) {
+		connman.PushMessage(pnode, msg);
+	});
+}
+
+void ThreadMarketOverviewBroadcast(CConnman& connman)
+{
+	if (fLiteMode) return; // disable all Infinex specific functionality
+
+	static bool fOneThread;
+	if (fOneThread) return;
+	fOneThread = true;
+
+	RenameThread("infinex-dexoverview");
+
+	int64_t nTick = std::max<int64_t>(1, GetArg("-dexoverviewtick", DEFAULT_MARKET_OVERVIEW_TICK));
+	while (true)
+	{
+		MilliSleep(nTick);
+		marketOverviewManager.BroadcastMarketOverview(connman);
+	}
+}
@@ -0,0 +1,195 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MARKETOVERVIEW_H
+#define MARKETOVERVIEW_H
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include "hash.h"
+#include "net.h"
+#include "sync.h"
+#include "utilstrencodings.h"
+
+class CMarketTicker;
+class CMarketTickerBucket;
+class CMarketTickerWindow;
+class CMarketOverview;
+class CMarketOverviewManager;
+
+static const uint64_t MARKET_TICKER_BUCKET_LENGTH = 60; //seconds, the unit of CActualTrade::nTradeTime
+static const uint32_t MARKET_TICKER_BUCKETS = 1440; //24 hours of minute buckets
+static const int DEFAULT_MARKET_OVERVIEW_TICK = 1000; //milliseconds between market overview broadcasts
+static const unsigned int MAX_MARKET_OVERVIEW_PAIRS = 10000;
+static const int64_t MAX_MARKET_OVERVIEW_FUTURE_SECONDS = 60; //clock skew allowed for nLastUpdateTime
+
+extern CMarketOverviewManager marketOverviewManager;
+
+//rolling 24 hour statistics of one trade pair, nOpenPrice is the first trade price inside the window
+class CMarketTicker
+{
+public:
+	int nTradePairID;
+	uint64_t nLastPrice;
+	uint64_t nOpenPrice;
+	uint64_t nHighPrice;
+	uint64_t nLowPrice;
+	uint64_t nQty;
+	uint64_t nAmount;
+	uint64_t nNoOfTrades;
+	uint64_t nLastTradeTime;
+
+	CMarketTicker() :
+		nTradePairID(0),
+		nLastPrice(0),
+		nOpenPrice(0),
+		nHighPrice(0),
+		nLowPrice(0),
+		nQty(0),
+		nAmount(0),
+		nNoOfTrades(0),
+		nLastTradeTime(0)
+	{}
+
+	ADD_SERIALIZE_METHODS;
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+		READWRITE(nTradePairID);
+		READWRITE(nLastPrice);
+		READWRITE(nOpenPrice);
+		READWRITE(nHighPrice);
+		READWRITE(nLowPrice);
+		READWRITE(nQty);
+		READWRITE(nAmount);
+		READWRITE(nNoOfTrades);
+		READWRITE(nLastTradeTime);
+	}
+
+	int64_t GetChange() const; //basis points of nOpenPrice, 0 without trades in the window
+};
+
+//one minute of trades, nNoOfTrades is 0 for a slot not used yet or already expired
+class CMarketTickerBucket
+{
+public:
+	uint64_t nStartTime;
+	uint64_t nOpenPrice;
+	uint64_t nHighPrice;
+	uint64_t nLowPrice;
+	uint64_t nQty;
+	uint64_t nAmount;
+	uint64_t nNoOfTrades;
+
+	CMarketTickerBucket() :
+		nStartTime(0),
+		nOpenPrice(0),
+		nHighPrice(0),
+		nLowPrice(0),
+		nQty(0),
+		nAmount(0),
+		nNoOfTrades(0)
+	{}
+};
+
+/**
+ * 24 hour rolling statistics of one trade pair.
+ *
+ * Trades go into a ring of minute buckets and the window totals are kept as running
+ * sums, a bucket is subtracted again when it ages out. Each bucket is added and expired
+ * once, so keeping the ticker current costs O(1) amortized per trade instead of a scan
+ * of the trade history per request. The high and low are only rescanned over the ring
+ * after the bucket holding them expired.
+ */
+class CMarketTickerWindow
+{
+private:
+	std::vector<CMarketTickerBucket> vBuckets;
+	uint64_t nOldestStartTime; //oldest bucket that may still hold trades
+	uint64_t nNewestStartTime;
+	uint64_t nLastPrice;
+	uint64_t nLastTradeTime;
+	uint64_t nHighPrice;
+	uint64_t nLowPrice;
+	uint64_t nQty;
+	uint64_t nAmount;
+	uint64_t nNoOfTrades;
+	bool fRescanExtremes;
+
+	CMarketTickerBucket& GetBucket(uint64_t StartTime) { return vBuckets[(StartTime / MARKET_TICKER_BUCKET_LENGTH) % MARKET_TICKER_BUCKETS]; }
+	void ExpireBucket(CMarketTickerBucket& bucket);
+	void RescanExtremes();
+
+public:
+	int nTradePairID;
+
+	CMarketTickerWindow(int nTradePairID);
+	CMarketTickerWindow();
+
+	bool Advance(uint64_t Time);
+	void InputNewTrade(uint64_t Price, uint64_t Qty, uint64_t TradeTime);
+	void GetTicker(CMarketTicker& ticker);
+};
+
+/**
+ * Tickers of all trade pairs a node keeps chart data for, signed once per broadcast tick.
+ */
+class CMarketOverview
+{
+private:
+	std::vector<unsigned char> vchSig;
+
+public:
+	uint64_t nLastUpdateTime;
+	std::vector<CMarketTicker> vTickers;
+	std::string nMNPubKey;
+
+	CMarketOverview(uint64_t nLastUpdateTime, std::string nMNPubKey) :
+		nLastUpdateTime(nLastUpdateTime),
+		nMNPubKey(nMNPubKey)
+	{}
+
+	CMarketOverview() :
+		nLastUpdateTime(0),
+		nMNPubKey("")
+	{}
+
+	ADD_SERIALIZE_METHODS;
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+		READWRITE(nLastUpdateTime);
+		READWRITE(vTickers);
+		READWRITE(nMNPubKey);
+		READWRITE(vchSig);
+	}
+
+	uint256 GetSignatureHash() const;
+	bool VerifySignature();
+	bool Sign();
+};
+
+class CMarketOverviewManager
+{
+private:
+	//protects everything below
+	mutable CCriticalSection cs;
+	std::map<int, CMarketTickerWindow> mapMarketTicker; //pairs this node keeps statistics for
+	std::map<int, std::pair<uint64_t, CMarketTicker>> mapReceivedTicker; //update time and latest ticker of each pair from the network
+	bool fChanged; //a ticker changed since the last broadcast
+
+	void InputMarketOverview(const CMarketOverview& overview);
+
+public:
+	CMarketOverviewManager() : fChanged(false) {}
+
+	void ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman);
+	void InputNewTrade(int TradePairID, uint64_t Price, uint64_t Qty, uint64_t TradeTime);
+	bool GetMarketTicker(int TradePairID, CMarketTicker& ticker);
+	bool GetMarketOverview(uint64_t Time, CMarketOverview& overview);
+	void BroadcastMarketOverview(CConnman& connman);
+};
+
+void ThreadMarketOverviewBroadcast(CConnman& connman);
+
+#endif
@@ -3,12 +3,19 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "activemasternode.h"
+#include "activenoderole.h"
+#include "dexverifier.h"
 #include "messagesigner.h"
+#include "net_processing.h"
 #include "timedata.h"
 #include "orderbook.h"
+#include "trade.h"
+#include "util.h"
+#include "validation.h"
 #include <boost/lexical_cast.hpp>
 
 class COrderBook;
+class COrderBookDelta;
 class COrderBookManager;
 class COrderBookSetting;
 
@@ -16,13 +23,17 @@ std::map<int, PriceOrderBook> mapOrderBidBook;
 std::map<int, PriceOrderBook> mapOrderAskBook;
 COrderBookManager orderBookManager;
 
+COrderBookManager::COrderBookManager() :
+	nEpoch(GetTimeMicros())
+{}
+
 bool COrderBook::VerifySignature()
 {
 	std::string strError = "";
 	std::string strMessage = boost::lexical_cast<std::string>(nTradePairID) + boost::lexical_cast<std::string>(nIsBid) + boost::lexical_cast<std::string>(nPrice)
 		+ boost::lexical_cast<std::string>(nQty) + boost::lexical_cast<std::string>(nLastUpdateTime) + nMNPubKey;
 	CPubKey pubkey(ParseHex(nMNPubKey));
-	if (!CMessageSigner::VerifyMessage(pubkey, vchSig, strMessage, strError)) {
+	if (!dexVerifier.VerifyMessage(pubkey, vchSig, strMessage, strError)) {
 		LogPrintf("COrderBook::VerifySignature -- VerifyMessage() failed, error: %s\n", strError);
 		return false;
 	}
@@ -50,119 +61,397 @@ void COrderBook::Broadcast()
 
 }
 
-void COrderBookManager::AdjustBidQuantity(int TradePairID, uint64_t Price, int64_t Qty)
+uint256 COrderBookDelta::GetSignatureHash() const
 {
-	if (!mapOrderBidBook.count(TradePairID))
-	{
-		//need to sync with seed server or check node task
+	CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+	ss << nTradePairID << nIsBid << nIsSnapshot << nEpoch << nSequence << nLastUpdateTime << vLevels << nMNPubKey;
+	return ss.GetHash();
+}
+
+bool COrderBookDelta::VerifySignature()
+{
+	std::string strError = "";
+	CPubKey pubkey(ParseHex(nMNPubKey));
+	if (!dexVerifier.VerifyHash(GetSignatureHash(), pubkey, vchSig, strError)) {
+		LogPrintf("COrderBookDelta::VerifySignature -- VerifyHash() failed, error: %s\n", strError);
+		return false;
 	}
+	return true;
+}
 
-	auto& a = mapOrderBidBook[TradePairID];
-	if (!a.count(Price))
+bool COrderBookDelta::Sign()
+{
+	std::string strError = "";
+	uint256 hash = GetSignatureHash();
+	if (!CHashSigner::SignHash(hash, activeMasternode.keyMasternode, vchSig)) {
+		LogPrintf("COrderBookDelta::Sign -- SignHash() failed\n");
+		return false;
+	}
+	if (!CHashSigner::VerifyHash(hash, activeMasternode.pubKeyMasternode, vchSig, strError)) {
+		LogPrintf("COrderBookDelta::Sign -- VerifyHash() failed, error: %s\n", strError);
+		return false;
+	}
+	return true;
+}
+
+void COrderBookManager::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman)
+{
+	if (strCommand == NetMsgType::DEXBIDDELTA || strCommand == NetMsgType::DEXASKDELTA)
 	{
-		COrderBook temp(TradePairID, true, Price, Qty, GetAdjustedTime(), MNPubKey);
-		if (!temp.Sign())
+		std::shared_ptr<COrderBookDelta> delta = std::make_shared<COrderBookDelta>();
+		vRecv >> *delta;
+
+		unsigned int nMaxLevels = delta->nIsSnapshot ? MAX_ORDERBOOK_SNAPSHOT_LEVELS : MAX_ORDERBOOK_DELTA_LEVELS;
+		if (delta->nIsBid != (strCommand == NetMsgType::DEXBIDDELTA) || delta->vLevels.size() > nMaxLevels) {
+			LogPrintf("COrderBookManager::ProcessMessage -- malformed order book delta, peer=%d\n", pfrom->id);
+			LOCK(cs_main);
+			Misbehaving(pfrom->GetId(), 20);
+			return;
+		}
+
+		//only the masternode in charge of the book side may publish it
+		std::string strInCharge;
+		infinidex_node_role_enum role = delta->nIsBid ? INFINIDEX_BID_BOOK_BROADCAST : INFINIDEX_ASK_BOOK_BROADCAST;
+		if (!nodeRoleManager.GetInChargePubKey(delta->nTradePairID, role, strInCharge) || delta->nMNPubKey != strInCharge) {
+			LogPrint("infinidex", "COrderBookManager::ProcessMessage -- order book delta for pair %d not from the masternode in charge, peer=%d\n", delta->nTradePairID, pfrom->id);
 			return;
-		a.insert(std::make_pair(Price, temp));
-		temp.Broadcast();
+		}
+
+		NodeId nodeid = pfrom->GetId();
+		if (!dexVerifier.Submit(nodeid, [delta]() { return delta->VerifySignature(); }, [delta, nodeid, &connman](bool fValid) {
+			if (!fValid) {
+				LogPrintf("COrderBookManager::ProcessMessage -- invalid signature, peer=%d\n", nodeid);
+				LOCK(cs_main);
+				Misbehaving(nodeid, 100);
+				return;
+			}
+			if (orderBookManager.InputOrderBookDelta(*delta) == ORDERBOOK_DELTA_NEED_SNAPSHOT) {
+				LogPrint("infinidex", "COrderBookManager::ProcessMessage -- out of sync on pair %d, requesting snapshot from peer=%d\n", delta->nTradePairID, nodeid);
+				connman.ForNode(nodeid, [&connman, &delta](CNode* pnode) {
+					connman.PushMessage(pnode, NetMsgType::DEXGETBOOK, delta->nTradePairID, delta->nIsBid);
+					return true;
+				});
+			}
+		}))
+			LogPrint("infinidex", "COrderBookManager::ProcessMessage -- verification queue full, dropping order book delta, peer=%d\n", nodeid);
 	}
-	else
+	else if (strCommand == NetMsgType::DEXGETBOOK)
 	{
-		auto& b = a[Price];
-		b.nQty += Qty;
-		b.nLastUpdateTime = GetAdjustedTime();
-		if (!b.Sign())
+		int TradePairID;
+		bool isBid;
+		vRecv >> TradePairID >> isBid;
+
+		//a snapshot is far larger than the request, do not let a peer repeat it
+		if (!ServeSnapshot(pfrom->GetId(), TradePairID, isBid)) {
+			LogPrint("infinidex", "COrderBookManager::ProcessMessage -- peer already asked for pair %d, ignoring, peer=%d\n", TradePairID, pfrom->id);
 			return;
-		b.Broadcast();
+		}
+
+		COrderBookDelta snapshot;
+		if (!GetSnapshot(isBid, TradePairID, snapshot))
+			return;
+
+		connman.PushMessage(pfrom, isBid ? NetMsgType::DEXBIDDELTA : NetMsgType::DEXASKDELTA, snapshot);
 	}
 }
 
-void COrderBookManager::AdjustAskQuantity(int TradePairID, uint64_t Price, int64_t Qty)
+//rate limits snapshot requests of a book side
+bool COrderBookManager::RequestSnapshot(COrderBookSyncState& state)
+{
+	int64_t nNow = GetTime();
+	if (nNow - state.nSnapshotRequestTime < ORDERBOOK_SNAPSHOT_RETRY_SECONDS)
+		return false;
+	state.nSnapshotRequestTime = nNow;
+	return true;
+}
+
+//rate limits snapshots sent to a peer per book side
+bool COrderBookManager::ServeSnapshot(NodeId nodeid, int TradePairID, bool isBid)
 {
-	if (!mapOrderAskBook.count(TradePairID))
+	LOCK(cs);
+	int64_t nNow = GetTime();
+	std::map<std::pair<NodeId, std::pair<int, bool>>, int64_t>::iterator it = mapSnapshotServed.begin();
+	while (it != mapSnapshotServed.end())
 	{
-		//need to sync with seed server or check node task
+		if (nNow - it->second >= ORDERBOOK_SNAPSHOT_RETRY_SECONDS)
+			mapSnapshotServed.erase(it++);
+		else
+			++it;
 	}
+	return mapSnapshotServed.insert(std::make_pair(std::make_pair(nodeid, std::make_pair(TradePairID, isBid)), nNow)).second;
+}
 
-	auto& a = mapOrderAskBook[TradePairID];
-	if (!a.count(Price))
+orderbook_delta_result_enum COrderBookManager::InputOrderBookDelta(const COrderBookDelta& delta)
+{
+	LOCK(cs);
+	std::map<int, PriceOrderBook>& book = GetBook(delta.nIsBid);
+	COrderBookSyncState& state = GetSyncState(delta.nIsBid)[delta.nTradePairID];
+	bool fSameStream = delta.nMNPubKey == state.strPublisher && delta.nEpoch == state.nEpoch;
+
+	if (delta.nMNPubKey == state.strPublisher && delta.nEpoch < state.nEpoch)
 	{
-		COrderBook temp(TradePairID, false, Price, Qty, GetAdjustedTime(), MNPubKey);
-		if (!temp.Sign())
-			return;
-		a.insert(std::make_pair(Price, temp));
-		temp.Broadcast();
+		return ORDERBOOK_DELTA_IGNORED; //from before the publisher restarted
 	}
-	else
+	else if (delta.nIsSnapshot)
 	{
-		auto& b = a[Price];
-		b.nQty += Qty;
-		b.nLastUpdateTime = GetAdjustedTime();
-		if (!b.Sign())
-			return;
-		b.Broadcast();
+		//a snapshot starts the sequence of a new publisher or epoch
+		if (fSameStream && state.nSequence > delta.nSequence)
+			return ORDERBOOK_DELTA_IGNORED;
+		book[delta.nTradePairID].clear();
+		state.strPublisher = delta.nMNPubKey;
+		state.nEpoch = delta.nEpoch;
+	}
+	else if (!fSameStream)
+	{
+		//deltas of a publisher or epoch we have no snapshot of yet
+		return RequestSnapshot(state) ? ORDERBOOK_DELTA_NEED_SNAPSHOT : ORDERBOOK_DELTA_IGNORED;
+	}
+	else if (delta.nSequence <= state.nSequence)
+	{
+		return ORDERBOOK_DELTA_IGNORED; //already applied
+	}
+	else if (delta.nSequence != state.nSequence + 1)
+	{
+		//a delta was lost, the book side can only be recovered from a snapshot
+		LogPrint("infinidex", "COrderBookManager::InputOrderBookDelta -- sequence gap on pair %d, expected %d got %d\n",
+			delta.nTradePairID, state.nSequence + 1, delta.nSequence);
+		return RequestSnapshot(state) ? ORDERBOOK_DELTA_NEED_SNAPSHOT : ORDERBOOK_DELTA_IGNORED;
+	}
+
+	PriceOrderBook& levels = book[delta.nTradePairID];
+	for (const std::pair<uint64_t, uint64_t>& level : delta.vLevels)
+	{
+		if (level.second == 0)
+		{
+			levels.erase(level.first);
+			continue;
+		}
+		COrderBook& b = levels[level.first];
+		b.nTradePairID = delta.nTradePairID;
+		b.nIsBid = delta.nIsBid;
+		b.nPrice = level.first;
+		b.nQty = level.second;
+		b.nLastUpdateTime = delta.nLastUpdateTime;
+		b.nMNPubKey = delta.nMNPubKey;
 	}
+	state.nSequence = delta.nSequence;
+	state.nSnapshotRequestTime = 0;
+	state.fSnapshotValid = false;
+	return ORDERBOOK_DELTA_APPLIED;
 }
 
-void COrderBookManager::UpdateBidQuantity(int TradePairID, uint64_t Price, uint64_t Qty)
+bool COrderBookManager::GetSnapshot(bool isBid, int TradePairID, COrderBookDelta& snapshot)
+{
+	//the trade setting belongs to the pair worker, ask the role table instead
+	std::string strInCharge;
+	if (!nodeRoleManager.GetInChargePubKey(TradePairID, isBid ? INFINIDEX_BID_BOOK_BROADCAST : INFINIDEX_ASK_BOOK_BROADCAST, strInCharge) || strInCharge != MNPubKey)
+		return false;
+
+	LOCK(cs);
+	std::map<int, PriceOrderBook>& book = GetBook(isBid);
+	if (!book.count(TradePairID))
+		return false;
+
+	//signed once per change of the book side, not once per request
+	COrderBookSyncState& state = GetSyncState(isBid)[TradePairID];
+	if (state.fSnapshotValid && state.snapshot.nEpoch == nEpoch && state.snapshot.nSequence == state.nSequence && state.snapshot.nMNPubKey == MNPubKey)
+	{
+		snapshot = state.snapshot;
+		return true;
+	}
+
+	const PriceOrderBook& levels = book[TradePairID];
+	if (levels.size() > MAX_ORDERBOOK_SNAPSHOT_LEVELS)
+	{
+		LogPrintf("COrderBookManager::GetSnapshot -- pair %d has %d levels, too many for a snapshot\n", TradePairID, levels.size());
+		return false;
+	}
+	snapshot = COrderBookDelta(TradePairID, isBid, true, nEpoch, state.nSequence, GetAdjustedTime(), MNPubKey);
+	snapshot.vLevels.reserve(levels.size());
+	for (PriceOrderBook::const_iterator it = levels.begin(); it != levels.end(); ++it)
+		snapshot.vLevels.push_back(std::make_pair(it->first, it->second.nQty));
+	if (!snapshot.Sign())
+		return false;
+
+	state.snapshot = snapshot;
+	state.fSnapshotValid = true;
+	return true;
+}
+
+void COrderBookManager::AdjustQuantity(bool isBid, int TradePairID, uint64_t Price, int64_t Qty)
 {
-	if (!mapOrderBidBook.count(TradePairID))
+	LOCK(cs);
+	std::map<int, PriceOrderBook>& book = GetBook(isBid);
+	if (!book.count(TradePairID))
 	{
 		//need to sync with seed server or check node task
 	}
 
-	auto& a = mapOrderBidBook[TradePairID];
+	auto& a = book[TradePairID];
 	if (!a.count(Price))
 	{
-		COrderBook temp(TradePairID, true, Price, Qty, GetAdjustedTime(), MNPubKey);
-		if (!temp.Sign())
-			return;
-		a.insert(std::make_pair(Price, temp));
-		temp.Broadcast();
+		a.insert(std::make_pair(Price, COrderBook(TradePairID, isBid, Price, Qty, GetAdjustedTime(), MNPubKey)));
 	}
 	else
 	{
 		auto& b = a[Price];
-		b.nQty = Qty;
+		b.nQty += Qty;
 		b.nLastUpdateTime = GetAdjustedTime();
-		if (!b.Sign())
-			return;
-		b.Broadcast();
+		if (b.nQty == 0)
+			a.erase(Price);
 	}
+	COrderBookSyncState& state = GetSyncState(isBid)[TradePairID];
+	state.setPendingPrice.insert(Price);
+	state.fSnapshotValid = false;
 }
 
-void COrderBookManager::UpdateAskQuantity(int TradePairID, uint64_t Price, uint64_t Qty)
+void COrderBookManager::UpdateQuantity(bool isBid, int TradePairID, uint64_t Price, uint64_t Qty)
 {
-	if (!mapOrderAskBook.count(TradePairID))
+	LOCK(cs);
+	std::map<int, PriceOrderBook>& book = GetBook(isBid);
+	if (!book.count(TradePairID))
 	{
 		//need to sync with seed server or check node task
 	}
 
-	auto& a = mapOrderAskBook[TradePairID];
-	if (!a.count(Price))
+	auto& a = book[TradePairID];
+	if (Qty == 0)
 	{
-		COrderBook temp(TradePairID, false, Price, Qty, GetAdjustedTime(), MNPubKey);
-		if (!temp.Sign())
-			return;
-		a.insert(std::make_pair(Price, temp));
-		temp.Broadcast();
+		a.erase(Price);
+	}
+	else if (!a.count(Price))
+	{
+		a.insert(std::make_pair(Price, COrderBook(TradePairID, isBid, Price, Qty, GetAdjustedTime(), MNPubKey)));
 	}
 	else
 	{
 		auto& b = a[Price];
 		b.nQty = Qty;
 		b.nLastUpdateTime = GetAdjustedTime();
-		if (!b.Sign())
-			return;
-		b.Broadcast();
 	}
+	COrderBookSyncState& state = GetSyncState(isBid)[TradePairID];
+	state.setPendingPrice.insert(Price);
+	state.fSnapshotValid = false;
+}
+
+void COrderBookManager::AdjustBidQuantity(int TradePairID, uint64_t Price, int64_t Qty)
+{
+	AdjustQuantity(true, TradePairID, Price, Qty);
+}
+
+void COrderBookManager::AdjustAskQuantity(int TradePairID, uint64_t Price, int64_t Qty)
+{
+	AdjustQuantity(false, TradePairID, Price, Qty);
+}
+
+void COrderBookManager::UpdateBidQuantity(int TradePairID, uint64_t Price, uint64_t Qty)
+{
+	UpdateQuantity(true, TradePairID, Price, Qty);
+}
+
+void COrderBookManager::UpdateAskQuantity(int TradePairID, uint64_t Price, uint64_t Qty)
+{
+	UpdateQuantity(false, TradePairID, Price, Qty);
+}
+
+void COrderBookManager::CollectDeltas(bool isBid, std::vector<COrderBookDelta>& vDeltas)
+{
+	std::map<int, PriceOrderBook>& book = GetBook(isBid);
+	std::map<int, COrderBookSyncState>& syncState = GetSyncState(isBid);
+	uint64_t nTime = GetAdjustedTime();
+
+	for (auto& it : syncState)
+	{
+		COrderBookSyncState& state = it.second;
+		if (state.setPendingPrice.empty())
+			continue;
+
+		const PriceOrderBook& levels = book[it.first];
+		std::vector<COrderBookDelta> vPairDeltas;
+		COrderBookDelta delta(it.first, isBid, false, nEpoch, state.nSequence + 1, nTime, MNPubKey);
+		for (std::set<uint64_t>::const_iterator price = state.setPendingPrice.begin(); price != state.setPendingPrice.end(); ++price)
+		{
+			PriceOrderBook::const_iterator level = levels.find(*price);
+			delta.vLevels.push_back(std::make_pair(*price, level == levels.end() ? 0 : level->second.nQty));
+			if (delta.vLevels.size() == MAX_ORDERBOOK_DELTA_LEVELS)
+			{
+				vPairDeltas.push_back(delta);
+				delta.nSequence++;
+				delta.vLevels.clear();
+			}
+		}
+		if (!delta.vLevels.empty())
+			vPairDeltas.push_back(delta);
+
+		//one signature per side and tick instead of one per changed level, the sequence and
+		//pending levels are only given up once every delta of the pair is signed
+		bool fSigned = true;
+		for (COrderBookDelta& pairDelta : vPairDeltas)
+		{
+			if (!pairDelta.Sign())
+			{
+				fSigned = false;
+				break;
+			}
+		}
+		if (!fSigned)
+		{
+			LogPrint("infinidex", "COrderBookManager::CollectDeltas -- failed to sign deltas of pair %d, keeping them for the next tick\n", it.first);
+			continue;
+		}
+
+		state.nSequence += vPairDeltas.size();
+		state.setPendingPrice.clear();
+		vDeltas.insert(vDeltas.end(), vPairDeltas.begin(), vPairDeltas.end());
+	}
+}
+
+void COrderBookManager::BroadcastPendingDeltas(CConnman& connman)
+{
+	std::vector<COrderBookDelta> vDeltas;
+	{
+		LOCK(cs);
+		CollectDeltas(true, vDeltas);
+		CollectDeltas(false, vDeltas);
+	}
+	if (vDeltas.empty())
+		return;
+
+	//serialized once, every peer's send queue shares the same buffers
+	std::vector<CSerializedNetMsg> vMsgs;
+	for (const COrderBookDelta& delta : vDeltas)
+		vMsgs.push_back(connman.MakeMessage(PROTOCOL_VERSION, delta.nIsBid ? NetMsgType::DEXBIDDELTA : NetMsgType::DEXASKDELTA, delta));
+
+	connman.ForEachNode([&connman, &vMsgs](CNode* pnode) {
+		for (const CSerializedNetMsg& msg : vMsgs)
+			connman.PushMessage(pnode, msg);
+	});
 }
 
 void COrderBookManager::InitTradePair(int TradePairID)
 {
+	LOCK(cs);
 	if (mapOrderBidBook.count(TradePairID))
 		return;
 
 	mapOrderBidBook.insert(std::make_pair(TradePairID, PriceOrderBook()));
 	mapOrderAskBook.insert(std::make_pair(TradePairID, PriceOrderBook()));
-}
\ No newline at end of file
+}
+
+void ThreadOrderBookBroadcast(CConnman& connman)
+{
+	if (fLiteMode) return; // disable all Infinex specific functionality
+
+	static bool fOneThread;
+	if (fOneThread) return;
+	fOneThread = true;
+
+	RenameThread("infinex-dexbook");
+
+	int64_t nTick = std::max<int64_t>(1, GetArg("-dexbooktick", DEFAULT_ORDERBOOK_TICK));
+	while (true)
+	{
+		MilliSleep(nTick);
+		orderBookManager.BroadcastPendingDeltas(connman);
+	}
+}
@@ -8,14 +8,29 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <set>
 #include "userconnection.h"
 #include "hash.h"
 #include "net.h"
+#include "sync.h"
 #include "utilstrencodings.h"
 
 class COrderBook;
+class COrderBookDelta;
+class COrderBookSyncState;
 class COrderBookManager;
 
+static const int DEFAULT_ORDERBOOK_TICK = 50; //milliseconds between order book delta broadcasts
+static const unsigned int MAX_ORDERBOOK_DELTA_LEVELS = 1000;
+static const unsigned int MAX_ORDERBOOK_SNAPSHOT_LEVELS = 100000; //keeps a snapshot below the network message size limit
+static const int64_t ORDERBOOK_SNAPSHOT_RETRY_SECONDS = 10; //also how often a peer is served the same book side
+
+enum orderbook_delta_result_enum {
+	ORDERBOOK_DELTA_APPLIED = 0,
+	ORDERBOOK_DELTA_IGNORED = 1,
+	ORDERBOOK_DELTA_NEED_SNAPSHOT = 2
+};
+
 typedef std::map<uint64_t, COrderBook> PriceOrderBook; //price and order data
 extern std::map<int, PriceOrderBook> mapOrderBidBook;
 extern std::map<int, PriceOrderBook> mapOrderAskBook;
@@ -69,13 +84,125 @@ public:
 	void Broadcast();
 };
 
+/**
+ * Changed price levels of one side of a trade pair, collected over a broadcast tick.
+ *
+ * Each level carries its absolute quantity, a zero quantity removes the level. Deltas of
+ * a book side are numbered consecutively so receivers can detect a lost message, and a
+ * snapshot carries the whole side together with the sequence it is valid at.
+ *
+ * Sequences only count within one epoch of one publisher. The epoch is the time the
+ * publisher started, a restarted or a new publisher starts a new sequence that receivers
+ * pick up from its first snapshot.
+ */
+class COrderBookDelta
+{
+private:
+	std::vector<unsigned char> vchSig;
+
+public:
+	int nTradePairID;
+	bool nIsBid;
+	bool nIsSnapshot;
+	uint64_t nEpoch;
+	uint64_t nSequence;
+	uint64_t nLastUpdateTime;
+	std::vector<std::pair<uint64_t, uint64_t>> vLevels; //price and quantity
+	std::string nMNPubKey;
+
+	COrderBookDelta(int nTradePairID, bool nIsBid, bool nIsSnapshot, uint64_t nEpoch, uint64_t nSequence, uint64_t nLastUpdateTime, std::string nMNPubKey) :
+		nTradePairID(nTradePairID),
+		nIsBid(nIsBid),
+		nIsSnapshot(nIsSnapshot),
+		nEpoch(nEpoch),
+		nSequence(nSequence),
+		nLastUpdateTime(nLastUpdateTime),
+		nMNPubKey(nMNPubKey)
+	{}
+
+	COrderBookDelta() :
+		nTradePairID(0),
+		nIsBid(true),
+		nIsSnapshot(false),
+		nEpoch(0),
+		nSequence(0),
+		nLastUpdateTime(0),
+		nMNPubKey("")
+	{}
+
+	ADD_SERIALIZE_METHODS;
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+		READWRITE(nTradePairID);
+		READWRITE(nIsBid);
+		READWRITE(nIsSnapshot);
+		READWRITE(nEpoch);
+		READWRITE(nSequence);
+		READWRITE(nLastUpdateTime);
+		READWRITE(vLevels);
+		READWRITE(nMNPubKey);
+		READWRITE(vchSig);
+	}
+
+	uint256 GetSignatureHash() const;
+	bool VerifySignature();
+	bool Sign();
+};
+
+class COrderBookSyncState
+{
+public:
+	std::string strPublisher; //masternode the sequence belongs to
+	uint64_t nEpoch;
+	uint64_t nSequence; //last sequence sent or applied
+	int64_t nSnapshotRequestTime;
+	std::set<uint64_t> setPendingPrice; //levels changed since the last broadcast
+	COrderBookDelta snapshot; //signed snapshot served until the book side changes
+	bool fSnapshotValid;
+
+	COrderBookSyncState() :
+		strPublisher(""),
+		nEpoch(0),
+		nSequence(0),
+		nSnapshotRequestTime(0),
+		fSnapshotValid(false)
+	{}
+};
+
 class COrderBookManager
 {
+private:
+	std::map<int, COrderBookSyncState> mapBidSyncState;
+	std::map<int, COrderBookSyncState> mapAskSyncState;
+	uint64_t nEpoch; //start time of this node as a publisher
+	std::map<std::pair<NodeId, std::pair<int, bool>>, int64_t> mapSnapshotServed; //peer, pair and side to the time a snapshot was sent
+
+	std::map<int, PriceOrderBook>& GetBook(bool isBid) { return isBid ? mapOrderBidBook : mapOrderAskBook; }
+	std::map<int, COrderBookSyncState>& GetSyncState(bool isBid) { return isBid ? mapBidSyncState : mapAskSyncState; }
+	void AdjustQuantity(bool isBid, int TradePairID, uint64_t Price, int64_t Qty);
+	void UpdateQuantity(bool isBid, int TradePairID, uint64_t Price, uint64_t Qty);
+	void CollectDeltas(bool isBid, std::vector<COrderBookDelta>& vDeltas);
+	bool GetSnapshot(bool isBid, int TradePairID, COrderBookDelta& snapshot);
+	bool RequestSnapshot(COrderBookSyncState& state);
+	bool ServeSnapshot(NodeId nodeid, int TradePairID, bool isBid);
+
 public:
+	//protects mapOrderBidBook, mapOrderAskBook and the sync state
+	CCriticalSection cs;
+
+	COrderBookManager();
+
+	//applies a delta or snapshot whose signer was checked to be in charge of the book side
+	orderbook_delta_result_enum InputOrderBookDelta(const COrderBookDelta& delta);
+	void ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman);
 	void InitTradePair(int TradePairID);
 	void AdjustBidQuantity(int TradePairID, uint64_t Price, int64_t Qty);
 	void AdjustAskQuantity(int TradePairID, uint64_t Price, int64_t Qty);
 	void UpdateBidQuantity(int TradePairID, uint64_t Price, uint64_t Quantity);
 	void UpdateAskQuantity(int TradePairID, uint64_t Price, uint64_t Quantity);
+	void BroadcastPendingDeltas(CConnman& connman);
 };
+
+void ThreadOrderBookBroadcast(CConnman& connman);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,178 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "orderbookengine.h"
+#include "trade.h"
+
+#include <algorithm>
+
+class COrderBookEngine;
+
+std::map<int, COrderBookEngine> mapUserTradeBook;
+
+static bool IsBidLevelBefore(const COrderPriceLevel& level, uint64_t Price)
+{
+	return level.nPrice < Price;
+}
+
+static bool IsAskLevelBefore(const COrderPriceLevel& level, uint64_t Price)
+{
+	return level.nPrice > Price;
+}
+
+std::vector<COrderPriceLevel>::iterator COrderBookEngine::FindLevel(bool isBid, uint64_t Price)
+{
+	std::vector<COrderPriceLevel>& levels = GetLevels(isBid);
+	return std::lower_bound(levels.begin(), levels.end(), Price, isBid ? IsBidLevelBefore : IsAskLevelBefore);
+}
+
+std::vector<COrderPriceLevel>::const_iterator COrderBookEngine::FindLevel(bool isBid, uint64_t Price) const
+{
+	const std::vector<COrderPriceLevel>& levels = GetLevels(isBid);
+	return std::lower_bound(levels.begin(), levels.end(), Price, isBid ? IsBidLevelBefore : IsAskLevelBefore);
+}
+
+uint32_t COrderBookEngine::AllocNode(const std::shared_ptr<CUserTrade>& userTrade)
+{
+	uint32_t index;
+	if (!vFreeNodes.empty())
+	{
+		index = vFreeNodes.back();
+		vFreeNodes.pop_back();
+	}
+	else
+	{
+		index = vNodePool.size();
+		vNodePool.push_back(COrderNode());
+	}
+	COrderNode& node = vNodePool[index];
+	node.nUserTrade = userTrade;
+	node.nPrev = ORDER_NODE_NONE;
+	node.nNext = ORDER_NODE_NONE;
+	return index;
+}
+
+void COrderBookEngine::ReleaseNode(uint32_t Index)
+{
+	vNodePool[Index].nUserTrade.reset();
+	vFreeNodes.push_back(Index);
+}
+
+void COrderBookEngine::UnlinkNode(bool isBid, std::vector<COrderPriceLevel>::iterator level, uint32_t Index)
+{
+	COrderNode& node = vNodePool[Index];
+	if (node.nPrev != ORDER_NODE_NONE)
+		vNodePool[node.nPrev].nNext = node.nNext;
+	else
+		level->nHead = node.nNext;
+
+	if (node.nNext != ORDER_NODE_NONE)
+		vNodePool[node.nNext].nPrev = node.nPrev;
+	else
+		level->nTail = node.nPrev;
+
+	mapNodeByPairTradeID.erase(node.nUserTrade->nPairTradeID);
+	ReleaseNode(Index);
+
+	if (--level->nOrderCount == 0)
+		GetLevels(isBid).erase(level);
+}
+
+void COrderBookEngine::Reserve(size_t nOrders)
+{
+	vNodePool.reserve(nOrders);
+	vFreeNodes.reserve(nOrders);
+	mapNodeByPairTradeID.reserve(nOrders);
+}
+
+bool COrderBookEngine::AddOrder(const std::shared_ptr<CUserTrade>& userTrade)
+{
+	if (mapNodeByPairTradeID.count(userTrade->nPairTradeID))
+		return false;
+
+	std::vector<COrderPriceLevel>& levels = GetLevels(userTrade->nIsBid);
+	std::vector<COrderPriceLevel>::iterator level = FindLevel(userTrade->nIsBid, userTrade->nPrice);
+	if (level == levels.end() || level->nPrice != userTrade->nPrice)
+		level = levels.insert(level, COrderPriceLevel(userTrade->nPrice));
+
+	uint32_t index = AllocNode(userTrade);
+	COrderNode& node = vNodePool[index];
+	node.nPrev = level->nTail;
+	if (level->nTail != ORDER_NODE_NONE)
+		vNodePool[level->nTail].nNext = index;
+	else
+		level->nHead = index;
+	level->nTail = index;
+	++level->nOrderCount;
+
+	mapNodeByPairTradeID.insert(std::make_pair(userTrade->nPairTradeID, index));
+	return true;
+}
+
+std::shared_ptr<CUserTrade> COrderBookEngine::CancelOrder(int PairTradeID)
+{
+	std::unordered_map<int, uint32_t>::iterator it = mapNodeByPairTradeID.find(PairTradeID);
+	if (it == mapNodeByPairTradeID.end())
+		return std::shared_ptr<CUserTrade>();
+
+	uint32_t index = it->second;
+	std::shared_ptr<CUserTrade> userTrade = vNodePool[index].nUserTrade;
+	std::vector<COrderPriceLevel>::iterator level = FindLevel(userTrade->nIsBid, userTrade->nPrice);
+	UnlinkNode(userTrade->nIsBid, level, index);
+	return userTrade;
+}
+
+bool COrderBookEngine::HasOrder(int PairTradeID) const
+{
+	return mapNodeByPairTradeID.count(PairTradeID);
+}
+
+std::shared_ptr<CUserTrade> COrderBookEngine::GetOrder(int PairTradeID) const
+{
+	std::unordered_map<int, uint32_t>::const_iterator it = mapNodeByPairTradeID.find(PairTradeID);
+	if (it == mapNodeByPairTradeID.end())
+		return std::shared_ptr<CUserTrade>();
+	return vNodePool[it->second].nUserTrade;
+}
+
+uint64_t COrderBookEngine::GetBestPrice(bool isBid) const
+{
+	const std::vector<COrderPriceLevel>& levels = GetLevels(isBid);
+	if (levels.empty())
+		return 0;
+	return levels.back().nPrice;
+}
+
+//caller must check IsEmpty first
+const std::shared_ptr<CUserTrade>& COrderBookEngine::GetBestOrder(bool isBid) const
+{
+	return vNodePool[GetLevels(isBid).back().nHead].nUserTrade;
+}
+
+void COrderBookEngine::PopBestOrder(bool isBid)
+{
+	std::vector<COrderPriceLevel>& levels = GetLevels(isBid);
+	if (levels.empty())
+		return;
+	UnlinkNode(isBid, levels.end() - 1, levels.back().nHead);
+}
+
+void COrderBookEngine::GetLevelOrders(bool isBid, uint64_t Price, std::vector<std::shared_ptr<CUserTrade>>& orders) const
+{
+	std::vector<COrderPriceLevel>::const_iterator level = FindLevel(isBid, Price);
+	if (level == GetLevels(isBid).end() || level->nPrice != Price)
+		return;
+
+	for (uint32_t index = level->nHead; index != ORDER_NODE_NONE; index = vNodePool[index].nNext)
+		orders.push_back(vNodePool[index].nUserTrade);
+}
+
+void COrderBookEngine::Clear()
+{
+	vNodePool.clear();
+	vFreeNodes.clear();
+	vBidLevels.clear();
+	vAskLevels.clear();
+	mapNodeByPairTradeID.clear();
+}
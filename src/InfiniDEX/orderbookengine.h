@@ -0,0 +1,100 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef ORDERBOOKENGINE_H
+#define ORDERBOOKENGINE_H
+
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+class CUserTrade;
+class COrderBookEngine;
+
+extern std::map<int, COrderBookEngine> mapUserTradeBook;
+
+static const uint32_t ORDER_NODE_NONE = 0xFFFFFFFF;
+
+//pooled order slot, linked into the FIFO queue of its price level
+struct COrderNode
+{
+	std::shared_ptr<CUserTrade> nUserTrade;
+	uint32_t nPrev;
+	uint32_t nNext;
+
+	COrderNode() :
+		nPrev(ORDER_NODE_NONE),
+		nNext(ORDER_NODE_NONE)
+	{}
+};
+
+struct COrderPriceLevel
+{
+	uint64_t nPrice;
+	uint32_t nHead;
+	uint32_t nTail;
+	uint32_t nOrderCount;
+
+	COrderPriceLevel(uint64_t nPrice) :
+		nPrice(nPrice),
+		nHead(ORDER_NODE_NONE),
+		nTail(ORDER_NODE_NONE),
+		nOrderCount(0)
+	{}
+};
+
+/**
+ * Resting user trades of a single trade pair.
+ *
+ * Each side keeps its price levels in one contiguous vector ordered from the worst
+ * to the best price, so the best bid/ask is always the last element. Orders within
+ * a level form an intrusive FIFO queue of indices into a shared node pool, which
+ * gives price-time priority without a tree lookup per matching step.
+ */
+class COrderBookEngine
+{
+private:
+	std::vector<COrderNode> vNodePool;
+	std::vector<uint32_t> vFreeNodes;
+	std::vector<COrderPriceLevel> vBidLevels; //ascending price, best bid at back
+	std::vector<COrderPriceLevel> vAskLevels; //descending price, best ask at back
+	std::unordered_map<int, uint32_t> mapNodeByPairTradeID;
+
+	std::vector<COrderPriceLevel>& GetLevels(bool isBid) { return isBid ? vBidLevels : vAskLevels; }
+	const std::vector<COrderPriceLevel>& GetLevels(bool isBid) const { return isBid ? vBidLevels : vAskLevels; }
+	std::vector<COrderPriceLevel>::iterator FindLevel(bool isBid, uint64_t Price);
+	std::vector<COrderPriceLevel>::const_iterator FindLevel(bool isBid, uint64_t Price) const;
+	uint32_t AllocNode(const std::shared_ptr<CUserTrade>& userTrade);
+	void ReleaseNode(uint32_t Index);
+	void UnlinkNode(bool isBid, std::vector<COrderPriceLevel>::iterator level, uint32_t Index);
+
+public:
+	int nTradePairID;
+
+	COrderBookEngine(int nTradePairID) :
+		nTradePairID(nTradePairID)
+	{}
+
+	COrderBookEngine() :
+		nTradePairID(0)
+	{}
+
+	void Reserve(size_t nOrders);
+	bool AddOrder(const std::shared_ptr<CUserTrade>& userTrade);
+	std::shared_ptr<CUserTrade> CancelOrder(int PairTradeID);
+	bool HasOrder(int PairTradeID) const;
+	std::shared_ptr<CUserTrade> GetOrder(int PairTradeID) const;
+	bool IsEmpty(bool isBid) const { return GetLevels(isBid).empty(); }
+	uint64_t GetBestPrice(bool isBid) const;
+	const std::shared_ptr<CUserTrade>& GetBestOrder(bool isBid) const;
+	void PopBestOrder(bool isBid);
+	size_t GetLevelCount(bool isBid) const { return GetLevels(isBid).size(); }
+	size_t GetOrderCount() const { return mapNodeByPairTradeID.size(); }
+	void GetLevelOrders(bool isBid, uint64_t Price, std::vector<std::shared_ptr<CUserTrade>>& orders) const;
+	void Clear();
+};
+
+#endif
@@ -5,9 +5,15 @@
 #include "activemasternode.h"
 #include "timedata.h"
 #include "trade.h"
+#include "balanceledger.h"
 #include "chartdata.h"
+#include "dexexecutor.h"
+#include "dexverifier.h"
+#include "marketoverview.h"
 #include "orderbook.h"
+#include "orderbookengine.h"
 #include "messagesigner.h"
+#include "tradelog.h"
 #include "tradepair.h"
 #include "userbalance.h"
 #include "usertradehistory.h"
@@ -22,14 +28,12 @@ class CUserTradeManager;
 class CActualTrade;
 class CActualTradeManager;
 
-std::map<std::string, pULTIUTC> mapUserTrades;
-
-std::map<int, mUTPIUTV> mapBidUserTradeByPrice;
-std::map<int, mUTPIUTV> mapAskUserTradeByPrice;
+std::map<uint32_t, pULTIUTC> mapUserTrades;
 
+CCriticalSection cs_mapTradePair;
 std::map<int, CUserTradeSetting> mapUserTradeSetting;
 
-std::map<std::string, mUTImAT> mapUserActualTrades;
+std::map<uint32_t, mUTImAT> mapUserActualTrades;
 std::map<int, mATIAT> mapActualTradeByActualTradeID;
 std::map<int, mUTImAT> mapActualTradeByUserTradeID;
 std::map<int, std::vector<CActualTrade>> mapConflictTrade;
@@ -37,13 +41,62 @@ std::map<int, std::set<std::string>> mapActualTradeHash;
 CActualTradeManager actualTradeManager;
 CUserTradeManager userTradeManager;
 
+//the entry stays valid after the lock is released, see cs_mapTradePair
+template<typename T>
+static T* FindTradePairEntry(std::map<int, T>& map, int TradePairID)
+{
+	LOCK(cs_mapTradePair);
+	typename std::map<int, T>::iterator it = map.find(TradePairID);
+	return it == map.end() ? NULL : &it->second;
+}
+
+static std::shared_ptr<CUserTradeHistory> MakeTradeHistory(const CActualTrade& actualTrade)
+{
+	std::shared_ptr<CUserTradeHistory> tradeHistory = std::make_shared<CUserTradeHistory>(actualTrade.nTradePairID, actualTrade.nUserPubKey1, actualTrade.nUserPubKey2, actualTrade.nTradePrice, actualTrade.nTradeQty, actualTrade.nTradeAmount, false, actualTrade.nTradeTime);
+	tradeHistory->nUserID1 = actualTrade.nUserID1;
+	tradeHistory->nUserID2 = actualTrade.nUserID2;
+	return tradeHistory;
+}
+
+void CUserTradeManager::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman)
+{
+	if (strCommand == NetMsgType::DEXUSERTRADE)
+	{
+		std::shared_ptr<CUserTrade> userTrade = std::make_shared<CUserTrade>();
+		vRecv >> *userTrade;
+		//the user worker checks the signature again, which is then answered from the verifier cache
+		if (!dexVerifier.Submit(pfrom->GetId(), [userTrade]() { return userTrade->VerifyUserSignature(); }, [userTrade](bool fValid) {
+			if (fValid)
+				dexExecutor.PostUserTask([userTrade]() { userTradeManager.InputUserTrade(userTrade); });
+		}))
+			LogPrint("infinidex", "CUserTradeManager::ProcessMessage -- verification queue full, dropping user trade, peer=%d\n", pfrom->id);
+	}
+	else if (strCommand == NetMsgType::DEXUSERTRADECANCEL)
+	{
+		std::shared_ptr<CCancelTrade> cancelTrade = std::make_shared<CCancelTrade>();
+		vRecv >> *cancelTrade;
+		if (!dexVerifier.Submit(pfrom->GetId(), [cancelTrade]() {
+			return cancelTrade->VerifyUserSignature() && (cancelTrade->nMNTradePubKey == "" || cancelTrade->VerifyMNSignature());
+		}, [cancelTrade](bool fValid) {
+			if (fValid)
+				dexExecutor.PostUserTask([cancelTrade]() { userTradeManager.InputTradeCancel(*cancelTrade); });
+		}))
+			LogPrint("infinidex", "CUserTradeManager::ProcessMessage -- verification queue full, dropping trade cancel, peer=%d\n", pfrom->id);
+	}
+}
+
+//runs on the user worker
 void CUserTradeManager::InputTradeCancel(CCancelTrade& cancelTrade)
 {
 	if (!cancelTrade.VerifyUserSignature())
 		return;
 
-	CUserTradeSetting& setting = mapUserTradeSetting[cancelTrade.nTradePairID];
-	if (setting.nTradePairID != cancelTrade.nTradePairID)
+	if (!FindTradePairEntry(mapUserTradeSetting, cancelTrade.nTradePairID))
+		return;
+
+	//a trader without an ID has no trades to cancel, the key is not interned for it
+	cancelTrade.nUserID = traderRegistry.FindTraderID(cancelTrade.nUserPubKey);
+	if (cancelTrade.nUserID == TRADER_ID_NONE)
 		return;
 
 	if (cancelTrade.nMNTradePubKey != "")
@@ -53,53 +106,44 @@ void CUserTradeManager::InputTradeCancel(CCancelTrade& cancelTrade)
 
 		if (userBalanceManager.InChargeOfUserBalance(cancelTrade.nUserPubKey))
 			ReturnTradeCancelBalance(cancelTrade);
+	}
 
-		if (setting.nInChargeOfBidBroadcast && cancelTrade.isBid)
-		{
-			orderBookManager.AdjustBidQuantity(cancelTrade.nTradePairID, cancelTrade.nPrice, (0 - cancelTrade.nBalanceQty));			
-		}
+	//the roles of the pair are read by its own worker
+	dexExecutor.PostTradePairTask(cancelTrade.nTradePairID, [cancelTrade]() mutable { userTradeManager.InputPairTradeCancel(cancelTrade); });
+}
 
-		if (setting.nInChargeOfAskBroadcast && !cancelTrade.isBid)
-		{
+//runs on the worker owning the trade pair
+void CUserTradeManager::InputPairTradeCancel(CCancelTrade& cancelTrade)
+{
+	const CUserTradeSetting* setting = FindTradePairEntry(mapUserTradeSetting, cancelTrade.nTradePairID);
+	if (!setting)
+		return;
+
+	if (cancelTrade.nMNTradePubKey != "")
+	{
+		if (cancelTrade.isBid && setting->nInChargeOfBidBroadcast)
+			orderBookManager.AdjustBidQuantity(cancelTrade.nTradePairID, cancelTrade.nPrice, (0 - cancelTrade.nBalanceQty));
+		else if (!cancelTrade.isBid && setting->nInChargeOfAskBroadcast)
 			orderBookManager.AdjustAskQuantity(cancelTrade.nTradePairID, cancelTrade.nPrice, (0 - cancelTrade.nBalanceQty));
-		}
 	}
-	else if (setting.nInChargeOfMatchUserTrade)
+	else if (setting->nInChargeOfMatchUserTrade)
+	{
 		ProcessTradeCancelRequest(cancelTrade);
+	}
 }
 
+//runs on the worker owning the trade pair
 void CUserTradeManager::ProcessTradeCancelRequest(CCancelTrade& cancelTrade)
 {
-	std::shared_ptr<CUserTrade> existingUserTrade;
-	if (cancelTrade.isBid)
-	{
-		if (mapBidUserTradeByPrice.count(cancelTrade.nTradePairID))
-		{
-			auto& a = mapBidUserTradeByPrice[cancelTrade.nTradePairID];
-			if (a.count(cancelTrade.nPrice))
-			{
-				auto& b = a[cancelTrade.nPrice];
-				if (b.count(cancelTrade.nPairTradeID))
-				{
-					existingUserTrade = b[cancelTrade.nPairTradeID];
-					b.erase(cancelTrade.nPairTradeID);
-				}
-			}
-		}
-	}
-	else if (mapAskUserTradeByPrice.count(cancelTrade.nTradePairID))
-	{
-		auto& a = mapAskUserTradeByPrice[cancelTrade.nTradePairID];
-		if (a.count(cancelTrade.nPrice))
-		{
-			auto& b = a[cancelTrade.nPrice];
-			if (b.count(cancelTrade.nPairTradeID))
-			{
-				existingUserTrade = b[cancelTrade.nPairTradeID];
-				b.erase(cancelTrade.nPairTradeID);
-			}
-		}
-	}
+	COrderBookEngine* pbook = FindTradePairEntry(mapUserTradeBook, cancelTrade.nTradePairID);
+	if (!pbook)
+		return;
+
+	COrderBookEngine& book = *pbook;
+	std::shared_ptr<CUserTrade> existingUserTrade = book.GetOrder(cancelTrade.nPairTradeID);
+	if (!existingUserTrade || existingUserTrade->nUserID != cancelTrade.nUserID || existingUserTrade->nIsBid != cancelTrade.isBid || existingUserTrade->nPrice != cancelTrade.nPrice)
+		return;
+	book.CancelOrder(cancelTrade.nPairTradeID);
 
 	cancelTrade.nBalanceQty = existingUserTrade->nBalanceQty;
 	cancelTrade.nBalanceAmount = existingUserTrade->nBalanceAmount;
@@ -116,9 +160,9 @@ void CUserTradeManager::ReturnTradeCancelBalance(CCancelTrade& cancelTrade)
 	if (tradePair.nTradePairID != cancelTrade.nTradePairID)
 		return;
 
-	if (mapUserTrades.count(cancelTrade.nUserPubKey))
+	if (mapUserTrades.count(cancelTrade.nUserID))
 	{
-		auto& a = mapUserTrades[cancelTrade.nUserPubKey];
+		auto& a = mapUserTrades[cancelTrade.nUserID];
 		if (a.second.count(cancelTrade.nUserTradeID))
 		{
 			auto& b = a.second[cancelTrade.nUserTradeID];
@@ -134,18 +178,28 @@ void CUserTradeManager::ReturnTradeCancelBalance(CCancelTrade& cancelTrade)
 	}
 }
 
+//runs on the user worker
 void CUserTradeManager::InputUserTrade(const std::shared_ptr<CUserTrade>& userTrade)
 {
 	if (!userTrade->VerifyUserSignature())
 		return;
 
-	CTradePair& tradePair = mapCompleteTradePair[userTrade->nTradePairID];
-	if (tradePair.nTradePairID != userTrade->nTradePairID)
+	//the message thread may replace the pair at any time, work on a copy
+	CTradePair tradePair;
 	{
-		//request node setup
-		return;
+		LOCK(cs_mapCompleteTradePair);
+		auto it = mapCompleteTradePair.find(userTrade->nTradePairID);
+		if (it == mapCompleteTradePair.end())
+		{
+			//request node setup
+			return;
+		}
+		tradePair = it->second;
 	}
 
+	//interned IDs are never given back, so the key only gets one once the trade is accepted
+	userTrade->nUserID = traderRegistry.FindTraderID(userTrade->nUserPubKey);
+
 	if (userBalanceManager.InChargeOfUserBalance(userTrade->nUserPubKey))
 	{
 		if (userTrade->nMNBalancePubKey == "")
@@ -155,9 +209,13 @@ void CUserTradeManager::InputUserTrade(const std::shared_ptr<CUserTrade>& userTr
 		}
 		else
 		{
-			if (!mapUserTrades.count(userTrade->nUserPubKey))
-				mapUserTrades.insert(std::make_pair(userTrade->nUserPubKey, pULTIUTC()));
-			auto& a = mapUserTrades[userTrade->nUserPubKey];
+			if (!userTrade->VerifyMNBalanceSignature())
+				return;
+
+			userTrade->nUserID = traderRegistry.GetTraderID(userTrade->nUserPubKey);
+			if (!mapUserTrades.count(userTrade->nUserID))
+				mapUserTrades.insert(std::make_pair(userTrade->nUserID, pULTIUTC()));
+			auto& a = mapUserTrades[userTrade->nUserID];
 			if (!a.second.count(userTrade->nUserTradeID))
 				a.second.insert(std::make_pair(userTrade->nUserTradeID, userTrade));
 			else
@@ -172,13 +230,29 @@ void CUserTradeManager::InputUserTrade(const std::shared_ptr<CUserTrade>& userTr
 	if (userTrade->nMNBalancePubKey == "" || !userTrade->VerifyMNBalanceSignature())
 		return;
 
+	if (userTrade->nUserID == TRADER_ID_NONE)
+		userTrade->nUserID = traderRegistry.GetTraderID(userTrade->nUserPubKey);
+
 	if (userBalanceManager.InChargeOfBackup(userTrade->nUserPubKey))
 		SaveProcessedUserTrade(userTrade, tradePair);
 
-	CUserTradeSetting& setting = mapUserTradeSetting[userTrade->nTradePairID];
-	if (setting.nTradePairID != userTrade->nTradePairID)
+	//the pair worker matches its own copy, the one kept in mapUserTrades stays with this worker
+	std::shared_ptr<CUserTrade> pairUserTrade = std::make_shared<CUserTrade>(*userTrade);
+	CTradePair pairTradePair = tradePair;
+	dexExecutor.PostTradePairTask(userTrade->nTradePairID, [pairUserTrade, pairTradePair]() mutable {
+		userTradeManager.InputPairUserTrade(pairUserTrade, pairTradePair);
+	});
+}
+
+//runs on the worker owning the trade pair
+void CUserTradeManager::InputPairUserTrade(const std::shared_ptr<CUserTrade>& userTrade, CTradePair& tradePair)
+{
+	CUserTradeSetting* psetting = FindTradePairEntry(mapUserTradeSetting, userTrade->nTradePairID);
+	if (!psetting)
 		return;
 
+	CUserTradeSetting& setting = *psetting;
+
 	if (userTrade->nMNTradePubKey == "")
 	{
 		if (setting.nInChargeOfMatchUserTrade)
@@ -225,25 +299,18 @@ bool CUserTradeManager::ProcessUserTradeRequest(const std::shared_ptr<CUserTrade
 	if (timeDiff > 10000 && timeDiff < -10000)
 		return false;
 
-	std::shared_ptr<CUserBalance> userBalance;
-	if (userTrade->nIsBid)
-		userBalanceManager.InitUserBalance(tradePair.nCoinID2, userTrade->nUserPubKey, userBalance);
-	else
-		userBalanceManager.InitUserBalance(tradePair.nCoinID1, userTrade->nUserPubKey, userBalance);
-	
-	if (userBalance->nAvailableBalance < userTrade->nAmount)
+	int CoinID = userTrade->nIsBid ? tradePair.nCoinID2 : tradePair.nCoinID1;
+	if (!userBalanceManager.BalanceToExchangeV2(CoinID, userTrade->nUserPubKey, userTrade->nAmount))
 	{
 		std::cout << "Not enough balance" << std::endl;
 		return false;
 	}
 
-	userBalance->nAvailableBalance -= userTrade->nAmount;
-	userBalance->nInExchangeBalance += userTrade->nAmount;
-
-	if (!mapUserTrades.count(userTrade->nUserPubKey))
-		mapUserTrades.insert(std::make_pair(userTrade->nUserPubKey, pULTIUTC()));
+	userTrade->nUserID = traderRegistry.GetTraderID(userTrade->nUserPubKey);
+	if (!mapUserTrades.count(userTrade->nUserID))
+		mapUserTrades.insert(std::make_pair(userTrade->nUserID, pULTIUTC()));
 
-	auto& a = mapUserTrades[userTrade->nUserPubKey];
+	auto& a = mapUserTrades[userTrade->nUserID];
 	userTrade->nUserTradeID = a.first + 1;
 	userTrade->nBalanceAmount = userTrade->nAmount;
 	userTrade->nBalanceQty = userTrade->nQuantity;
@@ -258,102 +325,84 @@ bool CUserTradeManager::ProcessUserTradeRequest(const std::shared_ptr<CUserTrade
 
 void CUserTradeManager::SaveProcessedUserTrade(const std::shared_ptr<CUserTrade>& userTrade, CTradePair& tradePair)
 {
-	std::shared_ptr<CUserBalance> userBalance;
-	userBalanceManager.InitUserBalance(tradePair.nCoinID2, userTrade->nUserPubKey, userBalance);
-	userBalance->nAvailableBalance -= userTrade->nAmount;
-	userBalance->nInExchangeBalance += userTrade->nAmount;
+	balanceLedger.Move(tradePair.nCoinID2, userTrade->nUserPubKey, BALANCE_AVAILABLE, userTrade->nAmount, BALANCE_IN_EXCHANGE, userTrade->nAmount, false);
 
-	if (!mapUserTrades.count(userTrade->nUserPubKey))
-		mapUserTrades.insert(std::make_pair(userTrade->nUserPubKey, pULTIUTC()));	
-	mapUserTrades[userTrade->nUserPubKey].second.insert(std::make_pair(userTrade->nUserTradeID, userTrade));
+	if (!mapUserTrades.count(userTrade->nUserID))
+		mapUserTrades.insert(std::make_pair(userTrade->nUserID, pULTIUTC()));	
+	mapUserTrades[userTrade->nUserID].second.insert(std::make_pair(userTrade->nUserTradeID, userTrade));
 }
 
 void CUserTradeManager::InputMatchUserBuyRequest(const std::shared_ptr<CUserTrade>& userTrade, CTradePair& tradePair)
 {
 	std::cout << "Processing bid request: price: " << userTrade->nPrice << ", qty: " << userTrade->nQuantity << std::endl;
-	CUserTradeSetting& setting = mapUserTradeSetting[userTrade->nTradePairID];
-	if (setting.nTradePairID != userTrade->nTradePairID)
-		return;	
+	CUserTradeSetting* psetting = FindTradePairEntry(mapUserTradeSetting, userTrade->nTradePairID);
+	COrderBookEngine* pbook = FindTradePairEntry(mapUserTradeBook, userTrade->nTradePairID);
+	if (!psetting || !pbook)
+		return;
 
-	mUTPIUTV::iterator Sellers = mapAskUserTradeByPrice[userTrade->nTradePairID].begin();
-	while (Sellers != mapAskUserTradeByPrice[userTrade->nTradePairID].end() && Sellers->first <= userTrade->nPrice)
+	CUserTradeSetting& setting = *psetting;
+	COrderBookEngine& book = *pbook;
+	userTrade->nPairTradeID = ++setting.nLastPairTradeID;
+
+	while (!book.IsEmpty(false) && book.GetBestPrice(false) <= userTrade->nPrice)
 	{
-		mINTUT::iterator Seller = Sellers->second.begin();
-		while (Seller != Sellers->second.end())
+		const std::shared_ptr<CUserTrade>& ExistingTrade = book.GetBestOrder(false);
+		if (ExistingTrade->nBalanceQty <= 0)
 		{
-			auto& ExistingTrade = Seller->second;
-			if (ExistingTrade->nBalanceQty <= 0)
-			{
-				if (ExistingTrade->nBalanceAmount <= 0)
-				{
-					if (ExistingTrade->nBalanceQty == 0)
-						mapAskUserTradeByPrice[userTrade->nTradePairID][Sellers->first].erase(Seller->first);
-					else
-					{
-						//not possible to be here but check for security purpose
-					}
-				}
-				else
-				{
-					//not possible to be here but check for security purpose
-				}
-				++Seller;
-				continue;
-			}
+			//not possible to be here but check for security purpose
+			book.PopBestOrder(false);
+			continue;
+		}
 
-			int qty = 0;
-			if (userTrade->nBalanceQty <= ExistingTrade->nBalanceQty)
-				qty = userTrade->nBalanceQty;
-			else
-				qty = ExistingTrade->nBalanceQty;
-
-			int bidTradeFee = (userTrade->nTradeFee < tradePair.nAskTradeFee) ? userTrade->nTradeFee : tradePair.nAskTradeFee;
-			int askTradeFee = (ExistingTrade->nTradeFee < tradePair.nBidTradeFee) ? ExistingTrade->nTradeFee : tradePair.nBidTradeFee;
-			uint64_t bidAmount = GetBidRequiredAmount(ExistingTrade->nPrice, qty, bidTradeFee);
-			uint64_t askAmount = GetAskExpectedAmount(ExistingTrade->nPrice, qty, askTradeFee);
-			std::cout << "Found seller to match: price: " << ExistingTrade->nPrice << ", qty: " << qty << std::endl;
-			std::shared_ptr<CActualTrade> actualTrade = std::make_shared<CActualTrade>(tradePair.nTradePairID, userTrade->nUserTradeID, ExistingTrade->nUserTradeID, ExistingTrade->nPrice, qty, bidAmount, askAmount, userTrade->nUserPubKey, ExistingTrade->nUserPubKey, bidTradeFee, askTradeFee, true, GetAdjustedTime());
-			if (!actualTradeManager.GenerateActualTrade(actualTrade, setting))
-				return;
+		int qty = 0;
+		if (userTrade->nBalanceQty <= ExistingTrade->nBalanceQty)
+			qty = userTrade->nBalanceQty;
+		else
+			qty = ExistingTrade->nBalanceQty;
+
+		int bidTradeFee = (userTrade->nTradeFee < tradePair.nAskTradeFee) ? userTrade->nTradeFee : tradePair.nAskTradeFee;
+		int askTradeFee = (ExistingTrade->nTradeFee < tradePair.nBidTradeFee) ? ExistingTrade->nTradeFee : tradePair.nBidTradeFee;
+		uint64_t bidAmount = GetBidRequiredAmount(ExistingTrade->nPrice, qty, bidTradeFee);
+		uint64_t askAmount = GetAskExpectedAmount(ExistingTrade->nPrice, qty, askTradeFee);
+		std::cout << "Found seller to match: price: " << ExistingTrade->nPrice << ", qty: " << qty << std::endl;
+		std::shared_ptr<CActualTrade> actualTrade = std::make_shared<CActualTrade>(tradePair.nTradePairID, userTrade->nUserTradeID, ExistingTrade->nUserTradeID, ExistingTrade->nPrice, qty, bidAmount, askAmount, userTrade->nUserPubKey, ExistingTrade->nUserPubKey, bidTradeFee, askTradeFee, true, GetAdjustedTime());
+		actualTrade->nUserID1 = userTrade->nUserID;
+		actualTrade->nUserID2 = ExistingTrade->nUserID;
+		if (!actualTradeManager.GenerateActualTrade(actualTrade, setting))
+			return;
 			
-			ExistingTrade->nBalanceQty -= qty;
-			ExistingTrade->nBalanceAmount -= askAmount;			
-			userTrade->nBalanceQty -= qty;
-			userTrade->nBalanceAmount -= bidAmount;
-			actualTradeManager.InputActualTrade(actualTrade, setting, tradePair);
-			if (setting.nInChargeOfAskBroadcast)
-				orderBookManager.AdjustAskQuantity(actualTrade->nTradePairID, actualTrade->nTradePrice, (0 - actualTrade->nTradeQty));
+		ExistingTrade->nBalanceQty -= qty;
+		ExistingTrade->nBalanceAmount -= askAmount;			
+		userTrade->nBalanceQty -= qty;
+		userTrade->nBalanceAmount -= bidAmount;
+		actualTradeManager.InputActualTrade(actualTrade, setting, tradePair);
+		if (setting.nInChargeOfAskBroadcast)
+			orderBookManager.AdjustAskQuantity(actualTrade->nTradePairID, actualTrade->nTradePrice, (0 - actualTrade->nTradeQty));
 			
-			if (ExistingTrade->nBalanceQty == 0)
-			{
-				std::cout << "Completed seller order, balance amount: " << ExistingTrade->nBalanceAmount << std::endl;
-				mapAskUserTradeByPrice[userTrade->nTradePairID][Sellers->first].erase(Seller->first);
-			}
-			++Seller;
+		if (ExistingTrade->nBalanceQty == 0)
+		{
+			std::cout << "Completed seller order, balance amount: " << ExistingTrade->nBalanceAmount << std::endl;
+			book.PopBestOrder(false);
+		}
 
-			if (userTrade->nBalanceQty <= 0)
+		if (userTrade->nBalanceQty <= 0)
+		{
+			std::cout << "Completed buying request, balance amount: " << userTrade->nBalanceAmount << std::endl;
+			if (userTrade->nBalanceAmount > 0)
 			{
-				std::cout << "Completed buying request, balance amount: " << userTrade->nBalanceAmount << std::endl;
-				if (userTrade->nBalanceAmount > 0)
-				{
-					if (userBalanceManager.InChargeOfUserBalance(userTrade->nUserPubKey))
-						userBalanceManager.ExchangeToBalanceV2(tradePair.nCoinID2, userTrade->nUserPubKey, userTrade->nBalanceAmount);
-				}
-				return;
+				int CoinID = tradePair.nCoinID2;
+				std::string UserPubKey = userTrade->nUserPubKey;
+				int64_t BalanceAmount = userTrade->nBalanceAmount;
+				dexExecutor.PostUserTask([CoinID, UserPubKey, BalanceAmount]() {
+					if (userBalanceManager.InChargeOfUserBalance(UserPubKey))
+						userBalanceManager.ExchangeToBalanceV2(CoinID, UserPubKey, BalanceAmount);
+				});
 			}
+			return;
 		}
-		++Sellers;
 	}
 
-	auto& a = mapBidUserTradeByPrice[userTrade->nTradePairID];
-	if (!a.count(userTrade->nPrice))
-	{
-		mINTUT temp;
-		temp.insert(std::make_pair(userTrade->nUserTradeID, userTrade));
-		a.insert(std::make_pair(userTrade->nPrice, temp));
-	}
-	else
-		a[userTrade->nPrice].insert(std::make_pair(userTrade->nUserTradeID, userTrade));
+	book.AddOrder(userTrade);
 
 	if (setting.nInChargeOfBidBroadcast)
 		orderBookManager.AdjustBidQuantity(userTrade->nTradePairID, userTrade->nPrice, userTrade->nBalanceQty);
@@ -362,84 +411,64 @@ void CUserTradeManager::InputMatchUserBuyRequest(const std::shared_ptr<CUserTrad
 void CUserTradeManager::InputMatchUserSellRequest(const std::shared_ptr<CUserTrade>& userTrade, CTradePair& tradePair)
 {
 	std::cout << "Processing ask request: price: " << userTrade->nPrice << ", qty: " << userTrade->nQuantity << std::endl;
-	CUserTradeSetting& actualTradeSetting = mapUserTradeSetting[userTrade->nTradePairID];
-	if (actualTradeSetting.nTradePairID != userTrade->nTradePairID)
+	CUserTradeSetting* psetting = FindTradePairEntry(mapUserTradeSetting, userTrade->nTradePairID);
+	COrderBookEngine* pbook = FindTradePairEntry(mapUserTradeBook, userTrade->nTradePairID);
+	if (!psetting || !pbook)
 		return;
 
-	mUTPIUTV::reverse_iterator Buyers = mapBidUserTradeByPrice[userTrade->nTradePairID].rbegin();
-	while (Buyers != mapBidUserTradeByPrice[userTrade->nTradePairID].rend() && Buyers->first >= userTrade->nPrice)
+	CUserTradeSetting& actualTradeSetting = *psetting;
+	COrderBookEngine& book = *pbook;
+	userTrade->nPairTradeID = ++actualTradeSetting.nLastPairTradeID;
+
+	while (!book.IsEmpty(true) && book.GetBestPrice(true) >= userTrade->nPrice)
 	{
-		mINTUT::iterator Buyer = Buyers->second.begin();
-		while (Buyer != Buyers->second.end())
+		const std::shared_ptr<CUserTrade>& ExistingTrade = book.GetBestOrder(true);
+		if (ExistingTrade->nBalanceQty <= 0)
 		{
-			auto& ExistingTrade = Buyer->second;
-			if (ExistingTrade->nBalanceQty <= 0)
-			{
-				if (ExistingTrade->nBalanceAmount <= 0)
-				{
-					if (ExistingTrade->nBalanceQty == 0)
-						mapBidUserTradeByPrice[userTrade->nTradePairID][Buyers->first].erase(Buyer->first);
-					else
-					{
-						//not possible to be here but check for security purpose
-					}
-				}
-				else
-				{
-					//not possible to be here but check for security purpose
-				}
-				++Buyer;
-				continue;
-			}
+			//not possible to be here but check for security purpose
+			book.PopBestOrder(true);
+			continue;
+		}
 
-			int qty = 0;
-			if (userTrade->nBalanceQty <= ExistingTrade->nBalanceQty)
-				qty = userTrade->nBalanceQty;
-			else
-				qty = ExistingTrade->nBalanceQty;
-
-			int bidTradeFee = (ExistingTrade->nTradeFee < tradePair.nBidTradeFee) ? ExistingTrade->nTradeFee : tradePair.nBidTradeFee;
-			int askTradeFee = (userTrade->nTradeFee < tradePair.nAskTradeFee) ? userTrade->nTradeFee : tradePair.nAskTradeFee;
-			uint64_t bidAmount = GetBidRequiredAmount(ExistingTrade->nPrice, qty, bidTradeFee);
-			uint64_t askAmount = GetAskExpectedAmount(ExistingTrade->nPrice, qty, askTradeFee);
-			std::cout << "Found buyer to match: price: " << ExistingTrade->nPrice << ", qty: " << qty << std::endl;
-			std::shared_ptr<CActualTrade> actualTrade = std::make_shared<CActualTrade>(tradePair.nTradePairID, ExistingTrade->nUserTradeID, userTrade->nUserTradeID, ExistingTrade->nPrice, qty, bidAmount, askAmount, ExistingTrade->nUserPubKey, userTrade->nUserPubKey, bidTradeFee, askTradeFee, false, GetAdjustedTime());
-			if (!actualTradeManager.GenerateActualTrade(actualTrade, actualTradeSetting))
-				return;
+		int qty = 0;
+		if (userTrade->nBalanceQty <= ExistingTrade->nBalanceQty)
+			qty = userTrade->nBalanceQty;
+		else
+			qty = ExistingTrade->nBalanceQty;
+
+		int bidTradeFee = (ExistingTrade->nTradeFee < tradePair.nBidTradeFee) ? ExistingTrade->nTradeFee : tradePair.nBidTradeFee;
+		int askTradeFee = (userTrade->nTradeFee < tradePair.nAskTradeFee) ? userTrade->nTradeFee : tradePair.nAskTradeFee;
+		uint64_t bidAmount = GetBidRequiredAmount(ExistingTrade->nPrice, qty, bidTradeFee);
+		uint64_t askAmount = GetAskExpectedAmount(ExistingTrade->nPrice, qty, askTradeFee);
+		std::cout << "Found buyer to match: price: " << ExistingTrade->nPrice << ", qty: " << qty << std::endl;
+		std::shared_ptr<CActualTrade> actualTrade = std::make_shared<CActualTrade>(tradePair.nTradePairID, ExistingTrade->nUserTradeID, userTrade->nUserTradeID, ExistingTrade->nPrice, qty, bidAmount, askAmount, ExistingTrade->nUserPubKey, userTrade->nUserPubKey, bidTradeFee, askTradeFee, false, GetAdjustedTime());
+		actualTrade->nUserID1 = ExistingTrade->nUserID;
+		actualTrade->nUserID2 = userTrade->nUserID;
+		if (!actualTradeManager.GenerateActualTrade(actualTrade, actualTradeSetting))
+			return;
 
-			ExistingTrade->nBalanceQty -= qty;
-			ExistingTrade->nBalanceAmount -= bidAmount;			
-			userTrade->nBalanceQty -= qty;			
-			userTrade->nBalanceAmount -= askAmount;
-			actualTradeManager.InputActualTrade(actualTrade, actualTradeSetting, tradePair);
-			if (actualTradeSetting.nInChargeOfBidBroadcast)
-				orderBookManager.AdjustBidQuantity(actualTrade->nTradePairID, actualTrade->nTradePrice, (0 - actualTrade->nTradeQty));
+		ExistingTrade->nBalanceQty -= qty;
+		ExistingTrade->nBalanceAmount -= bidAmount;			
+		userTrade->nBalanceQty -= qty;			
+		userTrade->nBalanceAmount -= askAmount;
+		actualTradeManager.InputActualTrade(actualTrade, actualTradeSetting, tradePair);
+		if (actualTradeSetting.nInChargeOfBidBroadcast)
+			orderBookManager.AdjustBidQuantity(actualTrade->nTradePairID, actualTrade->nTradePrice, (0 - actualTrade->nTradeQty));
 
-			if (ExistingTrade->nBalanceQty == 0)
-			{
-				std::cout << "Completed buyer order, balance amount: " << ExistingTrade->nBalanceAmount << std::endl;
-				mapBidUserTradeByPrice[userTrade->nTradePairID][Buyers->first].erase(Buyer->first);
-			}
-			++Buyer;
+		if (ExistingTrade->nBalanceQty == 0)
+		{
+			std::cout << "Completed buyer order, balance amount: " << ExistingTrade->nBalanceAmount << std::endl;
+			book.PopBestOrder(true);
+		}
 
-			if (userTrade->nBalanceQty <= 0)
-			{
-				std::cout << "Completed selling request, balance amount: " << userTrade->nBalanceAmount << std::endl;
-				return;
-			}
+		if (userTrade->nBalanceQty <= 0)
+		{
+			std::cout << "Completed selling request, balance amount: " << userTrade->nBalanceAmount << std::endl;
+			return;
 		}
-		++Buyers;
 	}
 
-	auto& a = mapAskUserTradeByPrice[userTrade->nTradePairID];
-	if (!a.count(userTrade->nPrice))
-	{
-		mINTUT temp;
-		temp.insert(std::make_pair(userTrade->nUserTradeID, userTrade));
-		a.insert(std::make_pair(userTrade->nPrice, temp));
-	}
-	else
-		a[userTrade->nPrice].insert(std::make_pair(userTrade->nUserTradeID, userTrade));
+	book.AddOrder(userTrade);
 
 	if (actualTradeSetting.nInChargeOfAskBroadcast)
 		orderBookManager.AdjustAskQuantity(userTrade->nTradePairID, userTrade->nPrice, userTrade->nBalanceQty);
@@ -460,48 +489,68 @@ bool CActualTradeManager::GenerateActualTrade(std::shared_ptr<CActualTrade> actu
 	return true;
 }
 
-bool CActualTradeManager::InputActualTrade(const std::shared_ptr<CActualTrade>& actualTrade, CUserTradeSetting& setting, CTradePair& tradePair)
+static void IndexActualTrade(const std::shared_ptr<CActualTrade>& actualTrade, std::set<std::string>& setHash, mATIAT& mapByID, mUTImAT& mapByUserTrade)
 {
-	mapActualTradeHash[actualTrade->nTradePairID].insert(actualTrade->GetHash());
+	setHash.insert(actualTrade->GetHash());
 	std::pair<int, std::shared_ptr<CActualTrade>> temp(std::make_pair(actualTrade->nActualTradeID, actualTrade));
-	mapActualTradeByActualTradeID[actualTrade->nTradePairID].insert(temp);
+	mapByID.insert(temp);
+	mapByUserTrade[actualTrade->nUserTrade1].insert(temp);
+	mapByUserTrade[actualTrade->nUserTrade2].insert(temp);
+}
 
-	auto& a = mapActualTradeByUserTradeID[actualTrade->nTradePairID];
-	if (a.count(actualTrade->nUserTrade1))
-		a[actualTrade->nUserTrade1].insert(temp);
-	else
-	{
-		mATIAT temp2;
-		temp2.insert(temp);
-		a.insert(std::make_pair(actualTrade->nUserTrade1, temp2));
-	}
+bool CActualTradeManager::InputActualTrade(const std::shared_ptr<CActualTrade>& actualTrade, CUserTradeSetting& setting, CTradePair& tradePair)
+{
+	std::set<std::string>* psetHash = FindTradePairEntry(mapActualTradeHash, actualTrade->nTradePairID);
+	mATIAT* pmapByID = FindTradePairEntry(mapActualTradeByActualTradeID, actualTrade->nTradePairID);
+	mUTImAT* pmapByUserTrade = FindTradePairEntry(mapActualTradeByUserTradeID, actualTrade->nTradePairID);
+	if (!psetHash || !pmapByID || !pmapByUserTrade)
+		return false;
+
+	IndexActualTrade(actualTrade, *psetHash, *pmapByID, *pmapByUserTrade);
 
-	if (a.count(actualTrade->nUserTrade2))
-		a[actualTrade->nUserTrade2].insert(temp);
-	else
+	if (setting.nInChargeOfChartData)
 	{
-		mATIAT temp2;
-		temp2.insert(temp);
-		a.insert(std::make_pair(actualTrade->nUserTrade2, temp2));
+		ChartDataManager.InputNewTrade(actualTrade->nTradePairID, actualTrade->nTradePrice, actualTrade->nTradeQty, actualTrade->nTradeTime);
+		marketOverviewManager.InputNewTrade(actualTrade->nTradePairID, actualTrade->nTradePrice, actualTrade->nTradeQty, actualTrade->nTradeTime);
 	}
+
+	if (!tradeLogManager.AppendActualTrade(*actualTrade))
+		LogPrintf("CActualTradeManager::InputActualTrade -- unable to log actual trade %d of pair %d\n", actualTrade->nActualTradeID, actualTrade->nTradePairID);
+
+	//balances and trade history are shared by all pairs, hand them over to the user worker
+	bool fUserTradeHistory = setting.nInChargeOfUserTradeHistory;
+	bool fMarketTradeHistory = setting.nInChargeOfMarketTradeHistory;
+	CTradePair settleTradePair = tradePair;
+	dexExecutor.PostUserTask([actualTrade, settleTradePair, fUserTradeHistory, fMarketTradeHistory]() {
+		actualTradeManager.SettleActualTrade(actualTrade, settleTradePair, fUserTradeHistory, fMarketTradeHistory);
+	});
 	
+	actualTrade->Relay();
+	return true;
+}
+
+//runs on the user worker
+void CActualTradeManager::SettleActualTrade(const std::shared_ptr<CActualTrade>& actualTrade, const CTradePair& tradePair, bool fUserTradeHistory, bool fMarketTradeHistory)
+{
 	if (userBalanceManager.InChargeOfUserBalance(actualTrade->nUserPubKey1))
+	{
+		userTradeManager.UpdateUserTradeAfterTrade(actualTrade->nUserID1, actualTrade->nUserTrade1, actualTrade->nTradeQty, actualTrade->nBidAmount);
 		userBalanceManager.UpdateAfterTradeBalance(actualTrade->nUserPubKey1, tradePair.nCoinID2, tradePair.nCoinID1, actualTrade->nBidAmount, actualTrade->nTradeQty);
+	}
 	if (userBalanceManager.InChargeOfUserBalance(actualTrade->nUserPubKey2))
+	{
+		userTradeManager.UpdateUserTradeAfterTrade(actualTrade->nUserID2, actualTrade->nUserTrade2, actualTrade->nTradeQty, actualTrade->nAskAmount);
 		userBalanceManager.UpdateAfterTradeBalance(actualTrade->nUserPubKey2, tradePair.nCoinID1, tradePair.nCoinID2, actualTrade->nTradeQty, actualTrade->nAskAmount);
-	if (setting.nInChargeOfChartData)
-		ChartDataManager.InputNewTrade(actualTrade->nTradePairID, actualTrade->nTradePrice, actualTrade->nTradeQty, actualTrade->nTradeTime);
-	if (setting.nInChargeOfMarketTradeHistory || setting.nInChargeOfUserTradeHistory)
+	}
+	if (fMarketTradeHistory || fUserTradeHistory)
 	{
-		std::shared_ptr<CUserTradeHistory> tradeHistory = std::make_shared<CUserTradeHistory>(actualTrade->nTradePairID, actualTrade->nUserPubKey1, actualTrade->nUserPubKey2, actualTrade->nTradePrice, actualTrade->nTradeQty, actualTrade->nTradeAmount, false, actualTrade->nTradeTime);
-		if (setting.nInChargeOfMarketTradeHistory)
+		std::shared_ptr<CUserTradeHistory> tradeHistory = MakeTradeHistory(*actualTrade);
+		if (fMarketTradeHistory)
 			userTradeHistoryManager.InputMarketTradeHistory(tradeHistory);
-		if (setting.nInChargeOfUserTradeHistory)
+		if (fUserTradeHistory)
 			userTradeHistoryManager.InputUserTradeHistory(tradeHistory);
+		tradeLogManager.AppendTradeHistory(tradeHistory);
 	}
-	
-	actualTrade->Relay();
-	return true;
 }
 
 bool CActualTradeManager::InputActualTradeFromNetwork(const std::shared_ptr<CActualTrade>& actualTrade, CUserTradeSetting& setting, CTradePair& tradePair)
@@ -528,14 +577,18 @@ bool CActualTradeManager::InputActualTradeFromNetwork(const std::shared_ptr<CAct
 		return false;
 	}
 
-	if (mapActualTradeHash[actualTrade->nTradePairID].count(actualTrade->GetHash()))
+	std::set<std::string>* psetHash = FindTradePairEntry(mapActualTradeHash, actualTrade->nTradePairID);
+	if (!psetHash || psetHash->count(actualTrade->GetHash()))
 		return false;
 
+	actualTrade->nUserID1 = traderRegistry.GetTraderID(actualTrade->nUserPubKey1);
+	actualTrade->nUserID2 = traderRegistry.GetTraderID(actualTrade->nUserPubKey2);
+
 	if (userBalanceManager.InChargeOfUserBalance(actualTrade->nUserPubKey1) || userBalanceManager.InChargeOfBackup(actualTrade->nUserPubKey1))
 	{
-		if (mapUserTrades.count(actualTrade->nUserPubKey1))
+		if (mapUserTrades.count(actualTrade->nUserID1))
 		{
-			auto& a = mapUserTrades[actualTrade->nUserPubKey1];
+			auto& a = mapUserTrades[actualTrade->nUserID1];
 			if (a.first >= actualTrade->nUserTrade1)
 			{
 				auto& b = a.second[actualTrade->nUserTrade1];
@@ -568,9 +621,9 @@ bool CActualTradeManager::InputActualTradeFromNetwork(const std::shared_ptr<CAct
 
 	if (userBalanceManager.InChargeOfUserBalance(actualTrade->nUserPubKey2) || userBalanceManager.InChargeOfBackup(actualTrade->nUserPubKey2))
 	{
-		if (mapUserTrades.count(actualTrade->nUserPubKey2))
+		if (mapUserTrades.count(actualTrade->nUserID2))
 		{
-			auto& a = mapUserTrades[actualTrade->nUserPubKey2];
+			auto& a = mapUserTrades[actualTrade->nUserID2];
 			if (a.first >= actualTrade->nUserTrade2)
 			{
 				auto& b = a.second[actualTrade->nUserTrade2];
@@ -601,17 +654,23 @@ bool CActualTradeManager::InputActualTradeFromNetwork(const std::shared_ptr<CAct
 		}
 	}
 	if (setting.nInChargeOfChartData)
+	{
 		ChartDataManager.InputNewTrade(actualTrade->nTradePairID, actualTrade->nTradePrice, actualTrade->nTradeQty, actualTrade->nTradeTime);
+		marketOverviewManager.InputNewTrade(actualTrade->nTradePairID, actualTrade->nTradePrice, actualTrade->nTradeQty, actualTrade->nTradeTime);
+	}
 	if (setting.nInChargeOfMarketTradeHistory)
 	{
-		std::shared_ptr<CUserTradeHistory> tradeHistory = std::make_shared<CUserTradeHistory>(actualTrade->nTradePairID, actualTrade->nUserPubKey1, actualTrade->nUserPubKey2, actualTrade->nTradePrice, actualTrade->nTradeQty, actualTrade->nTradeAmount, false, actualTrade->nTradeTime);
+		std::shared_ptr<CUserTradeHistory> tradeHistory = MakeTradeHistory(*actualTrade);
 		userTradeHistoryManager.InputMarketTradeHistory(tradeHistory);
 	}
 	if (setting.nInChargeOfUserTradeHistory)
 	{
-		std::shared_ptr<CUserTradeHistory> tradeHistory = std::make_shared<CUserTradeHistory>(actualTrade->nTradePairID, actualTrade->nUserPubKey1, actualTrade->nUserPubKey2, actualTrade->nTradePrice, actualTrade->nTradeQty, actualTrade->nTradeAmount, false, actualTrade->nTradeTime);
+		std::shared_ptr<CUserTradeHistory> tradeHistory = MakeTradeHistory(*actualTrade);
 		userTradeHistoryManager.InputUserTradeHistory(tradeHistory);
 	}
+	tradeLogManager.AppendActualTrade(*actualTrade);
+	if (setting.nInChargeOfMarketTradeHistory || setting.nInChargeOfUserTradeHistory)
+		tradeLogManager.AppendTradeHistory(MakeTradeHistory(*actualTrade));
 	if (setting.nInChargeOfBidBroadcast)
 	{
 		if (!actualTrade->nFromBid)
@@ -634,52 +693,72 @@ bool CActualTradeManager::InputActualTradeFromNetwork(const std::shared_ptr<CAct
 
 void CUserTradeManager::InitTradePair(int TradePairID)
 {
+	LOCK(cs_mapTradePair);
 	if (mapUserTradeSetting.count(TradePairID))
 		return;
 
-	mapBidUserTradeByPrice.insert(std::make_pair(TradePairID, mUTPIUTV()));
-	mapAskUserTradeByPrice.insert(std::make_pair(TradePairID, mUTPIUTV()));
+	mapUserTradeBook.insert(std::make_pair(TradePairID, COrderBookEngine(TradePairID)));
 	mapUserTradeSetting.insert(std::make_pair(TradePairID, CUserTradeSetting(TradePairID, ""))); //to update with actual MN key
 	mapActualTradeByActualTradeID.insert(std::make_pair(TradePairID, mATIAT()));
 	mapActualTradeByUserTradeID.insert(std::make_pair(TradePairID, mUTImAT()));
 	mapConflictTrade.insert(std::make_pair(TradePairID, std::vector<CActualTrade>()));
 	mapActualTradeHash.insert(std::make_pair(TradePairID, std::set<std::string>()));
+
+	//carry on from the trades already logged, the log refuses IDs it holds and a restarted
+	//node numbering from 0 again would no longer persist anything
+	std::vector<CActualTrade> vActualTrade;
+	tradeLogManager.GetLastActualTrades(TradePairID, TRADE_LOG_RELOAD_ACTUAL_TRADES, vActualTrade);
+	if (vActualTrade.empty())
+		return;
+
+	CUserTradeSetting& setting = mapUserTradeSetting[TradePairID];
+	setting.nLastActualTradeID = vActualTrade.back().nActualTradeID;
+	setting.nLastActualTradeTime = vActualTrade.back().nTradeTime;
+	for (const CActualTrade& actualTrade : vActualTrade)
+		IndexActualTrade(std::make_shared<CActualTrade>(actualTrade), mapActualTradeHash[TradePairID],
+			mapActualTradeByActualTradeID[TradePairID], mapActualTradeByUserTradeID[TradePairID]);
+	LogPrint("infinidex", "CUserTradeManager::InitTradePair -- pair %d continues from actual trade %d\n", TradePairID, setting.nLastActualTradeID);
 }
 
-void CUserTradeManager::AssignBidBroadcastRole(int TradePairID, bool toAssign)
+//the setting belongs to the pair worker, it is changed there in order with the pair's trades
+void CUserTradeManager::UpdateTradeSetting(int TradePairID, std::function<void(CUserTradeSetting&)> update)
 {
 	InitTradePair(TradePairID);
-	mapUserTradeSetting[TradePairID].nInChargeOfBidBroadcast = toAssign;
+	dexExecutor.PostTradePairTask(TradePairID, [TradePairID, update]() {
+		CUserTradeSetting* setting = FindTradePairEntry(mapUserTradeSetting, TradePairID);
+		if (setting)
+			update(*setting);
+	});
+}
+
+void CUserTradeManager::AssignBidBroadcastRole(int TradePairID, bool toAssign)
+{
+	UpdateTradeSetting(TradePairID, [toAssign](CUserTradeSetting& setting) { setting.nInChargeOfBidBroadcast = toAssign; });
 }
 
 void CUserTradeManager::AssignAskBroadcastRole(int TradePairID, bool toAssign)
 {
-	InitTradePair(TradePairID);
-	mapUserTradeSetting[TradePairID].nInChargeOfAskBroadcast = toAssign;
+	UpdateTradeSetting(TradePairID, [toAssign](CUserTradeSetting& setting) { setting.nInChargeOfAskBroadcast = toAssign; });
 }
 
 void CUserTradeManager::AssignMatchUserTradeRole(int TradePairID, bool toAssign)
 {
-	InitTradePair(TradePairID);
-	mapUserTradeSetting[TradePairID].nInChargeOfMatchUserTrade = toAssign;
+	UpdateTradeSetting(TradePairID, [toAssign](CUserTradeSetting& setting) { setting.nInChargeOfMatchUserTrade = toAssign; });
 }
 
 void CUserTradeManager::AssignUserHistoryProviderRole(int TradePairID, bool toAssign)
 {
-	InitTradePair(TradePairID);
-	mapUserTradeSetting[TradePairID].nInChargeOfUserTradeHistory = toAssign;
+	UpdateTradeSetting(TradePairID, [toAssign](CUserTradeSetting& setting) { setting.nInChargeOfUserTradeHistory = toAssign; });
 }
 
 void CUserTradeManager::AssignMarketHistoryProviderRole(int TradePairID, bool toAssign)
 {
-	InitTradePair(TradePairID);
-	mapUserTradeSetting[TradePairID].nInChargeOfMarketTradeHistory = toAssign;
+	UpdateTradeSetting(TradePairID, [toAssign](CUserTradeSetting& setting) { setting.nInChargeOfMarketTradeHistory = toAssign; });
 }
 
 void CUserTradeManager::AssignChartDataProviderRole(int TradePairID, bool toAssign)
 {
-	InitTradePair(TradePairID);
-	mapUserTradeSetting[TradePairID].nInChargeOfChartData = toAssign;
+	UpdateTradeSetting(TradePairID, [toAssign](CUserTradeSetting& setting) { setting.nInChargeOfChartData = toAssign; });
 }
 
 uint64_t CUserTradeManager::GetBidRequiredAmount(uint64_t Price, uint64_t Qty, int TradeFee)
@@ -780,6 +859,21 @@ bool CActualTrade::Relay()
 	return true;
 }
 
+//runs on the user worker
+void CUserTradeManager::UpdateUserTradeAfterTrade(uint32_t UserID, int UserTradeID, uint64_t Qty, uint64_t Amount)
+{
+	if (!mapUserTrades.count(UserID))
+		return;
+
+	auto& a = mapUserTrades[UserID];
+	if (!a.second.count(UserTradeID))
+		return;
+
+	auto& b = a.second[UserTradeID];
+	b->nBalanceQty -= Qty;
+	b->nBalanceAmount -= Amount;
+}
+
 bool CUserTradeManager::ReduceBalanceQty(int TradePairID, int UserTradeID1, int UserTradeID2, uint64_t Qty)
 {
 	return true;
@@ -800,6 +894,21 @@ bool CActualTradeManager::IsActualTradeInList(int TradePairID, int ActualTradeID
 	return true;
 }
 
+//normally done by the user's wallet, used by tests and benchmarks to build signed trades
+bool CUserTrade::UserSign(const CKey& key)
+{
+	std::string strMessage = boost::lexical_cast<std::string>(nTradePairID) + boost::lexical_cast<std::string>(nPrice) + boost::lexical_cast<std::string>(nQuantity)
+		+ boost::lexical_cast<std::string>(nAmount) + boost::lexical_cast<std::string>(nIsBid)+ boost::lexical_cast<std::string>(nTradeFee) + nUserPubKey
+		+ boost::lexical_cast<std::string>(nTimeSubmit) + nUserHash;
+
+	if (!CMessageSigner::SignMessage(strMessage, userVchSig, key)) {
+		LogPrintf("CUserTrade::UserSign -- SignMessage() failed\n");
+		return false;
+	}
+
+	return true;
+}
+
 bool CUserTrade::VerifyUserSignature()
 {
 	std::string strError = "";
@@ -808,7 +917,7 @@ bool CUserTrade::VerifyUserSignature()
 		+ boost::lexical_cast<std::string>(nTimeSubmit) + nUserHash;
 	CPubKey pubkey(ParseHex(nUserPubKey));
 
-	if (!CMessageSigner::VerifyMessage(pubkey, userVchSig, strMessage, strError)) {
+	if (!dexVerifier.VerifyMessage(pubkey, userVchSig, strMessage, strError)) {
 		LogPrintf("CUserTrade::VerifyUserSignature -- VerifyMessage() failed, error: %s\n", strError);
 		return false;
 	}
@@ -825,7 +934,7 @@ bool CUserTrade::VerifyMNBalanceSignature()
 		+ boost::lexical_cast<std::string>(nBalanceQty) + boost::lexical_cast<std::string>(nBalanceAmount) + boost::lexical_cast<std::string>(nLastUpdate);
 	CPubKey pubkey(ParseHex(nMNBalancePubKey));
 
-	if (!CMessageSigner::VerifyMessage(pubkey, mnBalanceVchSig, strMessage, strError)) {
+	if (!dexVerifier.VerifyMessage(pubkey, mnBalanceVchSig, strMessage, strError)) {
 		LogPrintf("CUserTrade::VerifyUserSignature -- VerifyMessage() failed, error: %s\n", strError);
 		return false;
 	}
@@ -843,7 +952,7 @@ bool CUserTrade::VerifyMNTradeSignature()
 		+ boost::lexical_cast<std::string>(nLastUpdate);
 	CPubKey pubkey(ParseHex(nMNTradePubKey));
 
-	if (!CMessageSigner::VerifyMessage(pubkey, mnTradeVchSig, strMessage, strError)) {
+	if (!dexVerifier.VerifyMessage(pubkey, mnTradeVchSig, strMessage, strError)) {
 		LogPrintf("CUserTrade::VerifyMNTradeSignature -- VerifyMessage() failed, error: %s\n", strError);
 		return false;
 	}
@@ -893,6 +1002,19 @@ bool CCancelTrade::MNSign()
 	return true;
 }
 
+bool CCancelTrade::UserSign(const CKey& key)
+{
+	std::string strMessage = boost::lexical_cast<std::string>(nUserTradeID) + boost::lexical_cast<std::string>(nPairTradeID) + nUserPubKey + boost::lexical_cast<std::string>(isBid)
+		+ boost::lexical_cast<std::string>(nUserSubmitTime) + boost::lexical_cast<std::string>(nPrice);
+
+	if (!CMessageSigner::SignMessage(strMessage, userVchSig, key)) {
+		LogPrintf("CCancelTrade::UserSign -- SignMessage() failed\n");
+		return false;
+	}
+
+	return true;
+}
+
 bool CCancelTrade::VerifyUserSignature()
 {
 	std::string strError = "";
@@ -900,7 +1022,7 @@ bool CCancelTrade::VerifyUserSignature()
 		+ boost::lexical_cast<std::string>(nUserSubmitTime) + boost::lexical_cast<std::string>(nPrice);
 	CPubKey pubkey(ParseHex(nUserPubKey));
 
-	if (!CMessageSigner::VerifyMessage(pubkey, userVchSig, strMessage, strError)) {
+	if (!dexVerifier.VerifyMessage(pubkey, userVchSig, strMessage, strError)) {
 		LogPrintf("CCancelTrade::VerifyUserSignature -- VerifyMessage() failed, error: %s\n", strError);
 		return false;
 	}
@@ -916,7 +1038,7 @@ bool CCancelTrade::VerifyMNSignature()
 		+ boost::lexical_cast<std::string>(nBalanceAmount) + nMNTradePubKey + boost::lexical_cast<std::string>(nMNProcessTime);
 	CPubKey pubkey(ParseHex(MNPubKey));
 
-	if (!CMessageSigner::VerifyMessage(pubkey, mnVchSig, strMessage, strError)) {
+	if (!dexVerifier.VerifyMessage(pubkey, mnVchSig, strMessage, strError)) {
 		LogPrintf("CCancelTrade::VerifyMNSignature -- VerifyMessage() failed, error: %s\n", strError);
 		return false;
 	}
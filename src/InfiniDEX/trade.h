@@ -11,11 +11,16 @@
 #include <memory>
 #include <set>
 #include "tradepair.h"
+#include "traderregistry.h"
 #include "userconnection.h"
 #include "hash.h"
 #include "net.h"
+#include "sync.h"
 #include "utilstrencodings.h"
 
+#include <functional>
+
+class CKey;
 class CUserTrade;
 class CUserTradeSetting;
 class CUserTradeManager;
@@ -26,19 +31,25 @@ class CActualTradeManager;
 typedef std::map<int, std::shared_ptr<CUserTrade>> mINTUT; //int and trade details
 
 typedef std::pair<int, mINTUT> pULTIUTC;
-extern std::map<std::string, pULTIUTC> mapUserTrades;
-
-typedef std::map<uint64_t, mINTUT> mUTPIUTV; //price and user trade container
-extern std::map<int, mUTPIUTV> mapBidUserTradeByPrice;
-extern std::map<int, mUTPIUTV> mapAskUserTradeByPrice;
-
+extern std::map<uint32_t, pULTIUTC> mapUserTrades; //by trader ID, owned by the user worker
+
+/**
+ * Per trade pair state: mapUserTradeSetting, mapUserTradeBook, mapActualTradeByActualTradeID,
+ * mapActualTradeByUserTradeID, mapConflictTrade and mapActualTradeHash.
+ *
+ * cs_mapTradePair guards which pairs these maps hold, not their entries. Entries are only
+ * added by InitTradePair and never erased while the executor runs, so a pair worker looks its
+ * entries up under the lock and then uses them without it. The entries of a pair, role flags
+ * included, are only read and written by the pair's worker.
+ */
+extern CCriticalSection cs_mapTradePair;
 extern std::map<int, CUserTradeSetting> mapUserTradeSetting;
 extern CUserTradeManager userTradeManager;
 
 typedef std::map<int, std::shared_ptr<CActualTrade>> mATIAT;
 typedef std::map<int, mATIAT> mUTImAT;
 
-extern std::map<std::string, mUTImAT> mapUserActualTrades;
+extern std::map<uint32_t, mUTImAT> mapUserActualTrades; //by trader ID
 
 extern std::map<int, mATIAT> mapActualTradeByActualTradeID;
 extern std::map<int, mUTImAT> mapActualTradeByUserTradeID;
@@ -64,6 +75,7 @@ public:
 	uint64_t nBalanceAmount;
 	std::string nMNTradePubKey;
 	uint64_t nMNProcessTime;
+	uint32_t nUserID; //interned nUserPubKey, not serialized
 
 	CCancelTrade() :
 		nUserTradeID(0),
@@ -76,7 +88,8 @@ public:
 		nBalanceQty(0),
 		nBalanceAmount(0),
 		nMNTradePubKey(""),
-		nMNProcessTime(0)
+		nMNProcessTime(0),
+		nUserID(TRADER_ID_NONE)
 	{}
 
 	ADD_SERIALIZE_METHODS;
@@ -98,6 +111,7 @@ public:
 		READWRITE(mnVchSig);
 	}
 
+	bool UserSign(const CKey& key);
 	bool VerifyUserSignature();
 	bool VerifyMNSignature();
 	bool MNSign();
@@ -185,6 +199,7 @@ public:
 	int64_t nBalanceQty;
 	int64_t nBalanceAmount;
 	uint64_t nLastUpdate;
+	uint32_t nUserID; //interned nUserPubKey, not serialized
 
 	//to remove on actual implementation
 	CUserTrade(int nTradePairID, uint64_t nPrice, uint64_t nQuantity, bool nIsBid, int nTradeFee, std::string nUserPubKey, uint64_t nTimeSubmit, std::string nUserHash) :
@@ -203,7 +218,8 @@ public:
 		nMNTradePubKey(""),
 		nBalanceQty(nQuantity),
 		nBalanceAmount(nAmount),
-		nLastUpdate(0)
+		nLastUpdate(0),
+		nUserID(TRADER_ID_NONE)
 	{}
 
 	CUserTrade() :
@@ -222,9 +238,36 @@ public:
 		nMNTradePubKey(""),
 		nBalanceQty(0),
 		nBalanceAmount(0),
-		nLastUpdate(0)
+		nLastUpdate(0),
+		nUserID(TRADER_ID_NONE)
 	{}
 
+	ADD_SERIALIZE_METHODS;
+
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+		READWRITE(nTradePairID);
+		READWRITE(nPrice);
+		READWRITE(nQuantity);
+		READWRITE(nAmount);
+		READWRITE(nIsBid);
+		READWRITE(nTradeFee);
+		READWRITE(nUserPubKey);
+		READWRITE(nTimeSubmit);
+		READWRITE(nUserHash);
+		READWRITE(nUserTradeID);
+		READWRITE(nPairTradeID);
+		READWRITE(nMNBalancePubKey);
+		READWRITE(nMNTradePubKey);
+		READWRITE(nBalanceQty);
+		READWRITE(nBalanceAmount);
+		READWRITE(nLastUpdate);
+		READWRITE(userVchSig);
+		READWRITE(mnBalanceVchSig);
+		READWRITE(mnTradeVchSig);
+	}
+
+	bool UserSign(const CKey& key);
 	bool VerifyUserSignature();
 	bool VerifyMNBalanceSignature();
 	bool VerifyMNTradeSignature();
@@ -244,7 +287,9 @@ public:
 	void InputTradeCancel(CCancelTrade& cancelTrade);
 	void ProcessTradeCancelRequest(CCancelTrade& cancelTrade);
 	void ReturnTradeCancelBalance(CCancelTrade& cancelTrade);
+	void InputPairTradeCancel(CCancelTrade& cancelTrade);
 	void InitTradePair(int TradePairID);
+	void UpdateTradeSetting(int TradePairID, std::function<void(CUserTradeSetting&)> update);
 	void AssignBidBroadcastRole(int TradePairID, bool toAssign = true);
 	void AssignAskBroadcastRole(int TradePairID, bool toAssign = true);
 	void AssignUserHistoryProviderRole(int TradePairID, bool toAssign = true);
@@ -258,6 +303,8 @@ public:
 	bool IsSubmittedBidAmountValid(const std::shared_ptr<CUserTrade>& userTrade, int nTradeFee);
 	bool IsSubmittedAskAmountValid(const std::shared_ptr<CUserTrade>& userTrade, int nTradeFee);
 	void InputUserTrade(const std::shared_ptr<CUserTrade>& userTrade);
+	void InputPairUserTrade(const std::shared_ptr<CUserTrade>& userTrade, CTradePair& tradePair);
+	void UpdateUserTradeAfterTrade(uint32_t UserID, int UserTradeID, uint64_t Qty, uint64_t Amount);
 	bool ProcessUserTradeRequest(const std::shared_ptr<CUserTrade>& userTrade, CTradePair& tradePair);
 	void SaveProcessedUserTrade(const std::shared_ptr<CUserTrade>& userTrade, CTradePair& tradePair);
 	void InputMatchUserBuyRequest(const std::shared_ptr<CUserTrade>& userTrade, CTradePair& tradePair);
@@ -289,6 +336,8 @@ public:
 	std::string nMasternodeInspector;
 	std::string nCurrentHash;
 	uint64_t nTradeTime;
+	uint32_t nUserID1; //interned nUserPubKey1, not serialized
+	uint32_t nUserID2; //interned nUserPubKey2, not serialized
 
 	CActualTrade(int nTradePairID, int nUserTrade1, int nUserTrade2, uint64_t nTradePrice, uint64_t nTradeQty, uint64_t nBidAmount, uint64_t nAskAmount, std::string nUserPubKey1,
 		std::string nUserPubKey2, int64_t nFee1, int64_t nFee2, bool nFromBid, uint64_t nTradeTime) :
@@ -308,7 +357,9 @@ public:
 		nFromBid(nFromBid),
 		nMasternodeInspector(""),
 		nCurrentHash(""),		
-		nTradeTime(nTradeTime)
+		nTradeTime(nTradeTime),
+		nUserID1(TRADER_ID_NONE),
+		nUserID2(TRADER_ID_NONE)
 	{}
 
 	CActualTrade() :
@@ -328,9 +379,34 @@ public:
 		nFromBid(true),
 		nMasternodeInspector(""),
 		nCurrentHash(""),
-		nTradeTime(0)
+		nTradeTime(0),
+		nUserID1(TRADER_ID_NONE),
+		nUserID2(TRADER_ID_NONE)
 	{}
 
+	ADD_SERIALIZE_METHODS;
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+		READWRITE(nActualTradeID);
+		READWRITE(nTradePairID);
+		READWRITE(nUserTrade1);
+		READWRITE(nUserTrade2);
+		READWRITE(nTradePrice);
+		READWRITE(nTradeQty);
+		READWRITE(nTradeAmount);
+		READWRITE(nBidAmount);
+		READWRITE(nAskAmount);
+		READWRITE(nUserPubKey1);
+		READWRITE(nUserPubKey2);
+		READWRITE(nFee1);
+		READWRITE(nFee2);
+		READWRITE(nFromBid);
+		READWRITE(nMasternodeInspector);
+		READWRITE(nCurrentHash);
+		READWRITE(nTradeTime);
+		READWRITE(vchSig);
+	}
+
 	std::string GetHash();
 	bool VerifySignature();
 	bool Sign();
@@ -345,6 +421,7 @@ public:
 	bool GenerateActualTrade(std::shared_ptr<CActualTrade> actualTrade, CUserTradeSetting& setting);
 	bool InputActualTrade(const std::shared_ptr<CActualTrade>& actualTrade, CUserTradeSetting& setting, CTradePair& tradePair);
 	bool InputActualTradeFromNetwork(const std::shared_ptr<CActualTrade>& actualTrade, CUserTradeSetting& setting, CTradePair& tradePair);
+	void SettleActualTrade(const std::shared_ptr<CActualTrade>& actualTrade, const CTradePair& tradePair, bool fUserTradeHistory, bool fMarketTradeHistory);
 	bool IsActualTradeInList(int TradePairID, int ActualTradeID, std::string Hash);
 };
 
@@ -0,0 +1,643 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "tradelog.h"
+#include "crypto/common.h"
+#include "hash.h"
+#include "trade.h"
+#include "util.h"
+
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+
+class CTradeLog;
+class CTradeLogManager;
+
+CTradeLogManager tradeLogManager;
+
+typedef std::function<bool(const CTradeLogRecordHeader&, const char*)> TradeLogRecordFunc;
+
+static uint32_t GetTradeLogChecksum(const char* pBegin, const char* pEnd)
+{
+	return (uint32_t)Hash(pBegin, pEnd).GetCheapHash();
+}
+
+boost::filesystem::path CTradeLog::GetSegmentPath(uint32_t nNumber, bool fIndex) const
+{
+	return pathDir / strprintf("%08u.%s", nNumber, fIndex ? "idx" : "log");
+}
+
+bool CTradeLog::OpenAppendFiles()
+{
+	CloseAppendFiles();
+	fileLog = fopen(GetSegmentPath(vSegments.back().nNumber, false).string().c_str(), "ab");
+	fileIndex = fopen(GetSegmentPath(vSegments.back().nNumber, true).string().c_str(), "ab");
+	if (!fileLog || !fileIndex)
+	{
+		LogPrintf("CTradeLog::OpenAppendFiles -- unable to open segment %u in %s\n", vSegments.back().nNumber, pathDir.string());
+		CloseAppendFiles();
+		return false;
+	}
+	return true;
+}
+
+void CTradeLog::CloseAppendFiles()
+{
+	if (fileLog)
+	{
+		FileCommit(fileLog);
+		fclose(fileLog);
+		fileLog = NULL;
+	}
+	if (fileIndex)
+	{
+		FileCommit(fileIndex);
+		fclose(fileIndex);
+		fileIndex = NULL;
+	}
+}
+
+bool CTradeLog::StartSegment()
+{
+	CSegment segment;
+	segment.nNumber = vSegments.empty() ? 0 : vSegments.back().nNumber + 1;
+	segment.nSize = 0;
+	vSegments.push_back(std::move(segment));
+	nSinceIndex = 0;
+	nSegmentRecords = 0;
+	return OpenAppendFiles();
+}
+
+//indexes the first record of a segment and every TRADE_LOG_INDEX_INTERVAL-th one after it
+bool CTradeLog::NoteRecord(const CTradeLogRecordHeader& header, uint64_t nOffset)
+{
+	if (nSegmentRecords == 0 || nSinceIndex == TRADE_LOG_INDEX_INTERVAL)
+	{
+		CTradeLogIndexEntry entry;
+		entry.nID = header.nID;
+		entry.nTime = header.nTime;
+		entry.nSegment = vSegments.back().nNumber;
+		entry.nOffset = nOffset;
+		vIndex.push_back(entry);
+		nSinceIndex = 0;
+
+		CDataStream ss(SER_DISK, CLIENT_VERSION);
+		ss << entry;
+		if (fileIndex && (fwrite(&ss[0], 1, ss.size(), fileIndex) != ss.size() || fflush(fileIndex) != 0))
+			return false;
+	}
+	++nSinceIndex;
+	++nSegmentRecords;
+	nLastID = header.nID;
+	return true;
+}
+
+size_t CTradeLog::FindSegmentPos(uint32_t nSegment) const
+{
+	for (size_t i = 0; i < vSegments.size(); i++)
+	{
+		if (vSegments[i].nNumber == nSegment)
+			return i;
+	}
+	return vSegments.size();
+}
+
+//returns the payload of the record at nOffset, NULL past the end of the segment
+const char* CTradeLog::MapRecord(size_t nSegmentPos, uint64_t nOffset, CTradeLogRecordHeader& header) const
+{
+	CSegment& segment = vSegments[nSegmentPos];
+	if (nOffset + TRADE_LOG_HEADER_SIZE + TRADE_LOG_CHECKSUM_SIZE > segment.nSize)
+		return NULL;
+
+	try {
+		//the last segment grows, map it again when a record lies beyond the current mapping
+		if (!segment.region || segment.region->get_size() < nOffset + TRADE_LOG_HEADER_SIZE)
+		{
+			segment.region.reset();
+			segment.file.reset(new boost::interprocess::file_mapping(GetSegmentPath(segment.nNumber, false).string().c_str(), boost::interprocess::read_only));
+			segment.region.reset(new boost::interprocess::mapped_region(*segment.file, boost::interprocess::read_only, 0, segment.nSize));
+		}
+
+		const char* pBegin = static_cast<const char*>(segment.region->get_address()) + nOffset;
+		CDataStream ss(pBegin, pBegin + TRADE_LOG_HEADER_SIZE, SER_DISK, CLIENT_VERSION);
+		ss >> header;
+		if (header.nSize > TRADE_LOG_MAX_RECORD_SIZE || nOffset + TRADE_LOG_HEADER_SIZE + header.nSize + TRADE_LOG_CHECKSUM_SIZE > segment.nSize)
+			return NULL;
+
+		if (segment.region->get_size() < nOffset + TRADE_LOG_HEADER_SIZE + header.nSize + TRADE_LOG_CHECKSUM_SIZE)
+		{
+			segment.region.reset(new boost::interprocess::mapped_region(*segment.file, boost::interprocess::read_only, 0, segment.nSize));
+			pBegin = static_cast<const char*>(segment.region->get_address()) + nOffset;
+		}
+		return pBegin + TRADE_LOG_HEADER_SIZE;
+	} catch (const std::exception& e) {
+		LogPrintf("CTradeLog::MapRecord -- unable to map segment %u in %s: %s\n", segment.nNumber, pathDir.string(), e.what());
+		return NULL;
+	}
+}
+
+//drops a torn or corrupted tail of the last segment and indexes records written after its last index entry
+bool CTradeLog::RecoverLastSegment()
+{
+	CSegment& segment = vSegments.back();
+	uint64_t nOffset = 0;
+	nLastID = 0;
+	nSinceIndex = 0;
+	nSegmentRecords = 0;
+	if (!vIndex.empty() && vIndex.back().nSegment == segment.nNumber)
+	{
+		//scan again from the last index entry, its record is indexed again by NoteRecord
+		nOffset = vIndex.back().nOffset;
+		vIndex.pop_back();
+		if (nOffset > 0)
+		{
+			nSinceIndex = TRADE_LOG_INDEX_INTERVAL;
+			nSegmentRecords = 1;
+		}
+	}
+
+	CTradeLogRecordHeader header;
+	const char* pData;
+	while ((pData = MapRecord(vSegments.size() - 1, nOffset, header)) != NULL)
+	{
+		uint32_t nChecksum = ReadLE32((const unsigned char*)(pData + header.nSize));
+		if (nChecksum != GetTradeLogChecksum(pData, pData + header.nSize) || header.nID <= nLastID)
+			break;
+
+		NoteRecord(header, nOffset);
+		nOffset += TRADE_LOG_HEADER_SIZE + header.nSize + TRADE_LOG_CHECKSUM_SIZE;
+	}
+
+	if (nOffset < segment.nSize)
+	{
+		LogPrintf("CTradeLog::RecoverLastSegment -- truncating %s from %u to %u bytes\n", GetSegmentPath(segment.nNumber, false).string(), segment.nSize, nOffset);
+		segment.region.reset();
+		segment.file.reset();
+		boost::filesystem::resize_file(GetSegmentPath(segment.nNumber, false), nOffset);
+		segment.nSize = nOffset;
+	}
+
+	//nothing valid after the last index entry, the last ID is in front of it
+	if (nLastID == 0 && !vIndex.empty())
+	{
+		ScanFromIndex(vIndex.size() - 1, true, [this](const CTradeLogRecordHeader& header, const char* pData) {
+			nLastID = header.nID;
+			return true;
+		});
+	}
+
+	//the index file may hold entries of the dropped tail, write it again from memory
+	CAutoFile fileout(fopen(GetSegmentPath(segment.nNumber, true).string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+	if (fileout.IsNull())
+		return false;
+	for (size_t i = 0; i < vIndex.size(); i++)
+	{
+		if (vIndex[i].nSegment == segment.nNumber)
+			fileout << vIndex[i];
+	}
+	return true;
+}
+
+bool CTradeLog::Open(const boost::filesystem::path& path)
+{
+	LOCK(cs);
+	if (fileLog)
+		return true;
+
+	pathDir = path;
+	try {
+		boost::filesystem::create_directories(pathDir);
+
+		std::vector<uint32_t> vNumbers;
+		for (boost::filesystem::directory_iterator it(pathDir); it != boost::filesystem::directory_iterator(); ++it)
+		{
+			if (it->path().extension() != ".log")
+				continue;
+			uint32_t nNumber = atoi(it->path().stem().string());
+			if (it->path().filename() == GetSegmentPath(nNumber, false).filename())
+				vNumbers.push_back(nNumber);
+		}
+		std::sort(vNumbers.begin(), vNumbers.end());
+
+		for (size_t i = 0; i < vNumbers.size(); i++)
+		{
+			CSegment segment;
+			segment.nNumber = vNumbers[i];
+			segment.nSize = boost::filesystem::file_size(GetSegmentPath(vNumbers[i], false));
+			vSegments.push_back(std::move(segment));
+
+			boost::filesystem::path pathIndex = GetSegmentPath(vNumbers[i], true);
+			if (!boost::filesystem::exists(pathIndex))
+				continue;
+			uint64_t nEntries = boost::filesystem::file_size(pathIndex) / TRADE_LOG_INDEX_ENTRY_SIZE;
+			CAutoFile filein(fopen(pathIndex.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+			for (uint64_t j = 0; j < nEntries && !filein.IsNull(); j++)
+			{
+				CTradeLogIndexEntry entry;
+				filein >> entry;
+				entry.nSegment = vNumbers[i];
+				if (entry.nOffset >= vSegments.back().nSize || (!vIndex.empty() && entry.nID <= vIndex.back().nID))
+					break;
+				vIndex.push_back(entry);
+			}
+		}
+
+		if (vSegments.empty())
+			return StartSegment();
+
+		if (!RecoverLastSegment())
+			return false;
+	} catch (const std::exception& e) {
+		LogPrintf("CTradeLog::Open -- unable to open %s: %s\n", pathDir.string(), e.what());
+		return false;
+	}
+
+	LogPrint("infinidex", "CTradeLog::Open -- %s, %u segments, %u index entries, last ID %d\n", pathDir.string(), vSegments.size(), vIndex.size(), nLastID);
+	return OpenAppendFiles();
+}
+
+void CTradeLog::Close()
+{
+	LOCK(cs);
+	CloseAppendFiles();
+	vSegments.clear();
+	vIndex.clear();
+	nLastID = 0;
+	nSinceIndex = 0;
+	nSegmentRecords = 0;
+}
+
+void CTradeLog::Flush()
+{
+	LOCK(cs);
+	if (fileLog)
+		FileCommit(fileLog);
+	if (fileIndex)
+		FileCommit(fileIndex);
+}
+
+bool CTradeLog::AppendRecord(uint64_t nID, uint64_t nTime, const CDataStream& ssPayload)
+{
+	LOCK(cs);
+	if (!fileLog || nID <= nLastID || ssPayload.size() > TRADE_LOG_MAX_RECORD_SIZE)
+		return false;
+
+	uint64_t nRecordSize = TRADE_LOG_HEADER_SIZE + ssPayload.size() + TRADE_LOG_CHECKSUM_SIZE;
+	if (nSegmentRecords > 0 && vSegments.back().nSize + nRecordSize > TRADE_LOG_SEGMENT_SIZE)
+	{
+		if (!StartSegment())
+			return false;
+	}
+
+	CTradeLogRecordHeader header;
+	header.nID = nID;
+	header.nTime = nTime;
+	header.nSize = ssPayload.size();
+
+	CDataStream ss(SER_DISK, CLIENT_VERSION);
+	ss.reserve(nRecordSize);
+	ss << header;
+	ss.write(&ssPayload[0], ssPayload.size());
+	ss << GetTradeLogChecksum(&ssPayload[0], &ssPayload[0] + ssPayload.size());
+	if (fwrite(&ss[0], 1, ss.size(), fileLog) != ss.size() || fflush(fileLog) != 0)
+	{
+		LogPrintf("CTradeLog::AppendRecord -- write to %s failed\n", pathDir.string());
+		return false;
+	}
+
+	uint64_t nOffset = vSegments.back().nSize;
+	vSegments.back().nSize += nRecordSize;
+	return NoteRecord(header, nOffset);
+}
+
+//walks the records from index entry nIndexPos up to the next index entry, or to the end of the log
+bool CTradeLog::ScanFromIndex(size_t nIndexPos, bool fToEnd, const TradeLogRecordFunc& func) const
+{
+	size_t nSegmentPos = FindSegmentPos(vIndex[nIndexPos].nSegment);
+	uint64_t nOffset = vIndex[nIndexPos].nOffset;
+	uint64_t nStopID = (!fToEnd && nIndexPos + 1 < vIndex.size()) ? vIndex[nIndexPos + 1].nID : std::numeric_limits<uint64_t>::max();
+
+	while (nSegmentPos < vSegments.size())
+	{
+		CTradeLogRecordHeader header;
+		const char* pData = MapRecord(nSegmentPos, nOffset, header);
+		if (!pData)
+		{
+			if (!fToEnd)
+				return true;
+			++nSegmentPos;
+			nOffset = 0;
+			continue;
+		}
+		if (header.nID >= nStopID)
+			return true;
+		if (!func(header, pData))
+			return false;
+		nOffset += TRADE_LOG_HEADER_SIZE + header.nSize + TRADE_LOG_CHECKSUM_SIZE;
+	}
+	return true;
+}
+
+static bool IsIndexIDBefore(const CTradeLogIndexEntry& entry, uint64_t nID)
+{
+	return entry.nID < nID;
+}
+
+static bool IsIndexTimeBefore(const CTradeLogIndexEntry& entry, uint64_t nTime)
+{
+	return entry.nTime < nTime;
+}
+
+bool CTradeLog::ForEachFrom(uint64_t nID, const TradeLogRecordFunc& func) const
+{
+	LOCK(cs);
+	if (vIndex.empty())
+		return true;
+
+	//last entry at or before nID, the wanted record is at most one interval after it
+	size_t nPos = std::lower_bound(vIndex.begin(), vIndex.end(), nID + 1, IsIndexIDBefore) - vIndex.begin();
+	if (nPos > 0)
+		--nPos;
+	return ScanFromIndex(nPos, true, [&](const CTradeLogRecordHeader& header, const char* pData) {
+		if (header.nID < nID)
+			return true;
+		return func(header, pData);
+	});
+}
+
+bool CTradeLog::ForEachInTime(uint64_t nFromTime, uint64_t nToTime, const TradeLogRecordFunc& func) const
+{
+	LOCK(cs);
+	if (vIndex.empty())
+		return true;
+
+	size_t nPos = std::lower_bound(vIndex.begin(), vIndex.end(), nFromTime, IsIndexTimeBefore) - vIndex.begin();
+	if (nPos > 0)
+		--nPos;
+	return ScanFromIndex(nPos, true, [&](const CTradeLogRecordHeader& header, const char* pData) {
+		if (header.nTime < nFromTime)
+			return true;
+		if (header.nTime > nToTime)
+			return false;
+		return func(header, pData);
+	});
+}
+
+//calls func for the last nCount records, oldest first
+bool CTradeLog::ForEachLast(size_t nCount, const TradeLogRecordFunc& func) const
+{
+	LOCK(cs);
+	std::deque<std::pair<CTradeLogRecordHeader, const char*>> vRecords;
+	size_t nPos = vIndex.size();
+	while (nPos > 0 && vRecords.size() < nCount)
+	{
+		--nPos;
+		std::vector<std::pair<CTradeLogRecordHeader, const char*>> vChunk;
+		ScanFromIndex(nPos, false, [&vChunk](const CTradeLogRecordHeader& header, const char* pData) {
+			vChunk.push_back(std::make_pair(header, pData));
+			return true;
+		});
+		vRecords.insert(vRecords.begin(), vChunk.begin(), vChunk.end());
+	}
+
+	size_t nStart = vRecords.size() > nCount ? vRecords.size() - nCount : 0;
+	for (size_t i = nStart; i < vRecords.size(); i++)
+	{
+		if (!func(vRecords[i].first, vRecords[i].second))
+			return false;
+	}
+	return true;
+}
+
+void CTradeLogManager::Open(const boost::filesystem::path& path)
+{
+	LOCK(cs);
+	pathDir = path;
+}
+
+void CTradeLogManager::Close()
+{
+	LOCK(cs);
+	for (auto& it : mapTradePairLog)
+	{
+		CTradePairLog& pairLog = *it.second;
+		{
+			LOCK(pairLog.csHistory);
+			WriteUserSnapshot(it.first, pairLog);
+		}
+		pairLog.actualTradeLog.Close();
+		pairLog.historyLog.Close();
+	}
+	mapTradePairLog.clear();
+	pathDir.clear();
+}
+
+CTradeLogManager::CTradePairLog* CTradeLogManager::GetTradePairLog(int TradePairID)
+{
+	LOCK(cs);
+	if (pathDir.empty())
+		return NULL;
+
+	if (mapTradePairLog.count(TradePairID))
+		return mapTradePairLog[TradePairID].get();
+
+	std::unique_ptr<CTradePairLog> pairLog(new CTradePairLog());
+	boost::filesystem::path pathPair = pathDir / strprintf("%d", TradePairID);
+	if (!pairLog->actualTradeLog.Open(pathPair / "actualtrade") || !pairLog->historyLog.Open(pathPair / "tradehistory"))
+	{
+		LogPrintf("CTradeLogManager::GetTradePairLog -- unable to open trade log of pair %d\n", TradePairID);
+		return NULL;
+	}
+	{
+		LOCK(pairLog->csHistory);
+		LoadUserSnapshot(TradePairID, *pairLog);
+	}
+
+	CTradePairLog* pResult = pairLog.get();
+	mapTradePairLog.insert(std::make_pair(TradePairID, std::move(pairLog)));
+	return pResult;
+}
+
+bool CTradeLogManager::LoadUserSnapshot(int TradePairID, CTradePairLog& pairLog)
+{
+	boost::filesystem::path pathSnapshot = pathDir / strprintf("%d", TradePairID) / "users.dat";
+	if (boost::filesystem::exists(pathSnapshot))
+	{
+		CAutoFile filein(fopen(pathSnapshot.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+		try {
+			std::map<std::string, uint64_t> mapPubKeyLastID;
+			filein >> pairLog.nUserSnapshotID >> mapPubKeyLastID;
+			for (auto& it : mapPubKeyLastID)
+				pairLog.mapUserLastID[traderRegistry.GetTraderID(it.first)] = it.second;
+		} catch (const std::exception& e) {
+			LogPrintf("CTradeLogManager::LoadUserSnapshot -- %s is corrupted, rebuilding: %s\n", pathSnapshot.string(), e.what());
+			pairLog.nUserSnapshotID = 0;
+			pairLog.mapUserLastID.clear();
+		}
+	}
+
+	//the log may have lost records the snapshot refers to
+	if (pairLog.nUserSnapshotID > pairLog.historyLog.GetLastID())
+	{
+		pairLog.nUserSnapshotID = 0;
+		pairLog.mapUserLastID.clear();
+	}
+
+	//replay records written after the snapshot
+	pairLog.historyLog.ForEachFrom(pairLog.nUserSnapshotID + 1, [&pairLog](const CTradeLogRecordHeader& header, const char* pData) {
+		CTradeHistoryLogRecord record;
+		CDataStream ss(pData, pData + header.nSize, SER_DISK, CLIENT_VERSION);
+		ss >> record;
+		pairLog.mapUserLastID[traderRegistry.GetTraderID(record.tradeHistory.nUserPubKey1)] = header.nID;
+		pairLog.mapUserLastID[traderRegistry.GetTraderID(record.tradeHistory.nUserPubKey2)] = header.nID;
+		return true;
+	});
+	return true;
+}
+
+bool CTradeLogManager::WriteUserSnapshot(int TradePairID, CTradePairLog& pairLog)
+{
+	//records the snapshot refers to have to be on disk first
+	pairLog.historyLog.Flush();
+	uint64_t nLastID = pairLog.historyLog.GetLastID();
+
+	boost::filesystem::path pathSnapshot = pathDir / strprintf("%d", TradePairID) / "users.dat";
+	boost::filesystem::path pathTemp = pathSnapshot;
+	pathTemp += ".new";
+	{
+		CAutoFile fileout(fopen(pathTemp.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+		if (fileout.IsNull())
+			return false;
+		std::map<std::string, uint64_t> mapPubKeyLastID;
+		for (auto& it : pairLog.mapUserLastID)
+			mapPubKeyLastID[traderRegistry.GetPubKey(it.first)] = it.second;
+		fileout << nLastID << mapPubKeyLastID;
+		FileCommit(fileout.Get());
+	}
+	if (!RenameOver(pathTemp, pathSnapshot))
+		return false;
+	pairLog.nUserSnapshotID = nLastID;
+	return true;
+}
+
+bool CTradeLogManager::AppendActualTrade(const CActualTrade& actualTrade)
+{
+	CTradePairLog* pairLog = GetTradePairLog(actualTrade.nTradePairID);
+	if (!pairLog)
+		return false;
+
+	return pairLog->actualTradeLog.Append(actualTrade.nActualTradeID, actualTrade.nTradeTime, actualTrade);
+}
+
+bool CTradeLogManager::AppendTradeHistory(const std::shared_ptr<CUserTradeHistory>& tradeHistory)
+{
+	CTradePairLog* pairLog = GetTradePairLog(tradeHistory->nTradePairID);
+	if (!pairLog)
+		return false;
+
+	uint32_t UserID1 = tradeHistory->nUserID1 != TRADER_ID_NONE ? tradeHistory->nUserID1 : traderRegistry.GetTraderID(tradeHistory->nUserPubKey1);
+	uint32_t UserID2 = tradeHistory->nUserID2 != TRADER_ID_NONE ? tradeHistory->nUserID2 : traderRegistry.GetTraderID(tradeHistory->nUserPubKey2);
+
+	LOCK(pairLog->csHistory);
+	uint64_t nID = pairLog->historyLog.GetLastID() + 1;
+	uint64_t nPrevUser1ID = pairLog->mapUserLastID.count(UserID1) ? pairLog->mapUserLastID[UserID1] : 0;
+	uint64_t nPrevUser2ID = pairLog->mapUserLastID.count(UserID2) ? pairLog->mapUserLastID[UserID2] : 0;
+	if (!pairLog->historyLog.Append(nID, tradeHistory->nTradeTime, CTradeHistoryLogRecord(*tradeHistory, nPrevUser1ID, nPrevUser2ID)))
+		return false;
+
+	pairLog->mapUserLastID[UserID1] = nID;
+	pairLog->mapUserLastID[UserID2] = nID;
+	if (nID - pairLog->nUserSnapshotID >= TRADE_LOG_USER_SNAPSHOT_INTERVAL)
+		WriteUserSnapshot(tradeHistory->nTradePairID, *pairLog);
+	return true;
+}
+
+bool CTradeLogManager::GetActualTrade(int TradePairID, int ActualTradeID, CActualTrade& actualTrade)
+{
+	CTradePairLog* pairLog = GetTradePairLog(TradePairID);
+	if (!pairLog)
+		return false;
+
+	return pairLog->actualTradeLog.Read(ActualTradeID, actualTrade);
+}
+
+size_t CTradeLogManager::GetActualTrades(int TradePairID, uint64_t FromTime, uint64_t ToTime, size_t MaxCount, std::vector<CActualTrade>& vActualTrade)
+{
+	CTradePairLog* pairLog = GetTradePairLog(TradePairID);
+	if (!pairLog)
+		return 0;
+
+	size_t nCount = 0;
+	pairLog->actualTradeLog.ForEachInTime(FromTime, ToTime, [&](const CTradeLogRecordHeader& header, const char* pData) {
+		CDataStream ss(pData, pData + header.nSize, SER_DISK, CLIENT_VERSION);
+		vActualTrade.push_back(CActualTrade());
+		ss >> vActualTrade.back();
+		return ++nCount < MaxCount;
+	});
+	return nCount;
+}
+
+//last Count actual trades of the pair, oldest first
+size_t CTradeLogManager::GetLastActualTrades(int TradePairID, size_t Count, std::vector<CActualTrade>& vActualTrade)
+{
+	CTradePairLog* pairLog = GetTradePairLog(TradePairID);
+	if (!pairLog)
+		return 0;
+
+	size_t nCount = 0;
+	pairLog->actualTradeLog.ForEachLast(Count, [&](const CTradeLogRecordHeader& header, const char* pData) {
+		CDataStream ss(pData, pData + header.nSize, SER_DISK, CLIENT_VERSION);
+		vActualTrade.push_back(CActualTrade());
+		ss >> vActualTrade.back();
+		++nCount;
+		return true;
+	});
+	return nCount;
+}
+
+//last Count trades of the pair, oldest first
+size_t CTradeLogManager::GetMarketTradeHistory(int TradePairID, size_t Count, std::vector<CUserTradeHistory>& vTradeHistory)
+{
+	CTradePairLog* pairLog = GetTradePairLog(TradePairID);
+	if (!pairLog)
+		return 0;
+
+	size_t nCount = 0;
+	pairLog->historyLog.ForEachLast(Count, [&](const CTradeLogRecordHeader& header, const char* pData) {
+		CTradeHistoryLogRecord record;
+		CDataStream ss(pData, pData + header.nSize, SER_DISK, CLIENT_VERSION);
+		ss >> record;
+		vTradeHistory.push_back(record.tradeHistory);
+		++nCount;
+		return true;
+	});
+	return nCount;
+}
+
+//last Count trades of the user in the pair, newest first
+size_t CTradeLogManager::GetUserTradeHistory(int TradePairID, const std::string& UserPubKey, size_t Count, std::vector<CUserTradeHistory>& vTradeHistory)
+{
+	CTradePairLog* pairLog = GetTradePairLog(TradePairID);
+	if (!pairLog)
+		return 0;
+
+	uint32_t UserID = traderRegistry.FindTraderID(UserPubKey);
+	LOCK(pairLog->csHistory);
+	if (!pairLog->mapUserLastID.count(UserID))
+		return 0;
+
+	size_t nCount = 0;
+	uint64_t nID = pairLog->mapUserLastID[UserID];
+	while (nID > 0 && nCount < Count)
+	{
+		CTradeHistoryLogRecord record;
+		if (!pairLog->historyLog.Read(nID, record))
+			break;
+		vTradeHistory.push_back(record.tradeHistory);
+		++nCount;
+		nID = (record.tradeHistory.nUserPubKey1 == UserPubKey) ? record.nPrevUser1ID : record.nPrevUser2ID;
+	}
+	return nCount;
+}
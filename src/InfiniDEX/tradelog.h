@@ -0,0 +1,233 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef TRADELOG_H
+#define TRADELOG_H
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+#include "clientversion.h"
+#include "streams.h"
+#include "sync.h"
+#include "usertradehistory.h"
+
+#include <boost/filesystem/path.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+class CActualTrade;
+class CTradeLog;
+class CTradeHistoryLogRecord;
+class CTradeLogManager;
+
+extern CTradeLogManager tradeLogManager;
+
+static const uint64_t TRADE_LOG_SEGMENT_SIZE = 64 * 1024 * 1024;
+static const unsigned int TRADE_LOG_INDEX_INTERVAL = 64; //records per sparse index entry
+static const unsigned int TRADE_LOG_MAX_RECORD_SIZE = 1024 * 1024;
+static const uint64_t TRADE_LOG_USER_SNAPSHOT_INTERVAL = 10000; //history records between saves of the user map
+static const size_t TRADE_LOG_RELOAD_ACTUAL_TRADES = 10000; //actual trades put back in memory when a pair is initialized
+
+//every record is stored as header, payload and a 32 bit checksum of the payload
+struct CTradeLogRecordHeader
+{
+	uint64_t nID;
+	uint64_t nTime;
+	uint32_t nSize;
+
+	ADD_SERIALIZE_METHODS;
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+		READWRITE(nID);
+		READWRITE(nTime);
+		READWRITE(nSize);
+	}
+};
+
+static const unsigned int TRADE_LOG_HEADER_SIZE = 20;
+static const unsigned int TRADE_LOG_CHECKSUM_SIZE = 4;
+
+struct CTradeLogIndexEntry
+{
+	uint64_t nID;
+	uint64_t nTime;
+	uint32_t nSegment;
+	uint32_t nOffset;
+
+	ADD_SERIALIZE_METHODS;
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+		READWRITE(nID);
+		READWRITE(nTime);
+		READWRITE(nOffset); //segment is implied by the index file
+	}
+};
+
+static const unsigned int TRADE_LOG_INDEX_ENTRY_SIZE = 20;
+
+/**
+ * Append-only record log split into fixed size segment files.
+ *
+ * Records carry a strictly increasing ID and a time which is expected to be non
+ * decreasing with the ID. Every segment has a small index file holding the position
+ * of its first record and of every TRADE_LOG_INDEX_INTERVAL-th record after it, which
+ * is all that has to be read on startup. Records are read through memory mappings of
+ * the segments, so nothing but the sparse index is kept in memory.
+ */
+class CTradeLog
+{
+private:
+	struct CSegment
+	{
+		uint32_t nNumber;
+		uint64_t nSize;
+		std::unique_ptr<boost::interprocess::file_mapping> file;
+		std::unique_ptr<boost::interprocess::mapped_region> region;
+	};
+
+	mutable CCriticalSection cs;
+	boost::filesystem::path pathDir;
+	mutable std::vector<CSegment> vSegments; //mappings are created on first read
+	std::vector<CTradeLogIndexEntry> vIndex;
+	FILE* fileLog;
+	FILE* fileIndex;
+	uint64_t nLastID;
+	unsigned int nSinceIndex; //records of the last segment since its last index entry
+	unsigned int nSegmentRecords;
+
+	boost::filesystem::path GetSegmentPath(uint32_t nNumber, bool fIndex) const;
+	bool OpenAppendFiles();
+	void CloseAppendFiles();
+	bool StartSegment();
+	bool RecoverLastSegment();
+	bool NoteRecord(const CTradeLogRecordHeader& header, uint64_t nOffset);
+	const char* MapRecord(size_t nSegmentPos, uint64_t nOffset, CTradeLogRecordHeader& header) const;
+	size_t FindSegmentPos(uint32_t nSegment) const;
+	bool ScanFromIndex(size_t nIndexPos, bool fToEnd, const std::function<bool(const CTradeLogRecordHeader&, const char*)>& func) const;
+
+public:
+	CTradeLog() :
+		fileLog(NULL),
+		fileIndex(NULL),
+		nLastID(0),
+		nSinceIndex(0),
+		nSegmentRecords(0)
+	{}
+
+	~CTradeLog() { Close(); }
+
+	bool Open(const boost::filesystem::path& path);
+	void Close();
+	void Flush();
+	bool IsOpen() const { return fileLog != NULL; }
+	uint64_t GetLastID() const { LOCK(cs); return nLastID; }
+
+	bool AppendRecord(uint64_t nID, uint64_t nTime, const CDataStream& ssPayload);
+	//func returns false to stop
+	bool ForEachFrom(uint64_t nID, const std::function<bool(const CTradeLogRecordHeader&, const char*)>& func) const;
+	bool ForEachInTime(uint64_t nFromTime, uint64_t nToTime, const std::function<bool(const CTradeLogRecordHeader&, const char*)>& func) const;
+	bool ForEachLast(size_t nCount, const std::function<bool(const CTradeLogRecordHeader&, const char*)>& func) const;
+
+	template <typename T>
+	bool Append(uint64_t nID, uint64_t nTime, const T& obj)
+	{
+		CDataStream ss(SER_DISK, CLIENT_VERSION);
+		ss << obj;
+		return AppendRecord(nID, nTime, ss);
+	}
+
+	template <typename T>
+	bool Read(uint64_t nID, T& obj) const
+	{
+		bool fFound = false;
+		ForEachFrom(nID, [&](const CTradeLogRecordHeader& header, const char* pData) {
+			if (header.nID == nID)
+			{
+				CDataStream ss(pData, pData + header.nSize, SER_DISK, CLIENT_VERSION);
+				ss >> obj;
+				fFound = true;
+			}
+			return false;
+		});
+		return fFound;
+	}
+};
+
+//user trade history record, linked to the previous record of both users
+class CTradeHistoryLogRecord
+{
+public:
+	CUserTradeHistory tradeHistory;
+	uint64_t nPrevUser1ID;
+	uint64_t nPrevUser2ID;
+
+	CTradeHistoryLogRecord(const CUserTradeHistory& tradeHistory, uint64_t nPrevUser1ID, uint64_t nPrevUser2ID) :
+		tradeHistory(tradeHistory),
+		nPrevUser1ID(nPrevUser1ID),
+		nPrevUser2ID(nPrevUser2ID)
+	{}
+
+	CTradeHistoryLogRecord() :
+		nPrevUser1ID(0),
+		nPrevUser2ID(0)
+	{}
+
+	ADD_SERIALIZE_METHODS;
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+		READWRITE(tradeHistory);
+		READWRITE(nPrevUser1ID);
+		READWRITE(nPrevUser2ID);
+	}
+};
+
+/**
+ * Durable actual trades and trade history of every trade pair.
+ *
+ * The actual trade log of a pair is written by the worker owning the pair, the trade
+ * history log by the user worker. For each user only the ID of the last history
+ * record is kept in memory, older records are reached through the links stored in
+ * the records. That map is saved on close and every TRADE_LOG_USER_SNAPSHOT_INTERVAL
+ * records, so opening a log only replays the records written after the last save.
+ */
+class CTradeLogManager
+{
+private:
+	struct CTradePairLog
+	{
+		CTradeLog actualTradeLog;
+		CTradeLog historyLog;
+		CCriticalSection csHistory;
+		std::map<uint32_t, uint64_t> mapUserLastID; //by trader ID
+		uint64_t nUserSnapshotID;
+
+		CTradePairLog() : nUserSnapshotID(0) {}
+	};
+
+	CCriticalSection cs;
+	boost::filesystem::path pathDir;
+	std::map<int, std::unique_ptr<CTradePairLog>> mapTradePairLog;
+
+	CTradePairLog* GetTradePairLog(int TradePairID);
+	bool LoadUserSnapshot(int TradePairID, CTradePairLog& pairLog);
+	bool WriteUserSnapshot(int TradePairID, CTradePairLog& pairLog);
+
+public:
+	void Open(const boost::filesystem::path& path);
+	void Close();
+
+	bool AppendActualTrade(const CActualTrade& actualTrade);
+	bool AppendTradeHistory(const std::shared_ptr<CUserTradeHistory>& tradeHistory);
+
+	bool GetActualTrade(int TradePairID, int ActualTradeID, CActualTrade& actualTrade);
+	size_t GetActualTrades(int TradePairID, uint64_t FromTime, uint64_t ToTime, size_t MaxCount, std::vector<CActualTrade>& vActualTrade);
+	size_t GetLastActualTrades(int TradePairID, size_t Count, std::vector<CActualTrade>& vActualTrade);
+	size_t GetMarketTradeHistory(int TradePairID, size_t Count, std::vector<CUserTradeHistory>& vTradeHistory);
+	size_t GetUserTradeHistory(int TradePairID, const std::string& UserPubKey, size_t Count, std::vector<CUserTradeHistory>& vTradeHistory);
+};
+
+#endif
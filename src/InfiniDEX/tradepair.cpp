@@ -13,6 +13,7 @@ class CTradePair;
 class CTradePairManager;
 
 std::map<int, CTradePair> mapCompleteTradePair;
+CCriticalSection cs_mapCompleteTradePair;
 CTradePairManager tradePairManager;
 
 void CTradePairManager::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman)
@@ -81,6 +82,7 @@ bool CTradePairManager::InputTradePair(CTradePair &tradePair)
 		return false;
 	}
 
+	LOCK(cs_mapCompleteTradePair);
 	if (!mapCompleteTradePair.count(tradePair.nTradePairID))
 		mapCompleteTradePair.insert(std::make_pair(tradePair.nTradePairID, tradePair));
 	else if (tradePair.nLastUpdate > mapCompleteTradePair[tradePair.nTradePairID].nLastUpdate)
@@ -91,6 +93,7 @@ bool CTradePairManager::InputTradePair(CTradePair &tradePair)
 
 void CTradePairManager::SendCompleteTradePairs(CNode* node, CConnman& connman)
 {
+	LOCK(cs_mapCompleteTradePair);
 	std::map<int, CTradePair>::iterator it = mapCompleteTradePair.begin();
 	while (it != mapCompleteTradePair.end())
 	{
@@ -106,6 +109,7 @@ void CTradePairManager::SendTradePair(CTradePair TradePair, CNode* node, CConnma
 
 CTradePair CTradePairManager::GetTradePair(int TradePairID)
 {
+	LOCK(cs_mapCompleteTradePair);
 	if (IsValidTradePairID(TradePairID))
 		return mapCompleteTradePair[TradePairID];
 
@@ -114,6 +118,7 @@ CTradePair CTradePairManager::GetTradePair(int TradePairID)
 
 int CTradePairManager::GetAskSideCoinID(int TradePairID)
 {
+	LOCK(cs_mapCompleteTradePair);
 	if (IsValidTradePairID(TradePairID))
 		return mapCompleteTradePair[TradePairID].nCoinID2;
 	return 0;
@@ -121,6 +126,7 @@ int CTradePairManager::GetAskSideCoinID(int TradePairID)
 
 int CTradePairManager::GetBidSideCoinID(int TradePairID)
 {
+	LOCK(cs_mapCompleteTradePair);
 	if (IsValidTradePairID(TradePairID))
 		return mapCompleteTradePair[TradePairID].nCoinID1;
 	return 0;
@@ -131,6 +137,7 @@ tradepair_enum CTradePairManager::ProcessTradePair(CTradePair TradePair)
 	if (!TradePair.VerifySignature())
 		return TRADEPAIR_INVALID;
 
+	LOCK(cs_mapCompleteTradePair);
 	CTradePair temp = GetTradePair(TradePair.nTradePairID);
 	if (temp.nTradePairID == TradePair.nTradePairID)
 	{
@@ -166,7 +173,8 @@ tradepair_enum CTradePairManager::ProcessTradePair(CTradePair TradePair)
 }
 
 void CTradePairManager::GetTradeFee(int TradePairID, int &BuyFee, int &SellFee)
-{	
+{
+	LOCK(cs_mapCompleteTradePair);
 	if (IsValidTradePairID(TradePairID))
 	{
 		BuyFee = mapCompleteTradePair[TradePairID].nBidTradeFee;
@@ -179,6 +187,7 @@ void CTradePairManager::GetTradeFee(int TradePairID, int &BuyFee, int &SellFee)
 
 int CTradePairManager::GetBidTradeFee(int TradePairID)
 {
+	LOCK(cs_mapCompleteTradePair);
 	if (IsValidTradePairID(TradePairID))
 	{
 		return mapCompleteTradePair[TradePairID].nBidTradeFee;
@@ -188,6 +197,7 @@ int CTradePairManager::GetBidTradeFee(int TradePairID)
 
 int CTradePairManager::GetAskTradeFee(int TradePairID)
 {
+	LOCK(cs_mapCompleteTradePair);
 	if (IsValidTradePairID(TradePairID))
 	{
 		return mapCompleteTradePair[TradePairID].nAskTradeFee;
@@ -197,11 +207,13 @@ int CTradePairManager::GetAskTradeFee(int TradePairID)
 
 bool CTradePairManager::IsValidTradePairID(int TradePairID)
 {
+	LOCK(cs_mapCompleteTradePair);
 	return mapCompleteTradePair.count(TradePairID);
 }
 
 std::string CTradePairManager::GetTradePairStatus(int TradePairID)
 {
+	LOCK(cs_mapCompleteTradePair);
 	if (IsValidTradePairID(TradePairID))
 		return mapCompleteTradePair[TradePairID].nStatus;
 	return "";
@@ -209,6 +221,7 @@ std::string CTradePairManager::GetTradePairStatus(int TradePairID)
 
 bool CTradePairManager::IsTradeEnabled(int TradePairID)
 {
+	LOCK(cs_mapCompleteTradePair);
 	if (IsValidTradePairID(TradePairID))
 		return mapCompleteTradePair[TradePairID].nTradeEnabled;
 	return false;
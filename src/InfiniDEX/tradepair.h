@@ -11,12 +11,14 @@
 #include "userconnection.h"
 #include "hash.h"
 #include "net.h"
+#include "sync.h"
 #include "utilstrencodings.h"
 
 class CTradePair;
 class CTradePairManager;
 
-extern std::map<int, CTradePair> mapCompleteTradePair;
+extern std::map<int, CTradePair> mapCompleteTradePair; //updated by the message thread, read by the DEX workers
+extern CCriticalSection cs_mapCompleteTradePair;
 extern CTradePairManager tradePairManager;
 
 enum tradepair_enum {
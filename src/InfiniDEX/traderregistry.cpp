@@ -0,0 +1,63 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "traderregistry.h"
+#include "memusage.h"
+
+class CTraderRegistry;
+
+CTraderRegistry traderRegistry;
+
+static const std::string strNoPubKey;
+
+//interns the key, empty keys are left without an ID
+uint32_t CTraderRegistry::GetTraderID(const std::string& UserPubKey)
+{
+	if (UserPubKey.empty())
+		return TRADER_ID_NONE;
+
+	LOCK(cs);
+	auto it = mapTraderID.find(UserPubKey);
+	if (it != mapTraderID.end())
+		return it->second;
+
+	it = mapTraderID.insert(std::make_pair(UserPubKey, vPubKey.size() + 1)).first;
+	vPubKey.push_back(&it->first);
+	return it->second;
+}
+
+uint32_t CTraderRegistry::FindTraderID(const std::string& UserPubKey) const
+{
+	LOCK(cs);
+	auto it = mapTraderID.find(UserPubKey);
+	return it == mapTraderID.end() ? TRADER_ID_NONE : it->second;
+}
+
+//the string lives as long as the registry, so it can be used after the lock is released
+const std::string& CTraderRegistry::GetPubKey(uint32_t TraderID) const
+{
+	LOCK(cs);
+	if (TraderID == TRADER_ID_NONE || TraderID > vPubKey.size())
+		return strNoPubKey;
+	return *vPubKey[TraderID - 1];
+}
+
+size_t CTraderRegistry::GetTraderCount() const
+{
+	LOCK(cs);
+	return vPubKey.size();
+}
+
+size_t CTraderRegistry::DynamicMemoryUsage() const
+{
+	LOCK(cs);
+	size_t nUsage = memusage::DynamicUsage(vPubKey) + memusage::MallocUsage(sizeof(std::string) + sizeof(uint32_t) + 2 * sizeof(void*)) * mapTraderID.size() +
+		memusage::MallocUsage(sizeof(void*) * mapTraderID.bucket_count());
+	for (auto& it : mapTraderID)
+	{
+		if (it.first.capacity() > 15) //beyond the small string buffer
+			nUsage += memusage::MallocUsage(it.first.capacity() + 1);
+	}
+	return nUsage;
+}
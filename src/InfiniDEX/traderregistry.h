@@ -0,0 +1,44 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef TRADERREGISTRY_H
+#define TRADERREGISTRY_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+#include "sync.h"
+
+class CTraderRegistry;
+
+extern CTraderRegistry traderRegistry;
+
+static const uint32_t TRADER_ID_NONE = 0;
+
+/**
+ * Interns user public keys into compact trader IDs.
+ *
+ * A public key is looked up once when a message carrying it enters the DEX, after that
+ * the in-memory indexes are keyed by the 32-bit trader ID and the hex string is only
+ * needed again when something is serialized. IDs are dense, start at 1 and are never
+ * reused while the node runs; they are not stable across restarts, so anything written
+ * to disk or the network keeps the public key.
+ */
+class CTraderRegistry
+{
+private:
+	mutable CCriticalSection cs;
+	std::unordered_map<std::string, uint32_t> mapTraderID;
+	std::vector<const std::string*> vPubKey; //keys of mapTraderID by trader ID - 1
+
+public:
+	uint32_t GetTraderID(const std::string& UserPubKey);
+	uint32_t FindTraderID(const std::string& UserPubKey) const;
+	const std::string& GetPubKey(uint32_t TraderID) const;
+	size_t GetTraderCount() const;
+	size_t DynamicMemoryUsage() const;
+};
+
+#endif
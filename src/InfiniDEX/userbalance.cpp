@@ -3,18 +3,18 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "userbalance.h"
+#include "balanceledger.h"
 #include <boost/lexical_cast.hpp>
 
 class CUserBalance;
 class CUserBalanceManager;
 class CGlobalUserSetting;
 
-std::map<std::string, mapUserBalanceWithCoinID> mapUserBalanceByPubKey;
-std::map<int, mapUserBalanceWithPubKey> mapUserBalanceByCoinID;
 std::map<int, CUserBalanceSetting> mapUserBalanceSetting;
 CGlobalUserBalanceHandler globalUserBalanceHandler;
 CUserBalanceManager userBalanceManager;
 std::map<char, CGlobalUserSetting> mapGlobalUserSetting;
+CCriticalSection cs_mapGlobalUserSetting;
 
 bool CUserBalance::VerifySignature()
 {
@@ -23,15 +23,16 @@ bool CUserBalance::VerifySignature()
 
 void CUserBalanceManager::InitCoin(int CoinID)
 {
-	if (mapUserBalanceByCoinID.count(CoinID))
+	if (balanceLedger.IsCoinExist(CoinID))
 		return;
 
 	mapUserBalanceSetting.insert(std::make_pair(CoinID, CUserBalanceSetting(CoinID)));
-	mapUserBalanceByCoinID.insert(std::make_pair(CoinID, mapUserBalanceWithPubKey()));
+	balanceLedger.InitCoin(CoinID);
 }
 
 void CUserBalanceManager::InitGlobalUserSetting(char Char)
 {
+	LOCK(cs_mapGlobalUserSetting);
 	if (mapGlobalUserSetting.count(Char))
 		return;
 
@@ -40,6 +41,7 @@ void CUserBalanceManager::InitGlobalUserSetting(char Char)
 
 bool CUserBalanceManager::AssignUserBalanceRole(char Char, bool toAssign)
 {
+	LOCK(cs_mapGlobalUserSetting);
 	InitGlobalUserSetting(Char);
 	auto& a = mapGlobalUserSetting[Char];
 	a.nInChargeUserBalance = toAssign;
@@ -48,6 +50,7 @@ bool CUserBalanceManager::AssignUserBalanceRole(char Char, bool toAssign)
 
 bool CUserBalanceManager::AssignBackupRole(char Char, bool toAssign)
 {
+	LOCK(cs_mapGlobalUserSetting);
 	InitGlobalUserSetting(Char);
 	auto& a = mapGlobalUserSetting[Char];
 	a.nInChargeBackup = toAssign;
@@ -62,61 +65,38 @@ bool CUserBalanceManager::UpdateUserBalance(CUserBalance UserBalance)
 	if (!InChargeOfUserBalance(UserBalance.nUserPubKey))
 		return false;
 
-	std::shared_ptr<CUserBalance> ub1;
-	InitUserBalance(UserBalance.nCoinID, UserBalance.nUserPubKey, ub1);
-
-	std::shared_ptr<CUserBalance> ub = std::make_shared<CUserBalance>(UserBalance);
-	if (ub1->nLastUpdateTime < ub->nLastUpdateTime)
-		ub1 = ub;
+	LOCK(balanceLedger.cs);
+	CUserBalance current;
+	if (balanceLedger.GetUserBalance(UserBalance.nCoinID, UserBalance.nUserPubKey, current) && current.nLastUpdateTime >= UserBalance.nLastUpdateTime)
+		return true;
 
-	return true;
+	return balanceLedger.SetUserBalance(UserBalance);
 }
 
-void CUserBalanceManager::InitUserBalance(int CoinID, std::string UserPubKey, std::shared_ptr<CUserBalance>& UserBalance)
-{	
-	if (!mapUserBalanceByPubKey.count(UserPubKey))
-		mapUserBalanceByPubKey.insert(std::make_pair(UserPubKey, mapUserBalanceWithCoinID()));
-
-	mapUserBalanceWithCoinID& temp = mapUserBalanceByPubKey[UserPubKey];
-	if (!temp.count(CoinID)) 
-	{
-		UserBalance = std::make_shared<CUserBalance>(UserPubKey, CoinID);
-		temp.insert(std::make_pair(CoinID, UserBalance));
-	}
-
-	if (!mapUserBalanceByCoinID.count(CoinID))
-		mapUserBalanceByCoinID.insert(std::make_pair(CoinID, mapUserBalanceWithPubKey()));
-
-	mapUserBalanceWithPubKey& temp2 = mapUserBalanceByCoinID[CoinID];
-	if (!temp2.count(UserPubKey))
-		temp2.insert(std::make_pair(UserPubKey, UserBalance));
-
-	UserBalance = temp[CoinID];
+bool CUserBalanceManager::GetUserBalance(int CoinID, std::string UserPubKey, CUserBalance& UserBalance)
+{
+	return balanceLedger.GetUserBalance(CoinID, UserPubKey, UserBalance);
 }
 
 int CUserBalanceManager::GetLastDepositID(int CoinID, std::string UserPubKey)
 {
-	std::shared_ptr<CUserBalance> ub;
-	InitUserBalance(CoinID, UserPubKey, ub);
-	return ub->nLastDepositID;
+	return balanceLedger.GetLastDepositID(CoinID, UserPubKey);
 }
 
 bool CUserBalanceManager::InChargeOfUserBalance(std::string pubKey)
 {
 	char c = pubKey[2];
-	auto a = mapGlobalUserSetting[c];
-	if (a.nInChargeUserBalance)
-		return true;
-	return false;
+	LOCK(cs_mapGlobalUserSetting);
+	auto it = mapGlobalUserSetting.find(c);
+	return it != mapGlobalUserSetting.end() && it->second.nInChargeUserBalance;
 }
 
 bool CUserBalanceManager::InChargeOfBackup(std::string pubKey)
 {
 	char c = pubKey[2];
-	auto a = mapGlobalUserSetting[c];
-	if (a.nInChargeBackup)
-		return true;
-	return false;
+	LOCK(cs_mapGlobalUserSetting);
+	auto it = mapGlobalUserSetting.find(c);
+	return it != mapGlobalUserSetting.end() && it->second.nInChargeBackup;
 }
 
 bool CUserBalanceManager::IsInChargeOfCoinBalance(int CoinID)
@@ -131,12 +111,12 @@ bool CUserBalanceManager::VerifyUserBalance(int CoinID)
 
 bool CUserBalanceManager::IsCoinInList(int CoinID)
 {
-	return mapUserBalanceByCoinID.count(CoinID);
+	return balanceLedger.IsCoinExist(CoinID);
 }
 
 bool CUserBalanceManager::IsUserBalanceExist(int CoinID, std::string UserPubKey)
 {
-	return (mapUserBalanceByCoinID[CoinID].count(UserPubKey));
+	return balanceLedger.IsBalanceExist(CoinID, UserPubKey);
 }
 
 userbalance_to_exchange_enum_t CUserBalanceManager::BalanceToExchange(int CoinID, std::string UserPubKey, uint64_t amount)
@@ -145,20 +125,12 @@ userbalance_to_exchange_enum_t CUserBalanceManager::BalanceToExchange(int CoinID
 	if (setting.nCoinID != CoinID)
 		return USER_BALANCE_INVALID_NODE;
 
-	mapUserBalanceWithPubKey& temp = mapUserBalanceByCoinID[CoinID];
-	if (!temp.count(UserPubKey))
+	LOCK(balanceLedger.cs);
+	if (!balanceLedger.IsBalanceExist(CoinID, UserPubKey))
 		return USER_ACCOUNT_NOT_FOUND;
 
-	auto& temp2 = temp[UserPubKey];
-
-	if (setting.nVerifyUserBalance)
-	{
-		if (temp2->nAvailableBalance < amount)
-			return USER_BALANCE_NOT_ENOUGH;
-	}
-
-	temp2->nAvailableBalance -= amount;
-	temp2->nInExchangeBalance += amount;
+	if (!balanceLedger.Move(CoinID, UserPubKey, BALANCE_AVAILABLE, amount, BALANCE_IN_EXCHANGE, amount, setting.nVerifyUserBalance))
+		return USER_BALANCE_NOT_ENOUGH;
 	return USER_BALANCE_DEDUCTED;
 }
 
@@ -168,77 +140,53 @@ exchange_to_userbalance_enum_t CUserBalanceManager::ExchangeToBalance(int CoinID
 	if (setting.nCoinID != CoinID)
 		return EXCHANGE_INVALID_NODE;
 
-	mapUserBalanceWithPubKey& temp = mapUserBalanceByCoinID[CoinID];
-	if (!temp.count(UserPubKey))
+	LOCK(balanceLedger.cs);
+	if (!balanceLedger.IsBalanceExist(CoinID, UserPubKey))
 		return EXCHANGE_ACCOUNT_NOT_FOUND;
 
-	auto& temp2 = temp[UserPubKey];
-
-	if (setting.nVerifyUserBalance)
-	{
-		if (temp2->nInExchangeBalance < amount)
-			return EXCHANGE_BALANCE_NOT_ENOUGH;
-	}
-
-	temp2->nAvailableBalance += amount;
-	temp2->nInExchangeBalance -= amount;
+	if (!balanceLedger.Move(CoinID, UserPubKey, BALANCE_IN_EXCHANGE, amount, BALANCE_AVAILABLE, amount, setting.nVerifyUserBalance))
+		return EXCHANGE_BALANCE_NOT_ENOUGH;
 	return EXCHANGE_BALANCE_RETURNED;
 }
 
 int64_t CUserBalanceManager::GetUserAvailableBalance(int CoinID, std::string UserPubKey)
 {
-	std::shared_ptr<CUserBalance> ub;
-	InitUserBalance(CoinID, UserPubKey, ub);
-	return ub->nAvailableBalance;
+	return balanceLedger.GetBalance(CoinID, UserPubKey, BALANCE_AVAILABLE);
 }
 
 int64_t CUserBalanceManager::GetUserInExchangeBalance(int CoinID, std::string UserPubKey)
 {
-	std::shared_ptr<CUserBalance> ub;
-	InitUserBalance(CoinID, UserPubKey, ub);
-	return ub->nInExchangeBalance;
+	return balanceLedger.GetBalance(CoinID, UserPubKey, BALANCE_IN_EXCHANGE);
 }
 
 int64_t CUserBalanceManager::GetUserPendingDepositBalance(int CoinID, std::string UserPubKey)
 {
-	std::shared_ptr<CUserBalance> ub;
-	InitUserBalance(CoinID, UserPubKey, ub);
-	return ub->nPendingDepositBalance;
+	return balanceLedger.GetBalance(CoinID, UserPubKey, BALANCE_PENDING_DEPOSIT);
 }
 
 int64_t CUserBalanceManager::GetUserPendingWithdrawalBalance(int CoinID, std::string UserPubKey)
 {
-	std::shared_ptr<CUserBalance> ub;
-	InitUserBalance(CoinID, UserPubKey, ub);
-	return ub->nPendingWithdrawalBalance;
+	return balanceLedger.GetBalance(CoinID, UserPubKey, BALANCE_PENDING_WITHDRAWAL);
 }
 
 void CUserBalanceManager::AdjustUserAvailableBalance(int CoinID, std::string UserPubKey, int64_t amount)
 {
-	std::shared_ptr<CUserBalance> ub;
-	InitUserBalance(CoinID, UserPubKey, ub);
-	ub->nAvailableBalance += amount;
+	balanceLedger.Adjust(CoinID, UserPubKey, BALANCE_AVAILABLE, amount);
 }
 
 void CUserBalanceManager::AdjustUserInExchangeBalance(int CoinID, std::string UserPubKey, int64_t amount)
 {
-	std::shared_ptr<CUserBalance> ub;
-	InitUserBalance(CoinID, UserPubKey, ub);
-	ub->nInExchangeBalance += amount;
+	balanceLedger.Adjust(CoinID, UserPubKey, BALANCE_IN_EXCHANGE, amount);
 }
 
 void CUserBalanceManager::AdjustUserPendingDepositBalance(int CoinID, std::string UserPubKey, int64_t amount)
 {
-	std::shared_ptr<CUserBalance> ub;
-	InitUserBalance(CoinID, UserPubKey, ub);
-	ub->nPendingDepositBalance += amount;
+	balanceLedger.Adjust(CoinID, UserPubKey, BALANCE_PENDING_DEPOSIT, amount);
 }
 
 void CUserBalanceManager::AdjustUserPendingWithdrawalBalance(int CoinID, std::string UserPubKey, int64_t amount)
 {
-	std::shared_ptr<CUserBalance> ub;
-	InitUserBalance(CoinID, UserPubKey, ub);
-	ub->nPendingWithdrawalBalance += amount;
+	balanceLedger.Adjust(CoinID, UserPubKey, BALANCE_PENDING_WITHDRAWAL, amount);
 }
 
 bool CUserBalanceManager::UpdateAfterTradeBalance(std::string User1PubKey, std::string User2PubKey, int CoinID1, int CoinID2, int64_t User1EAdjDown, int64_t User1BAdjUp, int64_t User2EAdjDown, int64_t User2BAdjUp)
@@ -246,77 +194,42 @@ bool CUserBalanceManager::UpdateAfterTradeBalance(std::string User1PubKey, std::
 	if (!IsInChargeOfCoinBalance(CoinID1) || !IsInChargeOfCoinBalance(CoinID2))
 		return false;
 
-	auto& temp1 = mapUserBalanceByCoinID[CoinID1];
-	auto& temp2 = mapUserBalanceByCoinID[CoinID2];
-
-	if (!temp1.count(User1PubKey) || !temp1.count(User2PubKey) || !temp2.count(User1PubKey) || !temp2.count(User2PubKey))
+	LOCK(balanceLedger.cs);
+	if (!balanceLedger.IsBalanceExist(CoinID1, User1PubKey) || !balanceLedger.IsBalanceExist(CoinID1, User2PubKey) || !balanceLedger.IsBalanceExist(CoinID2, User1PubKey) || !balanceLedger.IsBalanceExist(CoinID2, User2PubKey))
 		return false;
 
-	temp1[User1PubKey]->nAvailableBalance += User1BAdjUp;
-	temp1[User2PubKey]->nInExchangeBalance -= User2EAdjDown;
-	temp2[User1PubKey]->nInExchangeBalance -= User1EAdjDown;
-	temp2[User2PubKey]->nAvailableBalance += User2BAdjUp;
-	return true;
+	std::vector<CBalanceChange> vChange;
+	vChange.push_back(CBalanceChange(CoinID1, User1PubKey, BALANCE_AVAILABLE, User1BAdjUp));
+	vChange.push_back(CBalanceChange(CoinID1, User2PubKey, BALANCE_IN_EXCHANGE, 0 - User2EAdjDown));
+	vChange.push_back(CBalanceChange(CoinID2, User1PubKey, BALANCE_IN_EXCHANGE, 0 - User1EAdjDown));
+	vChange.push_back(CBalanceChange(CoinID2, User2PubKey, BALANCE_AVAILABLE, User2BAdjUp));
+	return balanceLedger.Adjust(vChange);
 }
 
 bool CUserBalanceManager::UpdateAfterTradeBalance(std::string UserPubKey, int ExchangeCoinID, int BalanceCoinID, int64_t ExchangeAdjDown, int64_t BalanceAdjUp)
 {
-	auto& a = mapUserBalanceByPubKey[UserPubKey];
-	if (!a.count(ExchangeCoinID))
-	{
-		std::shared_ptr<CUserBalance> temp = std::make_shared<CUserBalance>(UserPubKey, BalanceCoinID);
-		temp->nAvailableBalance += BalanceAdjUp;
-		a.insert(std::make_pair(BalanceCoinID, temp));
-	}
-	else
-		a[BalanceCoinID]->nAvailableBalance += BalanceAdjUp;
-	a[ExchangeCoinID]->nInExchangeBalance -= ExchangeAdjDown;
+	std::vector<CBalanceChange> vChange;
+	vChange.push_back(CBalanceChange(BalanceCoinID, UserPubKey, BALANCE_AVAILABLE, BalanceAdjUp));
+	vChange.push_back(CBalanceChange(ExchangeCoinID, UserPubKey, BALANCE_IN_EXCHANGE, 0 - ExchangeAdjDown));
+	return balanceLedger.Adjust(vChange);
 }
 
 bool CUserBalanceManager::BalanceToExchangeV2(int CoinID, std::string UserPubKey, uint64_t amount)
 {
-	std::shared_ptr<CUserBalance> ub;
-	InitUserBalance(CoinID, UserPubKey, ub);
-	if (ub->nAvailableBalance < amount)
-		return false;
-
-	ub->nAvailableBalance -= amount;
-	ub->nInExchangeBalance += amount;
-	return true;
+	return balanceLedger.Move(CoinID, UserPubKey, BALANCE_AVAILABLE, amount, BALANCE_IN_EXCHANGE, amount, true);
 }
 
 bool CUserBalanceManager::ExchangeToBalanceV2(int CoinID, std::string UserPubKey, uint64_t amount)
 {
-	std::shared_ptr<CUserBalance> ub;
-	InitUserBalance(CoinID, UserPubKey, ub);
-	if (ub->nInExchangeBalance < amount)
-		return false;
-
-	ub->nInExchangeBalance -= amount;
-	ub->nAvailableBalance += amount;
-	return true;
+	return balanceLedger.Move(CoinID, UserPubKey, BALANCE_IN_EXCHANGE, amount, BALANCE_AVAILABLE, amount, true);
 }
 
 bool CUserBalanceManager::PendingToAvailable(int CoinID, std::string UserPubKey, uint64_t PendingAmount, uint64_t AvailableAmount)
 {
-	std::shared_ptr<CUserBalance> ub;
-	InitUserBalance(CoinID, UserPubKey, ub);
-	if (ub->nPendingDepositBalance < PendingAmount)
-		return false;
-
-	ub->nPendingDepositBalance -= PendingAmount;
-	ub->nAvailableBalance += AvailableAmount;
-	return true;
+	return balanceLedger.Move(CoinID, UserPubKey, BALANCE_PENDING_DEPOSIT, PendingAmount, BALANCE_AVAILABLE, AvailableAmount, true);
 }
 
 bool CUserBalanceManager::AvailableToPending(int CoinID, std::string UserPubKey, uint64_t AvailableAmount, uint64_t PendingAmount)
 {
-	std::shared_ptr<CUserBalance> ub;
-	InitUserBalance(CoinID, UserPubKey, ub);
-	if (ub->nAvailableBalance < AvailableAmount)
-		return false;
-
-	ub->nAvailableBalance -= AvailableAmount;
-	ub->nPendingDepositBalance += PendingAmount;
-	return true;
-}
\ No newline at end of file
+	return balanceLedger.Move(CoinID, UserPubKey, BALANCE_AVAILABLE, AvailableAmount, BALANCE_PENDING_DEPOSIT, PendingAmount, true);
+}
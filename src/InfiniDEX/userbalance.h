@@ -12,6 +12,7 @@
 #include <set>
 #include "hash.h"
 #include "net.h"
+#include "sync.h"
 #include "utilstrencodings.h"
 
 class CUserBalance;
@@ -20,14 +21,11 @@ class CUserBalanceManager;
 class CGlobalUserBalanceHandler;
 class CGlobalUserSetting;
 
-typedef std::map<std::string, std::shared_ptr<CUserBalance>> mapUserBalanceWithPubKey;
-typedef std::map<int, std::shared_ptr<CUserBalance>> mapUserBalanceWithCoinID;
-extern std::map<std::string, mapUserBalanceWithCoinID> mapUserBalanceByPubKey;
-extern std::map<int, mapUserBalanceWithPubKey> mapUserBalanceByCoinID;
 extern std::map<int, CUserBalanceSetting> mapUserBalanceSetting;
 extern CGlobalUserBalanceHandler globalUserBalanceHandler;
 extern CUserBalanceManager userBalanceManager;
-extern std::map<char, CGlobalUserSetting> mapGlobalUserSetting;
+extern std::map<char, CGlobalUserSetting> mapGlobalUserSetting; //role changes come from the message thread, lookups from the DEX workers
+extern CCriticalSection cs_mapGlobalUserSetting;
 
 enum userbalance_to_exchange_enum_t {
 	USER_ACCOUNT_NOT_FOUND = -1,
@@ -176,7 +174,7 @@ public:
 	bool AssignUserBalanceRole(char Char, bool toAssign = true);
 	bool AssignBackupRole(char Char, bool toAssign = true);
 	bool UpdateUserBalance(CUserBalance UserBalance);
-	void InitUserBalance(int CoinID, std::string UserPubKey, std::shared_ptr<CUserBalance>& UserBalance);
+	bool GetUserBalance(int CoinID, std::string UserPubKey, CUserBalance& UserBalance);
 	int GetLastDepositID(int CoinID, std::string UserPubKey);
 	bool InChargeOfUserBalance(std::string pubKey);
 	bool InChargeOfBackup(std::string pubKey);
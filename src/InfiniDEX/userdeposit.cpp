@@ -16,9 +16,9 @@ class CUserDeposit;
 class CUserDepositSetting;
 class CUserDepositManager;
 
-std::map<int, mapUserDepositWithPubKey> mapUserDepositByCoinID;
-std::map<std::string, mapUserDepositWithCoinID> mapUserDepositByPubKey;
-std::map<int, mapLastRequestTimeByPubKey> mapUserLastRequestTime;
+std::map<int, mapUserDepositWithUserID> mapUserDepositByCoinID;
+std::map<uint32_t, mapUserDepositWithCoinID> mapUserDepositByUserID;
+std::map<int, mapLastRequestTimeByUserID> mapUserLastRequestTime;
 std::map<int, CUserDepositSetting> mapUserDepositSetting;
 CUserDepositManager userDepositManager;
 
@@ -56,13 +56,21 @@ bool CUserDeposit::VerifySignature()
 	return true;
 }
 
+uint32_t CUserDeposit::GetUserID()
+{
+	if (nUserID == TRADER_ID_NONE)
+		nUserID = traderRegistry.GetTraderID(nUserPubKey);
+	return nUserID;
+}
+
 void CUserDepositManager::InputUserDeposit(const std::shared_ptr<CUserDeposit>& UserDeposit)
 {	
+	uint32_t UserID = UserDeposit->GetUserID();
 	if (userBalanceManager.InChargeOfUserBalance(UserDeposit->nUserPubKey))
 	{		
-		if (!mapUserDepositByPubKey.count(UserDeposit->nUserPubKey))
-			mapUserDepositByPubKey.insert(std::make_pair(UserDeposit->nUserPubKey, mapUserDepositWithCoinID()));
-		mapUserDepositWithCoinID& temp = mapUserDepositByPubKey[UserDeposit->nUserPubKey];
+		if (!mapUserDepositByUserID.count(UserID))
+			mapUserDepositByUserID.insert(std::make_pair(UserID, mapUserDepositWithCoinID()));
+		mapUserDepositWithCoinID& temp = mapUserDepositByUserID[UserID];
 		if (!temp.count(UserDeposit->nCoinID))
 			temp.insert(std::make_pair(UserDeposit->nCoinID, UserDepositInfo()));
 		UserDepositInfo& temp2 = temp[UserDeposit->nCoinID];
@@ -127,11 +135,11 @@ void CUserDepositManager::InputUserDeposit(const std::shared_ptr<CUserDeposit>&
 	if (!setting.ProvideUserDepositInfo)
 		return;
 
-	mapUserDepositWithPubKey& temp4 = mapUserDepositByCoinID[UserDeposit->nCoinID];
-	if (!temp4.count(UserDeposit->nUserPubKey))
-		temp4.insert(std::make_pair(UserDeposit->nUserPubKey, UserDepositInfo()));
+	mapUserDepositWithUserID& temp4 = mapUserDepositByCoinID[UserDeposit->nCoinID];
+	if (!temp4.count(UserID))
+		temp4.insert(std::make_pair(UserID, UserDepositInfo()));
 
-	mapUserDepositWithID& temp5 = temp4[UserDeposit->nUserPubKey].second;
+	mapUserDepositWithID& temp5 = temp4[UserID].second;
 	if (!temp5.count(UserDeposit->nUserDepositID))
 	{
 		int lastPendingID = 0;
@@ -183,8 +191,8 @@ void CUserDepositManager::SetSyncInProgress(int CoinID, bool status)
 void CUserDepositManager::AddCoinToList(int CoinID)
 {
 	mapUserDepositSetting.insert(std::make_pair(CoinID, CUserDepositSetting()));
-	mapUserLastRequestTime.insert(std::make_pair(CoinID, mapLastRequestTimeByPubKey()));
-	mapUserDepositByCoinID.insert(std::make_pair(CoinID, mapUserDepositWithPubKey()));
+	mapUserLastRequestTime.insert(std::make_pair(CoinID, mapLastRequestTimeByUserID()));
+	mapUserDepositByCoinID.insert(std::make_pair(CoinID, mapUserDepositWithUserID()));
 }
 
 bool CUserDepositManager::IsCoinInList(int CoinID)
@@ -194,13 +202,14 @@ bool CUserDepositManager::IsCoinInList(int CoinID)
 
 void CUserDepositManager::AddNewUser(std::string UserPubKey, int CoinID)
 {
-	mapUserDepositByCoinID[CoinID].insert(std::make_pair(UserPubKey, UserDepositInfo()));
-	mapUserLastRequestTime[CoinID].insert(std::make_pair(UserPubKey, 0));
+	uint32_t UserID = traderRegistry.GetTraderID(UserPubKey);
+	mapUserDepositByCoinID[CoinID].insert(std::make_pair(UserID, UserDepositInfo()));
+	mapUserLastRequestTime[CoinID].insert(std::make_pair(UserID, 0));
 }
 
 bool CUserDepositManager::IsUserInList(std::string UserPubKey, int CoinID)
 {
-	return mapUserDepositByCoinID[CoinID].count(UserPubKey);
+	return mapUserDepositByCoinID[CoinID].count(traderRegistry.FindTraderID(UserPubKey));
 }
 
 void CUserDepositManager::RequestPendingDepositData(int StartingID)
@@ -220,11 +229,11 @@ void CUserDepositManager::AddPendingDeposit(std::shared_ptr<CUserDeposit> UserDe
 	if (UserDeposit->nDepositStatus != USER_DEPOSIT_PENDING)
 		return;
 
-	mapUserDepositWithPubKey& temp = mapUserDepositByCoinID[UserDeposit->nCoinID];
-	if (!temp.count(UserDeposit->nUserPubKey))
-		temp.insert(std::make_pair(UserDeposit->nUserPubKey, UserDepositInfo()));
+	mapUserDepositWithUserID& temp = mapUserDepositByCoinID[UserDeposit->nCoinID];
+	if (!temp.count(UserDeposit->GetUserID()))
+		temp.insert(std::make_pair(UserDeposit->GetUserID(), UserDepositInfo()));
 	
-	mapUserDepositWithID& temp2 = temp[UserDeposit->nUserPubKey].second;
+	mapUserDepositWithID& temp2 = temp[UserDeposit->GetUserID()].second;
 	if (temp2.count(UserDeposit->nUserDepositID))
 		return;	
 
@@ -245,16 +254,26 @@ void CUserDepositManager::AddPendingDeposit(std::shared_ptr<CUserDeposit> UserDe
 
 bool CUserDepositManager::IsUserDepositInList(std::shared_ptr<CUserDeposit> UserDeposit)
 {
-	return mapUserDepositByCoinID[UserDeposit->nCoinID][UserDeposit->nUserPubKey].second.count(UserDeposit->nUserDepositID);
+	return mapUserDepositByCoinID[UserDeposit->nCoinID][UserDeposit->GetUserID()].second.count(UserDeposit->nUserDepositID);
 }
 
-int CUserDepositManager::GetLastUserPendingDepositID(std::string UserPubKey, int CoinID)
+//a lookup only, keys without deposits are not interned or added to the map
+static int GetLastUserDepositID(const std::string& UserPubKey, int CoinID)
 {
-	mapUserDepositWithID::reverse_iterator it = mapUserDepositByCoinID[CoinID][UserPubKey].second.rbegin();
-	if (it == mapUserDepositByCoinID[CoinID][UserPubKey].second.rend())
+	auto itCoin = mapUserDepositByCoinID.find(CoinID);
+	if (itCoin == mapUserDepositByCoinID.end())
+		return 0;
+
+	auto itUser = itCoin->second.find(traderRegistry.FindTraderID(UserPubKey));
+	if (itUser == itCoin->second.end() || itUser->second.second.empty())
 		return 0;
 
-	return it->second->nUserDepositID;
+	return itUser->second.second.rbegin()->second->nUserDepositID;
+}
+
+int CUserDepositManager::GetLastUserPendingDepositID(std::string UserPubKey, int CoinID)
+{
+	return GetLastUserDepositID(UserPubKey, CoinID);
 }
 
 void CUserDepositManager::RequestConfirmDepositData(int StartingID)
@@ -279,7 +298,7 @@ void CUserDepositManager::AddConfirmDeposit(std::shared_ptr<CUserDeposit> UserDe
 	}
 	else if (IsUserDepositInList(UserDeposit))
 	{
-		if (mapUserDepositByCoinID[UserDeposit->nCoinID][UserDeposit->nUserPubKey].second[UserDeposit->nUserDepositID]->nDepositStatus == USER_DEPOSIT_CONFIRMED)
+		if (mapUserDepositByCoinID[UserDeposit->nCoinID][UserDeposit->GetUserID()].second[UserDeposit->nUserDepositID]->nDepositStatus == USER_DEPOSIT_CONFIRMED)
 			return;
 	}
 
@@ -291,7 +310,7 @@ void CUserDepositManager::AddConfirmDeposit(std::shared_ptr<CUserDeposit> UserDe
 		return;
 	}
 
-	mapUserDepositByCoinID[UserDeposit->nCoinID][UserDeposit->nUserPubKey].second.insert(std::make_pair(UserDeposit->nUserDepositID, UserDeposit));
+	mapUserDepositByCoinID[UserDeposit->nCoinID][UserDeposit->GetUserID()].second.insert(std::make_pair(UserDeposit->nUserDepositID, UserDeposit));
 	if (userBalanceManager.GetLastDepositID(UserDeposit->nCoinID, UserDeposit->nUserPubKey) > UserDeposit->nUserDepositID)
 		return;
 
@@ -300,9 +319,5 @@ void CUserDepositManager::AddConfirmDeposit(std::shared_ptr<CUserDeposit> UserDe
 
 int CUserDepositManager::GetLastUserConfirmDepositID(std::string UserPubKey, int CoinID)
 {
-	mapUserDepositWithID::reverse_iterator it = mapUserDepositByCoinID[CoinID][UserPubKey].second.rbegin();
-	if (it == mapUserDepositByCoinID[CoinID][UserPubKey].second.rend())
-		return 0;
-
-	return it->second->nUserDepositID;
+	return GetLastUserDepositID(UserPubKey, CoinID);
 }
\ No newline at end of file
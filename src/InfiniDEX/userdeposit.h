@@ -11,6 +11,7 @@
 #include <set>
 #include <memory>
 #include "userconnection.h"
+#include "traderregistry.h"
 #include "hash.h"
 #include "net.h"
 #include "utilstrencodings.h"
@@ -25,14 +26,14 @@ class CUserDeposit;
 class CUserDepositSetting;
 class CUserDepositManager;
 
-typedef std::map<std::string, uint64_t> mapLastRequestTimeByPubKey;
+typedef std::map<uint32_t, uint64_t> mapLastRequestTimeByUserID;
 typedef std::map<int, std::shared_ptr<CUserDeposit>> mapUserDepositWithID;
 typedef std::pair<int, mapUserDepositWithID> UserDepositInfo;
-typedef std::map<std::string, UserDepositInfo> mapUserDepositWithPubKey;
+typedef std::map<uint32_t, UserDepositInfo> mapUserDepositWithUserID;
 typedef std::map<int, UserDepositInfo> mapUserDepositWithCoinID;
-extern std::map<int, mapUserDepositWithPubKey> mapUserDepositByCoinID;
-extern std::map<std::string, mapUserDepositWithCoinID> mapUserDepositByPubKey;
-extern std::map<int, mapLastRequestTimeByPubKey> mapUserLastRequestTime;
+extern std::map<int, mapUserDepositWithUserID> mapUserDepositByCoinID;
+extern std::map<uint32_t, mapUserDepositWithCoinID> mapUserDepositByUserID;
+extern std::map<int, mapLastRequestTimeByUserID> mapUserLastRequestTime;
 extern std::map<int, CUserDepositSetting> mapUserDepositSetting;
 extern CUserDepositManager userDepositManager;
 
@@ -80,6 +81,7 @@ public:
 	int nDepositStatus;
 	std::string nRemark;
 	uint64_t nLastUpdateTime;
+	uint32_t nUserID; //interned nUserPubKey, not serialized
 
 	CUserDeposit(int nUserDepositID, std::string nUserPubKey, int nCoinID, uint64_t nDepositAmount, uint64_t nBlockNumber, uint64_t nDepositTime, int nDepositStatus, std::string nRemark, uint64_t nLastUpdateTime) :
 		nUserDepositID(nUserDepositID),
@@ -90,7 +92,8 @@ public:
 		nDepositTime(nDepositTime),
 		nDepositStatus(nDepositStatus),
 		nRemark(nRemark),
-		nLastUpdateTime(nLastUpdateTime)
+		nLastUpdateTime(nLastUpdateTime),
+		nUserID(TRADER_ID_NONE)
 	{}
 
 	CUserDeposit() :
@@ -102,7 +105,8 @@ public:
 		nDepositTime(0),
 		nDepositStatus(USER_DEPOSIT_INVALID),
 		nRemark(""),
-		nLastUpdateTime(0)
+		nLastUpdateTime(0),
+		nUserID(TRADER_ID_NONE)
 	{}
 	
 	ADD_SERIALIZE_METHODS;
@@ -122,6 +126,7 @@ public:
 	}
 
 	bool VerifySignature();
+	uint32_t GetUserID();
 	void RelayTo(CNode* node, CConnman& connman);
 	void RelayToCoOpNode(CConnman& connman);
 };
@@ -7,7 +7,7 @@
 class CUserTradeHistory;
 class CUserTradeHistoryManager;
 
-std::map<std::string, mapUserTradeHistoryById2> mapUserTradeHistoriesByTradePair;
+std::map<uint32_t, mapUserTradeHistoryById2> mapUserTradeHistoriesByTradePair;
 std::map<int, mapUserTradeHistoryById> mapMarketTradeHistories;
 std::map<int, CUserTradeHistorySetting> mapUserTradeHistorySetting;
 std::set<std::string> mapMarketTradeHistoryHash;
@@ -16,6 +16,7 @@ CUserTradeHistoryManager userTradeHistoryManager;
 
 void CUserTradeHistoryManager::InitTradePair(int TradePairID)
 {
+	LOCK(cs);
 	if (mapUserTradeHistorySetting.count(TradePairID))
 		return;
 
@@ -25,6 +26,7 @@ void CUserTradeHistoryManager::InitTradePair(int TradePairID)
 
 void CUserTradeHistoryManager::AssignMarketTradeHistoryBroadcastRole(int TradePairID, bool toAssign)
 {
+	LOCK(cs);
 	InitTradePair(TradePairID);
 	mapUserTradeHistorySetting[TradePairID].InChargeOfBroadcastMarketTradeHistory = true;
 }
@@ -35,17 +37,18 @@ void CUserTradeHistoryManager::InputUserTradeHistory(const std::shared_ptr<CUser
 	tradeHistory->SetMNUserHash();
 	tradeHistory->nMNUserPubKey = ""; //to update
 
-	if (!mapUserTradeHistoriesByTradePair.count(tradeHistory->nUserPubKey1))
-		mapUserTradeHistoriesByTradePair.insert(std::make_pair(tradeHistory->nUserPubKey1, mapUserTradeHistoryById2()));
+	LOCK(cs);
+	if (!mapUserTradeHistoriesByTradePair.count(tradeHistory->nUserID1))
+		mapUserTradeHistoriesByTradePair.insert(std::make_pair(tradeHistory->nUserID1, mapUserTradeHistoryById2()));
 
-	if (!mapUserTradeHistoriesByTradePair.count(tradeHistory->nUserPubKey2))
-		mapUserTradeHistoriesByTradePair.insert(std::make_pair(tradeHistory->nUserPubKey2, mapUserTradeHistoryById2()));
+	if (!mapUserTradeHistoriesByTradePair.count(tradeHistory->nUserID2))
+		mapUserTradeHistoriesByTradePair.insert(std::make_pair(tradeHistory->nUserID2, mapUserTradeHistoryById2()));
 
-	auto& a = mapUserTradeHistoriesByTradePair[tradeHistory->nUserPubKey1];
+	auto& a = mapUserTradeHistoriesByTradePair[tradeHistory->nUserID1];
 	if (!a.count(tradeHistory->nTradePairID))
 		a.insert(std::make_pair(tradeHistory->nTradePairID, std::make_pair(0, mapUserTradeHistoryById())));
 
-	auto& c = mapUserTradeHistoriesByTradePair[tradeHistory->nUserPubKey2];
+	auto& c = mapUserTradeHistoriesByTradePair[tradeHistory->nUserID2];
 	if (!c.count(tradeHistory->nTradePairID))
 		c.insert(std::make_pair(tradeHistory->nTradePairID, std::make_pair(0, mapUserTradeHistoryById())));
 
@@ -66,6 +69,7 @@ void CUserTradeHistoryManager::InputUserTradeHistory(const std::shared_ptr<CUser
 //initiated from actual trade info
 void CUserTradeHistoryManager::InputMarketTradeHistory(const std::shared_ptr<CUserTradeHistory>& tradeHistory)
 {
+	LOCK(cs);
 	CUserTradeHistorySetting& setting = mapUserTradeHistorySetting[tradeHistory->nTradePairID];
 	if (setting.TradePairID == 0)
 	{
@@ -10,9 +10,11 @@
 #include <map>
 #include <memory>
 #include <set>
+#include "traderregistry.h"
 #include "userconnection.h"
 #include "hash.h"
 #include "net.h"
+#include "sync.h"
 #include "utilstrencodings.h"
 
 class CUserTradeHistory;
@@ -22,10 +24,10 @@ class CUserTradeHistorySetting;
 typedef std::map<int, std::shared_ptr<CUserTradeHistory>> mapUserTradeHistoryById;
 typedef std::pair<int, mapUserTradeHistoryById> pairLastCounterUserTradeHistory;
 typedef std::map<int, pairLastCounterUserTradeHistory> mapUserTradeHistoryById2;
-typedef std::map<std::string, mapUserTradeHistoryById> mapUserTradeHistoryByPubKey;
+typedef std::map<uint32_t, mapUserTradeHistoryById> mapUserTradeHistoryByUserID;
 extern std::map<int, mapUserTradeHistoryById> mapMarketTradeHistories;
 extern std::map<int, CUserTradeHistorySetting> mapUserTradeHistorySetting;
-extern std::map<std::string, mapUserTradeHistoryById2> mapUserTradeHistoriesByTradePair;
+extern std::map<uint32_t, mapUserTradeHistoryById2> mapUserTradeHistoriesByTradePair; //by trader ID
 extern std::set<std::string> mapMarketTradeHistoryHash;
 extern std::set<std::string> mapUserTradeHistoryHash;
 extern CUserTradeHistoryManager userTradeHistoryManager;
@@ -52,6 +54,8 @@ public:
 	std::string nMNUserHash;
 	std::string nMNUserPubKey;
 	uint64_t nTradeTime;
+	uint32_t nUserID1; //interned nUserPubKey1, not serialized
+	uint32_t nUserID2; //interned nUserPubKey2, not serialized
 
 	CUserTradeHistory(int nTradePairID, std::string nUserPubKey1, std::string nUserPubKey2, uint64_t nPrice, uint64_t nQty, uint64_t nAmount, bool nIsBid, uint64_t nTradeTime) :
 		nMarketTradeHistoryID(0),
@@ -68,7 +72,9 @@ public:
 		nMNMarketPubKey(""),
 		nMNUserHash(""),
 		nMNUserPubKey(""),
-		nTradeTime(nTradeTime)
+		nTradeTime(nTradeTime),
+		nUserID1(TRADER_ID_NONE),
+		nUserID2(TRADER_ID_NONE)
 	{}
 
 	CUserTradeHistory() :
@@ -86,9 +92,33 @@ public:
 		nMNMarketPubKey(""),
 		nMNUserHash(""),
 		nMNUserPubKey(""),
-		nTradeTime(0)
+		nTradeTime(0),
+		nUserID1(TRADER_ID_NONE),
+		nUserID2(TRADER_ID_NONE)
 	{}
 
+	ADD_SERIALIZE_METHODS;
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+		READWRITE(nMarketTradeHistoryID);
+		READWRITE(nTradePairID);
+		READWRITE(nUser1TradeHistoryID);
+		READWRITE(nUser2TradeHistoryID);
+		READWRITE(nUserPubKey1);
+		READWRITE(nUserPubKey2);
+		READWRITE(nPrice);
+		READWRITE(nQty);
+		READWRITE(nAmount);
+		READWRITE(nIsBid);
+		READWRITE(nMNMarketHash);
+		READWRITE(nMNMarketPubKey);
+		READWRITE(nMNUserHash);
+		READWRITE(nMNUserPubKey);
+		READWRITE(nTradeTime);
+		READWRITE(mnMarketvchSig);
+		READWRITE(mnUservchSig);
+	}
+
 	void SetMNUserHash();
 	void SetMNMarketHash();
 	bool MNUserSign();
@@ -103,6 +133,9 @@ private:
 	std::vector<unsigned char> vchSig;
 
 public:
+	//protects the trade history maps, pair workers and the role thread all write them
+	CCriticalSection cs;
+
 	CUserTradeHistoryManager() {}
 	void InitTradePair(int TradePairID);
 	void AssignMarketTradeHistoryBroadcastRole(int TradePairID, bool toAssign = true);
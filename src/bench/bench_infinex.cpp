@@ -4,6 +4,7 @@
 
 #include "bench.h"
 
+#include "crypto/Lyra2.h"
 #include "key.h"
 #include "validation.h"
 #include "util.h"
@@ -11,7 +12,9 @@
 int
 main(int argc, char** argv)
 {
+	spongeAutoDetect();
 	ECC_Start();
+	ECCVerifyHandle globalVerifyHandle;
 	SetupEnvironment();
 	fPrintToDebugLog = false; // don't want to write to debug.log file
 
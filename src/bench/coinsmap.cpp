@@ -0,0 +1,132 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "coins.h"
+#include "crypto/common.h"
+
+#include <stdexcept>
+#include <vector>
+
+// Coins in the cache the lookups run against, and coins written per flush
+static const unsigned int CACHE_COINS = 200000;
+static const unsigned int FLUSH_COINS = 5000;
+
+namespace {
+// Consumes the flushed entries like CCoinsViewDB::BatchWrite, without the database
+class CCoinsViewSink : public CCoinsView
+{
+public:
+    size_t nWritten;
+
+    CCoinsViewSink() : nWritten(0) {}
+
+    bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock)
+    {
+        for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+            if (it->second.flags & CCoinsCacheEntry::DIRTY)
+                nWritten += it->second.coins.vout.size();
+            it = mapCoins.erase(it);
+        }
+        return true;
+    }
+};
+}
+
+// Cheap distinct txids, the map hashes them with its own salt anyway
+static uint256 BenchTxid(uint64_t n, uint64_t nSeries)
+{
+    uint256 txid;
+    WriteLE64(txid.begin(), n);
+    WriteLE64(txid.begin() + 8, nSeries);
+    return txid;
+}
+
+static void AddCoins(CCoinsViewCache& cache, const uint256& txid)
+{
+    CCoinsModifier coins = cache.ModifyNewCoins(txid);
+    coins->vout.resize(2);
+    coins->vout[0].nValue = 1;
+    coins->vout[1].nValue = 2;
+}
+
+static void CoinsMapLookup(benchmark::State& state, CCoinsMap::Implementation impl)
+{
+    CCoinsMap::Implementation implPrev = CCoinsMap::GetDefaultImplementation();
+    CCoinsMap::SetDefaultImplementation(impl);
+    {
+        CCoinsViewSink sink;
+        CCoinsViewCache cache(&sink);
+        std::vector<uint256> vTxid(CACHE_COINS);
+        for (unsigned int i = 0; i < CACHE_COINS; i++) {
+            vTxid[i] = BenchTxid(i, 0);
+            AddCoins(cache, vTxid[i]);
+        }
+
+        // each iteration looks up 1000 cached and 100 unknown txids
+        uint32_t n = 0;
+        while (state.KeepRunning()) {
+            for (int i = 0; i < 1000; i++) {
+                n = n * 1103515245 + 12345;
+                if (!cache.AccessCoins(vTxid[n % CACHE_COINS]))
+                    throw std::runtime_error("CoinsMapLookup: coins not found");
+            }
+            for (int i = 0; i < 100; i++) {
+                if (cache.HaveCoinsInCache(BenchTxid(++n, 1)))
+                    throw std::runtime_error("CoinsMapLookup: unknown coins found");
+            }
+        }
+    }
+    CCoinsMap::SetDefaultImplementation(implPrev);
+}
+
+// ConnectBlock writes into a child view, which is flushed into the coins
+// tip, which is flushed into the database
+static void CoinsMapFlush(benchmark::State& state, CCoinsMap::Implementation impl)
+{
+    CCoinsMap::Implementation implPrev = CCoinsMap::GetDefaultImplementation();
+    CCoinsMap::SetDefaultImplementation(impl);
+    {
+        CCoinsViewSink sink;
+        CCoinsViewCache tip(&sink);
+        uint64_t nSeries = 0;
+        while (state.KeepRunning()) {
+            nSeries++;
+            {
+                CCoinsViewCache view(&tip);
+                for (unsigned int i = 0; i < FLUSH_COINS; i++)
+                    AddCoins(view, BenchTxid(i, nSeries));
+                view.Flush();
+            }
+            tip.Flush();
+        }
+    }
+    CCoinsMap::SetDefaultImplementation(implPrev);
+}
+
+static void CoinsMapLookupNode(benchmark::State& state)
+{
+    CoinsMapLookup(state, CCoinsMap::NODE);
+}
+
+static void CoinsMapLookupFlat(benchmark::State& state)
+{
+    CoinsMapLookup(state, CCoinsMap::FLAT);
+}
+
+static void CoinsMapFlushNode(benchmark::State& state)
+{
+    CoinsMapFlush(state, CCoinsMap::NODE);
+}
+
+static void CoinsMapFlushFlat(benchmark::State& state)
+{
+    CoinsMapFlush(state, CCoinsMap::FLAT);
+}
+
+BENCHMARK(CoinsMapLookupNode);
+BENCHMARK(CoinsMapLookupFlat);
+BENCHMARK(CoinsMapFlushNode);
+BENCHMARK(CoinsMapFlushFlat);
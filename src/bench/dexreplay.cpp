@@ -0,0 +1,203 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "key.h"
+#include "InfiniDEX/balanceledger.h"
+#include "InfiniDEX/orderbookengine.h"
+#include "InfiniDEX/trade.h"
+#include "InfiniDEX/tradepair.h"
+#include "InfiniDEX/userbalance.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <streambuf>
+#include <vector>
+
+// Replays a deterministic stream of signed user trades and cancels through the
+// same entry points the message handler uses (CUserTradeManager::InputUserTrade,
+// InputPairUserTrade and InputTradeCancel), with balances, settlement and order
+// book broadcast state included. The executor and verifier are not started, so
+// every stage runs inline in this thread and nothing reaches the network.
+//
+// Masternode balance signing is still a stub, so InputUserTrade stops after the
+// balance stage; the replay then hands the trade to the pair stage itself, the way
+// InputUserTrade does for a trade carrying a valid balance signature.
+//
+// The first replay happens during setup and fills the signature cache, so the
+// timed replays measure matching and settlement rather than secp256k1.
+
+static const int REPLAY_STREAM_SIZE = 20000;
+static const int REPLAY_USERS = 16;
+static const int REPLAY_PAIR = 1;
+static const int REPLAY_COIN1 = 1;
+static const int REPLAY_COIN2 = 2;
+static const int REPLAY_FEE = 20;
+static const uint64_t REPLAY_MID_PRICE = 10000;
+static const uint64_t REPLAY_TIME = 1514764800;
+static const int64_t REPLAY_USER_FUNDS = 1000000000000000LL;
+
+struct CReplayEvent
+{
+    std::shared_ptr<CUserTrade> userTrade;
+    std::shared_ptr<CCancelTrade> cancelTrade;
+};
+
+// swallows the matching code's console output while replaying
+class CNullStreamBuf : public std::streambuf
+{
+protected:
+    int overflow(int c) { return c; }
+};
+
+class CDEXReplay
+{
+private:
+    std::vector<CReplayEvent> vEvent;
+    CTradePair tradePair;
+
+    void ResetTradePair()
+    {
+        mapUserTrades.clear();
+        mapUserTradeBook.erase(REPLAY_PAIR);
+        mapUserTradeSetting.erase(REPLAY_PAIR);
+        mapActualTradeByActualTradeID.erase(REPLAY_PAIR);
+        mapActualTradeByUserTradeID.erase(REPLAY_PAIR);
+        mapConflictTrade.erase(REPLAY_PAIR);
+        mapActualTradeHash.erase(REPLAY_PAIR);
+        userTradeManager.AssignMatchUserTradeRole(REPLAY_PAIR);
+        userTradeManager.AssignBidBroadcastRole(REPLAY_PAIR);
+        userTradeManager.AssignAskBroadcastRole(REPLAY_PAIR);
+    }
+
+public:
+    CDEXReplay()
+    {
+        tradePair = CTradePair(REPLAY_PAIR, "INFX/BTC", REPLAY_COIN1, "INFX", REPLAY_COIN2, "BTC", true, 1, 1000000,
+            0, 0xFFFFFFFFFFFFULL, REPLAY_FEE, REPLAY_FEE, "", REPLAY_TIME);
+        {
+            LOCK(cs_mapCompleteTradePair);
+            mapCompleteTradePair[REPLAY_PAIR] = tradePair;
+        }
+        userBalanceManager.InitCoin(REPLAY_COIN1);
+        userBalanceManager.InitCoin(REPLAY_COIN2);
+
+        std::vector<CKey> vKey(REPLAY_USERS);
+        std::vector<std::string> vPubKey(REPLAY_USERS);
+        for (int i = 0; i < REPLAY_USERS; i++) {
+            vKey[i].MakeNewKey(true);
+            vPubKey[i] = HexStr(vKey[i].GetPubKey());
+            userBalanceManager.AssignUserBalanceRole(vPubKey[i][2]);
+            balanceLedger.Adjust(REPLAY_COIN1, vPubKey[i], BALANCE_AVAILABLE, REPLAY_USER_FUNDS);
+            balanceLedger.Adjust(REPLAY_COIN2, vPubKey[i], BALANCE_AVAILABLE, REPLAY_USER_FUNDS);
+        }
+
+        // fixed seed xorshift: passive limits around the mid price, crossing
+        // sweeps through several levels and cancels of earlier orders
+        uint64_t nState = 0x2545F4914F6CDD1DULL;
+        std::vector<int> vOrderEvent; // events of the orders, by pair trade ID - 1
+        vEvent.reserve(REPLAY_STREAM_SIZE);
+        for (int i = 0; i < REPLAY_STREAM_SIZE; i++) {
+            nState ^= nState << 13;
+            nState ^= nState >> 7;
+            nState ^= nState << 17;
+            int nUser = (nState >> 4) % REPLAY_USERS;
+            int nKind = (nState >> 12) % 10;
+            CReplayEvent event;
+
+            if (nKind < 2 && !vOrderEvent.empty()) {
+                int nTarget = (nState >> 24) % vOrderEvent.size();
+                const CUserTrade& target = *vEvent[vOrderEvent[nTarget]].userTrade;
+                std::shared_ptr<CCancelTrade> cancelTrade = std::make_shared<CCancelTrade>();
+                cancelTrade->nPairTradeID = nTarget + 1;
+                cancelTrade->nTradePairID = REPLAY_PAIR;
+                cancelTrade->nUserPubKey = target.nUserPubKey;
+                cancelTrade->isBid = target.nIsBid;
+                cancelTrade->nUserSubmitTime = REPLAY_TIME;
+                cancelTrade->nPrice = target.nPrice;
+                const CKey& key = vKey[std::find(vPubKey.begin(), vPubKey.end(), target.nUserPubKey) - vPubKey.begin()];
+                if (!cancelTrade->UserSign(key))
+                    throw std::runtime_error("CDEXReplay: unable to sign cancel");
+                event.cancelTrade = cancelTrade;
+            } else {
+                bool fBid = (nState >> 20) & 1;
+                int64_t nOffset = 1 + ((nState >> 32) % 32);
+                uint64_t nQty = 1 + ((nState >> 40) % 100);
+                if (nKind >= 8) {
+                    // crossing sweep, priced through the first levels of the other side
+                    nOffset = -1 - nOffset / 2;
+                    nQty *= 4;
+                }
+                uint64_t nPrice = fBid ? REPLAY_MID_PRICE - nOffset : REPLAY_MID_PRICE + nOffset;
+                std::shared_ptr<CUserTrade> userTrade = std::make_shared<CUserTrade>(REPLAY_PAIR, nPrice, nQty, fBid, REPLAY_FEE, vPubKey[nUser], REPLAY_TIME, "");
+                userTrade->nAmount = fBid ? userTradeManager.GetBidRequiredAmount(nPrice, nQty, REPLAY_FEE) : userTradeManager.GetAskExpectedAmount(nPrice, nQty, REPLAY_FEE);
+                if (!userTrade->UserSign(vKey[nUser]))
+                    throw std::runtime_error("CDEXReplay: unable to sign user trade");
+                event.userTrade = userTrade;
+                vOrderEvent.push_back(i);
+            }
+            vEvent.push_back(event);
+        }
+
+        std::vector<int64_t> vLatency;
+        Run(vLatency);
+    }
+
+    size_t GetOrderCount() const { return vEvent.size(); }
+
+    // returns the number of fills, appends the latency of every event in microseconds
+    uint64_t Run(std::vector<int64_t>& vLatency)
+    {
+        ResetTradePair();
+        CNullStreamBuf nullBuf;
+        std::streambuf* coutBuf = std::cout.rdbuf(&nullBuf);
+
+        for (size_t i = 0; i < vEvent.size(); i++) {
+            const CReplayEvent& event = vEvent[i];
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            if (event.cancelTrade) {
+                CCancelTrade cancelTrade = *event.cancelTrade;
+                userTradeManager.InputTradeCancel(cancelTrade);
+            } else {
+                std::shared_ptr<CUserTrade> userTrade = std::make_shared<CUserTrade>(*event.userTrade);
+                userTradeManager.InputUserTrade(userTrade);
+                if (userTrade->nMNBalancePubKey != "")
+                    userTradeManager.InputPairUserTrade(std::make_shared<CUserTrade>(*userTrade), tradePair);
+            }
+            vLatency.push_back(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        std::cout.rdbuf(coutBuf);
+        return mapUserTradeSetting[REPLAY_PAIR].nLastActualTradeID;
+    }
+};
+
+static void DEXReplayUserTrades(benchmark::State& state)
+{
+    static CDEXReplay replay;
+    std::vector<int64_t> vLatency;
+    uint64_t nOrders = 0;
+    uint64_t nFills = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (state.KeepRunning()) {
+        nFills += replay.Run(vLatency);
+        nOrders += replay.GetOrderCount();
+    }
+    double nSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    assert(nFills > 0 && !vLatency.empty());
+
+    std::sort(vLatency.begin(), vLatency.end());
+    std::cout << "DEXReplayUserTrades"
+              << ",orders/s=" << (uint64_t)(nOrders / nSeconds)
+              << ",fills/s=" << (uint64_t)(nFills / nSeconds)
+              << ",p50us=" << vLatency[vLatency.size() / 2]
+              << ",p99us=" << vLatency[vLatency.size() * 99 / 100] << "\n";
+}
+
+BENCHMARK(DEXReplayUserTrades);
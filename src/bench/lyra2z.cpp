@@ -0,0 +1,142 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "crypto/Lyra2.h"
+#include "crypto/Lyra2Z.h"
+#include "crypto/sph_blake.h"
+#include "primitives/block.h"
+#include "utilstrencodings.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <string.h>
+
+// Roughly how often one block's header is hashed on its way from the network
+// through AcceptBlockHeader, CheckBlock, ConnectBlock, ProcessNewBlock and the
+// relay code. Each benchmark iteration is one block.
+static const int BLOCK_HASH_CALLS = 18;
+
+static CBlockHeader MakeBenchHeader()
+{
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.hashPrevBlock = uint256S("0x00000c9b6a7d5e8c4f3b2a1908f7e6d5c4b3a29180706f5e4d3c2b1a09f8e7d6");
+    header.hashMerkleRoot = uint256S("0x4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b");
+    header.nTime = 1514764800;
+    header.nBits = 0x1e0ffff0;
+    return header;
+}
+
+// every call runs Lyra2Z, as GetHash() did before the hash was cached
+static void BlockHashUncached(benchmark::State& state)
+{
+    CBlockHeader header = MakeBenchHeader();
+    while (state.KeepRunning()) {
+        ++header.nNonce;
+        uint256 hash = header.ComputeHash();
+        for (int i = 1; i < BLOCK_HASH_CALLS; i++) {
+            if (header.ComputeHash() != hash)
+                throw std::runtime_error("BlockHashUncached: hash changed");
+        }
+    }
+}
+
+// the first call runs Lyra2Z, the others and the copies reuse it
+static void BlockHashCached(benchmark::State& state)
+{
+    CBlockHeader header = MakeBenchHeader();
+    while (state.KeepRunning()) {
+        ++header.nNonce;
+        uint256 hash = header.GetHash();
+        CBlock block(header);
+        for (int i = 1; i < BLOCK_HASH_CALLS; i++) {
+            if (block.GetHash() != hash)
+                throw std::runtime_error("BlockHashCached: hash changed");
+        }
+    }
+}
+
+// Lyra2Z the way it was computed before the scratch memory was kept per thread:
+// LYRA2() allocates and frees the matrix and the sponge state on every call
+static void Lyra2ZHashAllocating(const char* input, char* output)
+{
+    sph_blake256_context ctx_blake;
+    uint32_t hashA[8], hashB[8];
+    sph_blake256_init(&ctx_blake);
+    sph_blake256(&ctx_blake, input, 80);
+    sph_blake256_close(&ctx_blake, hashA);
+    if (LYRA2(hashB, 32, hashA, 32, hashA, 32, 8, 8, 8) != 0)
+        throw std::runtime_error("Lyra2ZHashAllocating: out of memory");
+    memcpy(output, hashB, 32);
+}
+
+static void RunLyra2ZHash(benchmark::State& state, const char* strName, void (*hash)(const char*, char*))
+{
+    CBlockHeader header = MakeBenchHeader();
+    uint256 result;
+    uint64_t nHashes = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (state.KeepRunning()) {
+        ++header.nNonce;
+        hash(BEGIN(header.nVersion), BEGIN(result));
+        ++nHashes;
+    }
+    double nSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << strName << ",hashes/s=" << (uint64_t)(nHashes / nSeconds) << "\n";
+}
+
+static void Lyra2ZAllocating(benchmark::State& state)
+{
+    RunLyra2ZHash(state, "Lyra2ZAllocating", Lyra2ZHashAllocating);
+}
+
+static void Lyra2ZThreadScratch(benchmark::State& state)
+{
+    RunLyra2ZHash(state, "Lyra2ZThreadScratch", lyra2z_hash);
+}
+
+// lyra2z_hash on one sponge implementation, skipped when the CPU lacks the instructions
+static void RunLyra2ZSponge(benchmark::State& state, const char* strImpl, const char* strName)
+{
+    std::string strDefault = spongeImplementation();
+    if (spongeSelect(strImpl) != 0) {
+        std::cout << strName << ",not supported by this CPU\n";
+        return;
+    }
+    RunLyra2ZHash(state, strName, lyra2z_hash);
+    spongeSelect(strDefault.c_str());
+}
+
+static void Lyra2ZSpongeGeneric(benchmark::State& state)
+{
+    RunLyra2ZSponge(state, "generic", "Lyra2ZSpongeGeneric");
+}
+
+static void Lyra2ZSpongeSSE2(benchmark::State& state)
+{
+    RunLyra2ZSponge(state, "sse2", "Lyra2ZSpongeSSE2");
+}
+
+static void Lyra2ZSpongeSSSE3(benchmark::State& state)
+{
+    RunLyra2ZSponge(state, "ssse3", "Lyra2ZSpongeSSSE3");
+}
+
+static void Lyra2ZSpongeAVX2(benchmark::State& state)
+{
+    RunLyra2ZSponge(state, "avx2", "Lyra2ZSpongeAVX2");
+}
+
+BENCHMARK(BlockHashUncached);
+BENCHMARK(BlockHashCached);
+BENCHMARK(Lyra2ZAllocating);
+BENCHMARK(Lyra2ZThreadScratch);
+BENCHMARK(Lyra2ZSpongeGeneric);
+BENCHMARK(Lyra2ZSpongeSSE2);
+BENCHMARK(Lyra2ZSpongeSSSE3);
+BENCHMARK(Lyra2ZSpongeAVX2);
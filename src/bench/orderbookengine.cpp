@@ -0,0 +1,190 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "InfiniDEX/orderbookengine.h"
+#include "InfiniDEX/trade.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Replays the same synthetic stream of one million limit orders and cancels
+// through the nested std::map walk used by the previous matching code and
+// through COrderBookEngine.
+
+static const int ORDER_STREAM_SIZE = 1000000;
+static const int ORDER_STREAM_PAIR = 1;
+
+struct CSyntheticOrder
+{
+    bool fCancel;
+    bool fBid;
+    uint64_t nPrice;
+    uint64_t nQty;
+    int nTarget; // stream index of the order to cancel
+};
+
+static const std::vector<CSyntheticOrder>& GetOrderStream()
+{
+    static std::vector<CSyntheticOrder> vStream;
+    if (!vStream.empty())
+        return vStream;
+
+    // fixed seed xorshift so every run and both books see the same stream
+    uint64_t nState = 0x9E3779B97F4A7C15ULL;
+    vStream.reserve(ORDER_STREAM_SIZE);
+    for (int i = 0; i < ORDER_STREAM_SIZE; i++) {
+        nState ^= nState << 13;
+        nState ^= nState >> 7;
+        nState ^= nState << 17;
+        CSyntheticOrder order;
+        order.fCancel = i > 0 && (nState % 4) == 0;
+        order.fBid = (nState >> 8) & 1;
+        order.nPrice = 10000 + ((nState >> 16) % 128) - 64;
+        order.nQty = 1 + ((nState >> 32) % 100);
+        order.nTarget = order.fCancel ? (int)((nState >> 40) % i) : 0;
+        vStream.push_back(order);
+    }
+    return vStream;
+}
+
+static std::shared_ptr<CUserTrade> MakeUserTrade(const CSyntheticOrder& order, int nPairTradeID)
+{
+    std::shared_ptr<CUserTrade> userTrade = std::make_shared<CUserTrade>(ORDER_STREAM_PAIR, order.nPrice, order.nQty, order.fBid, 0, "", 0, "");
+    userTrade->nPairTradeID = nPairTradeID;
+    return userTrade;
+}
+
+typedef std::map<int, std::shared_ptr<CUserTrade>> mapLegacyLevel;
+typedef std::map<uint64_t, mapLegacyLevel> mapLegacySide;
+
+static uint64_t ReplayLegacy(const std::vector<CSyntheticOrder>& vStream)
+{
+    std::map<int, mapLegacySide> mapBid;
+    std::map<int, mapLegacySide> mapAsk;
+    uint64_t nFills = 0;
+
+    for (size_t i = 0; i < vStream.size(); i++) {
+        const CSyntheticOrder& order = vStream[i];
+        if (order.fCancel) {
+            const CSyntheticOrder& target = vStream[order.nTarget];
+            std::map<int, mapLegacySide>& side = target.fBid ? mapBid : mapAsk;
+            if (side[ORDER_STREAM_PAIR].count(target.nPrice))
+                side[ORDER_STREAM_PAIR][target.nPrice].erase(order.nTarget + 1);
+            continue;
+        }
+
+        std::shared_ptr<CUserTrade> userTrade = MakeUserTrade(order, i + 1);
+        std::map<int, mapLegacySide>& opposite = order.fBid ? mapAsk : mapBid;
+        std::map<int, mapLegacySide>& own = order.fBid ? mapBid : mapAsk;
+        bool fDone = false;
+        if (order.fBid) {
+            mapLegacySide::iterator Sellers = opposite[ORDER_STREAM_PAIR].begin();
+            while (!fDone && Sellers != opposite[ORDER_STREAM_PAIR].end() && Sellers->first <= userTrade->nPrice) {
+                mapLegacyLevel::iterator Seller = Sellers->second.begin();
+                while (Seller != Sellers->second.end()) {
+                    std::shared_ptr<CUserTrade>& existing = Seller->second;
+                    int64_t qty = std::min(userTrade->nBalanceQty, existing->nBalanceQty);
+                    existing->nBalanceQty -= qty;
+                    userTrade->nBalanceQty -= qty;
+                    ++nFills;
+                    if (existing->nBalanceQty == 0)
+                        Seller = opposite[ORDER_STREAM_PAIR][Sellers->first].erase(Seller);
+                    else
+                        ++Seller;
+                    if (userTrade->nBalanceQty <= 0) {
+                        fDone = true;
+                        break;
+                    }
+                }
+                ++Sellers;
+            }
+        } else {
+            mapLegacySide::reverse_iterator Buyers = opposite[ORDER_STREAM_PAIR].rbegin();
+            while (!fDone && Buyers != opposite[ORDER_STREAM_PAIR].rend() && Buyers->first >= userTrade->nPrice) {
+                mapLegacyLevel::iterator Buyer = Buyers->second.begin();
+                while (Buyer != Buyers->second.end()) {
+                    std::shared_ptr<CUserTrade>& existing = Buyer->second;
+                    int64_t qty = std::min(userTrade->nBalanceQty, existing->nBalanceQty);
+                    existing->nBalanceQty -= qty;
+                    userTrade->nBalanceQty -= qty;
+                    ++nFills;
+                    if (existing->nBalanceQty == 0)
+                        Buyer = opposite[ORDER_STREAM_PAIR][Buyers->first].erase(Buyer);
+                    else
+                        ++Buyer;
+                    if (userTrade->nBalanceQty <= 0) {
+                        fDone = true;
+                        break;
+                    }
+                }
+                ++Buyers;
+            }
+        }
+
+        if (!fDone)
+            own[ORDER_STREAM_PAIR][userTrade->nPrice].insert(std::make_pair(userTrade->nPairTradeID, userTrade));
+    }
+    return nFills;
+}
+
+static uint64_t ReplayEngine(const std::vector<CSyntheticOrder>& vStream)
+{
+    COrderBookEngine book(ORDER_STREAM_PAIR);
+    uint64_t nFills = 0;
+
+    for (size_t i = 0; i < vStream.size(); i++) {
+        const CSyntheticOrder& order = vStream[i];
+        if (order.fCancel) {
+            book.CancelOrder(order.nTarget + 1);
+            continue;
+        }
+
+        std::shared_ptr<CUserTrade> userTrade = MakeUserTrade(order, i + 1);
+        bool fOppositeBid = !order.fBid;
+        while (userTrade->nBalanceQty > 0 && !book.IsEmpty(fOppositeBid)) {
+            uint64_t nBestPrice = book.GetBestPrice(fOppositeBid);
+            if (order.fBid ? nBestPrice > userTrade->nPrice : nBestPrice < userTrade->nPrice)
+                break;
+            const std::shared_ptr<CUserTrade>& existing = book.GetBestOrder(fOppositeBid);
+            int64_t qty = std::min(userTrade->nBalanceQty, existing->nBalanceQty);
+            existing->nBalanceQty -= qty;
+            userTrade->nBalanceQty -= qty;
+            ++nFills;
+            if (existing->nBalanceQty == 0)
+                book.PopBestOrder(fOppositeBid);
+        }
+
+        if (userTrade->nBalanceQty > 0)
+            book.AddOrder(userTrade);
+    }
+    return nFills;
+}
+
+static void OrderBookLegacyReplay(benchmark::State& state)
+{
+    const std::vector<CSyntheticOrder>& vStream = GetOrderStream();
+    uint64_t nFills = 0;
+    while (state.KeepRunning()) {
+        nFills += ReplayLegacy(vStream);
+    }
+    assert(nFills > 0);
+}
+
+static void OrderBookEngineReplay(benchmark::State& state)
+{
+    const std::vector<CSyntheticOrder>& vStream = GetOrderStream();
+    uint64_t nFills = 0;
+    while (state.KeepRunning()) {
+        nFills += ReplayEngine(vStream);
+    }
+    assert(nFills > 0);
+}
+
+BENCHMARK(OrderBookLegacyReplay);
+BENCHMARK(OrderBookEngineReplay);
@@ -45,6 +45,7 @@ bool CCoinsView::GetCoins(const uint256 &txid, CCoins &coins) const { return fal
 bool CCoinsView::HaveCoins(const uint256 &txid) const { return false; }
 uint256 CCoinsView::GetBestBlock() const { return uint256(); }
 bool CCoinsView::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) { return false; }
+bool CCoinsView::Sync() { return true; }
 bool CCoinsView::GetStats(CCoinsStats &stats) const { return false; }
 
 
@@ -53,11 +54,52 @@ bool CCoinsViewBacked::GetCoins(const uint256 &txid, CCoins &coins) const { retu
 bool CCoinsViewBacked::HaveCoins(const uint256 &txid) const { return base->HaveCoins(txid); }
 uint256 CCoinsViewBacked::GetBestBlock() const { return base->GetBestBlock(); }
 void CCoinsViewBacked::SetBackend(CCoinsView &viewIn) { base = &viewIn; }
+CCoinsView *CCoinsViewBacked::GetBackend() const { return base; }
 bool CCoinsViewBacked::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) { return base->BatchWrite(mapCoins, hashBlock); }
+bool CCoinsViewBacked::Sync() { return base->Sync(); }
 bool CCoinsViewBacked::GetStats(CCoinsStats &stats) const { return base->GetStats(stats); }
 
 CCoinsKeyHasher::CCoinsKeyHasher() : salt(GetRandHash()) {}
 
+static CCoinsMap::Implementation nDefaultCoinsMap = CCoinsMap::NODE;
+
+void CCoinsMap::SetDefaultImplementation(Implementation impl) { nDefaultCoinsMap = impl; }
+CCoinsMap::Implementation CCoinsMap::GetDefaultImplementation() { return nDefaultCoinsMap; }
+
+// Both maps share the salted hasher, only one of them is ever filled
+CCoinsMap::CCoinsMap() : fFlat(nDefaultCoinsMap == FLAT), mapNode(0, hasher), mapFlat(hasher) {}
+CCoinsMap::CCoinsMap(Implementation impl) : fFlat(impl == FLAT), mapNode(0, hasher), mapFlat(hasher) {}
+
+std::pair<CCoinsMap::iterator, bool> CCoinsMap::insert(const value_type& value)
+{
+    if (fFlat) {
+        std::pair<flat_map::iterator, bool> ret = mapFlat.insert(value);
+        return std::make_pair(iterator(ret.first), ret.second);
+    }
+    std::pair<node_map::iterator, bool> ret = mapNode.insert(value);
+    return std::make_pair(iterator(ret.first), ret.second);
+}
+
+CCoinsMap::iterator CCoinsMap::erase(iterator it)
+{
+    if (fFlat)
+        return iterator(mapFlat.erase(it.itFlat));
+    return iterator(mapNode.erase(it.itNode));
+}
+
+void CCoinsMap::clear()
+{
+    if (fFlat)
+        mapFlat.clear();
+    else
+        mapNode.clear();
+}
+
+size_t CCoinsMap::DynamicMemoryUsage() const
+{
+    return fFlat ? mapFlat.DynamicMemoryUsage() : memusage::DynamicUsage(mapNode);
+}
+
 CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), hasModifier(false), cachedCoinsUsage(0) { }
 
 CCoinsViewCache::~CCoinsViewCache()
@@ -66,7 +108,7 @@ CCoinsViewCache::~CCoinsViewCache()
 }
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
-    return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage;
+    return cacheCoins.DynamicMemoryUsage() + cachedCoinsUsage;
 }
 
 CCoinsMap::const_iterator CCoinsViewCache::FetchCoins(const uint256 &txid) const {
@@ -149,6 +191,19 @@ bool CCoinsViewCache::HaveCoinsInCache(const uint256 &txid) const {
     return it != cacheCoins.end();
 }
 
+void CCoinsViewCache::CacheCoins(const uint256 &txid, CCoins &coins) {
+    assert(!hasModifier);
+    std::pair<CCoinsMap::iterator, bool> ret = cacheCoins.insert(std::make_pair(txid, CCoinsCacheEntry()));
+    if (!ret.second)
+        return;
+    coins.swap(ret.first->second.coins);
+    if (ret.first->second.coins.IsPruned()) {
+        // Same as in FetchCoins, the parent only has an empty entry.
+        ret.first->second.flags = CCoinsCacheEntry::FRESH;
+    }
+    cachedCoinsUsage += ret.first->second.coins.DynamicMemoryUsage();
+}
+
 uint256 CCoinsViewCache::GetBestBlock() const {
     if (hashBlock.IsNull())
         hashBlock = base->GetBestBlock();
@@ -161,6 +216,8 @@ void CCoinsViewCache::SetBestBlock(const uint256 &hashBlockIn) {
 
 bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn) {
     assert(!hasModifier);
+    // Grow the map once rather than step by step while the entries move up
+    cacheCoins.reserve(cacheCoins.size() + mapCoins.size());
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) { // Ignore non-dirty entries (optimization).
             CCoinsMap::iterator itUs = cacheCoins.find(it->first);
@@ -8,6 +8,7 @@
 
 #include "compressor.h"
 #include "core_memusage.h"
+#include "flatmap.h"
 #include "memusage.h"
 #include "serialize.h"
 #include "uint256.h"
@@ -295,7 +296,97 @@ struct CCoinsCacheEntry
     CCoinsCacheEntry() : coins(), flags(0) {}
 };
 
-typedef boost::unordered_map<uint256, CCoinsCacheEntry, CCoinsKeyHasher> CCoinsMap;
+/** Default for -coinsmap */
+static const char* const DEFAULT_COINS_MAP = "node";
+
+/**
+ * Map from txid to cache entry used by the coins views. Depending on
+ * -coinsmap this is a boost::unordered_map with one node allocation per
+ * entry, or a flatmap with an open addressing table and entries pooled in
+ * arena chunks. Both keep entries at a fixed address until they are erased.
+ */
+class CCoinsMap
+{
+public:
+    enum Implementation {
+        NODE,
+        FLAT,
+    };
+
+    typedef boost::unordered_map<uint256, CCoinsCacheEntry, CCoinsKeyHasher> node_map;
+    typedef flatmap<uint256, CCoinsCacheEntry, CCoinsKeyHasher> flat_map;
+    typedef std::pair<const uint256, CCoinsCacheEntry> value_type;
+    typedef size_t size_type;
+
+    template <typename NodeIt, typename FlatIt, typename V>
+    class iter
+    {
+        NodeIt itNode;
+        FlatIt itFlat;
+        bool fFlat;
+
+        template <typename NodeIt2, typename FlatIt2, typename V2> friend class iter;
+        friend class CCoinsMap;
+
+    public:
+        iter() : fFlat(false) {}
+        iter(const NodeIt& it) : itNode(it), fFlat(false) {}
+        iter(const FlatIt& it) : itFlat(it), fFlat(true) {}
+        template <typename NodeIt2, typename FlatIt2, typename V2>
+        iter(const iter<NodeIt2, FlatIt2, V2>& it) : itNode(it.itNode), itFlat(it.itFlat), fFlat(it.fFlat) {}
+
+        V& operator*() const { return fFlat ? *itFlat : *itNode; }
+        V* operator->() const { return fFlat ? itFlat.operator->() : itNode.operator->(); }
+        iter& operator++() { if (fFlat) ++itFlat; else ++itNode; return *this; }
+        iter operator++(int) { iter copy(*this); ++(*this); return copy; }
+        bool operator==(const iter& it) const { return fFlat ? itFlat == it.itFlat : itNode == it.itNode; }
+        bool operator!=(const iter& it) const { return !(*this == it); }
+    };
+
+    typedef iter<node_map::iterator, flat_map::iterator, value_type> iterator;
+    typedef iter<node_map::const_iterator, flat_map::const_iterator, const value_type> const_iterator;
+
+private:
+    CCoinsKeyHasher hasher;
+    bool fFlat;
+    node_map mapNode;
+    flat_map mapFlat;
+
+    CCoinsMap(const CCoinsMap&);
+    CCoinsMap& operator=(const CCoinsMap&);
+
+public:
+    //! Implementation used by maps created from now on
+    static void SetDefaultImplementation(Implementation impl);
+    static Implementation GetDefaultImplementation();
+
+    CCoinsMap();
+    explicit CCoinsMap(Implementation impl);
+
+    Implementation GetImplementation() const { return fFlat ? FLAT : NODE; }
+
+    iterator begin() { return fFlat ? iterator(mapFlat.begin()) : iterator(mapNode.begin()); }
+    const_iterator begin() const { return fFlat ? const_iterator(mapFlat.begin()) : const_iterator(mapNode.begin()); }
+    iterator end() { return fFlat ? iterator(mapFlat.end()) : iterator(mapNode.end()); }
+    const_iterator end() const { return fFlat ? const_iterator(mapFlat.end()) : const_iterator(mapNode.end()); }
+
+    size_type size() const { return fFlat ? mapFlat.size() : mapNode.size(); }
+    bool empty() const { return fFlat ? mapFlat.empty() : mapNode.empty(); }
+
+    iterator find(const uint256& key) { return fFlat ? iterator(mapFlat.find(key)) : iterator(mapNode.find(key)); }
+    const_iterator find(const uint256& key) const { return fFlat ? const_iterator(mapFlat.find(key)) : const_iterator(mapNode.find(key)); }
+    size_type count(const uint256& key) const { return fFlat ? mapFlat.count(key) : mapNode.count(key); }
+
+    std::pair<iterator, bool> insert(const value_type& value);
+    void reserve(size_type n) { if (fFlat) mapFlat.reserve(n); else mapNode.reserve(n); }
+    CCoinsCacheEntry& operator[](const uint256& key) { return fFlat ? mapFlat[key] : mapNode[key]; }
+    iterator erase(iterator it);
+    size_type erase(const uint256& key) { return fFlat ? mapFlat.erase(key) : mapNode.erase(key); }
+    void clear();
+
+    //! Memory used by the map itself, not counting what the CCoins own
+    size_t DynamicMemoryUsage() const;
+};
 
 struct CCoinsStats
 {
@@ -329,6 +420,10 @@ public:
     //! The passed mapCoins can be modified.
     virtual bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock);
 
+    //! Wait until earlier BatchWrite calls have reached the underlying storage.
+    //! Returns false if one of them failed.
+    virtual bool Sync();
+
     //! Calculate statistics about the unspent transaction output set
     virtual bool GetStats(CCoinsStats &stats) const;
 
@@ -349,7 +444,9 @@ public:
     bool HaveCoins(const uint256 &txid) const;
     uint256 GetBestBlock() const;
     void SetBackend(CCoinsView &viewIn);
+    CCoinsView* GetBackend() const;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock);
+    bool Sync();
     bool GetStats(CCoinsStats &stats) const;
 };
 
@@ -412,6 +509,13 @@ public:
      */
     bool HaveCoinsInCache(const uint256 &txid) const;
 
+    /**
+     * Add coins the caller read from the backing view, unless the txid is
+     * already cached. This lets lookups done on other threads warm the cache;
+     * the entry is treated exactly as if it had been fetched here.
+     */
+    void CacheCoins(const uint256 &txid, CCoins &coins);
+
     /**
      * Return a pointer to CCoins in the cache, or NULL if not found. This is
      * more efficient than GetCoins. Modifications to other cache entries are
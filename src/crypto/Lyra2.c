@@ -40,10 +40,12 @@
 * @param timeCost Parameter to determine the processing time (T)
 * @param nRows Number or rows of the memory matrix (R)
 * @param nCols Number of columns of the memory matrix (C)
+* @param wholeMatrix Scratch memory for the matrix, nRows x nCols x BLOCK_LEN_BYTES bytes, left holding the matrix
+* @param state Scratch memory for the sponge state, 16 uint64_t, left holding the final state
 *
-* @return 0 if the key is generated correctly; -1 if there is an error (usually due to lack of memory for allocation)
+* @return 0 if the key is generated correctly
 */
-int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols) {
+int LYRA2_scratch(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols, uint64_t *wholeMatrix, uint64_t *state) {
 
 	//============================= Basic variables ============================//
 	int64_t row = 2; //index of row to be processed
@@ -56,31 +58,12 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
 	int64_t i; //auxiliary iteration counter
 			   //==========================================================================/
 
-			   //========== Initializing the Memory Matrix and pointers to it =============//
-			   //Tries to allocate enough space for the whole memory matrix
-
-
+			   //================ Pointers to the rows of the Memory Matrix ===============//
 	const int64_t ROW_LEN_INT64 = BLOCK_LEN_INT64 * nCols;
-	const int64_t ROW_LEN_BYTES = ROW_LEN_INT64 * 8;
-
-	i = (int64_t)((int64_t)nRows * (int64_t)ROW_LEN_BYTES);
-	uint64_t *wholeMatrix = malloc(i);
-	if (wholeMatrix == NULL) {
-		return -1;
-	}
-	memset(wholeMatrix, 0, i);
 
-	//Allocates pointers to each row of the matrix
-	uint64_t **memMatrix = malloc(nRows * sizeof(uint64_t*));
-	if (memMatrix == NULL) {
-		return -1;
-	}
-	//Places the pointers in the correct positions
-	uint64_t *ptrWord = wholeMatrix;
-	for (i = 0; i < nRows; i++) {
-		memMatrix[i] = ptrWord;
-		ptrWord += ROW_LEN_INT64;
-	}
+	//Every row is written by the Setup phase before it is read, so the matrix is not cleared
+	uint64_t *ptrWord;
+#define memMatrix(r) (wholeMatrix + (r) * ROW_LEN_INT64)
 	//==========================================================================/
 
 	//============= Getting the password + salt + basil padded with 10*1 ===============//
@@ -123,10 +106,6 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
 
 					  //======================= Initializing the Sponge State ====================//
 					  //Sponge state: 16 uint64_t, BLOCK_LEN_INT64 words of them for the bitrate (b) and the remainder for the capacity (c)
-	uint64_t *state = malloc(16 * sizeof(uint64_t));
-	if (state == NULL) {
-		return -1;
-	}
 	initState(state);
 	//==========================================================================/
 
@@ -139,12 +118,12 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
 	}
 
 	//Initializes M[0] and M[1]
-	reducedSqueezeRow0(state, memMatrix[0], nCols); //The locally copied password is most likely overwritten here
-	reducedDuplexRow1(state, memMatrix[0], memMatrix[1], nCols);
+	reducedSqueezeRow0(state, memMatrix(0), nCols); //The locally copied password is most likely overwritten here
+	reducedDuplexRow1(state, memMatrix(0), memMatrix(1), nCols);
 
 	do {
 		//M[row] = rand; //M[row*] = M[row*] XOR rotW(rand)
-		reducedDuplexRowSetup(state, memMatrix[prev], memMatrix[rowa], memMatrix[row], nCols);
+		reducedDuplexRowSetup(state, memMatrix(prev), memMatrix(rowa), memMatrix(row), nCols);
 
 
 		//updates the value of row* (deterministically picked during Setup))
@@ -177,7 +156,7 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
 												   //------------------------------------------------------------------------------------------
 
 												   //Performs a reduced-round duplexing operation over M[row*] XOR M[prev], updating both M[row*] and M[row]
-			reducedDuplexRow(state, memMatrix[prev], memMatrix[rowa], memMatrix[row], nCols);
+			reducedDuplexRow(state, memMatrix(prev), memMatrix(rowa), memMatrix(row), nCols);
 
 			//update prev: it now points to the last row ever computed
 			prev = row;
@@ -194,22 +173,41 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
 
 	//============================ Wrap-up Phase ===============================//
 	//Absorbs the last block of the memory matrix
-	absorbBlock(state, memMatrix[rowa]);
+	absorbBlock(state, memMatrix(rowa));
 
 	//Squeezes the key
 	squeeze(state, K, kLen);
 	//==========================================================================/
 
-	//========================= Freeing the memory =============================//
-	free(memMatrix);
+#undef memMatrix
+
+	return 0;
+}
+
+/**
+* Runs LYRA2_scratch on memory allocated for this call, which is wiped and freed afterwards.
+*
+* @return 0 if the key is generated correctly; -1 if there is an error (usually due to lack of memory for allocation)
+*/
+int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols) {
+	const int64_t nMatrixBytes = (int64_t)nRows * BLOCK_LEN_INT64 * nCols * 8;
+	uint64_t *wholeMatrix = malloc(nMatrixBytes);
+	if (wholeMatrix == NULL) {
+		return -1;
+	}
+	uint64_t *state = malloc(16 * sizeof(uint64_t));
+	if (state == NULL) {
+		free(wholeMatrix);
+		return -1;
+	}
+
+	int result = LYRA2_scratch(K, kLen, pwd, pwdlen, salt, saltlen, timeCost, nRows, nCols, wholeMatrix, state);
 	free(wholeMatrix);
 
 	//Wiping out the sponge's internal state before freeing it
 	memset(state, 0, 16 * sizeof(uint64_t));
 	free(state);
-	//==========================================================================/
-
-	return 0;
+	return result;
 }
 
 int LYRA2_old(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols) {
@@ -42,6 +42,12 @@ extern "C" {
 #endif
 
 	int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols);
+	int LYRA2_scratch(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols, uint64_t *wholeMatrix, uint64_t *state);
+
+	//Sponge implementation LYRA2 runs on: "generic", "sse2", "ssse3" or "avx2", see Sponge.c
+	const char *spongeAutoDetect(void);
+	int spongeSelect(const char *name);
+	const char *spongeImplementation(void);
 
 #ifdef __cplusplus
 }
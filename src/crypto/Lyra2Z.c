@@ -35,7 +35,24 @@
 #include "sph_blake.h"
 #include "Lyra2.h"
 
-void lyra2z_hash(const char* input, char* output)
+#if defined(_MSC_VER)
+#define LYRA2Z_THREAD_LOCAL __declspec(thread)
+#else
+#define LYRA2Z_THREAD_LOCAL __thread
+#endif
+
+_Static_assert(LYRA2Z_MATRIX_INT64 == 8 * 8 * BLOCK_LEN_INT64, "lyra2z_ctx matrix does not fit the Lyra2Z parameters");
+
+//no heap allocation per hash: every thread reuses its own context
+static LYRA2Z_THREAD_LOCAL lyra2z_ctx thread_ctx;
+
+lyra2z_ctx* lyra2z_thread_ctx(void)
+{
+	return &thread_ctx;
+}
+
+//the input is public block data, so the scratch memory is not wiped afterwards
+void lyra2z_hash_ctx(lyra2z_ctx* ctx, const char* input, char* output)
 {
 	sph_blake256_context     ctx_blake;
 
@@ -45,8 +62,12 @@ void lyra2z_hash(const char* input, char* output)
 	sph_blake256(&ctx_blake, input, 80);
 	sph_blake256_close(&ctx_blake, hashA);
 
-	LYRA2(hashB, 32, hashA, 32, hashA, 32, 8, 8, 8);
+	LYRA2_scratch(hashB, 32, hashA, 32, hashA, 32, 8, 8, 8, ctx->matrix, ctx->state);
 
 	memcpy(output, hashB, 32);
 }
 
+void lyra2z_hash(const char* input, char* output)
+{
+	lyra2z_hash_ctx(&thread_ctx, input, output);
+}
@@ -1,10 +1,34 @@
 #ifndef LYRA2RE_H
 #define LYRA2RE_H
 
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define LYRA2Z_ALIGN __attribute__ ((aligned(64)))
+#elif defined(_MSC_VER)
+#define LYRA2Z_ALIGN __declspec(align(64))
+#else
+#define LYRA2Z_ALIGN
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+	//Lyra2Z runs LYRA2 with timeCost, nRows and nCols of 8
+	#define LYRA2Z_MATRIX_INT64 (8 * 8 * 12) //nRows x nCols x BLOCK_LEN_INT64
+
+	//Scratch memory of one Lyra2Z computation, cache line aligned. It is fully written
+	//before it is read, so it can be reused for the next hash without clearing it.
+	typedef struct LYRA2Z_ALIGN lyra2z_ctx {
+		uint64_t matrix[LYRA2Z_MATRIX_INT64];
+		uint64_t state[16];
+	} lyra2z_ctx;
+
+	//Scratch memory of the calling thread, used by lyra2z_hash
+	lyra2z_ctx* lyra2z_thread_ctx(void);
+
+	void lyra2z_hash_ctx(lyra2z_ctx* ctx, const char* input, char* output);
 	void lyra2z_hash(const char* input, char* output);
 
 #ifdef __cplusplus
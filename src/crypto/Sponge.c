@@ -24,7 +24,24 @@
 #include "Sponge.h"
 #include "Lyra2.h"
 
-
+static void blake2bLyra(uint64_t *v);
+static void reducedSqueezeRow0_generic(uint64_t* state, uint64_t* rowOut, uint64_t nCols);
+static void reducedDuplexRow1_generic(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols);
+static void reducedDuplexRowSetup_generic(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+static void reducedDuplexRow_generic(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+
+/*Scalar 64-bit C, runs everywhere*/
+static const sponge_impl sponge_generic = {
+	"generic",
+	blake2bLyra,
+	reducedSqueezeRow0_generic,
+	reducedDuplexRow1_generic,
+	reducedDuplexRowSetup_generic,
+	reducedDuplexRow_generic
+};
+
+/*Implementation used by the functions below, changed by spongeSelect()*/
+static const sponge_impl *sponge = &sponge_generic;
 
 /**
 * Initializes the Sponge State. The first 512 bits are set to zeros and the remainder
@@ -56,7 +73,7 @@ inline void initState(uint64_t state[/*16*/]) {
 *
 * @param v     A 1024-bit (16 uint64_t) array to be processed by Blake2b's G function
 */
-inline static void blake2bLyra(uint64_t *v) {
+static void blake2bLyra(uint64_t *v) {
 	ROUND_LYRA(0);
 	ROUND_LYRA(1);
 	ROUND_LYRA(2);
@@ -94,7 +111,7 @@ inline void squeeze(uint64_t *state, byte *out, unsigned int len) {
 	//Squeezes full blocks
 	for (i = 0; i < fullBlocks; i++) {
 		memcpy(ptr, state, BLOCK_LEN_BYTES);
-		blake2bLyra(state);
+		sponge->blake2bLyra(state);
 		ptr += BLOCK_LEN_BYTES;
 	}
 
@@ -125,7 +142,7 @@ inline void absorbBlock(uint64_t *state, const uint64_t *in) {
 	state[11] ^= in[11];
 
 	//Applies the transformation f to the sponge's state
-	blake2bLyra(state);
+	sponge->blake2bLyra(state);
 }
 
 /**
@@ -149,7 +166,7 @@ inline void absorbBlockBlake2Safe(uint64_t *state, const uint64_t *in) {
 
 
 	//Applies the transformation f to the sponge's state
-	blake2bLyra(state);
+	sponge->blake2bLyra(state);
 
 }
 
@@ -161,7 +178,7 @@ inline void absorbBlockBlake2Safe(uint64_t *state, const uint64_t *in) {
 * @param state     The current state of the sponge
 * @param rowOut    Row to receive the data squeezed
 */
-inline void reducedSqueezeRow0(uint64_t* state, uint64_t* rowOut, uint64_t nCols) {
+static void reducedSqueezeRow0_generic(uint64_t* state, uint64_t* rowOut, uint64_t nCols) {
 	uint64_t* ptrWord = rowOut + (nCols - 1)*BLOCK_LEN_INT64; //In Lyra2: pointer to M[0][C-1]
 	int i;
 	//M[row][C-1-col] = H.reduced_squeeze()
@@ -196,7 +213,7 @@ inline void reducedSqueezeRow0(uint64_t* state, uint64_t* rowOut, uint64_t nCols
 * @param rowIn		Row to feed the sponge
 * @param rowOut	Row to receive the sponge's output
 */
-inline void reducedDuplexRow1(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols) {
+static void reducedDuplexRow1_generic(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols) {
 	uint64_t* ptrWordIn = rowIn;				//In Lyra2: pointer to prev
 	uint64_t* ptrWordOut = rowOut + (nCols - 1)*BLOCK_LEN_INT64; //In Lyra2: pointer to row
 	int i;
@@ -256,7 +273,7 @@ inline void reducedDuplexRow1(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut
 * @param rowOut         Row receiving the output
 *
 */
-inline void reducedDuplexRowSetup(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+static void reducedDuplexRowSetup_generic(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
 	uint64_t* ptrWordIn = rowIn;				//In Lyra2: pointer to prev
 	uint64_t* ptrWordInOut = rowInOut;				//In Lyra2: pointer to row*
 	uint64_t* ptrWordOut = rowOut + (nCols - 1)*BLOCK_LEN_INT64; //In Lyra2: pointer to row
@@ -330,7 +347,7 @@ inline void reducedDuplexRowSetup(uint64_t *state, uint64_t *rowIn, uint64_t *ro
 * @param rowOut         Row receiving the output
 *
 */
-inline void reducedDuplexRow(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+static void reducedDuplexRow_generic(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
 	uint64_t* ptrWordInOut = rowInOut; //In Lyra2: pointer to row*
 	uint64_t* ptrWordIn = rowIn; //In Lyra2: pointer to prev
 	uint64_t* ptrWordOut = rowOut; //In Lyra2: pointer to row
@@ -390,6 +407,90 @@ inline void reducedDuplexRow(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOu
 	}
 }
 
+/**
+* Performs a reduced squeeze operation for a single row with the selected implementation.
+*/
+void reducedSqueezeRow0(uint64_t* state, uint64_t* rowOut, uint64_t nCols) {
+	sponge->reducedSqueezeRow0(state, rowOut, nCols);
+}
+
+/**
+* Performs a reduced duplex operation for a single row with the selected implementation.
+*/
+void reducedDuplexRow1(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols) {
+	sponge->reducedDuplexRow1(state, rowIn, rowOut, nCols);
+}
+
+/**
+* Performs the duplexing operation of the setup phase with the selected implementation.
+*/
+void reducedDuplexRowSetup(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+	sponge->reducedDuplexRowSetup(state, rowIn, rowInOut, rowOut, nCols);
+}
+
+/**
+* Performs the duplexing operation of the wandering phase with the selected implementation.
+*/
+void reducedDuplexRow(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+	sponge->reducedDuplexRow(state, rowIn, rowInOut, rowOut, nCols);
+}
+
+/**
+* Looks up an implementation by name.
+*
+* @param name      "generic", "sse2", "ssse3" or "avx2"
+*
+* @return          The implementation, NULL if it is not built in or the CPU lacks the instructions
+*/
+static const sponge_impl *spongeFind(const char *name) {
+	if (strcmp(name, sponge_generic.name) == 0)
+		return &sponge_generic;
+#ifdef SPONGE_X86
+	__builtin_cpu_init();
+	if (strcmp(name, sponge_avx2.name) == 0 && __builtin_cpu_supports("avx2"))
+		return &sponge_avx2;
+	if (strcmp(name, sponge_ssse3.name) == 0 && __builtin_cpu_supports("ssse3"))
+		return &sponge_ssse3;
+	if (strcmp(name, sponge_sse2.name) == 0 && __builtin_cpu_supports("sse2"))
+		return &sponge_sse2;
+#endif
+	return NULL;
+}
+
+/**
+* Switches all sponge operations to another implementation. Not thread safe,
+* call it before any thread starts hashing.
+*
+* @param name      "generic", "sse2", "ssse3" or "avx2"
+*
+* @return          0 if the implementation is in use, -1 if it is not available on this CPU
+*/
+int spongeSelect(const char *name) {
+	const sponge_impl *impl = spongeFind(name);
+	if (impl == NULL)
+		return -1;
+	sponge = impl;
+	return 0;
+}
+
+/**
+* Selects the fastest implementation the CPU supports.
+*
+* @return          The name of the implementation now in use
+*/
+const char *spongeAutoDetect(void) {
+	if (spongeSelect("avx2") != 0 && spongeSelect("ssse3") != 0 && spongeSelect("sse2") != 0)
+		spongeSelect("generic");
+	return sponge->name;
+}
+
+/**
+* @return          The name of the implementation in use
+*/
+const char *spongeImplementation(void) {
+	return sponge->name;
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -73,6 +73,23 @@ static inline uint64_t rotr64(const uint64_t w, const unsigned c) {
     G(r,7,v[ 3],v[ 4],v[ 9],v[14]);
 
 
+/*The sponge operations that have vectorized versions, see Sponge_x86.c*/
+typedef struct sponge_impl {
+	const char *name;
+	void (*blake2bLyra)(uint64_t *v);
+	void (*reducedSqueezeRow0)(uint64_t *state, uint64_t *rowOut, uint64_t nCols);
+	void (*reducedDuplexRow1)(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols);
+	void (*reducedDuplexRowSetup)(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+	void (*reducedDuplexRow)(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+} sponge_impl;
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SPONGE_X86
+extern const sponge_impl sponge_sse2;
+extern const sponge_impl sponge_ssse3;
+extern const sponge_impl sponge_avx2;
+#endif
+
 //---- Housekeeping
 void initState(uint64_t state[/*16*/]);
 
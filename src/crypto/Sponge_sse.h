@@ -0,0 +1,161 @@
+/**
+* 128-bit versions of the sponge operations, included by Sponge_x86.c once per
+* instruction set. Expects SPONGE_SSE_TARGET, SPONGE_SSE_FN, SPONGE_SSE_IMPL,
+* SPONGE_SSE_CONSTANTS, SPONGE_SSE_ROTR24 and SPONGE_SSE_ROTR16 to be defined.
+*
+* The state lives in eight registers of two words each, v[0..1] hold words 0-3,
+* v[2..3] words 4-7 and so on, so the first six registers are the 12-word block
+* that is absorbed and squeezed on each column.
+*
+* This software is hereby placed in the public domain.
+*/
+
+/**
+* Execute Blake2b's G function, with all 12 rounds.
+*
+* @param state     A 1024-bit (16 uint64_t) array to be processed by Blake2b's G function
+*/
+static void __attribute__((target(SPONGE_SSE_TARGET))) SPONGE_SSE_FN(blake2bLyra)(uint64_t *state) {
+	SPONGE_SSE_CONSTANTS
+	__m128i v[8], t0, t1;
+	int i;
+
+	SSE_LOAD_STATE(v, state);
+	for (i = 0; i < 12; i++)
+		SSE_ROUND_LYRA(v);
+	SSE_STORE_STATE(v, state);
+}
+
+/**
+* Performs a reduced squeeze operation for a single row, see reducedSqueezeRow0_generic()
+*/
+static void __attribute__((target(SPONGE_SSE_TARGET))) SPONGE_SSE_FN(reducedSqueezeRow0)(uint64_t *state, uint64_t *rowOut, uint64_t nCols) {
+	SPONGE_SSE_CONSTANTS
+	__m128i v[8], t0, t1;
+	uint64_t* ptrWord = rowOut + (nCols - 1)*BLOCK_LEN_INT64; //In Lyra2: pointer to M[0][C-1]
+	uint64_t i;
+	int j;
+
+	SSE_LOAD_STATE(v, state);
+	for (i = 0; i < nCols; i++) {
+		//M[row][C-1-col] = H.reduced_squeeze()
+		for (j = 0; j < 6; j++)
+			SSE_STORE(ptrWord + 2 * j, v[j]);
+
+		ptrWord -= BLOCK_LEN_INT64;
+		SSE_ROUND_LYRA(v);
+	}
+	SSE_STORE_STATE(v, state);
+}
+
+/**
+* Performs a reduced duplex operation for a single row, see reducedDuplexRow1_generic()
+*/
+static void __attribute__((target(SPONGE_SSE_TARGET))) SPONGE_SSE_FN(reducedDuplexRow1)(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols) {
+	SPONGE_SSE_CONSTANTS
+	__m128i v[8], t0, t1;
+	uint64_t* ptrWordIn = rowIn;				//In Lyra2: pointer to prev
+	uint64_t* ptrWordOut = rowOut + (nCols - 1)*BLOCK_LEN_INT64; //In Lyra2: pointer to row
+	uint64_t i;
+	int j;
+
+	SSE_LOAD_STATE(v, state);
+	for (i = 0; i < nCols; i++) {
+		//Absorbing "M[prev][col]"
+		for (j = 0; j < 6; j++)
+			v[j] = _mm_xor_si128(v[j], SSE_LOAD(ptrWordIn + 2 * j));
+
+		SSE_ROUND_LYRA(v);
+
+		//M[row][C-1-col] = M[prev][col] XOR rand
+		for (j = 0; j < 6; j++)
+			SSE_STORE(ptrWordOut + 2 * j, _mm_xor_si128(SSE_LOAD(ptrWordIn + 2 * j), v[j]));
+
+		ptrWordIn += BLOCK_LEN_INT64;
+		ptrWordOut -= BLOCK_LEN_INT64;
+	}
+	SSE_STORE_STATE(v, state);
+}
+
+/**
+* Performs the duplexing operation of the setup phase, see reducedDuplexRowSetup_generic()
+*/
+static void __attribute__((target(SPONGE_SSE_TARGET))) SPONGE_SSE_FN(reducedDuplexRowSetup)(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+	SPONGE_SSE_CONSTANTS
+	__m128i v[8], r[6], t0, t1;
+	uint64_t* ptrWordIn = rowIn;				//In Lyra2: pointer to prev
+	uint64_t* ptrWordInOut = rowInOut;				//In Lyra2: pointer to row*
+	uint64_t* ptrWordOut = rowOut + (nCols - 1)*BLOCK_LEN_INT64; //In Lyra2: pointer to row
+	uint64_t i;
+	int j;
+
+	SSE_LOAD_STATE(v, state);
+	for (i = 0; i < nCols; i++) {
+		//Absorbing "M[prev] [+] M[row*]"
+		for (j = 0; j < 6; j++)
+			v[j] = _mm_xor_si128(v[j], _mm_add_epi64(SSE_LOAD(ptrWordIn + 2 * j), SSE_LOAD(ptrWordInOut + 2 * j)));
+
+		SSE_ROUND_LYRA(v);
+
+		//M[row][col] = M[prev][col] XOR rand
+		for (j = 0; j < 6; j++)
+			SSE_STORE(ptrWordOut + 2 * j, _mm_xor_si128(SSE_LOAD(ptrWordIn + 2 * j), v[j]));
+
+		//M[row*][col] = M[row*][col] XOR rotW(rand)
+		SSE_ROTW(r, v);
+		for (j = 0; j < 6; j++)
+			SSE_STORE(ptrWordInOut + 2 * j, _mm_xor_si128(SSE_LOAD(ptrWordInOut + 2 * j), r[j]));
+
+		ptrWordInOut += BLOCK_LEN_INT64;
+		ptrWordIn += BLOCK_LEN_INT64;
+		ptrWordOut -= BLOCK_LEN_INT64;
+	}
+	SSE_STORE_STATE(v, state);
+}
+
+/**
+* Performs the duplexing operation of the wandering phase, see reducedDuplexRow_generic().
+* The rows may be the same, so every output is read back from memory after the previous
+* store, in the order of the generic code.
+*/
+static void __attribute__((target(SPONGE_SSE_TARGET))) SPONGE_SSE_FN(reducedDuplexRow)(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+	SPONGE_SSE_CONSTANTS
+	__m128i v[8], r[6], t0, t1;
+	uint64_t* ptrWordInOut = rowInOut; //In Lyra2: pointer to row*
+	uint64_t* ptrWordIn = rowIn; //In Lyra2: pointer to prev
+	uint64_t* ptrWordOut = rowOut; //In Lyra2: pointer to row
+	uint64_t i;
+	int j;
+
+	SSE_LOAD_STATE(v, state);
+	for (i = 0; i < nCols; i++) {
+		//Absorbing "M[prev] [+] M[row*]"
+		for (j = 0; j < 6; j++)
+			v[j] = _mm_xor_si128(v[j], _mm_add_epi64(SSE_LOAD(ptrWordIn + 2 * j), SSE_LOAD(ptrWordInOut + 2 * j)));
+
+		SSE_ROUND_LYRA(v);
+
+		//M[rowOut][col] = M[rowOut][col] XOR rand
+		for (j = 0; j < 6; j++)
+			SSE_STORE(ptrWordOut + 2 * j, _mm_xor_si128(SSE_LOAD(ptrWordOut + 2 * j), v[j]));
+
+		//M[rowInOut][col] = M[rowInOut][col] XOR rotW(rand)
+		SSE_ROTW(r, v);
+		for (j = 0; j < 6; j++)
+			SSE_STORE(ptrWordInOut + 2 * j, _mm_xor_si128(SSE_LOAD(ptrWordInOut + 2 * j), r[j]));
+
+		ptrWordOut += BLOCK_LEN_INT64;
+		ptrWordInOut += BLOCK_LEN_INT64;
+		ptrWordIn += BLOCK_LEN_INT64;
+	}
+	SSE_STORE_STATE(v, state);
+}
+
+const sponge_impl SPONGE_SSE_IMPL = {
+	SPONGE_SSE_TARGET,
+	SPONGE_SSE_FN(blake2bLyra),
+	SPONGE_SSE_FN(reducedSqueezeRow0),
+	SPONGE_SSE_FN(reducedDuplexRow1),
+	SPONGE_SSE_FN(reducedDuplexRowSetup),
+	SPONGE_SSE_FN(reducedDuplexRow)
+};
@@ -0,0 +1,331 @@
+/**
+* SSE2, SSSE3 and AVX2 versions of the Blake2b sponge operations Lyra2 spends
+* its time in. They give the same output as the generic code in Sponge.c and are
+* compiled with per-function target attributes, spongeSelect() only uses them
+* when the CPU supports the instructions.
+*
+* The Blake2b rounds follow the vectorized Blake2b by Samuel Neves
+* (https://blake2.net/): the four rows of the state are processed as vectors,
+* the diagonal step rotates rows b, c and d by one, two and three words.
+*
+* This software is hereby placed in the public domain.
+*/
+#include "Sponge.h"
+#include "Lyra2.h"
+
+#ifdef SPONGE_X86
+
+#include <immintrin.h>
+
+/////////////////////////////////////////////////// 128-bit ///////////////////////////////////////////////////
+
+#define SSE_LOAD(p) _mm_loadu_si128((const __m128i *)(p))
+#define SSE_STORE(p, x) _mm_storeu_si128((__m128i *)(p), (x))
+
+#define SSE_LOAD_STATE(v, state) \
+	do { \
+		int k_; \
+		for (k_ = 0; k_ < 8; k_++) \
+			v[k_] = SSE_LOAD((state) + 2 * k_); \
+	} while (0)
+
+#define SSE_STORE_STATE(v, state) \
+	do { \
+		int k_; \
+		for (k_ = 0; k_ < 8; k_++) \
+			SSE_STORE((state) + 2 * k_, v[k_]); \
+	} while (0)
+
+/*{lo[1], hi[0]}*/
+#define SSE_ALIGNR64(hi, lo) _mm_castpd_si128(_mm_shuffle_pd(_mm_castsi128_pd(lo), _mm_castsi128_pd(hi), 1))
+
+#define SSE_ROTR32(x) _mm_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define SSE_ROTR63(x) _mm_xor_si128(_mm_srli_epi64((x), 63), _mm_add_epi64((x), (x)))
+
+/*Blake2b's G function on two columns at once*/
+#define SSE_G(a, b, c, d) \
+	do { \
+		a = _mm_add_epi64(a, b); \
+		d = SSE_ROTR32(_mm_xor_si128(d, a)); \
+		c = _mm_add_epi64(c, d); \
+		b = SPONGE_SSE_ROTR24(_mm_xor_si128(b, c)); \
+		a = _mm_add_epi64(a, b); \
+		d = SPONGE_SSE_ROTR16(_mm_xor_si128(d, a)); \
+		c = _mm_add_epi64(c, d); \
+		b = SSE_ROTR63(_mm_xor_si128(b, c)); \
+	} while (0)
+
+#define SSE_DIAGONALIZE(v) \
+	do { \
+		t0 = SSE_ALIGNR64(v[3], v[2]); \
+		t1 = SSE_ALIGNR64(v[2], v[3]); \
+		v[2] = t0; v[3] = t1; \
+		t0 = v[4]; v[4] = v[5]; v[5] = t0; \
+		t0 = SSE_ALIGNR64(v[6], v[7]); \
+		t1 = SSE_ALIGNR64(v[7], v[6]); \
+		v[6] = t0; v[7] = t1; \
+	} while (0)
+
+#define SSE_UNDIAGONALIZE(v) \
+	do { \
+		t0 = SSE_ALIGNR64(v[2], v[3]); \
+		t1 = SSE_ALIGNR64(v[3], v[2]); \
+		v[2] = t0; v[3] = t1; \
+		t0 = v[4]; v[4] = v[5]; v[5] = t0; \
+		t0 = SSE_ALIGNR64(v[7], v[6]); \
+		t1 = SSE_ALIGNR64(v[6], v[7]); \
+		v[6] = t0; v[7] = t1; \
+	} while (0)
+
+/*One Round of the Blake2b's compression function*/
+#define SSE_ROUND_LYRA(v) \
+	do { \
+		SSE_G(v[0], v[2], v[4], v[6]); \
+		SSE_G(v[1], v[3], v[5], v[7]); \
+		SSE_DIAGONALIZE(v); \
+		SSE_G(v[0], v[2], v[4], v[6]); \
+		SSE_G(v[1], v[3], v[5], v[7]); \
+		SSE_UNDIAGONALIZE(v); \
+	} while (0)
+
+/*r = the first 12 words of the state rotated by one word, {s11, s0}, {s1, s2}, ... {s9, s10}*/
+#define SSE_ROTW(r, v) \
+	do { \
+		r[0] = SSE_ALIGNR64(v[0], v[5]); \
+		r[1] = SSE_ALIGNR64(v[1], v[0]); \
+		r[2] = SSE_ALIGNR64(v[2], v[1]); \
+		r[3] = SSE_ALIGNR64(v[3], v[2]); \
+		r[4] = SSE_ALIGNR64(v[4], v[3]); \
+		r[5] = SSE_ALIGNR64(v[5], v[4]); \
+	} while (0)
+
+//---- SSE2, rotations by shifts
+#define SPONGE_SSE_TARGET "sse2"
+#define SPONGE_SSE_FN(f) f##_sse2
+#define SPONGE_SSE_IMPL sponge_sse2
+#define SPONGE_SSE_CONSTANTS
+#define SPONGE_SSE_ROTR24(x) _mm_xor_si128(_mm_srli_epi64((x), 24), _mm_slli_epi64((x), 40))
+#define SPONGE_SSE_ROTR16(x) _mm_xor_si128(_mm_srli_epi64((x), 16), _mm_slli_epi64((x), 48))
+#include "Sponge_sse.h"
+#undef SPONGE_SSE_TARGET
+#undef SPONGE_SSE_FN
+#undef SPONGE_SSE_IMPL
+#undef SPONGE_SSE_CONSTANTS
+#undef SPONGE_SSE_ROTR24
+#undef SPONGE_SSE_ROTR16
+
+//---- SSSE3, byte rotations by shuffles
+#define SPONGE_SSE_TARGET "ssse3"
+#define SPONGE_SSE_FN(f) f##_ssse3
+#define SPONGE_SSE_IMPL sponge_ssse3
+#define SPONGE_SSE_CONSTANTS \
+	const __m128i r16 = _mm_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9); \
+	const __m128i r24 = _mm_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+#define SPONGE_SSE_ROTR24(x) _mm_shuffle_epi8((x), r24)
+#define SPONGE_SSE_ROTR16(x) _mm_shuffle_epi8((x), r16)
+#include "Sponge_sse.h"
+#undef SPONGE_SSE_TARGET
+#undef SPONGE_SSE_FN
+#undef SPONGE_SSE_IMPL
+#undef SPONGE_SSE_CONSTANTS
+#undef SPONGE_SSE_ROTR24
+#undef SPONGE_SSE_ROTR16
+
+/////////////////////////////////////////////////// 256-bit ///////////////////////////////////////////////////
+
+#define AVX2_LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define AVX2_STORE(p, x) _mm256_storeu_si256((__m256i *)(p), (x))
+
+#define AVX2_CONSTANTS \
+	const __m256i r16 = _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9, \
+										 2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9); \
+	const __m256i r24 = _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10, \
+										 3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+
+#define AVX2_ROTR32(x) _mm256_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define AVX2_ROTR24(x) _mm256_shuffle_epi8((x), r24)
+#define AVX2_ROTR16(x) _mm256_shuffle_epi8((x), r16)
+#define AVX2_ROTR63(x) _mm256_xor_si256(_mm256_srli_epi64((x), 63), _mm256_add_epi64((x), (x)))
+
+/*Blake2b's G function on all four columns (or diagonals) at once*/
+#define AVX2_G(a, b, c, d) \
+	do { \
+		a = _mm256_add_epi64(a, b); \
+		d = AVX2_ROTR32(_mm256_xor_si256(d, a)); \
+		c = _mm256_add_epi64(c, d); \
+		b = AVX2_ROTR24(_mm256_xor_si256(b, c)); \
+		a = _mm256_add_epi64(a, b); \
+		d = AVX2_ROTR16(_mm256_xor_si256(d, a)); \
+		c = _mm256_add_epi64(c, d); \
+		b = AVX2_ROTR63(_mm256_xor_si256(b, c)); \
+	} while (0)
+
+/*One Round of the Blake2b's compression function*/
+#define AVX2_ROUND_LYRA(v) \
+	do { \
+		AVX2_G(v[0], v[1], v[2], v[3]); \
+		v[1] = _mm256_permute4x64_epi64(v[1], _MM_SHUFFLE(0, 3, 2, 1)); \
+		v[2] = _mm256_permute4x64_epi64(v[2], _MM_SHUFFLE(1, 0, 3, 2)); \
+		v[3] = _mm256_permute4x64_epi64(v[3], _MM_SHUFFLE(2, 1, 0, 3)); \
+		AVX2_G(v[0], v[1], v[2], v[3]); \
+		v[1] = _mm256_permute4x64_epi64(v[1], _MM_SHUFFLE(2, 1, 0, 3)); \
+		v[2] = _mm256_permute4x64_epi64(v[2], _MM_SHUFFLE(1, 0, 3, 2)); \
+		v[3] = _mm256_permute4x64_epi64(v[3], _MM_SHUFFLE(0, 3, 2, 1)); \
+	} while (0)
+
+/*r = the first 12 words of the state rotated by one word, {s11, s0, s1, s2}, {s3, ... s6}, {s7, ... s10}*/
+#define AVX2_ROTW(r, v) \
+	do { \
+		__m256i t0_ = _mm256_permute4x64_epi64(v[0], _MM_SHUFFLE(2, 1, 0, 3)); \
+		__m256i t1_ = _mm256_permute4x64_epi64(v[1], _MM_SHUFFLE(2, 1, 0, 3)); \
+		__m256i t2_ = _mm256_permute4x64_epi64(v[2], _MM_SHUFFLE(2, 1, 0, 3)); \
+		r[0] = _mm256_blend_epi32(t0_, t2_, 0x03); \
+		r[1] = _mm256_blend_epi32(t1_, t0_, 0x03); \
+		r[2] = _mm256_blend_epi32(t2_, t1_, 0x03); \
+	} while (0)
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+static void AVX2_TARGET blake2bLyra_avx2(uint64_t *state) {
+	AVX2_CONSTANTS
+	__m256i v[4];
+	int i;
+
+	for (i = 0; i < 4; i++)
+		v[i] = AVX2_LOAD(state + 4 * i);
+	for (i = 0; i < 12; i++)
+		AVX2_ROUND_LYRA(v);
+	for (i = 0; i < 4; i++)
+		AVX2_STORE(state + 4 * i, v[i]);
+}
+
+static void AVX2_TARGET reducedSqueezeRow0_avx2(uint64_t *state, uint64_t *rowOut, uint64_t nCols) {
+	AVX2_CONSTANTS
+	__m256i v[4];
+	uint64_t* ptrWord = rowOut + (nCols - 1)*BLOCK_LEN_INT64; //In Lyra2: pointer to M[0][C-1]
+	uint64_t i;
+	int j;
+
+	for (j = 0; j < 4; j++)
+		v[j] = AVX2_LOAD(state + 4 * j);
+	for (i = 0; i < nCols; i++) {
+		//M[row][C-1-col] = H.reduced_squeeze()
+		for (j = 0; j < 3; j++)
+			AVX2_STORE(ptrWord + 4 * j, v[j]);
+
+		ptrWord -= BLOCK_LEN_INT64;
+		AVX2_ROUND_LYRA(v);
+	}
+	for (j = 0; j < 4; j++)
+		AVX2_STORE(state + 4 * j, v[j]);
+}
+
+static void AVX2_TARGET reducedDuplexRow1_avx2(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols) {
+	AVX2_CONSTANTS
+	__m256i v[4];
+	uint64_t* ptrWordIn = rowIn;				//In Lyra2: pointer to prev
+	uint64_t* ptrWordOut = rowOut + (nCols - 1)*BLOCK_LEN_INT64; //In Lyra2: pointer to row
+	uint64_t i;
+	int j;
+
+	for (j = 0; j < 4; j++)
+		v[j] = AVX2_LOAD(state + 4 * j);
+	for (i = 0; i < nCols; i++) {
+		//Absorbing "M[prev][col]"
+		for (j = 0; j < 3; j++)
+			v[j] = _mm256_xor_si256(v[j], AVX2_LOAD(ptrWordIn + 4 * j));
+
+		AVX2_ROUND_LYRA(v);
+
+		//M[row][C-1-col] = M[prev][col] XOR rand
+		for (j = 0; j < 3; j++)
+			AVX2_STORE(ptrWordOut + 4 * j, _mm256_xor_si256(AVX2_LOAD(ptrWordIn + 4 * j), v[j]));
+
+		ptrWordIn += BLOCK_LEN_INT64;
+		ptrWordOut -= BLOCK_LEN_INT64;
+	}
+	for (j = 0; j < 4; j++)
+		AVX2_STORE(state + 4 * j, v[j]);
+}
+
+static void AVX2_TARGET reducedDuplexRowSetup_avx2(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+	AVX2_CONSTANTS
+	__m256i v[4], r[3];
+	uint64_t* ptrWordIn = rowIn;				//In Lyra2: pointer to prev
+	uint64_t* ptrWordInOut = rowInOut;				//In Lyra2: pointer to row*
+	uint64_t* ptrWordOut = rowOut + (nCols - 1)*BLOCK_LEN_INT64; //In Lyra2: pointer to row
+	uint64_t i;
+	int j;
+
+	for (j = 0; j < 4; j++)
+		v[j] = AVX2_LOAD(state + 4 * j);
+	for (i = 0; i < nCols; i++) {
+		//Absorbing "M[prev] [+] M[row*]"
+		for (j = 0; j < 3; j++)
+			v[j] = _mm256_xor_si256(v[j], _mm256_add_epi64(AVX2_LOAD(ptrWordIn + 4 * j), AVX2_LOAD(ptrWordInOut + 4 * j)));
+
+		AVX2_ROUND_LYRA(v);
+
+		//M[row][col] = M[prev][col] XOR rand
+		for (j = 0; j < 3; j++)
+			AVX2_STORE(ptrWordOut + 4 * j, _mm256_xor_si256(AVX2_LOAD(ptrWordIn + 4 * j), v[j]));
+
+		//M[row*][col] = M[row*][col] XOR rotW(rand)
+		AVX2_ROTW(r, v);
+		for (j = 0; j < 3; j++)
+			AVX2_STORE(ptrWordInOut + 4 * j, _mm256_xor_si256(AVX2_LOAD(ptrWordInOut + 4 * j), r[j]));
+
+		ptrWordInOut += BLOCK_LEN_INT64;
+		ptrWordIn += BLOCK_LEN_INT64;
+		ptrWordOut -= BLOCK_LEN_INT64;
+	}
+	for (j = 0; j < 4; j++)
+		AVX2_STORE(state + 4 * j, v[j]);
+}
+
+/*The rows may be the same, every output is read back from memory after the previous store*/
+static void AVX2_TARGET reducedDuplexRow_avx2(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+	AVX2_CONSTANTS
+	__m256i v[4], r[3];
+	uint64_t* ptrWordInOut = rowInOut; //In Lyra2: pointer to row*
+	uint64_t* ptrWordIn = rowIn; //In Lyra2: pointer to prev
+	uint64_t* ptrWordOut = rowOut; //In Lyra2: pointer to row
+	uint64_t i;
+	int j;
+
+	for (j = 0; j < 4; j++)
+		v[j] = AVX2_LOAD(state + 4 * j);
+	for (i = 0; i < nCols; i++) {
+		//Absorbing "M[prev] [+] M[row*]"
+		for (j = 0; j < 3; j++)
+			v[j] = _mm256_xor_si256(v[j], _mm256_add_epi64(AVX2_LOAD(ptrWordIn + 4 * j), AVX2_LOAD(ptrWordInOut + 4 * j)));
+
+		AVX2_ROUND_LYRA(v);
+
+		//M[rowOut][col] = M[rowOut][col] XOR rand
+		for (j = 0; j < 3; j++)
+			AVX2_STORE(ptrWordOut + 4 * j, _mm256_xor_si256(AVX2_LOAD(ptrWordOut + 4 * j), v[j]));
+
+		//M[rowInOut][col] = M[rowInOut][col] XOR rotW(rand)
+		AVX2_ROTW(r, v);
+		for (j = 0; j < 3; j++)
+			AVX2_STORE(ptrWordInOut + 4 * j, _mm256_xor_si256(AVX2_LOAD(ptrWordInOut + 4 * j), r[j]));
+
+		ptrWordOut += BLOCK_LEN_INT64;
+		ptrWordInOut += BLOCK_LEN_INT64;
+		ptrWordIn += BLOCK_LEN_INT64;
+	}
+	for (j = 0; j < 4; j++)
+		AVX2_STORE(state + 4 * j, v[j]);
+}
+
+const sponge_impl sponge_avx2 = {
+	"avx2",
+	blake2bLyra_avx2,
+	reducedSqueezeRow0_avx2,
+	reducedDuplexRow1_avx2,
+	reducedDuplexRowSetup_avx2,
+	reducedDuplexRow_avx2
+};
+
+#endif /* SPONGE_X86 */
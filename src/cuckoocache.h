@@ -0,0 +1,355 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CUCKOOCACHE_H
+#define BITCOIN_CUCKOOCACHE_H
+
+#include "uint256.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Fixed-size concurrent set of uint256 keys, used as a cache.
+ *
+ * Keys must already be uniformly distributed and unpredictable (e.g. salted
+ * SHA256 outputs): the two candidate buckets of a key are taken directly
+ * from its bits, and the all-zero key marks an empty slot.
+ *
+ * Each bucket holds two keys in one cache line. Buckets are guarded by a
+ * fixed number of lock stripes, each carrying a sequence counter: lookups
+ * take no lock and retry while a writer on the stripe is active, insertions
+ * lock the (at most two) stripes of their buckets.
+ *
+ * Every slot carries the generation it was last inserted in. The generation
+ * advances after a quarter of the slots were written; entries three or more
+ * generations old, or erased, are overwritten first. When both buckets of a
+ * key are full of young entries, entries are moved on to their other bucket
+ * cuckoo-style, up to MAX_KICKS times, before one is overwritten.
+ */
+class CCuckooCache
+{
+public:
+    static const unsigned int BUCKET_SLOTS = 2;
+    static const unsigned int LOCK_STRIPES = 128;
+    //! Age in generations from which entries are overwritten first
+    static const uint8_t STALE_AGE = 3;
+    //! Longest chain of entries moved to make room for an insertion
+    static const unsigned int MAX_KICKS = 8;
+
+    struct Stats
+    {
+        size_t nBytes;
+        size_t nSlots;
+        uint64_t nHits;
+        uint64_t nMisses;
+        uint64_t nInserts;
+        uint64_t nEvictions;
+    };
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> words[4];
+    };
+
+    struct alignas(64) Bucket
+    {
+        Slot slots[BUCKET_SLOTS];
+    };
+
+    struct alignas(64) Stripe
+    {
+        std::mutex mutex;
+        std::atomic<uint32_t> nSequence;
+        //! Counters are kept per stripe so lookups do not share a cache line
+        std::atomic<uint64_t> nHits;
+        std::atomic<uint64_t> nMisses;
+        std::atomic<uint64_t> nInserts;
+        std::atomic<uint64_t> nEvictions;
+    };
+
+    std::unique_ptr<char[]> vMemory;
+    Bucket* pBuckets;
+    //! Generation of each slot, 0 for empty or erased slots
+    std::unique_ptr<std::atomic<uint8_t>[]> vGeneration;
+    uint32_t nBuckets;
+    Stripe stripes[LOCK_STRIPES];
+    std::atomic<uint8_t> nGeneration;
+    std::atomic<uint32_t> nGenerationInserts;
+
+    static void Words(const uint256& key, uint64_t (&words)[4])
+    {
+        memcpy(words, key.begin(), sizeof(words));
+    }
+
+    uint32_t BucketFor(uint64_t word) const
+    {
+        return (uint32_t)(((uint64_t)(uint32_t)word * nBuckets) >> 32);
+    }
+
+    void Buckets(const uint64_t (&words)[4], uint32_t& b1, uint32_t& b2) const
+    {
+        b1 = BucketFor(words[0]);
+        b2 = BucketFor(words[1]);
+        if (b2 == b1)
+            b2 = (b1 + 1) % nBuckets;
+    }
+
+    Stripe& StripeFor(uint32_t b) { return stripes[b % LOCK_STRIPES]; }
+
+    //! Generations since the slot was written, 255 for empty slots
+    uint8_t Age(size_t nSlot) const
+    {
+        uint8_t g = vGeneration[nSlot].load(std::memory_order_relaxed);
+        if (g == 0)
+            return 255;
+        uint8_t cur = nGeneration.load(std::memory_order_relaxed);
+        return cur >= g ? cur - g : cur + 255 - g;
+    }
+
+    bool SlotEquals(const Slot& slot, const uint64_t (&words)[4]) const
+    {
+        for (int i = 0; i < 4; i++)
+            if (slot.words[i].load(std::memory_order_relaxed) != words[i])
+                return false;
+        return true;
+    }
+
+    //! Lock-free probe of one bucket, returns the slot index or -1
+    int Probe(uint32_t b, const uint64_t (&words)[4])
+    {
+        Stripe& stripe = StripeFor(b);
+        const Bucket& bucket = pBuckets[b];
+        while (true) {
+            uint32_t nSeq = stripe.nSequence.load(std::memory_order_acquire);
+            if (nSeq & 1)
+                continue;
+            int nFound = -1;
+            for (unsigned int i = 0; i < BUCKET_SLOTS; i++) {
+                if (SlotEquals(bucket.slots[i], words)) {
+                    nFound = i;
+                    break;
+                }
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (stripe.nSequence.load(std::memory_order_relaxed) == nSeq)
+                return nFound;
+        }
+    }
+
+    //! Write a slot, the stripe of its bucket must be locked
+    void WriteSlot(uint32_t b, unsigned int i, const uint64_t (&words)[4], uint8_t nGen)
+    {
+        Stripe& stripe = StripeFor(b);
+        uint32_t nSeq = stripe.nSequence.load(std::memory_order_relaxed);
+        stripe.nSequence.store(nSeq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int w = 0; w < 4; w++)
+            pBuckets[b].slots[i].words[w].store(words[w], std::memory_order_relaxed);
+        stripe.nSequence.store(nSeq + 2, std::memory_order_release);
+        vGeneration[(size_t)b * BUCKET_SLOTS + i].store(nGen, std::memory_order_relaxed);
+    }
+
+    //! Slot of the bucket that is best overwritten
+    unsigned int OldestSlot(uint32_t b, uint8_t& nAgeRet) const
+    {
+        unsigned int nOldest = 0;
+        nAgeRet = 0;
+        for (unsigned int i = 0; i < BUCKET_SLOTS; i++) {
+            uint8_t nAge = Age((size_t)b * BUCKET_SLOTS + i);
+            if (i == 0 || nAge > nAgeRet) {
+                nOldest = i;
+                nAgeRet = nAge;
+            }
+        }
+        return nOldest;
+    }
+
+    void AdvanceGeneration()
+    {
+        uint32_t nPerGeneration = std::max<uint32_t>(1, nBuckets * BUCKET_SLOTS / 4);
+        if (nGenerationInserts.fetch_add(1, std::memory_order_relaxed) + 1 < nPerGeneration)
+            return;
+        nGenerationInserts.store(0, std::memory_order_relaxed);
+        uint8_t cur = nGeneration.load(std::memory_order_relaxed);
+        nGeneration.store(cur == 255 ? 1 : cur + 1, std::memory_order_relaxed);
+    }
+
+public:
+    CCuckooCache() : pBuckets(NULL), nBuckets(0), nGeneration(1), nGenerationInserts(0)
+    {
+        for (unsigned int i = 0; i < LOCK_STRIPES; i++) {
+            stripes[i].nSequence = 0;
+            stripes[i].nHits = 0;
+            stripes[i].nMisses = 0;
+            stripes[i].nInserts = 0;
+            stripes[i].nEvictions = 0;
+        }
+    }
+
+    /**
+     * Allocate the table, using at most nBytes of memory, and drop all
+     * entries. Must not run concurrently with other calls. Returns the
+     * number of bytes used.
+     */
+    size_t Setup(size_t nBytes)
+    {
+        size_t nPerBucket = sizeof(Bucket) + BUCKET_SLOTS;
+        size_t nCount = std::min<size_t>(nBytes / nPerBucket, UINT32_MAX);
+        vMemory.reset();
+        vGeneration.reset();
+        pBuckets = NULL;
+        nBuckets = 0;
+        if (nCount == 0)
+            return 0;
+
+        // over-allocate by one line so the buckets can start cache-line aligned
+        vMemory.reset(new char[nCount * sizeof(Bucket) + sizeof(Bucket)]);
+        uintptr_t nAddr = (uintptr_t)vMemory.get();
+        pBuckets = (Bucket*)((nAddr + sizeof(Bucket) - 1) & ~(uintptr_t)(sizeof(Bucket) - 1));
+        vGeneration.reset(new std::atomic<uint8_t>[nCount * BUCKET_SLOTS]);
+        for (size_t b = 0; b < nCount; b++) {
+            for (unsigned int i = 0; i < BUCKET_SLOTS; i++) {
+                for (int w = 0; w < 4; w++)
+                    pBuckets[b].slots[i].words[w].store(0, std::memory_order_relaxed);
+                vGeneration[b * BUCKET_SLOTS + i].store(0, std::memory_order_relaxed);
+            }
+        }
+        nBuckets = nCount;
+        nGeneration = 1;
+        nGenerationInserts = 0;
+        return nCount * nPerBucket;
+    }
+
+    /**
+     * Check whether key is in the set, without taking a lock. With fErase a
+     * found entry is marked to be overwritten first; it stays visible until
+     * that happens.
+     */
+    bool Contains(const uint256& key, bool fErase)
+    {
+        if (nBuckets == 0)
+            return false;
+        uint64_t words[4];
+        Words(key, words);
+        uint32_t b[2];
+        Buckets(words, b[0], b[1]);
+        for (int n = 0; n < 2; n++) {
+            int nSlot = Probe(b[n], words);
+            if (nSlot >= 0) {
+                if (fErase)
+                    vGeneration[(size_t)b[n] * BUCKET_SLOTS + nSlot].store(0, std::memory_order_relaxed);
+                StripeFor(b[0]).nHits.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        StripeFor(b[0]).nMisses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void Insert(const uint256& key)
+    {
+        if (nBuckets == 0)
+            return;
+        uint64_t words[4];
+        Words(key, words);
+        uint32_t b[2];
+        Buckets(words, b[0], b[1]);
+        if ((words[0] | words[1] | words[2] | words[3]) == 0)
+            return;
+
+        // lock the stripes in index order
+        unsigned int s1 = std::min(b[0] % LOCK_STRIPES, b[1] % LOCK_STRIPES);
+        unsigned int s2 = std::max(b[0] % LOCK_STRIPES, b[1] % LOCK_STRIPES);
+        std::unique_lock<std::mutex> lock1(stripes[s1].mutex);
+        std::unique_lock<std::mutex> lock2;
+        if (s2 != s1)
+            lock2 = std::unique_lock<std::mutex>(stripes[s2].mutex);
+
+        uint8_t nGen = nGeneration.load(std::memory_order_relaxed);
+        for (int n = 0; n < 2; n++) {
+            int nSlot = Probe(b[n], words);
+            if (nSlot >= 0) {
+                vGeneration[(size_t)b[n] * BUCKET_SLOTS + nSlot].store(nGen, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        uint8_t nAge[2];
+        unsigned int nSlot[2];
+        for (int n = 0; n < 2; n++)
+            nSlot[n] = OldestSlot(b[n], nAge[n]);
+        int nTarget = nAge[1] > nAge[0] ? 1 : 0;
+        uint32_t bCur = b[nTarget];
+        unsigned int iCur = nSlot[nTarget];
+
+        // While the chosen slot holds a live entry, put the new key there and
+        // move that entry on to the oldest slot of its other bucket. Stripes
+        // beyond the first two are only try-locked, so inserts cannot
+        // deadlock; a chain that cannot continue drops its last entry.
+        uint64_t cur[4] = {words[0], words[1], words[2], words[3]};
+        uint8_t nCurGen = nGen;
+        unsigned int vHeld[MAX_KICKS + 2] = {s1, s2};
+        std::unique_lock<std::mutex> vLocks[MAX_KICKS];
+        unsigned int nHeld = 2;
+        for (unsigned int nKick = 0; ; nKick++) {
+            size_t nIndex = (size_t)bCur * BUCKET_SLOTS + iCur;
+            if (Age(nIndex) >= STALE_AGE || nKick == MAX_KICKS)
+                break;
+
+            const Slot& victim = pBuckets[bCur].slots[iCur];
+            uint64_t vwords[4];
+            for (int w = 0; w < 4; w++)
+                vwords[w] = victim.words[w].load(std::memory_order_relaxed);
+            uint8_t nVictimGen = vGeneration[nIndex].load(std::memory_order_relaxed);
+
+            uint32_t vb[2];
+            Buckets(vwords, vb[0], vb[1]);
+            uint32_t bAlt = vb[0] == bCur ? vb[1] : vb[0];
+            unsigned int sAlt = bAlt % LOCK_STRIPES;
+            bool fLocked = std::find(vHeld, vHeld + nHeld, sAlt) != vHeld + nHeld;
+            if (!fLocked) {
+                vLocks[nKick] = std::unique_lock<std::mutex>(stripes[sAlt].mutex, std::try_to_lock);
+                fLocked = vLocks[nKick].owns_lock();
+                if (fLocked)
+                    vHeld[nHeld++] = sAlt;
+            }
+            if (!fLocked)
+                break;
+
+            WriteSlot(bCur, iCur, cur, nCurGen);
+            memcpy(cur, vwords, sizeof(cur));
+            nCurGen = nVictimGen;
+            bCur = bAlt;
+            uint8_t nAltAge;
+            iCur = OldestSlot(bAlt, nAltAge);
+        }
+
+        if (Age((size_t)bCur * BUCKET_SLOTS + iCur) < STALE_AGE)
+            StripeFor(b[0]).nEvictions.fetch_add(1, std::memory_order_relaxed);
+        WriteSlot(bCur, iCur, cur, nCurGen);
+        StripeFor(b[0]).nInserts.fetch_add(1, std::memory_order_relaxed);
+        AdvanceGeneration();
+    }
+
+    void GetStats(Stats& stats)
+    {
+        stats.nBytes = (size_t)nBuckets * (sizeof(Bucket) + BUCKET_SLOTS);
+        stats.nSlots = (size_t)nBuckets * BUCKET_SLOTS;
+        stats.nHits = stats.nMisses = stats.nInserts = stats.nEvictions = 0;
+        for (unsigned int i = 0; i < LOCK_STRIPES; i++) {
+            stats.nHits += stripes[i].nHits.load(std::memory_order_relaxed);
+            stats.nMisses += stripes[i].nMisses.load(std::memory_order_relaxed);
+            stats.nInserts += stripes[i].nInserts.load(std::memory_order_relaxed);
+            stats.nEvictions += stripes[i].nEvictions.load(std::memory_order_relaxed);
+        }
+    }
+};
+
+#endif // BITCOIN_CUCKOOCACHE_H
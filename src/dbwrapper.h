@@ -33,12 +33,13 @@ class CDBBatch
 private:
     leveldb::WriteBatch batch;
     const std::vector<unsigned char> *obfuscate_key;
+    size_t size_estimate;
 
 public:
     /**
      * @param[in] obfuscate_key    If passed, XOR data with this key.
      */
-    CDBBatch(const std::vector<unsigned char> *obfuscate_key) : obfuscate_key(obfuscate_key) { };
+    CDBBatch(const std::vector<unsigned char> *obfuscate_key) : obfuscate_key(obfuscate_key), size_estimate(0) { };
 
     template <typename K, typename V>
     void Write(const K& key, const V& value)
@@ -55,6 +56,7 @@ public:
         leveldb::Slice slValue(&ssValue[0], ssValue.size());
 
         batch.Put(slKey, slValue);
+        size_estimate += ssKey.size() + ssValue.size();
     }
 
     template <typename K>
@@ -66,7 +68,17 @@ public:
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
         batch.Delete(slKey);
+        size_estimate += ssKey.size();
     }
+
+    void Clear()
+    {
+        batch.Clear();
+        size_estimate = 0;
+    }
+
+    //! Bytes of keys and values written to the batch so far
+    size_t SizeEstimate() const { return size_estimate; }
 };
 
 class CDBIterator
@@ -0,0 +1,345 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_FLATMAP_H
+#define BITCOIN_FLATMAP_H
+
+#include "memusage.h"
+
+#include <iterator>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Hash map with open addressing, for large maps of small keys.
+ *
+ * The table only holds 8-byte slots (32 bits of the hash and the index of
+ * the element), probed linearly and compacted by backward shifting on
+ * erase, so a lookup mostly touches one cache line before the element
+ * itself. Elements live in pooled arena chunks that double in size and are
+ * never moved: like with std::unordered_map, pointers and iterators stay
+ * valid until their element is erased, even across rehashes. Iteration
+ * follows the arena, not the table.
+ *
+ * Unlike std::unordered_map, inserting does not invalidate iterators either.
+ */
+template <typename K, typename T, typename Hash>
+class flatmap
+{
+public:
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef std::pair<const K, T> value_type;
+    typedef size_t size_type;
+
+private:
+    static const uint32_t NONE = 0xffffffff;
+    //! Elements in the first arena chunk, further chunks double in size up to
+    //! MAX_CHUNK elements. Chunks stay below the size malloc serves by mmap,
+    //! so maps that are filled and flushed repeatedly reuse warm memory.
+    static const uint32_t FIRST_CHUNK = 16;
+    static const uint32_t MAX_CHUNK_SHIFT = 6;
+    static const uint32_t MAX_CHUNK = FIRST_CHUNK << MAX_CHUNK_SHIFT;
+    //! Elements in the chunks that are smaller than MAX_CHUNK
+    static const uint32_t GROWING_NODES = FIRST_CHUNK * ((1U << MAX_CHUNK_SHIFT) - 1);
+
+    struct Slot
+    {
+        uint32_t nHash;
+        uint32_t nNode;
+    };
+
+    struct Node
+    {
+        typename std::aligned_storage<sizeof(value_type), std::alignment_of<value_type>::value>::type storage;
+        //! Hash of the key while used, next node on the free list otherwise
+        uint32_t nHashOrNextFree;
+        bool fUsed;
+
+        value_type* value() { return reinterpret_cast<value_type*>(&storage); }
+    };
+
+    Hash hasher;
+    Slot* pSlots;
+    uint32_t nMask;
+    std::vector<Node*> vChunks;
+    //! Nodes handed out from the arena so far, used or on the free list
+    uint32_t nNodes;
+    uint32_t nFreeHead;
+    size_t nSize;
+
+    static uint32_t ChunkSize(size_t k) { return k < MAX_CHUNK_SHIFT ? FIRST_CHUNK << k : MAX_CHUNK; }
+
+    //! Total elements in the first k chunks
+    static uint32_t ChunkStart(size_t k)
+    {
+        if (k <= MAX_CHUNK_SHIFT)
+            return FIRST_CHUNK * ((1U << k) - 1);
+        return GROWING_NODES + MAX_CHUNK * (k - MAX_CHUNK_SHIFT);
+    }
+
+    Node* GetNode(uint32_t nNode) const
+    {
+        if (nNode >= GROWING_NODES) {
+            uint32_t n = nNode - GROWING_NODES;
+            return vChunks[MAX_CHUNK_SHIFT + n / MAX_CHUNK] + n % MAX_CHUNK;
+        }
+        // chunk k holds the nodes from FIRST_CHUNK * (2^k - 1) on
+        uint32_t k = 31 - __builtin_clz(nNode / FIRST_CHUNK + 1);
+        return vChunks[k] + (nNode - ChunkStart(k));
+    }
+
+    uint32_t NewNode()
+    {
+        uint32_t nNode;
+        if (nFreeHead != NONE) {
+            nNode = nFreeHead;
+            nFreeHead = GetNode(nNode)->nHashOrNextFree;
+        } else {
+            if (nNodes == ChunkStart(vChunks.size()))
+                vChunks.push_back(static_cast<Node*>(::operator new(sizeof(Node) * ChunkSize(vChunks.size()))));
+            nNode = nNodes++;
+        }
+        return nNode;
+    }
+
+    void FreeNode(uint32_t nNode)
+    {
+        Node* node = GetNode(nNode);
+        node->value()->~value_type();
+        node->fUsed = false;
+        node->nHashOrNextFree = nFreeHead;
+        nFreeHead = nNode;
+    }
+
+    uint32_t HashKey(const key_type& key) const { return (uint32_t)hasher(key); }
+
+    //! Index of the slot pointing at the key, or NONE
+    uint32_t FindSlot(const key_type& key, uint32_t nHash) const
+    {
+        if (pSlots == NULL)
+            return NONE;
+        for (uint32_t i = nHash & nMask; ; i = (i + 1) & nMask) {
+            const Slot& slot = pSlots[i];
+            if (slot.nNode == NONE)
+                return NONE;
+            if (slot.nHash == nHash && GetNode(slot.nNode)->value()->first == key)
+                return i;
+        }
+    }
+
+    //! Index of the slot pointing at a used node
+    uint32_t FindNodeSlot(uint32_t nNode) const
+    {
+        uint32_t i = GetNode(nNode)->nHashOrNextFree & nMask;
+        while (pSlots[i].nNode != nNode)
+            i = (i + 1) & nMask;
+        return i;
+    }
+
+    void PlaceSlot(uint32_t nHash, uint32_t nNode)
+    {
+        uint32_t i = nHash & nMask;
+        while (pSlots[i].nNode != NONE)
+            i = (i + 1) & nMask;
+        pSlots[i].nHash = nHash;
+        pSlots[i].nNode = nNode;
+    }
+
+    void Rehash(size_t nSlots)
+    {
+        Slot* pOld = pSlots;
+        size_t nOld = pOld ? (size_t)nMask + 1 : 0;
+        pSlots = new Slot[nSlots];
+        nMask = nSlots - 1;
+        for (size_t i = 0; i < nSlots; i++)
+            pSlots[i].nNode = NONE;
+        for (size_t i = 0; i < nOld; i++) {
+            if (pOld[i].nNode != NONE)
+                PlaceSlot(pOld[i].nHash, pOld[i].nNode);
+        }
+        delete[] pOld;
+    }
+
+    //! Remove a slot, shifting back the slots probed past it
+    void EraseSlot(uint32_t i)
+    {
+        uint32_t j = i;
+        while (true) {
+            j = (j + 1) & nMask;
+            if (pSlots[j].nNode == NONE)
+                break;
+            uint32_t k = pSlots[j].nHash & nMask;
+            // leave slots whose home lies cyclically in (i, j]
+            if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+                continue;
+            pSlots[i] = pSlots[j];
+            i = j;
+        }
+        pSlots[i].nNode = NONE;
+    }
+
+    //! First used node from nNode on, NONE (the end iterator) if there is none
+    uint32_t NextUsed(uint32_t nNode) const
+    {
+        while (nNode < nNodes && !GetNode(nNode)->fUsed)
+            nNode++;
+        return nNode < nNodes ? nNode : NONE;
+    }
+
+    flatmap(const flatmap&);
+    flatmap& operator=(const flatmap&);
+
+public:
+    template <typename M, typename V>
+    class iter
+    {
+        friend class flatmap;
+        M* map;
+        uint32_t nNode;
+        V* pValue;
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef V value_type;
+        typedef ptrdiff_t difference_type;
+        typedef V* pointer;
+        typedef V& reference;
+
+        iter() : map(NULL), nNode(NONE), pValue(NULL) {}
+        iter(M* mapIn, uint32_t nNodeIn) : map(mapIn), nNode(nNodeIn), pValue(nNodeIn == NONE ? NULL : mapIn->GetNode(nNodeIn)->value()) {}
+        template <typename M2, typename V2>
+        iter(const iter<M2, V2>& it) : map(it.map), nNode(it.nNode), pValue(it.pValue) {}
+
+        V& operator*() const { return *pValue; }
+        V* operator->() const { return pValue; }
+        iter& operator++() { *this = iter(map, map->NextUsed(nNode + 1)); return *this; }
+        iter operator++(int) { iter copy(*this); ++(*this); return copy; }
+        bool operator==(const iter& it) const { return nNode == it.nNode; }
+        bool operator!=(const iter& it) const { return nNode != it.nNode; }
+
+        template <typename M2, typename V2> friend class iter;
+    };
+
+    typedef iter<flatmap, value_type> iterator;
+    typedef iter<const flatmap, const value_type> const_iterator;
+
+    explicit flatmap(const Hash& hasherIn = Hash()) : hasher(hasherIn), pSlots(NULL), nMask(0), nNodes(0), nFreeHead(NONE), nSize(0) {}
+
+    ~flatmap()
+    {
+        clear();
+    }
+
+    iterator begin() { return iterator(this, NextUsed(0)); }
+    const_iterator begin() const { return const_iterator(this, NextUsed(0)); }
+    iterator end() { return iterator(this, NONE); }
+    const_iterator end() const { return const_iterator(this, NONE); }
+
+    size_type size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+
+    iterator find(const key_type& key)
+    {
+        uint32_t i = FindSlot(key, HashKey(key));
+        return i == NONE ? end() : iterator(this, pSlots[i].nNode);
+    }
+
+    const_iterator find(const key_type& key) const
+    {
+        uint32_t i = FindSlot(key, HashKey(key));
+        return i == NONE ? end() : const_iterator(this, pSlots[i].nNode);
+    }
+
+    size_type count(const key_type& key) const { return FindSlot(key, HashKey(key)) == NONE ? 0 : 1; }
+
+    std::pair<iterator, bool> insert(const value_type& value)
+    {
+        uint32_t nHash = HashKey(value.first);
+        uint32_t i = FindSlot(value.first, nHash);
+        if (i != NONE)
+            return std::make_pair(iterator(this, pSlots[i].nNode), false);
+
+        // keep the table at most half full, linear probing degrades quickly beyond
+        if (pSlots == NULL || (nSize + 1) * 2 > (size_t)nMask + 1)
+            Rehash(pSlots == NULL ? FIRST_CHUNK * 2 : ((size_t)nMask + 1) * 2);
+        uint32_t nNode = NewNode();
+        Node* node = GetNode(nNode);
+        new (&node->storage) value_type(value);
+        node->nHashOrNextFree = nHash;
+        node->fUsed = true;
+        PlaceSlot(nHash, nNode);
+        nSize++;
+        return std::make_pair(iterator(this, nNode), true);
+    }
+
+    //! Size the table for n elements, so inserting up to them does not rehash
+    void reserve(size_type n)
+    {
+        size_t nSlots = pSlots ? (size_t)nMask + 1 : FIRST_CHUNK * 2;
+        while (n * 2 > nSlots)
+            nSlots *= 2;
+        if (pSlots == NULL || nSlots > (size_t)nMask + 1)
+            Rehash(nSlots);
+    }
+
+    mapped_type& operator[](const key_type& key)
+    {
+        return insert(value_type(key, mapped_type())).first->second;
+    }
+
+    iterator erase(iterator it)
+    {
+        EraseSlot(FindNodeSlot(it.nNode));
+        FreeNode(it.nNode);
+        nSize--;
+        return iterator(this, NextUsed(it.nNode + 1));
+    }
+
+    size_type erase(const key_type& key)
+    {
+        uint32_t i = FindSlot(key, HashKey(key));
+        if (i == NONE)
+            return 0;
+        uint32_t nNode = pSlots[i].nNode;
+        EraseSlot(i);
+        FreeNode(nNode);
+        nSize--;
+        return 1;
+    }
+
+    //! Destroy all elements and release the table and the arena
+    void clear()
+    {
+        for (uint32_t n = 0; n < nNodes; n++) {
+            Node* node = GetNode(n);
+            if (node->fUsed)
+                node->value()->~value_type();
+        }
+        for (size_t k = 0; k < vChunks.size(); k++)
+            ::operator delete(vChunks[k]);
+        std::vector<Node*>().swap(vChunks);
+        delete[] pSlots;
+        pSlots = NULL;
+        nMask = 0;
+        nNodes = 0;
+        nFreeHead = NONE;
+        nSize = 0;
+    }
+
+    //! Memory used by the table and the arena, not counting what elements own
+    size_t DynamicMemoryUsage() const
+    {
+        size_t nUsage = pSlots ? memusage::MallocUsage(((size_t)nMask + 1) * sizeof(Slot)) : 0;
+        for (size_t k = 0; k < vChunks.size(); k++)
+            nUsage += memusage::MallocUsage(sizeof(Node) * ChunkSize(k));
+        return nUsage + memusage::DynamicUsage(vChunks);
+    }
+};
+
+#endif // BITCOIN_FLATMAP_H
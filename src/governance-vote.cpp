@@ -8,6 +8,7 @@
 #include "masternodeman.h"
 #include "messagesigner.h"
 #include "util.h"
+#include "InfiniDEX/dexverifier.h"
 
 #include <boost/lexical_cast.hpp>
 
@@ -287,7 +288,8 @@ bool CGovernanceVote::IsValid(bool fSignatureCheck) const
     std::string strMessage = vinMasternode.prevout.ToStringShort() + "|" + nParentHash.ToString() + "|" +
         boost::lexical_cast<std::string>(nVoteSignal) + "|" + boost::lexical_cast<std::string>(nVoteOutcome) + "|" + boost::lexical_cast<std::string>(nTime);
 
-    if(!CMessageSigner::VerifyMessage(infoMn.pubKeyMasternode, vchSig, strMessage, strError)) {
+    // cached, the vote handler verifies votes before taking cs_main
+    if(!dexVerifier.VerifyMessage(infoMn.pubKeyMasternode, vchSig, strMessage, strError)) {
         LogPrintf("CGovernanceVote::IsValid -- VerifyMessage() failed, error: %s\n", strError);
         return false;
     }
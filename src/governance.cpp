@@ -253,6 +253,11 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, std::string& strCommand, C
             return;
         }
 
+        // Verify the signature before ProcessVote takes cs, so votes of different
+        // peers are checked in parallel on the message processing pool; the check
+        // in CGovernanceObject::ProcessVote then hits the DEX verifier signature cache
+        vote.IsValid(true);
+
         CGovernanceException exception;
         if(ProcessVote(pfrom, vote, exception, connman)) {
             LogPrint("gobject", "MNGOVERNANCEOBJECTVOTE -- %s new\n", strHash);
@@ -589,27 +594,29 @@ std::vector<CGovernanceVote> CGovernanceManager::GetCurrentVotes(const uint256&
     if(it == mapObjects.end()) return vecResult;
     CGovernanceObject& govobj = it->second;
 
-    CMasternode mn;
-    std::map<COutPoint, CMasternode> mapMasternodes;
+    std::vector<COutPoint> vecOutpoints;
     if(mnCollateralOutpointFilter == COutPoint()) {
-        mapMasternodes = mnodeman.GetFullMasternodeMap();
-    } else if (mnodeman.Get(mnCollateralOutpointFilter, mn)) {
-        mapMasternodes[mnCollateralOutpointFilter] = mn;
+        CMasternodeRegistry::snapshot_t snapshot = mnodeman.GetMasternodeSnapshot();
+        for (const auto& pmn : *snapshot) {
+            vecOutpoints.push_back(pmn->vin.prevout);
+        }
+    } else if (mnodeman.Has(mnCollateralOutpointFilter)) {
+        vecOutpoints.push_back(mnCollateralOutpointFilter);
     }
 
     // Loop thru each MN collateral outpoint and get the votes for the `nParentHash` governance object
-    for (auto& mnpair : mapMasternodes)
+    for (const COutPoint& outpoint : vecOutpoints)
     {
         // get a vote_rec_t from the govobj
         vote_rec_t voteRecord;
-        if (!govobj.GetCurrentMNVotes(mnpair.first, voteRecord)) continue;
+        if (!govobj.GetCurrentMNVotes(outpoint, voteRecord)) continue;
 
         for (vote_instance_m_it it3 = voteRecord.mapInstances.begin(); it3 != voteRecord.mapInstances.end(); ++it3) {
             int signal = (it3->first);
             int outcome = ((it3->second).eOutcome);
             int64_t nCreationTime = ((it3->second).nCreationTime);
 
-            CGovernanceVote vote = CGovernanceVote(mnpair.first, nParentHash, (vote_signal_enum_t)signal, (vote_outcome_enum_t)outcome);
+            CGovernanceVote vote = CGovernanceVote(outpoint, nParentHash, (vote_signal_enum_t)signal, (vote_outcome_enum_t)outcome);
             vote.SetTime(nCreationTime);
 
             vecResult.push_back(vote);
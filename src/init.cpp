@@ -18,6 +18,7 @@
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/validation.h"
+#include "crypto/Lyra2.h"
 #include "httpserver.h"
 #include "httprpc.h"
 #include "key.h"
@@ -63,6 +64,13 @@
 #include "privatesend-client.h"
 #include "privatesend-server.h"
 #include "spork.h"
+#include "InfiniDEX/balanceledger.h"
+#include "InfiniDEX/dexexecutor.h"
+#include "InfiniDEX/dexverifier.h"
+#include "InfiniDEX/marketoverview.h"
+#include "InfiniDEX/orderbook.h"
+#include "InfiniDEX/trade.h"
+#include "InfiniDEX/tradelog.h"
 
 #include <stdint.h>
 #include <stdio.h>
@@ -236,7 +244,11 @@ void PrepareShutdown()
     MapPort(false);
     UnregisterValidationInterface(peerLogic.get());
     peerLogic.reset();
+    dexVerifier.Stop();
     g_connman.reset();
+    dexExecutor.Stop();
+    tradeLogManager.Close();
+    balanceLedger.Close();
 
     // STORE DATA CACHES INTO SERIALIZED DAT FILES
     CFlatDB<CMasternodeMan> flatdb1("mncache.dat", "magicMasternodeCache");
@@ -382,6 +394,15 @@ void OnRPCPreCommand(const CRPCCommand& cmd)
         throw JSONRPCError(RPC_FORBIDDEN_BY_SAFE_MODE, string("Safe mode: ") + strWarning);
 }
 
+static std::string GetSupportedSocketEventsStr()
+{
+    std::string strSupportedModes = "'select'";
+#ifdef USE_EPOLL
+    strSupportedModes += ", 'epoll'";
+#endif
+    return strSupportedModes;
+}
+
 std::string HelpMessage(HelpMessageMode mode)
 {
     const bool showDebug = GetBoolArg("-help-debug", false);
@@ -406,11 +427,13 @@ std::string HelpMessage(HelpMessageMode mode)
     }
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-coinsmap=<type>", strprintf(_("Hash map holding the in-memory UTXO set, node or flat (default: %s)"), DEFAULT_COINS_MAP));
+    strUsage += HelpMessageOpt("-asyncflush", strprintf(_("Write the in-memory UTXO set to the chain state database on a background thread (default: %u)"), DEFAULT_ASYNC_FLUSH));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file on startup"));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-maxmempool=<n>", strprintf(_("Keep the transaction memory pool below <n> megabytes (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE));
     strUsage += HelpMessageOpt("-mempoolexpiry=<n>", strprintf(_("Do not keep transactions in the mempool longer than <n> hours (default: %u)"), DEFAULT_MEMPOOL_EXPIRY));
-    strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+    strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification, header hashing and coins prefetch threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), BITCOIN_PID_FILENAME));
@@ -444,6 +467,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-listenonion", strprintf(_("Automatically create Tor hidden service (default: %d)"), DEFAULT_LISTEN_ONION));
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf(_("Maintain at most <n> connections to peers (temporary service connections excluded) (default: %u)"), DEFAULT_MAX_PEER_CONNECTIONS));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXRECEIVEBUFFER));
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("Socket events mode, which must be one of: %s (default: %s)"), GetSupportedSocketEventsStr(), DEFAULT_SOCKETEVENTS));
+    strUsage += HelpMessageOpt("-msgprocthreads=<n>", strprintf(_("Set the number of threads processing masternode, governance, spork and DEX messages next to the message handler thread (%u to %d, 0 = auto, <0 = leave that many cores free, 1 = none, default: %d)"),
+        -GetNumCores(), MAX_MSGPROC_THREADS, DEFAULT_MSGPROC_THREADS));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXSENDBUFFER));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
@@ -529,6 +555,8 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED));
+        strUsage += HelpMessageOpt("-dbbatchsize=<n>", strprintf("Maximum size in bytes of the batches -asyncflush writes to the chain state database (default: %u)", nDefaultDbBatchSize));
+        strUsage += HelpMessageOpt("-verifyindexpow", strprintf("Recompute the proof-of-work hash of every block index entry at startup instead of trusting the stored hash, on the -par threads (default: %u)", DEFAULT_VERIFY_INDEX_POW));
 #ifdef ENABLE_WALLET
         strUsage += HelpMessageOpt("-dblogsize=<n>", strprintf("Flush wallet database activity from memory to disk log every <n> megabytes (default: %u)", DEFAULT_WALLET_DBLOGSIZE));
 #endif
@@ -546,7 +574,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-limitdescendantsize=<n>", strprintf("Do not accept transactions if any ancestor would have more than <n> kilobytes of in-mempool descendants (default: %u).", DEFAULT_DESCENDANT_SIZE_LIMIT));
     }
     string debugCategories = "addrman, alert, bench, coindb, db, http, libevent, lock, mempool, mempoolrej, net, proxy, prune, rand, reindex, rpc, selectcoins, tor, zmq, "
-                             "infinex (or specifically: gobject, instantsend, keepass, masternode, mnpayments, mnsync, privatesend, spork)"; // Don't translate these and qt below
+                             "infinex (or specifically: gobject, infinidex, instantsend, keepass, masternode, mnpayments, mnsync, privatesend, spork)"; // Don't translate these and qt below
     if (mode == HMM_BITCOIN_QT)
         debugCategories += ", qt";
     strUsage += HelpMessageOpt("-debug=<category>", strprintf(_("Output debugging information (default: %u, supplying <category> is optional)"), 0) + ". " +
@@ -600,6 +628,15 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-instantsenddepth=<n>", strprintf(_("Show N confirmations for a successfully locked transaction (0-12880, default: %u)"), DEFAULT_INSTANTSEND_DEPTH));
     strUsage += HelpMessageOpt("-instantsendnotify=<cmd>", _("Execute command when a wallet InstantSend transaction is successfully locked (%s in cmd is replaced by TxID)"));
 
+    strUsage += HelpMessageGroup(_("InfiniDEX options:"));
+    strUsage += HelpMessageOpt("-dexthreads=<n>", strprintf(_("Set the number of trade pair execution threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+        -GetNumCores(), MAX_DEX_THREADS, DEFAULT_DEX_THREADS));
+    strUsage += HelpMessageOpt("-dexverifythreads=<n>", strprintf(_("Set the number of message signature verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+        -GetNumCores(), MAX_DEX_VERIFY_THREADS, DEFAULT_DEX_VERIFY_THREADS));
+    strUsage += HelpMessageOpt("-dexsigcachesize=<n>", strprintf(_("Number of verified message signatures to remember (default: %u)"), DEFAULT_DEX_SIGCACHE_SIZE));
+    strUsage += HelpMessageOpt("-dexbooktick=<n>", strprintf(_("Collect order book changes for <n> milliseconds before broadcasting them as one signed delta (default: %u)"), DEFAULT_ORDERBOOK_TICK));
+    strUsage += HelpMessageOpt("-dexoverviewtick=<n>", strprintf(_("Broadcast the signed 24 hour market overview of all trade pairs every <n> milliseconds (default: %u)"), DEFAULT_MARKET_OVERVIEW_TICK));
+
 
     strUsage += HelpMessageGroup(_("Node relay options:"));
     if (showDebug)
@@ -1019,8 +1056,22 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     int nUserMaxConnections = GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     int nMaxConnections = std::max(nUserMaxConnections, 0);
 
+    std::string strSocketEvents = GetArg("-socketevents", DEFAULT_SOCKETEVENTS);
+    CConnman::SocketEventsMode socketEventsMode;
+    if (strSocketEvents == "select") {
+        socketEventsMode = CConnman::SOCKETEVENTS_SELECT;
+#ifdef USE_EPOLL
+    } else if (strSocketEvents == "epoll") {
+        socketEventsMode = CConnman::SOCKETEVENTS_EPOLL;
+#endif
+    } else {
+        return InitError(strprintf(_("Invalid -socketevents ('%s') specified. Only these modes are supported: %s"), strSocketEvents, GetSupportedSocketEventsStr()));
+    }
+
     // Trim requested connection counts, to fit into system limitations
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
+    // (select() cannot watch sockets beyond FD_SETSIZE, epoll has no such limit)
+    if (socketEventsMode == CConnman::SOCKETEVENTS_SELECT)
+        nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
     int nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -1208,9 +1259,13 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     // Initialize fast PRNG
     seed_insecure_rand(false);
 
+    // Pick the fastest Lyra2 sponge for this CPU before any thread hashes a block
+    std::string strSpongeImpl = spongeAutoDetect();
+
     // Initialize elliptic curve code
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
+    InitSignatureCache();
 
     // Sanity check
     if (!InitSanityCheck())
@@ -1257,12 +1312,16 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("Using data directory %s\n", strDataDir);
     LogPrintf("Using config file %s\n", GetConfigFile().string());
     LogPrintf("Using at most %i connections (%i file descriptors available)\n", nMaxConnections, nFD);
+    LogPrintf("Using the '%s' Lyra2 sponge implementation\n", strSpongeImpl);
     std::ostringstream strErrors;
 
-    LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
+    LogPrintf("Using %u threads for script verification, header hashing and coins prefetch\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
-        for (int i=0; i<nScriptCheckThreads-1; i++)
+        for (int i=0; i<nScriptCheckThreads-1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadBlockHeaderHashCheck);
+            threadGroup.create_thread(&ThreadCoinsPrefetch);
+        }
     }
 
     if (mapArgs.count("-sporkkey")) // spork priv key
@@ -1507,6 +1566,14 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         }
     }
 
+    std::string strCoinsMap = GetArg("-coinsmap", DEFAULT_COINS_MAP);
+    if (strCoinsMap == "flat")
+        CCoinsMap::SetDefaultImplementation(CCoinsMap::FLAT);
+    else if (strCoinsMap == "node")
+        CCoinsMap::SetDefaultImplementation(CCoinsMap::NODE);
+    else
+        return InitError(strprintf(_("Unknown -coinsmap type: '%s'"), strCoinsMap));
+
     // cache size calculations
     int64_t nTotalCache = (GetArg("-dbcache", nDefaultDbCache) << 20);
     nTotalCache = std::max(nTotalCache, nMinDbCache << 20); // total cache cannot be less than nMinDbCache
@@ -1521,7 +1588,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
-    LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1fMiB for in-memory UTXO set (%s map)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), strCoinsMap);
 
     bool fLoaded = false;
     while (!fLoaded) {
@@ -1540,7 +1607,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                 delete pblocktree;
 
                 pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex);
-                pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex || fReindexChainState);
+                pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex || fReindexChainState, GetBoolArg("-asyncflush", DEFAULT_ASYNC_FLUSH));
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
 
@@ -1551,6 +1618,12 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                         CleanupBlockRevFiles();
                 }
 
+                // A background flush written in several batches may have been interrupted
+                if (!pcoinsdbview->ReplayPartialFlush()) {
+                    strLoadError = _("Error finishing an interrupted flush of the chain state database");
+                    break;
+                }
+
                 if (!LoadBlockIndex()) {
                     strLoadError = _("Error loading block database");
                     break;
@@ -1997,6 +2070,15 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         threadGroup.create_thread(boost::bind(&ThreadCheckPrivateSendServer, boost::ref(*g_connman)));
     else
         threadGroup.create_thread(boost::bind(&ThreadCheckPrivateSendClient, boost::ref(*g_connman)));
+    threadGroup.create_thread(boost::bind(&ThreadOrderBookBroadcast, boost::ref(*g_connman)));
+    threadGroup.create_thread(boost::bind(&ThreadMarketOverviewBroadcast, boost::ref(*g_connman)));
+    if (!fLiteMode) {
+        if (!balanceLedger.Open(GetDataDir() / "infinidex"))
+            return InitError(_("Unable to load InfiniDEX user balances"));
+        tradeLogManager.Open(GetDataDir() / "infinidex");
+        dexExecutor.Start(GetArg("-dexthreads", DEFAULT_DEX_THREADS));
+        dexVerifier.Start(GetArg("-dexverifythreads", DEFAULT_DEX_VERIFY_THREADS), GetArg("-dexsigcachesize", DEFAULT_DEX_SIGCACHE_SIZE));
+    }
 
     // ********************************************************* Step 12: start node
 
@@ -2042,6 +2124,15 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     connOptions.uiInterface = &uiInterface;
     connOptions.nSendBufferMaxSize = 1000*GetArg("-maxsendbuffer", DEFAULT_MAXSENDBUFFER);
     connOptions.nReceiveFloodSize = 1000*GetArg("-maxreceivebuffer", DEFAULT_MAXRECEIVEBUFFER);
+    connOptions.socketEventsMode = socketEventsMode;
+    // -msgprocthreads=0 means autodetect, like -par, and 1 keeps all messages on the message handler thread
+    connOptions.nMsgProcThreads = GetArg("-msgprocthreads", DEFAULT_MSGPROC_THREADS);
+    if (connOptions.nMsgProcThreads <= 0)
+        connOptions.nMsgProcThreads += GetNumCores();
+    if (connOptions.nMsgProcThreads <= 1)
+        connOptions.nMsgProcThreads = 0;
+    else if (connOptions.nMsgProcThreads > MAX_MSGPROC_THREADS)
+        connOptions.nMsgProcThreads = MAX_MSGPROC_THREADS;
 
     if (!connman.Start(scheduler, strNodeError, connOptions))
         return InitError(strNodeError);
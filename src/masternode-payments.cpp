@@ -292,7 +292,7 @@ bool CMasternodePayments::GetBlockPayee(int nBlockHeight, CScript& payee)
 
 // Is this masternode scheduled to get paid soon?
 // -- Only look ahead up to 8 blocks to allow for propagation of the latest 2 blocks of votes
-bool CMasternodePayments::IsScheduled(CMasternode& mn, int nNotBlockHeight)
+bool CMasternodePayments::IsScheduled(const CMasternode& mn, int nNotBlockHeight)
 {
 	LOCK(cs_mapMasternodeBlocks);
 
@@ -654,7 +654,7 @@ void CMasternodePayments::CheckPreviousBlockVotes(int nPrevBlockHeight)
 						continue;
 					}
 					auto vote = mapMasternodePaymentVotes[voteHash];
-					if (vote.vinMasternode.prevout == mn.second.vin.prevout) {
+					if (vote.vinMasternode.prevout == mn.second->vin.prevout) {
 						payee = vote.payee;
 						found = true;
 						break;
@@ -665,8 +665,8 @@ void CMasternodePayments::CheckPreviousBlockVotes(int nPrevBlockHeight)
 
 		if (!found) {
 			debugStr += strprintf("CMasternodePayments::CheckPreviousBlockVotes --   %s - no vote received\n",
-				mn.second.vin.prevout.ToStringShort());
-			mapMasternodesDidNotVote[mn.second.vin.prevout]++;
+				mn.second->vin.prevout.ToStringShort());
+			mapMasternodesDidNotVote[mn.second->vin.prevout]++;
 			continue;
 		}
 
@@ -675,7 +675,7 @@ void CMasternodePayments::CheckPreviousBlockVotes(int nPrevBlockHeight)
 		CBitcoinAddress address2(address1);
 
 		debugStr += strprintf("CMasternodePayments::CheckPreviousBlockVotes --   %s - voted for %s\n",
-			mn.second.vin.prevout.ToStringShort(), address2.ToString());
+			mn.second->vin.prevout.ToStringShort(), address2.ToString());
 	}
 	debugStr += "CMasternodePayments::CheckPreviousBlockVotes -- Masternodes which missed a vote in the past:\n";
 	for (auto it : mapMasternodesDidNotVote) {
@@ -12,6 +12,7 @@
 #include "masternodeman.h"
 #include "messagesigner.h"
 #include "util.h"
+#include "InfiniDEX/dexverifier.h"
 
 #include <boost/lexical_cast.hpp>
 
@@ -89,7 +90,7 @@ bool CMasternode::UpdateFromNewBroadcast(CMasternodeBroadcast& mnb, CConnman& co
 // the proof of work for that block. The further away they are the better, the furthest will win the election
 // and get paid this block
 //
-arith_uint256 CMasternode::CalculateScore(const uint256& blockHash)
+arith_uint256 CMasternode::CalculateScore(const uint256& blockHash) const
 {
 	// Deterministically calculate a "score" for a Masternode based on any given (block)hash
 	CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
@@ -268,7 +269,7 @@ bool CMasternode::IsValidNetAddr(CService addrIn)
             (addrIn.IsIPv4() && IsReachable(addrIn) && addrIn.IsRoutable());
 }
 
-masternode_info_t CMasternode::GetInfo()
+masternode_info_t CMasternode::GetInfo() const
 {
     masternode_info_t info{*this};
     info.nTimeLastPing = lastPing.sigTime;
@@ -692,7 +693,8 @@ bool CMasternodePing::CheckSignature(CPubKey& pubKeyMasternode, int &nDos)
     std::string strError = "";
     nDos = 0;
 
-    if(!CMessageSigner::VerifyMessage(pubKeyMasternode, vchSig, strMessage, strError)) {
+    // cached, the MNPING handler verifies pings before taking cs_main
+    if(!dexVerifier.VerifyMessage(pubKeyMasternode, vchSig, strMessage, strError)) {
         LogPrintf("CMasternodePing::CheckSignature -- Got bad Masternode ping signature, masternode=%s, error: %s\n", vin.prevout.ToStringShort(), strError);
         nDos = 33;
         return false;
@@ -793,6 +795,7 @@ bool CMasternodePing::CheckAndUpdate(CMasternode* pmn, bool fFromNewBroadcast, i
     uint256 hash = mnb.GetHash();
     if (mnodeman.mapSeenMasternodeBroadcast.count(hash)) {
         mnodeman.mapSeenMasternodeBroadcast[hash].second.lastPing = *this;
+        ForgetRelayMessage(CInv(MSG_MASTERNODE_ANNOUNCE, hash));
     }
 
     // force update, ignoring cache
@@ -842,11 +845,11 @@ void CMasternode::UpdateWatchdogVoteTime(uint64_t nVoteTime)
 *   - When masternode come and go on the network, we must flag the items they voted on to recalc it's cached flags
 *
 */
-void CMasternode::FlagGovernanceItemsAsDirty()
+void CMasternode::FlagGovernanceItemsAsDirty() const
 {
     std::vector<uint256> vecDirty;
     {
-        std::map<uint256, int>::iterator it = mapGovernanceObjectsVotedOn.begin();
+        std::map<uint256, int>::const_iterator it = mapGovernanceObjectsVotedOn.begin();
         while(it != mapGovernanceObjectsVotedOn.end()) {
             vecDirty.push_back(it->first);
             ++it;
@@ -14,6 +14,8 @@
 #include "privatesend-client.h"
 #include "util.h"
 
+#include <iterator>
+
 /** Masternode manager */
 CMasternodeMan mnodeman;
 
@@ -21,8 +23,8 @@ const std::string CMasternodeMan::SERIALIZATION_VERSION_STRING = "CMasternodeMan
 
 struct CompareLastPaidBlock
 {
-    bool operator()(const std::pair<int, CMasternode*>& t1,
-                    const std::pair<int, CMasternode*>& t2) const
+    bool operator()(const std::pair<int, const CMasternode*>& t1,
+                    const std::pair<int, const CMasternode*>& t2) const
     {
         return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->vin < t2.second->vin);
     }
@@ -30,8 +32,8 @@ struct CompareLastPaidBlock
 
 struct CompareScoreMN
 {
-    bool operator()(const std::pair<arith_uint256, CMasternode*>& t1,
-                    const std::pair<arith_uint256, CMasternode*>& t2) const
+    bool operator()(const std::pair<arith_uint256, const CMasternode*>& t1,
+                    const std::pair<arith_uint256, const CMasternode*>& t2) const
     {
         return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->vin < t2.second->vin);
     }
@@ -49,7 +51,7 @@ struct CompareByAddr
 
 CMasternodeMan::CMasternodeMan()
 : cs(),
-  mapMasternodes(),
+  masternodes(),
   mAskedUsForMasternodeList(),
   mWeAskedForMasternodeList(),
   mWeAskedForMasternodeListEntry(),
@@ -73,7 +75,7 @@ bool CMasternodeMan::Add(CMasternode &mn)
     if (Has(mn.vin.prevout)) return false;
 
     LogPrint("masternode", "CMasternodeMan::Add -- Adding new Masternode: addr=%s, %i now\n", mn.addr.ToString(), size() + 1);
-    mapMasternodes[mn.vin.prevout] = mn;
+    masternodes.Add(mn);
     fMasternodesAdded = true;
     return true;
 }
@@ -110,7 +112,7 @@ void CMasternodeMan::AskForMN(CNode* pnode, const COutPoint& outpoint, CConnman&
 bool CMasternodeMan::AllowMixing(const COutPoint &outpoint)
 {
     LOCK(cs);
-    CMasternode* pmn = Find(outpoint);
+    CMasternode* pmn = FindMutable(outpoint);
     if (!pmn) {
         return false;
     }
@@ -124,7 +126,7 @@ bool CMasternodeMan::AllowMixing(const COutPoint &outpoint)
 bool CMasternodeMan::DisallowMixing(const COutPoint &outpoint)
 {
     LOCK(cs);
-    CMasternode* pmn = Find(outpoint);
+    CMasternode* pmn = FindMutable(outpoint);
     if (!pmn) {
         return false;
     }
@@ -136,7 +138,7 @@ bool CMasternodeMan::DisallowMixing(const COutPoint &outpoint)
 bool CMasternodeMan::PoSeBan(const COutPoint &outpoint)
 {
     LOCK(cs);
-    CMasternode* pmn = Find(outpoint);
+    CMasternode* pmn = FindMutable(outpoint);
     if (!pmn) {
         return false;
     }
@@ -151,9 +153,9 @@ void CMasternodeMan::Check()
 
     LogPrint("masternode", "CMasternodeMan::Check -- nLastWatchdogVoteTime=%d, IsWatchdogActive()=%d\n", nLastWatchdogVoteTime, IsWatchdogActive());
 
-    for (auto& mnpair : mapMasternodes) {
-        mnpair.second.Check();
-    }
+    masternodes.ForEachMutable([](CMasternode& mn) {
+        mn.Check();
+    });
 }
 
 void CMasternodeMan::CheckAndRemove(CConnman& connman)
@@ -173,26 +175,33 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
         rank_pair_vec_t vecMasternodeRanks;
         // ask for up to MNB_RECOVERY_MAX_ASK_ENTRIES masternode entries at a time
         int nAskForMnbRecovery = MNB_RECOVERY_MAX_ASK_ENTRIES;
-        std::map<COutPoint, CMasternode>::iterator it = mapMasternodes.begin();
-        while (it != mapMasternodes.end()) {
-            CMasternodeBroadcast mnb = CMasternodeBroadcast(it->second);
+        // walk a sorted copy of the outpoints, entries are erased on the way
+        std::vector<COutPoint> vecOutpoints;
+        vecOutpoints.reserve(masternodes.size());
+        for (const CMasternode& mn : masternodes) {
+            vecOutpoints.push_back(mn.vin.prevout);
+        }
+        std::sort(vecOutpoints.begin(), vecOutpoints.end());
+        for (const COutPoint& outpoint : vecOutpoints) {
+            const CMasternode* pmn = Find(outpoint);
+            CMasternodeBroadcast mnb = CMasternodeBroadcast(*pmn);
             uint256 hash = mnb.GetHash();
             // If collateral was spent ...
-            if (it->second.IsOutpointSpent()) {
-                LogPrint("masternode", "CMasternodeMan::CheckAndRemove -- Removing Masternode: %s  addr=%s  %i now\n", it->second.GetStateString(), it->second.addr.ToString(), size() - 1);
+            if (pmn->IsOutpointSpent()) {
+                LogPrint("masternode", "CMasternodeMan::CheckAndRemove -- Removing Masternode: %s  addr=%s  %i now\n", pmn->GetStateString(), pmn->addr.ToString(), size() - 1);
 
                 // erase all of the broadcasts we've seen from this txin, ...
                 mapSeenMasternodeBroadcast.erase(hash);
-                mWeAskedForMasternodeListEntry.erase(it->first);
+                mWeAskedForMasternodeListEntry.erase(outpoint);
 
                 // and finally remove it from the list
-                it->second.FlagGovernanceItemsAsDirty();
-                mapMasternodes.erase(it++);
+                pmn->FlagGovernanceItemsAsDirty();
+                masternodes.Erase(outpoint);
                 fMasternodesRemoved = true;
             } else {
                 bool fAsk = (nAskForMnbRecovery > 0) &&
                             masternodeSync.IsSynced() &&
-                            it->second.IsNewStartRequired() &&
+                            pmn->IsNewStartRequired() &&
                             !IsMnbRecoveryRequested(hash);
                 if(fAsk) {
                     // this mn is in a non-recoverable state and we haven't asked other nodes yet
@@ -206,21 +215,20 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
                     // ask first MNB_RECOVERY_QUORUM_TOTAL masternodes we can connect to and we haven't asked recently
                     for(int i = 0; setRequested.size() < MNB_RECOVERY_QUORUM_TOTAL && i < (int)vecMasternodeRanks.size(); i++) {
                         // avoid banning
-                        if(mWeAskedForMasternodeListEntry.count(it->first) && mWeAskedForMasternodeListEntry[it->first].count(vecMasternodeRanks[i].second.addr)) continue;
+                        if(mWeAskedForMasternodeListEntry.count(outpoint) && mWeAskedForMasternodeListEntry[outpoint].count(vecMasternodeRanks[i].second->addr)) continue;
                         // didn't ask recently, ok to ask now
-                        CService addr = vecMasternodeRanks[i].second.addr;
+                        CService addr = vecMasternodeRanks[i].second->addr;
                         setRequested.insert(addr);
                         listScheduledMnbRequestConnections.push_back(std::make_pair(addr, hash));
                         fAskedForMnbRecovery = true;
                     }
                     if(fAskedForMnbRecovery) {
-                        LogPrint("masternode", "CMasternodeMan::CheckAndRemove -- Recovery initiated, masternode=%s\n", it->first.ToStringShort());
+                        LogPrint("masternode", "CMasternodeMan::CheckAndRemove -- Recovery initiated, masternode=%s\n", outpoint.ToStringShort());
                         nAskForMnbRecovery--;
                     }
                     // wait for mnb recovery replies for MNB_RECOVERY_WAIT_SECONDS seconds
                     mMnbRecoveryRequests[hash] = std::make_pair(GetTime() + MNB_RECOVERY_WAIT_SECONDS, setRequested);
                 }
-                ++it;
             }
         }
 
@@ -342,7 +350,7 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
 void CMasternodeMan::Clear()
 {
     LOCK(cs);
-    mapMasternodes.clear();
+    masternodes.Clear();
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
@@ -358,8 +366,8 @@ int CMasternodeMan::CountMasternodes(int nProtocolVersion)
     int nCount = 0;
     nProtocolVersion = nProtocolVersion == -1 ? mnpayments.GetMinMasternodePaymentsProto() : nProtocolVersion;
 
-    for (auto& mnpair : mapMasternodes) {
-        if(mnpair.second.nProtocolVersion < nProtocolVersion) continue;
+    for (const CMasternode& mn : masternodes) {
+        if(mn.nProtocolVersion < nProtocolVersion) continue;
         nCount++;
     }
 
@@ -372,8 +380,8 @@ int CMasternodeMan::CountEnabled(int nProtocolVersion)
     int nCount = 0;
     nProtocolVersion = nProtocolVersion == -1 ? mnpayments.GetMinMasternodePaymentsProto() : nProtocolVersion;
 
-    for (auto& mnpair : mapMasternodes) {
-        if(mnpair.second.nProtocolVersion < nProtocolVersion || !mnpair.second.IsEnabled()) continue;
+    for (const CMasternode& mn : masternodes) {
+        if(mn.nProtocolVersion < nProtocolVersion || !mn.IsEnabled()) continue;
         nCount++;
     }
 
@@ -386,10 +394,10 @@ int CMasternodeMan::CountByIP(int nNetworkType)
     LOCK(cs);
     int nNodeCount = 0;
 
-    for (auto& mnpair : mapMasternodes)
-        if ((nNetworkType == NET_IPV4 && mnpair.second.addr.IsIPv4()) ||
-            (nNetworkType == NET_TOR  && mnpair.second.addr.IsTor())  ||
-            (nNetworkType == NET_IPV6 && mnpair.second.addr.IsIPv6())) {
+    for (const CMasternode& mn : masternodes)
+        if ((nNetworkType == NET_IPV4 && mn.addr.IsIPv4()) ||
+            (nNetworkType == NET_TOR  && mn.addr.IsTor())  ||
+            (nNetworkType == NET_IPV6 && mn.addr.IsIPv6())) {
                 nNodeCount++;
         }
 
@@ -418,66 +426,68 @@ void CMasternodeMan::DsegUpdate(CNode* pnode, CConnman& connman)
     LogPrint("masternode", "CMasternodeMan::DsegUpdate -- asked %s for the list\n", pnode->addr.ToString());
 }
 
-CMasternode* CMasternodeMan::Find(const COutPoint &outpoint)
+const CMasternode* CMasternodeMan::Find(const COutPoint &outpoint)
 {
     LOCK(cs);
-    auto it = mapMasternodes.find(outpoint);
-    return it == mapMasternodes.end() ? NULL : &(it->second);
+    return masternodes.Find(outpoint);
+}
+
+CMasternode* CMasternodeMan::FindMutable(const COutPoint &outpoint)
+{
+    LOCK(cs);
+    return masternodes.FindMutable(outpoint);
 }
 
 bool CMasternodeMan::Get(const COutPoint& outpoint, CMasternode& masternodeRet)
 {
     // Theses mutexes are recursive so double locking by the same thread is safe.
     LOCK(cs);
-    auto it = mapMasternodes.find(outpoint);
-    if (it == mapMasternodes.end()) {
+    const CMasternode* pmn = masternodes.Find(outpoint);
+    if (!pmn) {
         return false;
     }
 
-    masternodeRet = it->second;
+    masternodeRet = *pmn;
     return true;
 }
 
 bool CMasternodeMan::GetMasternodeInfo(const COutPoint& outpoint, masternode_info_t& mnInfoRet)
 {
     LOCK(cs);
-    auto it = mapMasternodes.find(outpoint);
-    if (it == mapMasternodes.end()) {
+    const CMasternode* pmn = masternodes.Find(outpoint);
+    if (!pmn) {
         return false;
     }
-    mnInfoRet = it->second.GetInfo();
+    mnInfoRet = pmn->GetInfo();
     return true;
 }
 
 bool CMasternodeMan::GetMasternodeInfo(const CPubKey& pubKeyMasternode, masternode_info_t& mnInfoRet)
 {
     LOCK(cs);
-    for (auto& mnpair : mapMasternodes) {
-        if (mnpair.second.pubKeyMasternode == pubKeyMasternode) {
-            mnInfoRet = mnpair.second.GetInfo();
-            return true;
-        }
+    const CMasternode* pmn = masternodes.FindByPubKey(pubKeyMasternode);
+    if (!pmn) {
+        return false;
     }
-    return false;
+    mnInfoRet = pmn->GetInfo();
+    return true;
 }
 
 bool CMasternodeMan::GetMasternodeInfo(const CScript& payee, masternode_info_t& mnInfoRet)
 {
     LOCK(cs);
-    for (auto& mnpair : mapMasternodes) {
-        CScript scriptCollateralAddress = GetScriptForDestination(mnpair.second.pubKeyCollateralAddress.GetID());
-        if (scriptCollateralAddress == payee) {
-            mnInfoRet = mnpair.second.GetInfo();
-            return true;
-        }
+    const CMasternode* pmn = masternodes.FindByPayee(payee);
+    if (!pmn) {
+        return false;
     }
-    return false;
+    mnInfoRet = pmn->GetInfo();
+    return true;
 }
 
 bool CMasternodeMan::Has(const COutPoint& outpoint)
 {
     LOCK(cs);
-    return mapMasternodes.find(outpoint) != mapMasternodes.end();
+    return masternodes.Find(outpoint) != NULL;
 }
 
 //
@@ -501,7 +511,7 @@ bool CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight, bool f
     // Need LOCK2 here to ensure consistent locking order because the GetBlockHash call below locks cs_main
     LOCK2(cs_main,cs);
 
-    std::vector<std::pair<int, CMasternode*> > vecMasternodeLastPaid;
+    std::vector<std::pair<int, const CMasternode*> > vecMasternodeLastPaid;
 
     /*
         Make a vector with all of the last paid times
@@ -509,22 +519,22 @@ bool CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight, bool f
 
     int nMnCount = CountMasternodes();
 
-    for (auto& mnpair : mapMasternodes) {
-        if(!mnpair.second.IsValidForPayment()) continue;
+    for (const CMasternode& mn : masternodes) {
+        if(!mn.IsValidForPayment()) continue;
 
         //check protocol version
-        if(mnpair.second.nProtocolVersion < mnpayments.GetMinMasternodePaymentsProto()) continue;
+        if(mn.nProtocolVersion < mnpayments.GetMinMasternodePaymentsProto()) continue;
 
         //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
-        if(mnpayments.IsScheduled(mnpair.second, nBlockHeight)) continue;
+        if(mnpayments.IsScheduled(mn, nBlockHeight)) continue;
 
         //it's too new, wait for a cycle
-        if(fFilterSigTime && mnpair.second.sigTime + (nMnCount*2.6*60) > GetAdjustedTime()) continue;
+        if(fFilterSigTime && mn.sigTime + (nMnCount*2.6*60) > GetAdjustedTime()) continue;
 
         //make sure it has at least as many confirmations as there are masternodes
-        if(GetUTXOConfirmations(mnpair.first) < nMnCount) continue;
+        if(GetUTXOConfirmations(mn.vin.prevout) < nMnCount) continue;
 
-        vecMasternodeLastPaid.push_back(std::make_pair(mnpair.second.GetLastPaidBlock(), &mnpair.second));
+        vecMasternodeLastPaid.push_back(std::make_pair(mn.GetLastPaidBlock(), &mn));
     }
 
     nCountRet = (int)vecMasternodeLastPaid.size();
@@ -536,9 +546,9 @@ bool CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight, bool f
     // Sort them low to high
     sort(vecMasternodeLastPaid.begin(), vecMasternodeLastPaid.end(), CompareLastPaidBlock());
 
-    uint256 blockHash;
-    if(!GetBlockHash(blockHash, nBlockHeight - 101)) {
-        LogPrintf("CMasternode::GetNextMasternodeInQueueForPayment -- ERROR: GetBlockHash() failed at nBlockHeight %d\n", nBlockHeight - 101);
+    std::shared_ptr<const CRankTable> pRankTable = GetRankTable(nBlockHeight - 101, mnpayments.GetMinMasternodePaymentsProto());
+    if(!pRankTable) {
+        LogPrintf("CMasternode::GetNextMasternodeInQueueForPayment -- ERROR: no masternode ranks at nBlockHeight %d\n", nBlockHeight - 101);
         return false;
     }
     // Look at 1/10 of the oldest nodes (by last payment), calculate their scores and pay the best one
@@ -546,18 +556,7 @@ bool CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight, bool f
     //  -- 1/100 payments should be a double payment on mainnet - (1/(3000/10))*2
     //  -- (chance per block * chances before IsScheduled will fire)
     int nTenthNetwork = nMnCount/10;
-    int nCountTenth = 0;
-    arith_uint256 nHighest = 0;
-    CMasternode *pBestMasternode = NULL;
-    BOOST_FOREACH (PAIRTYPE(int, CMasternode*)& s, vecMasternodeLastPaid){
-        arith_uint256 nScore = s.second->CalculateScore(blockHash);
-        if(nScore > nHighest){
-            nHighest = nScore;
-            pBestMasternode = s.second;
-        }
-        nCountTenth++;
-        if(nCountTenth >= nTenthNetwork) break;
-    }
+    const CMasternode *pBestMasternode = FindBestRanked(vecMasternodeLastPaid, nTenthNetwork, *pRankTable);
     if (pBestMasternode) {
         mnInfoRet = pBestMasternode->GetInfo();
     }
@@ -577,9 +576,9 @@ masternode_info_t CMasternodeMan::FindRandomNotInVec(const std::vector<COutPoint
     if(nCountNotExcluded < 1) return masternode_info_t();
 
     // fill a vector of pointers
-    std::vector<CMasternode*> vpMasternodesShuffled;
-    for (auto& mnpair : mapMasternodes) {
-        vpMasternodesShuffled.push_back(&mnpair.second);
+    std::vector<const CMasternode*> vpMasternodesShuffled;
+    for (const CMasternode& mn : masternodes) {
+        vpMasternodesShuffled.push_back(&mn);
     }
 
     InsecureRand insecureRand;
@@ -588,7 +587,7 @@ masternode_info_t CMasternodeMan::FindRandomNotInVec(const std::vector<COutPoint
     bool fExclude;
 
     // loop through
-    BOOST_FOREACH(CMasternode* pmn, vpMasternodesShuffled) {
+    BOOST_FOREACH(const CMasternode* pmn, vpMasternodesShuffled) {
         if(pmn->nProtocolVersion < nProtocolVersion || !pmn->IsEnabled()) continue;
         fExclude = false;
         BOOST_FOREACH(const COutPoint &outpointToExclude, vecToExclude) {
@@ -607,59 +606,124 @@ masternode_info_t CMasternodeMan::FindRandomNotInVec(const std::vector<COutPoint
     return masternode_info_t();
 }
 
-bool CMasternodeMan::GetMasternodeScores(const uint256& nBlockHash, CMasternodeMan::score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol)
+std::shared_ptr<CMasternodeMan::CRankTable> CMasternodeMan::CalculateRankTable(const CMasternodeRegistry::masternode_vec_t& vecMasternodes, const uint256& nBlockHash, int nMinProtocol)
 {
-    vecMasternodeScoresRet.clear();
+    score_pair_vec_t vecMasternodeScores;
+    vecMasternodeScores.reserve(vecMasternodes.size());
+    for (const auto& pmn : vecMasternodes) {
+        if (pmn->nProtocolVersion >= nMinProtocol) {
+            vecMasternodeScores.push_back(std::make_pair(pmn->CalculateScore(nBlockHash), pmn.get()));
+        }
+    }
+    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
 
-    if (!masternodeSync.IsMasternodeListSynced())
-        return false;
+    std::shared_ptr<CRankTable> pRankTable = std::make_shared<CRankTable>();
+    pRankTable->nListVersion = 0;
+    pRankTable->vecOutpoints.reserve(vecMasternodeScores.size());
+    pRankTable->mapRanks.reserve(vecMasternodeScores.size());
+    for (auto& scorePair : vecMasternodeScores) {
+        pRankTable->vecOutpoints.push_back(scorePair.second->vin.prevout);
+        pRankTable->mapRanks.emplace(scorePair.second->vin.prevout, (int)pRankTable->vecOutpoints.size());
+    }
+    return pRankTable;
+}
 
-    AssertLockHeld(cs);
+const CMasternode* CMasternodeMan::FindBestRanked(const std::vector<std::pair<int, const CMasternode*> >& vecMasternodes, int nCount, const CRankTable& rankTable)
+{
+    int nChecked = 0;
+    // the highest score has the lowest rank
+    int nBestRank = 0;
+    const CMasternode *pBestMasternode = NULL;
+    BOOST_FOREACH (const PAIRTYPE(int, const CMasternode*)& s, vecMasternodes){
+        auto itRank = rankTable.mapRanks.find(s.second->vin.prevout);
+        if(itRank != rankTable.mapRanks.end() && (!pBestMasternode || itRank->second < nBestRank)){
+            nBestRank = itRank->second;
+            pBestMasternode = s.second;
+        }
+        nChecked++;
+        if(nChecked >= nCount) break;
+    }
+    return pBestMasternode;
+}
 
-    if (mapMasternodes.empty())
-        return false;
+std::shared_ptr<const CMasternodeMan::CRankTable> CMasternodeMan::GetRankTable(const uint256& nBlockHash, int nMinProtocol)
+{
+    const rank_table_key_t key = std::make_pair(nBlockHash, nMinProtocol);
+    CMasternodeRegistry::snapshot_t snapshot;
+    uint64_t nListVersion;
+    {
+        LOCK(cs);
+        auto it = mapRankTables.find(key);
+        if (it != mapRankTables.end() && it->second->nListVersion == masternodes.GetListVersion()) {
+            if (it->second->vecOutpoints.empty())
+                return NULL;
+            return it->second;
+        }
+        snapshot = masternodes.GetSnapshot();
+        nListVersion = masternodes.GetListVersion();
+    }
+
+    std::shared_ptr<CRankTable> pRankTable = CalculateRankTable(*snapshot, nBlockHash, nMinProtocol);
+    pRankTable->nListVersion = nListVersion;
 
-    // calculate scores
-    for (auto& mnpair : mapMasternodes) {
-        if (mnpair.second.nProtocolVersion >= nMinProtocol) {
-            vecMasternodeScoresRet.push_back(std::make_pair(mnpair.second.CalculateScore(nBlockHash), &mnpair.second));
+    {
+        LOCK(cs);
+        // a table for a list that changed while it was calculated is only good for this call
+        if (masternodes.GetListVersion() == nListVersion) {
+            if (!mapRankTables.count(key)) {
+                listRankTableKeys.push_back(key);
+                if (listRankTableKeys.size() > MAX_RANK_TABLES) {
+                    mapRankTables.erase(listRankTableKeys.front());
+                    listRankTableKeys.pop_front();
+                }
+            }
+            mapRankTables[key] = pRankTable;
         }
     }
 
-    sort(vecMasternodeScoresRet.rbegin(), vecMasternodeScoresRet.rend(), CompareScoreMN());
-    return !vecMasternodeScoresRet.empty();
+    if (pRankTable->vecOutpoints.empty())
+        return NULL;
+    return pRankTable;
 }
 
-bool CMasternodeMan::GetMasternodeRank(const COutPoint& outpoint, int& nRankRet, int nBlockHeight, int nMinProtocol)
+std::shared_ptr<const CMasternodeMan::CRankTable> CMasternodeMan::GetRankTable(int nBlockHeight, int nMinProtocol)
 {
-    nRankRet = -1;
-
-    if (!masternodeSync.IsMasternodeListSynced())
-        return false;
-
     // make sure we know about this block
     uint256 nBlockHash = uint256();
     if (!GetBlockHash(nBlockHash, nBlockHeight)) {
         LogPrintf("CMasternodeMan::%s -- ERROR: GetBlockHash() failed at nBlockHeight %d\n", __func__, nBlockHeight);
-        return false;
+        return NULL;
     }
 
-    LOCK(cs);
+    {
+        LOCK(cs);
+        // remember how far below the tip ranks are needed, UpdatedBlockTip calculates them in advance
+        int nOffset = nBlockHeight < 0 ? 0 : nCachedBlockHeight - nBlockHeight;
+        if (nOffset >= 0) {
+            setRankOffsets.insert(std::make_pair(nOffset, nMinProtocol));
+        }
+    }
 
-    score_pair_vec_t vecMasternodeScores;
-    if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
+    return GetRankTable(nBlockHash, nMinProtocol);
+}
+
+bool CMasternodeMan::GetMasternodeRank(const COutPoint& outpoint, int& nRankRet, int nBlockHeight, int nMinProtocol)
+{
+    nRankRet = -1;
+
+    if (!masternodeSync.IsMasternodeListSynced())
         return false;
 
-    int nRank = 0;
-    for (auto& scorePair : vecMasternodeScores) {
-        nRank++;
-        if(scorePair.second->vin.prevout == outpoint) {
-            nRankRet = nRank;
-            return true;
-        }
-    }
+    std::shared_ptr<const CRankTable> pRankTable = GetRankTable(nBlockHeight, nMinProtocol);
+    if (!pRankTable)
+        return false;
 
-    return false;
+    auto it = pRankTable->mapRanks.find(outpoint);
+    if (it == pRankTable->mapRanks.end())
+        return false;
+
+    nRankRet = it->second;
+    return true;
 }
 
 bool CMasternodeMan::GetMasternodeRanks(CMasternodeMan::rank_pair_vec_t& vecMasternodeRanksRet, int nBlockHeight, int nMinProtocol)
@@ -669,23 +733,19 @@ bool CMasternodeMan::GetMasternodeRanks(CMasternodeMan::rank_pair_vec_t& vecMast
     if (!masternodeSync.IsMasternodeListSynced())
         return false;
 
-    // make sure we know about this block
-    uint256 nBlockHash = uint256();
-    if (!GetBlockHash(nBlockHash, nBlockHeight)) {
-        LogPrintf("CMasternodeMan::%s -- ERROR: GetBlockHash() failed at nBlockHeight %d\n", __func__, nBlockHeight);
+    std::shared_ptr<const CRankTable> pRankTable = GetRankTable(nBlockHeight, nMinProtocol);
+    if (!pRankTable)
         return false;
-    }
 
     LOCK(cs);
 
-    score_pair_vec_t vecMasternodeScores;
-    if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
-        return false;
-
-    int nRank = 0;
-    for (auto& scorePair : vecMasternodeScores) {
-        nRank++;
-        vecMasternodeRanksRet.push_back(std::make_pair(nRank, *scorePair.second));
+    vecMasternodeRanksRet.reserve(pRankTable->vecOutpoints.size());
+    for (size_t i = 0; i < pRankTable->vecOutpoints.size(); i++) {
+        // skip masternodes removed since the table was calculated
+        std::shared_ptr<const CMasternode> pmn = masternodes.FindShared(pRankTable->vecOutpoints[i]);
+        if (pmn) {
+            vecMasternodeRanksRet.push_back(std::make_pair((int)i + 1, pmn));
+        }
     }
 
     return true;
@@ -698,32 +758,18 @@ bool CMasternodeMan::GetMasternodeByRank(int nRankIn, masternode_info_t& mnInfoR
     if (!masternodeSync.IsMasternodeListSynced())
         return false;
 
-    // make sure we know about this block
-    uint256 nBlockHash = uint256();
-    if (!GetBlockHash(nBlockHash, nBlockHeight)) {
-        LogPrintf("CMasternodeMan::%s -- ERROR: GetBlockHash() failed at nBlockHeight %d\n", __func__, nBlockHeight);
+    std::shared_ptr<const CRankTable> pRankTable = GetRankTable(nBlockHeight, nMinProtocol);
+    if (!pRankTable || nRankIn < 1 || nRankIn > (int)pRankTable->vecOutpoints.size())
         return false;
-    }
 
     LOCK(cs);
 
-    score_pair_vec_t vecMasternodeScores;
-    if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
+    const CMasternode* pmn = masternodes.Find(pRankTable->vecOutpoints[nRankIn - 1]);
+    if (!pmn)
         return false;
 
-    if (vecMasternodeScores.size() < nRankIn)
-        return false;
-
-    int nRank = 0;
-    for (auto& scorePair : vecMasternodeScores) {
-        nRank++;
-        if(nRank == nRankIn) {
-            mnInfoRet = *scorePair.second;
-            return true;
-        }
-    }
-
-    return false;
+    mnInfoRet = *pmn;
+    return true;
 }
 
 void CMasternodeMan::ProcessMasternodeConnections(CConnman& connman)
@@ -806,6 +852,15 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
 
         LogPrint("masternode", "MNPING -- Masternode ping, masternode=%s\n", mnp.vin.prevout.ToStringShort());
 
+        // Verify the signature before taking cs_main, so pings of different peers
+        // are checked in parallel on the message processing pool. CheckAndUpdate
+        // below then finds the signature in the DEX verifier signature cache.
+        masternode_info_t infoMn;
+        if(GetMasternodeInfo(mnp.vin.prevout, infoMn)) {
+            int nDosIgnored;
+            mnp.CheckSignature(infoMn.pubKeyMasternode, nDosIgnored);
+        }
+
         // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
         LOCK2(cs_main, cs);
 
@@ -815,7 +870,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
         LogPrint("masternode", "MNPING -- Masternode ping, masternode=%s new\n", mnp.vin.prevout.ToStringShort());
 
         // see if we have this Masternode
-        CMasternode* pmn = Find(mnp.vin.prevout);
+        CMasternode* pmn = FindMutable(mnp.vin.prevout);
 
         // if masternode uses sentinel ping instead of watchdog
         // we shoud update nTimeLastWatchdogVote here if sentinel
@@ -872,23 +927,23 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
 
         int nInvCount = 0;
 
-        for (auto& mnpair : mapMasternodes) {
-            if (vin != CTxIn() && vin != mnpair.second.vin) continue; // asked for specific vin but we are not there yet
-            if (mnpair.second.addr.IsRFC1918() || mnpair.second.addr.IsLocal()) continue; // do not send local network masternode
-            if (mnpair.second.IsUpdateRequired()) continue; // do not send outdated masternodes
+        for (const CMasternode& mn : masternodes) {
+            if (vin != CTxIn() && vin != mn.vin) continue; // asked for specific vin but we are not there yet
+            if (mn.addr.IsRFC1918() || mn.addr.IsLocal()) continue; // do not send local network masternode
+            if (mn.IsUpdateRequired()) continue; // do not send outdated masternodes
 
-            LogPrint("masternode", "DSEG -- Sending Masternode entry: masternode=%s  addr=%s\n", mnpair.first.ToStringShort(), mnpair.second.addr.ToString());
-            CMasternodeBroadcast mnb = CMasternodeBroadcast(mnpair.second);
+            LogPrint("masternode", "DSEG -- Sending Masternode entry: masternode=%s  addr=%s\n", mn.vin.prevout.ToStringShort(), mn.addr.ToString());
+            CMasternodeBroadcast mnb = CMasternodeBroadcast(mn);
             uint256 hash = mnb.GetHash();
             pfrom->PushInventory(CInv(MSG_MASTERNODE_ANNOUNCE, hash));
-            pfrom->PushInventory(CInv(MSG_MASTERNODE_PING, mnpair.second.lastPing.GetHash()));
+            pfrom->PushInventory(CInv(MSG_MASTERNODE_PING, mn.lastPing.GetHash()));
             nInvCount++;
 
             if (!mapSeenMasternodeBroadcast.count(hash)) {
                 mapSeenMasternodeBroadcast.insert(std::make_pair(hash, std::make_pair(GetTime(), mnb)));
             }
 
-            if (vin.prevout == mnpair.first) {
+            if (vin.prevout == mn.vin.prevout) {
                 LogPrintf("DSEG -- Sent 1 Masternode inv to peer %d\n", pfrom->id);
                 return;
             }
@@ -943,14 +998,14 @@ void CMasternodeMan::DoFullVerificationStep(CConnman& connman)
     int nRanksTotal = (int)vecMasternodeRanks.size();
 
     // send verify requests only if we are in top MAX_POSE_RANK
-    std::vector<std::pair<int, CMasternode> >::iterator it = vecMasternodeRanks.begin();
+    rank_pair_vec_t::iterator it = vecMasternodeRanks.begin();
     while(it != vecMasternodeRanks.end()) {
         if(it->first > MAX_POSE_RANK) {
             LogPrint("masternode", "CMasternodeMan::DoFullVerificationStep -- Must be in top %d to send verify request\n",
                         (int)MAX_POSE_RANK);
             return;
         }
-        if(it->second.vin.prevout == activeMasternode.outpoint) {
+        if(it->second->vin.prevout == activeMasternode.outpoint) {
             nMyRank = it->first;
             LogPrint("masternode", "CMasternodeMan::DoFullVerificationStep -- Found self at rank %d/%d, verifying up to %d masternodes\n",
                         nMyRank, nRanksTotal, (int)MAX_POSE_CONNECTIONS);
@@ -967,29 +1022,29 @@ void CMasternodeMan::DoFullVerificationStep(CConnman& connman)
     int nOffset = MAX_POSE_RANK + nMyRank - 1;
     if(nOffset >= (int)vecMasternodeRanks.size()) return;
 
-    std::vector<CMasternode*> vSortedByAddr;
-    for (auto& mnpair : mapMasternodes) {
-        vSortedByAddr.push_back(&mnpair.second);
+    std::vector<const CMasternode*> vSortedByAddr;
+    for (const CMasternode& mn : masternodes) {
+        vSortedByAddr.push_back(&mn);
     }
 
     sort(vSortedByAddr.begin(), vSortedByAddr.end(), CompareByAddr());
 
     it = vecMasternodeRanks.begin() + nOffset;
     while(it != vecMasternodeRanks.end()) {
-        if(it->second.IsPoSeVerified() || it->second.IsPoSeBanned()) {
+        if(it->second->IsPoSeVerified() || it->second->IsPoSeBanned()) {
             LogPrint("masternode", "CMasternodeMan::DoFullVerificationStep -- Already %s%s%s masternode %s address %s, skipping...\n",
-                        it->second.IsPoSeVerified() ? "verified" : "",
-                        it->second.IsPoSeVerified() && it->second.IsPoSeBanned() ? " and " : "",
-                        it->second.IsPoSeBanned() ? "banned" : "",
-                        it->second.vin.prevout.ToStringShort(), it->second.addr.ToString());
+                        it->second->IsPoSeVerified() ? "verified" : "",
+                        it->second->IsPoSeVerified() && it->second->IsPoSeBanned() ? " and " : "",
+                        it->second->IsPoSeBanned() ? "banned" : "",
+                        it->second->vin.prevout.ToStringShort(), it->second->addr.ToString());
             nOffset += MAX_POSE_CONNECTIONS;
             if(nOffset >= (int)vecMasternodeRanks.size()) break;
             it += MAX_POSE_CONNECTIONS;
             continue;
         }
         LogPrint("masternode", "CMasternodeMan::DoFullVerificationStep -- Verifying masternode %s rank %d/%d address %s\n",
-                    it->second.vin.prevout.ToStringShort(), it->first, nRanksTotal, it->second.addr.ToString());
-        if(SendVerifyRequest(CAddress(it->second.addr, NODE_NETWORK), vSortedByAddr, connman)) {
+                    it->second->vin.prevout.ToStringShort(), it->first, nRanksTotal, it->second->addr.ToString());
+        if(SendVerifyRequest(CAddress(it->second->addr, NODE_NETWORK), vSortedByAddr, connman)) {
             nCount++;
             if(nCount >= MAX_POSE_CONNECTIONS) break;
         }
@@ -1008,24 +1063,24 @@ void CMasternodeMan::DoFullVerificationStep(CConnman& connman)
 
 void CMasternodeMan::CheckSameAddr()
 {
-    if(!masternodeSync.IsSynced() || mapMasternodes.empty()) return;
+    if(!masternodeSync.IsSynced() || masternodes.empty()) return;
 
-    std::vector<CMasternode*> vBan;
-    std::vector<CMasternode*> vSortedByAddr;
+    std::vector<const CMasternode*> vBan;
+    std::vector<const CMasternode*> vSortedByAddr;
 
-    {
-        LOCK(cs);
+    LOCK(cs);
 
-        CMasternode* pprevMasternode = NULL;
-        CMasternode* pverifiedMasternode = NULL;
+    {
+        const CMasternode* pprevMasternode = NULL;
+        const CMasternode* pverifiedMasternode = NULL;
 
-        for (auto& mnpair : mapMasternodes) {
-            vSortedByAddr.push_back(&mnpair.second);
+        for (const CMasternode& mn : masternodes) {
+            vSortedByAddr.push_back(&mn);
         }
 
         sort(vSortedByAddr.begin(), vSortedByAddr.end(), CompareByAddr());
 
-        BOOST_FOREACH(CMasternode* pmn, vSortedByAddr) {
+        BOOST_FOREACH(const CMasternode* pmn, vSortedByAddr) {
             // check only (pre)enabled masternodes
             if(!pmn->IsEnabled() && !pmn->IsPreEnabled()) continue;
             // initial step
@@ -1052,14 +1107,18 @@ void CMasternodeMan::CheckSameAddr()
         }
     }
 
-    // ban duplicates
-    BOOST_FOREACH(CMasternode* pmn, vBan) {
-        LogPrintf("CMasternodeMan::CheckSameAddr -- increasing PoSe ban score for masternode %s\n", pmn->vin.prevout.ToStringShort());
-        pmn->IncreasePoSeBanScore();
+    // ban duplicates, by outpoint as changing an entry may copy it
+    std::vector<COutPoint> vecOutpointsToBan;
+    BOOST_FOREACH(const CMasternode* pmn, vBan) {
+        vecOutpointsToBan.push_back(pmn->vin.prevout);
+    }
+    BOOST_FOREACH(const COutPoint& outpoint, vecOutpointsToBan) {
+        LogPrintf("CMasternodeMan::CheckSameAddr -- increasing PoSe ban score for masternode %s\n", outpoint.ToStringShort());
+        FindMutable(outpoint)->IncreasePoSeBanScore();
     }
 }
 
-bool CMasternodeMan::SendVerifyRequest(const CAddress& addr, const std::vector<CMasternode*>& vSortedByAddr, CConnman& connman)
+bool CMasternodeMan::SendVerifyRequest(const CAddress& addr, const std::vector<const CMasternode*>& vSortedByAddr, CConnman& connman)
 {
     if(netfulfilledman.HasFulfilledRequest(addr, strprintf("%s", NetMsgType::MNVERIFY)+"-request")) {
         // we already asked for verification, not a good idea to do this too often, skip it
@@ -1170,43 +1229,48 @@ void CMasternodeMan::ProcessVerifyReply(CNode* pnode, CMasternodeVerification& m
         CMasternode* prealMasternode = NULL;
         std::vector<CMasternode*> vpMasternodesToBan;
         std::string strMessage1 = strprintf("%s%d%s", pnode->addr.ToString(false), mnv.nonce, blockHash.ToString());
-        for (auto& mnpair : mapMasternodes) {
-            if(CAddress(mnpair.second.addr, NODE_NETWORK) == pnode->addr) {
-                if(CMessageSigner::VerifyMessage(mnpair.second.pubKeyMasternode, mnv.vchSig1, strMessage1, strError)) {
-                    // found it!
-                    prealMasternode = &mnpair.second;
-                    if(!mnpair.second.IsPoSeVerified()) {
-                        mnpair.second.DecreasePoSeBanScore();
-                    }
-                    netfulfilledman.AddFulfilledRequest(pnode->addr, strprintf("%s", NetMsgType::MNVERIFY)+"-done");
-
-                    // we can only broadcast it if we are an activated masternode
-                    if(activeMasternode.outpoint == COutPoint()) continue;
-                    // update ...
-                    mnv.addr = mnpair.second.addr;
-                    mnv.vin1 = mnpair.second.vin;
-                    mnv.vin2 = CTxIn(activeMasternode.outpoint);
-                    std::string strMessage2 = strprintf("%s%d%s%s%s", mnv.addr.ToString(false), mnv.nonce, blockHash.ToString(),
-                                            mnv.vin1.prevout.ToStringShort(), mnv.vin2.prevout.ToStringShort());
-                    // ... and sign it
-                    if(!CMessageSigner::SignMessage(strMessage2, mnv.vchSig2, activeMasternode.keyMasternode)) {
-                        LogPrintf("MasternodeMan::ProcessVerifyReply -- SignMessage() failed\n");
-                        return;
-                    }
+        // outpoints first, FindMutable below may copy the entries the address index points to
+        std::vector<COutPoint> vecOutpointsSameAddr;
+        BOOST_FOREACH(const CMasternode* pmn, masternodes.FindByAddr(pnode->addr)) {
+            vecOutpointsSameAddr.push_back(pmn->vin.prevout);
+        }
+        std::sort(vecOutpointsSameAddr.begin(), vecOutpointsSameAddr.end());
+        BOOST_FOREACH(const COutPoint& outpoint, vecOutpointsSameAddr) {
+            CMasternode* pmn = FindMutable(outpoint);
+            if(CMessageSigner::VerifyMessage(pmn->pubKeyMasternode, mnv.vchSig1, strMessage1, strError)) {
+                // found it!
+                prealMasternode = pmn;
+                if(!pmn->IsPoSeVerified()) {
+                    pmn->DecreasePoSeBanScore();
+                }
+                netfulfilledman.AddFulfilledRequest(pnode->addr, strprintf("%s", NetMsgType::MNVERIFY)+"-done");
+
+                // we can only broadcast it if we are an activated masternode
+                if(activeMasternode.outpoint == COutPoint()) continue;
+                // update ...
+                mnv.addr = pmn->addr;
+                mnv.vin1 = pmn->vin;
+                mnv.vin2 = CTxIn(activeMasternode.outpoint);
+                std::string strMessage2 = strprintf("%s%d%s%s%s", mnv.addr.ToString(false), mnv.nonce, blockHash.ToString(),
+                                        mnv.vin1.prevout.ToStringShort(), mnv.vin2.prevout.ToStringShort());
+                // ... and sign it
+                if(!CMessageSigner::SignMessage(strMessage2, mnv.vchSig2, activeMasternode.keyMasternode)) {
+                    LogPrintf("MasternodeMan::ProcessVerifyReply -- SignMessage() failed\n");
+                    return;
+                }
 
-                    std::string strError;
+                std::string strError;
 
-                    if(!CMessageSigner::VerifyMessage(activeMasternode.pubKeyMasternode, mnv.vchSig2, strMessage2, strError)) {
-                        LogPrintf("MasternodeMan::ProcessVerifyReply -- VerifyMessage() failed, error: %s\n", strError);
-                        return;
-                    }
+                if(!CMessageSigner::VerifyMessage(activeMasternode.pubKeyMasternode, mnv.vchSig2, strMessage2, strError)) {
+                    LogPrintf("MasternodeMan::ProcessVerifyReply -- VerifyMessage() failed, error: %s\n", strError);
+                    return;
+                }
 
-                    mWeAskedForVerification[pnode->addr] = mnv;
-                    mnv.Relay();
+                mWeAskedForVerification[pnode->addr] = mnv;
+                mnv.Relay();
 
-                } else {
-                    vpMasternodesToBan.push_back(&mnpair.second);
-                }
+            } else {
+                vpMasternodesToBan.push_back(pmn);
             }
         }
         // no real masternode found?...
@@ -1284,13 +1348,13 @@ void CMasternodeMan::ProcessVerifyBroadcast(CNode* pnode, const CMasternodeVerif
         std::string strMessage2 = strprintf("%s%d%s%s%s", mnv.addr.ToString(false), mnv.nonce, blockHash.ToString(),
                                 mnv.vin1.prevout.ToStringShort(), mnv.vin2.prevout.ToStringShort());
 
-        CMasternode* pmn1 = Find(mnv.vin1.prevout);
+        const CMasternode* pmn1 = Find(mnv.vin1.prevout);
         if(!pmn1) {
             LogPrintf("CMasternodeMan::ProcessVerifyBroadcast -- can't find masternode1 %s\n", mnv.vin1.prevout.ToStringShort());
             return;
         }
 
-        CMasternode* pmn2 = Find(mnv.vin2.prevout);
+        const CMasternode* pmn2 = Find(mnv.vin2.prevout);
         if(!pmn2) {
             LogPrintf("CMasternodeMan::ProcessVerifyBroadcast -- can't find masternode2 %s\n", mnv.vin2.prevout.ToStringShort());
             return;
@@ -1312,21 +1376,26 @@ void CMasternodeMan::ProcessVerifyBroadcast(CNode* pnode, const CMasternodeVerif
         }
 
         if(!pmn1->IsPoSeVerified()) {
-            pmn1->DecreasePoSeBanScore();
+            FindMutable(mnv.vin1.prevout)->DecreasePoSeBanScore();
         }
         mnv.Relay();
 
         LogPrintf("CMasternodeMan::ProcessVerifyBroadcast -- verified masternode %s for addr %s\n",
-                    pmn1->vin.prevout.ToStringShort(), pnode->addr.ToString());
+                    mnv.vin1.prevout.ToStringShort(), pnode->addr.ToString());
 
         // increase ban score for everyone else with the same addr
         int nCount = 0;
-        for (auto& mnpair : mapMasternodes) {
-            if(mnpair.second.addr != mnv.addr || mnpair.first == mnv.vin1.prevout) continue;
-            mnpair.second.IncreasePoSeBanScore();
+        std::vector<COutPoint> vecOutpointsSameAddr;
+        BOOST_FOREACH(const CMasternode* pmn, masternodes.FindByAddr(mnv.addr)) {
+            if(pmn->vin.prevout == mnv.vin1.prevout) continue;
+            vecOutpointsSameAddr.push_back(pmn->vin.prevout);
+        }
+        BOOST_FOREACH(const COutPoint& outpoint, vecOutpointsSameAddr) {
+            CMasternode* pmn = FindMutable(outpoint);
+            pmn->IncreasePoSeBanScore();
             nCount++;
             LogPrint("masternode", "CMasternodeMan::ProcessVerifyBroadcast -- increased PoSe ban score for %s addr %s, new score %d\n",
-                        mnpair.first.ToStringShort(), mnpair.second.addr.ToString(), mnpair.second.nPoSeBanScore);
+                        outpoint.ToStringShort(), pmn->addr.ToString(), pmn->nPoSeBanScore);
         }
         LogPrintf("CMasternodeMan::ProcessVerifyBroadcast -- PoSe score incresed for %d fake masternodes, addr %s\n",
                     nCount, pnode->addr.ToString());
@@ -1337,7 +1406,7 @@ std::string CMasternodeMan::ToString() const
 {
     std::ostringstream info;
 
-    info << "Masternodes: " << (int)mapMasternodes.size() <<
+    info << "Masternodes: " << (int)masternodes.size() <<
             ", peers who asked us for Masternode list: " << (int)mAskedUsForMasternodeList.size() <<
             ", peers we asked for Masternode list: " << (int)mWeAskedForMasternodeList.size() <<
             ", entries in Masternode list we asked for: " << (int)mWeAskedForMasternodeListEntry.size() <<
@@ -1354,14 +1423,16 @@ void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast mnb, CConnman& co
 
     LogPrintf("CMasternodeMan::UpdateMasternodeList -- masternode=%s  addr=%s\n", mnb.vin.prevout.ToStringShort(), mnb.addr.ToString());
 
-    CMasternode* pmn = Find(mnb.vin.prevout);
+    CMasternode* pmn = FindMutable(mnb.vin.prevout);
     if(pmn == NULL) {
         if(Add(mnb)) {
             masternodeSync.BumpAssetLastTime("CMasternodeMan::UpdateMasternodeList - new");
         }
     } else {
         CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
-        if(pmn->UpdateFromNewBroadcast(mnb, connman)) {
+        bool fUpdated = pmn->UpdateFromNewBroadcast(mnb, connman);
+        masternodes.Reindex(mnb.vin.prevout);
+        if(fUpdated) {
             masternodeSync.BumpAssetLastTime("CMasternodeMan::UpdateMasternodeList - seen");
             mapSeenMasternodeBroadcast.erase(mnbOld.GetHash());
         }
@@ -1420,10 +1491,13 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
         }
 
         // search Masternode list
-        CMasternode* pmn = Find(mnb.vin.prevout);
+        CMasternode* pmn = FindMutable(mnb.vin.prevout);
         if(pmn) {
             CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
-            if(!mnb.Update(pmn, nDos, connman)) {
+            bool fUpdated = mnb.Update(pmn, nDos, connman);
+            // the broadcast may have changed the pubkey and address of the entry
+            masternodes.Reindex(mnb.vin.prevout);
+            if(!fUpdated) {
                 LogPrint("masternode", "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- Update() failed, masternode=%s\n", mnb.vin.prevout.ToStringShort());
                 return false;
             }
@@ -1465,7 +1539,7 @@ void CMasternodeMan::UpdateLastPaid(const CBlockIndex* pindex)
 {
     LOCK(cs);
 
-    if(fLiteMode || !masternodeSync.IsWinnersListSynced() || mapMasternodes.empty()) return;
+    if(fLiteMode || !masternodeSync.IsWinnersListSynced() || masternodes.empty()) return;
 
     static bool IsFirstRun = true;
     // Do full scan on first run or if we are not a masternode
@@ -1475,9 +1549,9 @@ void CMasternodeMan::UpdateLastPaid(const CBlockIndex* pindex)
     // LogPrint("mnpayments", "CMasternodeMan::UpdateLastPaid -- nHeight=%d, nMaxBlocksToScanBack=%d, IsFirstRun=%s\n",
     //                         nCachedBlockHeight, nMaxBlocksToScanBack, IsFirstRun ? "true" : "false");
 
-    for (auto& mnpair: mapMasternodes) {
-        mnpair.second.UpdateLastPaid(pindex, nMaxBlocksToScanBack);
-    }
+    masternodes.ForEachMutable([pindex, nMaxBlocksToScanBack](CMasternode& mn) {
+        mn.UpdateLastPaid(pindex, nMaxBlocksToScanBack);
+    });
 
     IsFirstRun = false;
 }
@@ -1485,7 +1559,7 @@ void CMasternodeMan::UpdateLastPaid(const CBlockIndex* pindex)
 void CMasternodeMan::UpdateWatchdogVoteTime(const COutPoint& outpoint, uint64_t nVoteTime)
 {
     LOCK(cs);
-    CMasternode* pmn = Find(outpoint);
+    CMasternode* pmn = FindMutable(outpoint);
     if(!pmn) {
         return;
     }
@@ -1503,7 +1577,7 @@ bool CMasternodeMan::IsWatchdogActive()
 bool CMasternodeMan::AddGovernanceVote(const COutPoint& outpoint, uint256 nGovernanceObjectHash)
 {
     LOCK(cs);
-    CMasternode* pmn = Find(outpoint);
+    CMasternode* pmn = FindMutable(outpoint);
     if(!pmn) {
         return false;
     }
@@ -1514,33 +1588,32 @@ bool CMasternodeMan::AddGovernanceVote(const COutPoint& outpoint, uint256 nGover
 void CMasternodeMan::RemoveGovernanceObject(uint256 nGovernanceObjectHash)
 {
     LOCK(cs);
-    for(auto& mnpair : mapMasternodes) {
-        mnpair.second.RemoveGovernanceObject(nGovernanceObjectHash);
-    }
+    masternodes.ForEachMutable([&nGovernanceObjectHash](CMasternode& mn) {
+        mn.RemoveGovernanceObject(nGovernanceObjectHash);
+    });
 }
 
 void CMasternodeMan::CheckMasternode(const CPubKey& pubKeyMasternode, bool fForce)
 {
     LOCK(cs);
-    for (auto& mnpair : mapMasternodes) {
-        if (mnpair.second.pubKeyMasternode == pubKeyMasternode) {
-            mnpair.second.Check(fForce);
-            return;
-        }
+    const CMasternode* pmn = masternodes.FindByPubKey(pubKeyMasternode);
+    if (!pmn) {
+        return;
     }
+    FindMutable(pmn->vin.prevout)->Check(fForce);
 }
 
 bool CMasternodeMan::IsMasternodePingedWithin(const COutPoint& outpoint, int nSeconds, int64_t nTimeToCheckAt)
 {
     LOCK(cs);
-    CMasternode* pmn = Find(outpoint);
+    const CMasternode* pmn = Find(outpoint);
     return pmn ? pmn->IsPingedWithin(nSeconds, nTimeToCheckAt) : false;
 }
 
 void CMasternodeMan::SetMasternodeLastPing(const COutPoint& outpoint, const CMasternodePing& mnp)
 {
     LOCK(cs);
-    CMasternode* pmn = Find(outpoint);
+    CMasternode* pmn = FindMutable(outpoint);
     if(!pmn) {
         return;
     }
@@ -1557,6 +1630,7 @@ void CMasternodeMan::SetMasternodeLastPing(const COutPoint& outpoint, const CMas
     uint256 hash = mnb.GetHash();
     if(mapSeenMasternodeBroadcast.count(hash)) {
         mapSeenMasternodeBroadcast[hash].second.lastPing = mnp;
+        ForgetRelayMessage(CInv(MSG_MASTERNODE_ANNOUNCE, hash));
     }
 }
 
@@ -1571,6 +1645,31 @@ void CMasternodeMan::UpdatedBlockTip(const CBlockIndex *pindex)
         // normal wallet does not need to update this every block, doing update on rpc call should be enough
         UpdateLastPaid(pindex);
     }
+
+    // ranks asked for after the last block will likely be asked for again, calculate
+    // them now instead of in whichever thread needs them first. The ones also asked
+    // for after the block before go first, the others may have been one-off requests.
+    std::vector<std::pair<int, int> > vecRankOffsets;
+    {
+        LOCK(cs);
+        std::set_intersection(setRankOffsets.begin(), setRankOffsets.end(),
+                              setRankOffsetsPrev.begin(), setRankOffsetsPrev.end(),
+                              std::back_inserter(vecRankOffsets));
+        std::set_difference(setRankOffsets.begin(), setRankOffsets.end(),
+                            setRankOffsetsPrev.begin(), setRankOffsetsPrev.end(),
+                            std::back_inserter(vecRankOffsets));
+        setRankOffsetsPrev.swap(setRankOffsets);
+        setRankOffsets.clear();
+    }
+
+    if(!masternodeSync.IsMasternodeListSynced()) return;
+
+    for(size_t i = 0; i < vecRankOffsets.size() && i < MAX_RANK_TABLES_WARMED; i++) {
+        const CBlockIndex* pindexRank = pindex->GetAncestor(pindex->nHeight - vecRankOffsets[i].first);
+        if(pindexRank) {
+            GetRankTable(pindexRank->GetBlockHash(), vecRankOffsets[i].second);
+        }
+    }
 }
 
 void CMasternodeMan::NotifyMasternodeUpdates(CConnman& connman)
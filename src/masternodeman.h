@@ -7,6 +7,7 @@
 #define MASTERNODEMAN_H
 
 #include "masternode.h"
+#include "masternoderegistry.h"
 #include "sync.h"
 
 using namespace std;
@@ -19,11 +20,26 @@ extern CMasternodeMan mnodeman;
 class CMasternodeMan
 {
 public:
-    typedef std::pair<arith_uint256, CMasternode*> score_pair_t;
+    typedef std::pair<arith_uint256, const CMasternode*> score_pair_t;
     typedef std::vector<score_pair_t> score_pair_vec_t;
-    typedef std::pair<int, CMasternode> rank_pair_t;
+    typedef std::pair<int, std::shared_ptr<const CMasternode> > rank_pair_t;
     typedef std::vector<rank_pair_t> rank_pair_vec_t;
 
+    /// Masternodes sorted by score for one block, highest first
+    struct CRankTable
+    {
+        // list version the scores were calculated for
+        uint64_t nListVersion;
+        // vecOutpoints[nRank - 1] is the masternode of rank nRank
+        std::vector<COutPoint> vecOutpoints;
+        std::unordered_map<COutPoint, int, CMasternodeRegistry::CSaltedHasher> mapRanks;
+    };
+
+    /// Rank the masternodes of a snapshot with at least nMinProtocol by their score at a block
+    static std::shared_ptr<CRankTable> CalculateRankTable(const CMasternodeRegistry::masternode_vec_t& vecMasternodes, const uint256& nBlockHash, int nMinProtocol);
+    /// The best ranked of the first nCount (at least one) masternodes of vecMasternodes, NULL if none is ranked
+    static const CMasternode* FindBestRanked(const std::vector<std::pair<int, const CMasternode*> >& vecMasternodes, int nCount, const CRankTable& rankTable);
+
 private:
     static const std::string SERIALIZATION_VERSION_STRING;
 
@@ -42,6 +58,9 @@ private:
     static const int MNB_RECOVERY_WAIT_SECONDS      = 60;
     static const int MNB_RECOVERY_RETRY_SECONDS     = 3 * 60 * 60;
 
+    static const int MAX_RANK_TABLES                = 16;
+    static const int MAX_RANK_TABLES_WARMED         = 4;
+
 
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -49,8 +68,8 @@ private:
     // Keep track of current block height
     int nCachedBlockHeight;
 
-    // map to hold all MNs
-    std::map<COutPoint, CMasternode> mapMasternodes;
+    // all MNs, indexed by outpoint, pubkey, payee and address
+    CMasternodeRegistry masternodes;
     // who's asked for the Masternode list and the last time
     std::map<CNetAddr, int64_t> mAskedUsForMasternodeList;
     // who we asked for the Masternode list and the last time
@@ -75,11 +94,29 @@ private:
 
     int64_t nLastWatchdogVoteTime;
 
+    typedef std::pair<uint256, int> rank_table_key_t;
+
+    // rank tables by block hash and min protocol, the oldest ones first in listRankTableKeys
+    std::map<rank_table_key_t, std::shared_ptr<const CRankTable> > mapRankTables;
+    std::list<rank_table_key_t> listRankTableKeys;
+    // which tables were asked for since the last block and the one before, by blocks below the tip and min protocol
+    std::set<std::pair<int, int> > setRankOffsets;
+    std::set<std::pair<int, int> > setRankOffsetsPrev;
+
     friend class CMasternodeSync;
-    /// Find an entry
-    CMasternode* Find(const COutPoint& outpoint);
+    /// Find an entry to read it, the pointer is only valid until the next write to the list
+    const CMasternode* Find(const COutPoint& outpoint);
+    /// Find an entry to change it, copying it first if a snapshot may still use it
+    CMasternode* FindMutable(const COutPoint& outpoint);
 
-    bool GetMasternodeScores(const uint256& nBlockHash, score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol = 0);
+    /**
+     * Get the ranks of all masternodes with at least nMinProtocol at a block. Tables are
+     * calculated once per list version and block, from a snapshot of the list. cs is only
+     * released meanwhile if the caller does not hold it, the payment queue and
+     * CheckAndRemove do. Returns NULL when no masternode qualifies.
+     */
+    std::shared_ptr<const CRankTable> GetRankTable(const uint256& nBlockHash, int nMinProtocol);
+    std::shared_ptr<const CRankTable> GetRankTable(int nBlockHeight, int nMinProtocol);
 
 public:
     // Keep track of all broadcasts I've seen
@@ -106,7 +143,7 @@ public:
             READWRITE(strVersion);
         }
 
-        READWRITE(mapMasternodes);
+        READWRITE(masternodes);
         READWRITE(mAskedUsForMasternodeList);
         READWRITE(mWeAskedForMasternodeList);
         READWRITE(mWeAskedForMasternodeListEntry);
@@ -174,7 +211,8 @@ public:
     /// Find a random entry
     masternode_info_t FindRandomNotInVec(const std::vector<COutPoint> &vecToExclude, int nProtocolVersion = -1);
 
-    std::map<COutPoint, CMasternode> GetFullMasternodeMap() { return mapMasternodes; }
+    /// Immutable copy of the list sorted by outpoint, cheap to take and safe to read without any lock
+    CMasternodeRegistry::snapshot_t GetMasternodeSnapshot() { LOCK(cs); return masternodes.GetSnapshot(); }
 
     bool GetMasternodeRanks(rank_pair_vec_t& vecMasternodeRanksRet, int nBlockHeight = -1, int nMinProtocol = 0);
     bool GetMasternodeRank(const COutPoint &outpoint, int& nRankRet, int nBlockHeight = -1, int nMinProtocol = 0);
@@ -187,13 +225,13 @@ public:
 
     void DoFullVerificationStep(CConnman& connman);
     void CheckSameAddr();
-    bool SendVerifyRequest(const CAddress& addr, const std::vector<CMasternode*>& vSortedByAddr, CConnman& connman);
+    bool SendVerifyRequest(const CAddress& addr, const std::vector<const CMasternode*>& vSortedByAddr, CConnman& connman);
     void SendVerifyReply(CNode* pnode, CMasternodeVerification& mnv, CConnman& connman);
     void ProcessVerifyReply(CNode* pnode, CMasternodeVerification& mnv);
     void ProcessVerifyBroadcast(CNode* pnode, const CMasternodeVerification& mnv);
 
     /// Return the number of (unique) Masternodes
-    int size() { return mapMasternodes.size(); }
+    int size() { return masternodes.size(); }
 
     std::string ToString() const;
 
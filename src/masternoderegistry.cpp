@@ -0,0 +1,222 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternoderegistry.h"
+
+#include "random.h"
+#include "script/standard.h"
+
+CMasternodeRegistry::CSaltedHasher::CSaltedHasher() : salt(GetRandHash()) {}
+
+size_t CMasternodeRegistry::CSaltedHasher::operator()(const COutPoint& outpoint) const
+{
+    return outpoint.hash.GetHash(salt) ^ outpoint.n;
+}
+
+size_t CMasternodeRegistry::CSaltedHasher::operator()(const CKeyID& keyID) const
+{
+    uint256 key;
+    memcpy(key.begin(), keyID.begin(), keyID.size());
+    return key.GetHash(salt);
+}
+
+size_t CMasternodeRegistry::CSaltedHasher::operator()(const CService& addr) const
+{
+    std::vector<unsigned char> vchKey = addr.GetKey();
+    uint256 key;
+    memcpy(key.begin(), &vchKey[0], std::min(vchKey.size(), (size_t)key.size()));
+    return key.GetHash(salt);
+}
+
+template<typename Map, typename Key>
+static void EraseIndexEntry(Map& map, const Key& key, size_t nIndex)
+{
+    auto range = map.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == nIndex) {
+            map.erase(it);
+            return;
+        }
+    }
+}
+
+void CMasternodeRegistry::AddToIndexes(size_t nIndex)
+{
+    const CMasternode& mn = *vEntries[nIndex];
+    CIndexedKeys& keys = vKeys[nIndex];
+    keys.keyIDMasternode = mn.pubKeyMasternode.GetID();
+    keys.keyIDCollateral = mn.pubKeyCollateralAddress.GetID();
+    keys.addr = mn.addr;
+    keys.nProtocolVersion = mn.nProtocolVersion;
+
+    mapByOutpoint[mn.vin.prevout] = nIndex;
+    mapByPubKey.emplace(keys.keyIDMasternode, nIndex);
+    mapByCollateral.emplace(keys.keyIDCollateral, nIndex);
+    mapByAddr.emplace(keys.addr, nIndex);
+}
+
+void CMasternodeRegistry::RemoveFromIndexes(size_t nIndex)
+{
+    // the entry may have changed since it was indexed, use the keys it was indexed with
+    const CIndexedKeys& keys = vKeys[nIndex];
+    mapByOutpoint.erase(vEntries[nIndex]->vin.prevout);
+    EraseIndexEntry(mapByPubKey, keys.keyIDMasternode, nIndex);
+    EraseIndexEntry(mapByCollateral, keys.keyIDCollateral, nIndex);
+    EraseIndexEntry(mapByAddr, keys.addr, nIndex);
+}
+
+CMasternode* CMasternodeRegistry::Unshare(size_t nIndex)
+{
+    // an entry from an earlier generation may be held by a snapshot
+    if (vGenerations[nIndex] != nShareGeneration) {
+        vEntries[nIndex] = std::make_shared<CMasternode>(*vEntries[nIndex]);
+        vGenerations[nIndex] = nShareGeneration;
+    }
+    return vEntries[nIndex].get();
+}
+
+const CMasternode* CMasternodeRegistry::Find(const COutPoint& outpoint) const
+{
+    auto it = mapByOutpoint.find(outpoint);
+    return it == mapByOutpoint.end() ? NULL : vEntries[it->second].get();
+}
+
+const CMasternode* CMasternodeRegistry::FindByPubKey(const CPubKey& pubKeyMasternode) const
+{
+    // several masternodes may share a key, return the one std::map used to find first
+    const CMasternode* pmnRet = NULL;
+    auto range = mapByPubKey.equal_range(pubKeyMasternode.GetID());
+    for (auto it = range.first; it != range.second; ++it) {
+        const CMasternode* pmn = vEntries[it->second].get();
+        if (pmn->pubKeyMasternode != pubKeyMasternode) continue;
+        if (!pmnRet || pmn->vin.prevout < pmnRet->vin.prevout)
+            pmnRet = pmn;
+    }
+    return pmnRet;
+}
+
+const CMasternode* CMasternodeRegistry::FindByPayee(const CScript& payee) const
+{
+    // collaterals are always paid to their key hash
+    if (!payee.IsPayToPublicKeyHash())
+        return NULL;
+    CKeyID keyID = CKeyID(uint160(std::vector<unsigned char>(payee.begin() + 3, payee.begin() + 23)));
+
+    const CMasternode* pmnRet = NULL;
+    auto range = mapByCollateral.equal_range(keyID);
+    for (auto it = range.first; it != range.second; ++it) {
+        const CMasternode* pmn = vEntries[it->second].get();
+        if (pmn->pubKeyCollateralAddress.GetID() != keyID) continue;
+        if (!pmnRet || pmn->vin.prevout < pmnRet->vin.prevout)
+            pmnRet = pmn;
+    }
+    return pmnRet;
+}
+
+std::shared_ptr<const CMasternode> CMasternodeRegistry::FindShared(const COutPoint& outpoint) const
+{
+    auto it = mapByOutpoint.find(outpoint);
+    if (it == mapByOutpoint.end())
+        return std::shared_ptr<const CMasternode>();
+    vGenerations[it->second] = SHARED_GENERATION;
+    return vEntries[it->second];
+}
+
+std::vector<const CMasternode*> CMasternodeRegistry::FindByAddr(const CService& addr) const
+{
+    std::vector<const CMasternode*> vResult;
+    auto range = mapByAddr.equal_range(addr);
+    for (auto it = range.first; it != range.second; ++it) {
+        const CMasternode* pmn = vEntries[it->second].get();
+        if (pmn->addr == addr)
+            vResult.push_back(pmn);
+    }
+    return vResult;
+}
+
+CMasternode* CMasternodeRegistry::FindMutable(const COutPoint& outpoint)
+{
+    auto it = mapByOutpoint.find(outpoint);
+    if (it == mapByOutpoint.end())
+        return NULL;
+    snapshotCached.reset();
+    return Unshare(it->second);
+}
+
+bool CMasternodeRegistry::Add(const CMasternode& mn)
+{
+    if (mapByOutpoint.count(mn.vin.prevout))
+        return false;
+    snapshotCached.reset();
+    nListVersion++;
+    vEntries.push_back(std::make_shared<CMasternode>(mn));
+    vKeys.push_back(CIndexedKeys());
+    vGenerations.push_back(nShareGeneration);
+    AddToIndexes(vEntries.size() - 1);
+    return true;
+}
+
+bool CMasternodeRegistry::Erase(const COutPoint& outpoint)
+{
+    auto it = mapByOutpoint.find(outpoint);
+    if (it == mapByOutpoint.end())
+        return false;
+    snapshotCached.reset();
+    nListVersion++;
+
+    // move the last entry into the hole to keep the storage dense
+    size_t nIndex = it->second;
+    size_t nLast = vEntries.size() - 1;
+    RemoveFromIndexes(nIndex);
+    if (nIndex != nLast) {
+        RemoveFromIndexes(nLast);
+        vEntries[nIndex] = std::move(vEntries[nLast]);
+        vGenerations[nIndex] = vGenerations[nLast];
+        AddToIndexes(nIndex);
+    }
+    vEntries.pop_back();
+    vKeys.pop_back();
+    vGenerations.pop_back();
+    return true;
+}
+
+void CMasternodeRegistry::Reindex(const COutPoint& outpoint)
+{
+    auto it = mapByOutpoint.find(outpoint);
+    if (it == mapByOutpoint.end())
+        return;
+    size_t nIndex = it->second;
+    int nProtocolVersionIndexed = vKeys[nIndex].nProtocolVersion;
+    RemoveFromIndexes(nIndex);
+    AddToIndexes(nIndex);
+    if (vKeys[nIndex].nProtocolVersion != nProtocolVersionIndexed)
+        nListVersion++;
+}
+
+void CMasternodeRegistry::Clear()
+{
+    snapshotCached.reset();
+    nListVersion++;
+    vEntries.clear();
+    vKeys.clear();
+    vGenerations.clear();
+    mapByOutpoint.clear();
+    mapByPubKey.clear();
+    mapByCollateral.clear();
+    mapByAddr.clear();
+}
+
+CMasternodeRegistry::snapshot_t CMasternodeRegistry::GetSnapshot() const
+{
+    if (!snapshotCached) {
+        std::shared_ptr<masternode_vec_t> pvecSnapshot = std::make_shared<masternode_vec_t>(vEntries.begin(), vEntries.end());
+        std::sort(pvecSnapshot->begin(), pvecSnapshot->end(), [](const std::shared_ptr<const CMasternode>& a, const std::shared_ptr<const CMasternode>& b) {
+            return a->vin.prevout < b->vin.prevout;
+        });
+        snapshotCached = pvecSnapshot;
+        // every entry is in the snapshot now
+        nShareGeneration++;
+    }
+    return snapshotCached;
+}
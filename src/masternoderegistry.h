@@ -0,0 +1,176 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MASTERNODEREGISTRY_H
+#define MASTERNODEREGISTRY_H
+
+#include "masternode.h"
+#include "serialize.h"
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/iterator/indirect_iterator.hpp>
+
+/**
+ * The masternode list: entries are kept in a dense vector, with hash indexes
+ * by collateral outpoint, masternode pubkey, payee and network address.
+ *
+ * Entries are shared with snapshots and copied on write. A snapshot costs one
+ * pointer per masternode to build and can be kept and read without any lock,
+ * a masternode that may be referenced by a snapshot is copied before it is
+ * changed. Every snapshot starts a new share generation, an entry is owned by
+ * the registry alone only if it was created or copied in the current one and
+ * not handed out by FindShared since. Read paths use the const finders, which
+ * neither copy entries nor drop the cached snapshot. The registry itself is
+ * not thread safe, CMasternodeMan::cs guards it.
+ *
+ * The pubkey, payee and address of an entry must only be changed through the
+ * pointer returned by FindMutable, followed by a call to Reindex.
+ */
+class CMasternodeRegistry
+{
+public:
+    typedef std::vector<std::shared_ptr<const CMasternode> > masternode_vec_t;
+    /** Immutable copy of the list, sorted by collateral outpoint */
+    typedef std::shared_ptr<const masternode_vec_t> snapshot_t;
+
+    class CSaltedHasher
+    {
+    private:
+        uint256 salt;
+
+    public:
+        CSaltedHasher();
+
+        size_t operator()(const COutPoint& outpoint) const;
+        size_t operator()(const CKeyID& keyID) const;
+        size_t operator()(const CService& addr) const;
+    };
+
+private:
+    typedef std::vector<std::shared_ptr<CMasternode> > entry_vec_t;
+
+    // keys an entry was indexed with, they may differ from its current ones until Reindex
+    struct CIndexedKeys
+    {
+        CKeyID keyIDMasternode;
+        CKeyID keyIDCollateral;
+        CService addr;
+        int nProtocolVersion;
+    };
+
+    entry_vec_t vEntries;
+    std::vector<CIndexedKeys> vKeys;
+    // share generation each entry was created or copied in, SHARED_GENERATION once handed out alone
+    mutable std::vector<uint64_t> vGenerations;
+
+    std::unordered_map<COutPoint, size_t, CSaltedHasher> mapByOutpoint;
+    std::unordered_multimap<CKeyID, size_t, CSaltedHasher> mapByPubKey;
+    std::unordered_multimap<CKeyID, size_t, CSaltedHasher> mapByCollateral;
+    std::unordered_multimap<CService, size_t, CSaltedHasher> mapByAddr;
+
+    // last snapshot handed out, dropped on every write
+    mutable snapshot_t snapshotCached;
+    mutable uint64_t nShareGeneration;
+    uint64_t nListVersion;
+
+    static const uint64_t SHARED_GENERATION = 0;
+
+    void AddToIndexes(size_t nIndex);
+    void RemoveFromIndexes(size_t nIndex);
+    CMasternode* Unshare(size_t nIndex);
+
+public:
+    typedef boost::indirect_iterator<entry_vec_t::const_iterator, const CMasternode> const_iterator;
+
+    CMasternodeRegistry() : nShareGeneration(1), nListVersion(0) {}
+    // a copy would share entries without either side knowing
+    CMasternodeRegistry(const CMasternodeRegistry&) = delete;
+    CMasternodeRegistry& operator=(const CMasternodeRegistry&) = delete;
+
+    size_t size() const { return vEntries.size(); }
+    bool empty() const { return vEntries.empty(); }
+
+    /** Iterate over the list, in no particular order */
+    const_iterator begin() const { return const_iterator(vEntries.begin()); }
+    const_iterator end() const { return const_iterator(vEntries.end()); }
+
+    const CMasternode* Find(const COutPoint& outpoint) const;
+    const CMasternode* FindByPubKey(const CPubKey& pubKeyMasternode) const;
+    const CMasternode* FindByPayee(const CScript& payee) const;
+    std::vector<const CMasternode*> FindByAddr(const CService& addr) const;
+    /** Find an entry and share it like a snapshot does, it stays as it is when the list changes */
+    std::shared_ptr<const CMasternode> FindShared(const COutPoint& outpoint) const;
+
+    /** Find an entry to change it, copying it first if a snapshot still uses it */
+    CMasternode* FindMutable(const COutPoint& outpoint);
+
+    /** Call func on every entry, copying the ones still used by a snapshot */
+    template<typename Callable>
+    void ForEachMutable(Callable func)
+    {
+        snapshotCached.reset();
+        for (size_t i = 0; i < vEntries.size(); i++)
+            func(*Unshare(i));
+    }
+
+    bool Add(const CMasternode& mn);
+    bool Erase(const COutPoint& outpoint);
+    /** Update the indexes after the pubkey, payee or address of an entry changed */
+    void Reindex(const COutPoint& outpoint);
+    void Clear();
+
+    snapshot_t GetSnapshot() const;
+    /**
+     * Changes when a masternode is added or removed or changes its protocol version,
+     * which is everything masternode scores and ranks depend on.
+     */
+    uint64_t GetListVersion() const { return nListVersion; }
+
+    // Serialized the way std::map<COutPoint, CMasternode> is, so mncache.dat stays compatible
+
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        std::vector<const CMasternode*> vSorted;
+        vSorted.reserve(vEntries.size());
+        for (const auto& pmn : vEntries)
+            vSorted.push_back(pmn.get());
+        std::sort(vSorted.begin(), vSorted.end(), [](const CMasternode* a, const CMasternode* b) {
+            return a->vin.prevout < b->vin.prevout;
+        });
+
+        WriteCompactSize(s, vSorted.size());
+        for (const CMasternode* pmn : vSorted) {
+            ::Serialize(s, pmn->vin.prevout, nType, nVersion);
+            ::Serialize(s, *pmn, nType, nVersion);
+        }
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        Clear();
+        unsigned int nSize = ReadCompactSize(s);
+        for (unsigned int i = 0; i < nSize; i++) {
+            COutPoint outpoint;
+            CMasternode mn;
+            ::Unserialize(s, outpoint, nType, nVersion);
+            ::Unserialize(s, mn, nType, nVersion);
+            Add(mn);
+        }
+    }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        CSizeComputer s(nType, nVersion);
+        Serialize(s, nType, nVersion);
+        return s.size();
+    }
+};
+
+#endif
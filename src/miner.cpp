@@ -32,6 +32,8 @@
 
 #include <boost/thread.hpp>
 #include <boost/tuple/tuple.hpp>
+#include <atomic>
+#include <memory>
 #include <queue>
 
 using namespace std;
@@ -374,13 +376,176 @@ static bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainpar
     return true;
 }
 
-// ***TODO*** that part changed in bitcoin, we are using a mix with old one here for now
-void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman)
+//////////////////////////////////////////////////////////////////////////////
+//
+// Internal miner
+//
+// The control thread builds the block template and publishes it as the current
+// work, each worker thread searches its own slice of the nonce space on a copy of
+// it. Workers poll the work id, which changes once the work was replaced, so
+// picking up a new tip costs them one atomic load per batch of nonces.
+//
+
+/** Nonces a worker hashes between checks for new work and interruption */
+static const int MINER_NONCE_BATCH = 256;
+/** Milliseconds between checks of the control thread for a stale template */
+static const int MINER_CONTROL_TICK = 250;
+
+namespace {
+
+/** The block the workers search a nonce for, NULL while there is nothing to mine */
+struct CMinerWork
+{
+    std::shared_ptr<const CBlock> pblock;
+    arith_uint256 hashTarget;
+    uint64_t nWorkId;
+
+    CMinerWork() : nWorkId(0) {}
+};
+
+/** Nonce slice and counters of one worker thread */
+struct CMinerWorker
+{
+    const uint32_t nNonceBegin;
+    const uint32_t nNonceEnd;
+    std::atomic<uint64_t> nHashes; // written by the worker only
+    uint64_t nLastHashes;          // protected by cs_minerStats
+    double dHashesPerSec;          // protected by cs_minerStats
+
+    CMinerWorker(uint32_t nNonceBeginIn, uint32_t nNonceEndIn) :
+        nNonceBegin(nNonceBeginIn), nNonceEnd(nNonceEndIn), nHashes(0), nLastHashes(0), dHashesPerSec(0) {}
+};
+
+} // anon namespace
+
+static CCriticalSection cs_minerWork;
+static CMinerWork minerWork;                       // protected by cs_minerWork
+static std::atomic<uint64_t> nMinerWorkId(0);      // id of minerWork, set after it was replaced
+static std::atomic<bool> fMinerOutOfNonces(false); // a worker searched its whole slice of the current work
+static std::atomic<bool> fMinerBlockFound(false);  // a worker found a block, the coinbase script is used
+static std::atomic<int> nMinerWorkersRunning(0);
+static std::atomic<uint64_t> nMinerShares(0);
+static std::atomic<uint64_t> nMinerBlocks(0);
+static std::atomic<uint64_t> nMinerTemplates(0);
+
+static CCriticalSection cs_minerStats;
+static std::vector<std::unique_ptr<CMinerWorker> > vMinerWorkers; // protected by cs_minerStats, replaced only while no miner thread runs
+static bool fMinerRunning = false;                                // protected by cs_minerStats
+static int64_t nMinerStartTime = 0;                               // protected by cs_minerStats
+static double dMinerHashesPerSec = 0;                             // protected by cs_minerStats
+
+static void SetMinerWork(const CBlock* pblock)
+{
+    LOCK(cs_minerWork);
+    if (pblock) {
+        minerWork.pblock = std::make_shared<const CBlock>(*pblock);
+        minerWork.hashTarget = arith_uint256().SetCompact(pblock->nBits);
+    } else {
+        minerWork.pblock.reset();
+    }
+    minerWork.nWorkId++;
+    nMinerWorkId = minerWork.nWorkId;
+}
+
+static arith_uint256 GetShareTarget(const arith_uint256& hashTarget)
+{
+    arith_uint256 hashMax = ~arith_uint256();
+    if (hashTarget > (hashMax >> MINER_SHARE_TARGET_SHIFT))
+        return hashMax;
+    return hashTarget << MINER_SHARE_TARGET_SHIFT;
+}
+
+static void UpdateMinerStats(int64_t nElapsedMillis)
+{
+    LOCK(cs_minerStats);
+    dMinerHashesPerSec = 0;
+    for (const std::unique_ptr<CMinerWorker>& pworker : vMinerWorkers) {
+        uint64_t nHashes = pworker->nHashes.load(std::memory_order_relaxed);
+        pworker->dHashesPerSec = 1000.0 * (nHashes - pworker->nLastHashes) / nElapsedMillis;
+        pworker->nLastHashes = nHashes;
+        dMinerHashesPerSec += pworker->dHashesPerSec;
+    }
+}
+
+void static BitcoinMinerWorker(CMinerWorker* pworker, const CChainParams& chainparams)
 {
-    LogPrintf("InfinexMiner -- started\n");
     SetThreadPriority(THREAD_PRIORITY_LOWEST);
     RenameThread("infinex-miner");
 
+    CBlock block;
+    arith_uint256 hashTarget;
+    arith_uint256 hashShareTarget;
+    uint64_t nWorkId = 0;
+    uint32_t nNonce = 0;
+    bool fSearching = false;
+
+    try {
+        while (true) {
+            boost::this_thread::interruption_point();
+
+            if (nMinerWorkId != nWorkId) {
+                LOCK(cs_minerWork);
+                nWorkId = minerWork.nWorkId;
+                fSearching = (bool)minerWork.pblock;
+                if (fSearching) {
+                    block = *minerWork.pblock;
+                    hashTarget = minerWork.hashTarget;
+                    hashShareTarget = GetShareTarget(hashTarget);
+                    nNonce = pworker->nNonceBegin;
+                }
+            }
+            if (!fSearching) {
+                MilliSleep(100);
+                continue;
+            }
+
+            uint64_t nHashesDone = 0;
+            for (int i = 0; i < MINER_NONCE_BATCH && fSearching; i++) {
+                block.nNonce = nNonce;
+                // every nonce is a new header, skip the hash cache and use the thread's Lyra2Z scratch memory
+                arith_uint256 hash = UintToArith256(block.ComputeHash());
+                nHashesDone++;
+                if (hash <= hashShareTarget)
+                    nMinerShares++;
+
+                if (hash <= hashTarget) {
+                    // Found a solution
+                    SetThreadPriority(THREAD_PRIORITY_NORMAL);
+                    LogPrintf("InfinexMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
+                    if (ProcessBlockFound(&block, chainparams))
+                        nMinerBlocks++;
+                    fMinerBlockFound = true;
+                    SetThreadPriority(THREAD_PRIORITY_LOWEST);
+
+                    // In regression test mode, stop mining after a block is found. This
+                    // allows developers to controllably generate a block on demand.
+                    if (chainparams.MineBlocksOnDemand())
+                        throw boost::thread_interrupted();
+
+                    // wait for the template on top of it
+                    fSearching = false;
+                } else if (nNonce == pworker->nNonceEnd) {
+                    fMinerOutOfNonces = true;
+                    fSearching = false;
+                } else {
+                    nNonce++;
+                }
+            }
+            pworker->nHashes.fetch_add(nHashesDone, std::memory_order_relaxed);
+        }
+    }
+    catch (const boost::thread_interrupted&)
+    {
+        nMinerWorkersRunning--;
+        throw;
+    }
+}
+
+void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman)
+{
+    LogPrintf("InfinexMiner -- started\n");
+    RenameThread("infinex-minectl");
+
     unsigned int nExtraNonce = 0;
 
     boost::shared_ptr<CReserveScript> coinbaseScript;
@@ -393,7 +558,8 @@ void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman)
         if (!coinbaseScript || coinbaseScript->reserveScript.empty())
             throw std::runtime_error("No coinbase script available (mining requires a wallet)");
 
-        while (true) {
+        int64_t nLastStatsTime = GetTimeMillis();
+        while (nMinerWorkersRunning > 0) {
             if (chainparams.MiningRequiresPeers()) {
                 // Busy-wait for the network to come online so we don't waste time mining
                 // on an obsolete chain. In regtest mode we expect to fly solo.
@@ -417,6 +583,7 @@ void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman)
             if (!pblocktemplate.get())
             {
                 LogPrintf("InfinexMiner -- Keypool ran out, please call keypoolrefill before restarting the mining thread\n");
+                SetMinerWork(NULL);
                 return;
             }
             CBlock *pblock = &pblocktemplate->block;
@@ -425,47 +592,31 @@ void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman)
             LogPrintf("InfinexMiner -- Running miner with %u transactions in block (%u bytes)\n", pblock->vtx.size(),
                 ::GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION));
 
+            fMinerOutOfNonces = false;
+            SetMinerWork(pblock);
+            nMinerTemplates++;
+
             //
-            // Search
+            // Watch the search
             //
             int64_t nStart = GetTime();
-            arith_uint256 hashTarget = arith_uint256().SetCompact(pblock->nBits);
-            while (true)
+            while (nMinerWorkersRunning > 0)
             {
-                unsigned int nHashesDone = 0;
-
-                uint256 hash;
-                while (true)
-                {
-                    hash = pblock->GetHash();
-                    if (UintToArith256(hash) <= hashTarget)
-                    {
-                        // Found a solution
-                        SetThreadPriority(THREAD_PRIORITY_NORMAL);
-                        LogPrintf("InfinexMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
-                        ProcessBlockFound(pblock, chainparams);
-                        SetThreadPriority(THREAD_PRIORITY_LOWEST);
-                        coinbaseScript->KeepScript();
-
-                        // In regression test mode, stop mining after a block is found. This
-                        // allows developers to controllably generate a block on demand.
-                        if (chainparams.MineBlocksOnDemand())
-                            throw boost::thread_interrupted();
+                // Check for stop or if block needs to be rebuilt
+                MilliSleep(MINER_CONTROL_TICK);
 
-                        break;
-                    }
-                    pblock->nNonce += 1;
-                    nHashesDone += 1;
-                    if ((pblock->nNonce & 0xFF) == 0)
-                        break;
+                int64_t nNow = GetTimeMillis();
+                if (nNow - nLastStatsTime >= 1000) {
+                    UpdateMinerStats(nNow - nLastStatsTime);
+                    nLastStatsTime = nNow;
                 }
+                if (fMinerBlockFound.exchange(false))
+                    coinbaseScript->KeepScript();
 
-                // Check for stop or if block needs to be rebuilt
-                boost::this_thread::interruption_point();
                 // Regtest mode doesn't require peers
                 if (connman.GetNodeCount(CConnman::CONNECTIONS_ALL) == 0 && chainparams.MiningRequiresPeers())
                     break;
-                if (pblock->nNonce >= 0xffff0000)
+                if (fMinerOutOfNonces)
                     break;
                 if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 60)
                     break;
@@ -473,14 +624,14 @@ void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman)
                     break;
 
                 // Update nTime every few seconds
-                if (UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev) < 0)
+                int64_t nTimeDelta = UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev);
+                if (nTimeDelta < 0)
                     break; // Recreate the block if the clock has run backwards,
                            // so that we can use the correct time.
-                if (chainparams.GetConsensus().fPowAllowMinDifficultyBlocks)
-                {
-                    // Changing pblock->nTime can change work required on testnet:
-                    hashTarget.SetCompact(pblock->nBits);
-                }
+                // Changing pblock->nTime can change work required on testnet,
+                // the workers take the target from the new work
+                if (nTimeDelta > 0)
+                    SetMinerWork(pblock);
             }
         }
     }
@@ -492,6 +643,7 @@ void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman)
     catch (const std::runtime_error &e)
     {
         LogPrintf("InfinexMiner -- runtime error: %s\n", e.what());
+        SetMinerWork(NULL);
         return;
     }
 }
@@ -506,14 +658,63 @@ void GenerateInfinex(bool fGenerate, int nThreads, const CChainParams& chainpara
     if (minerThreads != NULL)
     {
         minerThreads->interrupt_all();
+        minerThreads->join_all();
         delete minerThreads;
         minerThreads = NULL;
     }
+    SetMinerWork(NULL);
+    {
+        LOCK(cs_minerStats);
+        fMinerRunning = false;
+        dMinerHashesPerSec = 0;
+        for (const std::unique_ptr<CMinerWorker>& pworker : vMinerWorkers)
+            pworker->dHashesPerSec = 0;
+    }
 
     if (nThreads == 0 || !fGenerate)
         return;
 
+    {
+        LOCK(cs_minerStats);
+        vMinerWorkers.clear();
+        for (int i = 0; i < nThreads; i++) {
+            // disjoint slices of the nonce space, together covering all of it
+            uint32_t nNonceBegin = ((uint64_t)i << 32) / nThreads;
+            uint32_t nNonceEnd = (((uint64_t)(i + 1) << 32) / nThreads) - 1;
+            vMinerWorkers.emplace_back(new CMinerWorker(nNonceBegin, nNonceEnd));
+        }
+        fMinerRunning = true;
+        nMinerStartTime = GetTime();
+    }
+    nMinerShares = 0;
+    nMinerBlocks = 0;
+    nMinerTemplates = 0;
+    nMinerWorkersRunning = nThreads;
+
     minerThreads = new boost::thread_group();
+    minerThreads->create_thread(boost::bind(&BitcoinMiner, boost::cref(chainparams), boost::ref(connman)));
     for (int i = 0; i < nThreads; i++)
-        minerThreads->create_thread(boost::bind(&BitcoinMiner, boost::cref(chainparams), boost::ref(connman)));
+        minerThreads->create_thread(boost::bind(&BitcoinMinerWorker, vMinerWorkers[i].get(), boost::cref(chainparams)));
+}
+
+void GetMinerStats(CMinerStats& stats)
+{
+    LOCK(cs_minerStats);
+    stats.fRunning = fMinerRunning && nMinerWorkersRunning > 0;
+    stats.nStartTime = nMinerStartTime;
+    stats.nHashes = 0;
+    stats.nShares = nMinerShares;
+    stats.nBlocks = nMinerBlocks;
+    stats.nTemplates = nMinerTemplates;
+    stats.dHashesPerSec = stats.fRunning ? dMinerHashesPerSec : 0;
+    stats.vThreads.clear();
+    for (const std::unique_ptr<CMinerWorker>& pworker : vMinerWorkers) {
+        CMinerThreadStats thread;
+        thread.nNonceBegin = pworker->nNonceBegin;
+        thread.nNonceEnd = pworker->nNonceEnd;
+        thread.nHashes = pworker->nHashes.load(std::memory_order_relaxed);
+        thread.dHashesPerSec = stats.fRunning ? pworker->dHashesPerSec : 0;
+        stats.nHashes += thread.nHashes;
+        stats.vThreads.push_back(thread);
+    }
 }
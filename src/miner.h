@@ -9,6 +9,7 @@
 #include "primitives/block.h"
 
 #include <stdint.h>
+#include <vector>
 
 class CBlockIndex;
 class CChainParams;
@@ -23,6 +24,9 @@ static const int DEFAULT_GENERATE_THREADS = 1;
 
 static const bool DEFAULT_PRINTPRIORITY = false;
 
+/** A share is a hash that meets a 2^MINER_SHARE_TARGET_SHIFT times lower difficulty than the block */
+static const int MINER_SHARE_TARGET_SHIFT = 8;
+
 struct CBlockTemplate
 {
     CBlock block;
@@ -30,6 +34,28 @@ struct CBlockTemplate
     std::vector<int64_t> vTxSigOps;
 };
 
+/** Nonce slice and hash rate of one internal miner thread */
+struct CMinerThreadStats
+{
+    uint32_t nNonceBegin;
+    uint32_t nNonceEnd;
+    uint64_t nHashes;
+    double dHashesPerSec;
+};
+
+/** Internal miner statistics since it was last started */
+struct CMinerStats
+{
+    bool fRunning;
+    int64_t nStartTime;
+    uint64_t nHashes;
+    uint64_t nShares;
+    uint64_t nBlocks;
+    uint64_t nTemplates;
+    double dHashesPerSec;
+    std::vector<CMinerThreadStats> vThreads;
+};
+
 /** Run the miner threads */
 void GenerateInfinex(bool fGenerate, int nThreads, const CChainParams& chainparams, CConnman& connman);
 /** Generate a new block, without valid proof-of-work */
@@ -37,5 +63,7 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& s
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
+/** Get the statistics of the internal miner threads */
+void GetMinerStats(CMinerStats& stats);
 
 #endif // BITCOIN_MINER_H
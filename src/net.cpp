@@ -33,6 +33,11 @@
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <sys/uio.h>
+#endif
+
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
 #endif
 
 #ifdef USE_UPNP
@@ -48,6 +53,9 @@
 // Dump addresses to peers.dat and banlist.dat every 15 minutes (900s)
 #define DUMP_ADDRESSES_INTERVAL 900
 
+// Most socket events handled per epoll_wait() call
+#define EPOLL_MAX_EVENTS 128
+
 // We add a random period time (0 to 1 seconds) to feeler connections to prevent synchronization.
 #define FEELER_SLEEP_WINDOW 1
 
@@ -83,7 +91,7 @@ static bool vfLimited[NET_MAX] = {};
 static CNode* pnodeLocalHost = NULL;
 std::string strSubVersion;
 
-std::map<CInv, CDataStream> mapRelay;
+std::map<CInv, CSerializedNetMsg> mapRelay;
 std::deque<pair<int64_t, CInv> > vRelayExpiration;
 CCriticalSection cs_mapRelay;
 limitedmap<uint256, int64_t> mapAlreadyAskedFor(MAX_INV_SZ);
@@ -427,6 +435,7 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCo
         }
 
         GetNodeSignals().InitializeNode(pnode, *this);
+        AddSocketEvents(pnode);
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
 
@@ -463,6 +472,7 @@ void CConnman::DumpBanlist()
 void CNode::CloseSocketDisconnect()
 {
     fDisconnect = true;
+    LOCK(cs_hSocket);
     if (hSocket != INVALID_SOCKET)
     {
         LogPrint("net", "disconnecting peer=%d\n", id);
@@ -808,28 +818,70 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
 
 
 
+#ifndef WIN32
+// Messages gathered into one sendmsg call
+static const size_t MAX_SEND_IOV = 64;
+#endif
+
+// Send the queued messages from the unsent part of the first one on, as far
+// as the socket takes them. Returns the result of the send call and the
+// number of bytes it was given.
+static ssize_t SendQueuedData(SOCKET hSocket, const std::deque<std::shared_ptr<const CSerializeData> >& vSendMsg, size_t nSendOffset, size_t& nGathered)
+{
+#ifdef WIN32
+    // no scatter-gather sends here, send one message at a time
+    const CSerializeData& data = *vSendMsg.front();
+    nGathered = data.size() - nSendOffset;
+    return send(hSocket, &data[nSendOffset], nGathered, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+    struct iovec vIov[MAX_SEND_IOV];
+    size_t nIov = 0;
+    nGathered = 0;
+    for (std::deque<std::shared_ptr<const CSerializeData> >::const_iterator it = vSendMsg.begin(); it != vSendMsg.end() && nIov < MAX_SEND_IOV; ++it, ++nIov) {
+        const CSerializeData& data = **it;
+        size_t nOffset = nIov == 0 ? nSendOffset : 0;
+        vIov[nIov].iov_base = const_cast<char*>(&data[nOffset]);
+        vIov[nIov].iov_len = data.size() - nOffset;
+        nGathered += vIov[nIov].iov_len;
+    }
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = vIov;
+    msg.msg_iovlen = nIov;
+    return sendmsg(hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
+}
+
 // requires LOCK(cs_vSend)
 size_t CConnman::SocketSendData(CNode *pnode)
 {
-    std::deque<CSerializeData>::iterator it = pnode->vSendMsg.begin();
     size_t nSentSize = 0;
 
-    while (it != pnode->vSendMsg.end()) {
-        const CSerializeData &data = *it;
-        assert(data.size() > pnode->nSendOffset);
-        int nBytes = send(pnode->hSocket, &data[pnode->nSendOffset], data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+    while (!pnode->vSendMsg.empty()) {
+        assert(pnode->vSendMsg.front()->size() > pnode->nSendOffset);
+        size_t nGathered;
+        ssize_t nBytes = SendQueuedData(pnode->hSocket, pnode->vSendMsg, pnode->nSendOffset, nGathered);
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            // drop the messages that went out completely, the peers they
+            // are shared with keep their own references
+            size_t nLeft = nBytes;
+            while (nLeft > 0) {
+                size_t nSize = pnode->vSendMsg.front()->size();
+                if (nLeft < nSize - pnode->nSendOffset) {
+                    pnode->nSendOffset += nLeft;
+                    break;
+                }
+                nLeft -= nSize - pnode->nSendOffset;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
-                it++;
-            } else {
-                // could not send full message; stop sending more
+                pnode->nSendSize -= nSize;
+                pnode->vSendMsg.pop_front();
+            }
+            pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+            if ((size_t)nBytes < nGathered) {
+                // could not send everything; stop sending more
                 break;
             }
         } else {
@@ -847,11 +899,10 @@ size_t CConnman::SocketSendData(CNode *pnode)
         }
     }
 
-    if (it == pnode->vSendMsg.end()) {
+    if (pnode->vSendMsg.empty()) {
         assert(pnode->nSendOffset == 0);
         assert(pnode->nSendSize == 0);
     }
-    pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
     return nSentSize;
 }
 
@@ -1055,7 +1106,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    if (socketEventsMode == SOCKETEVENTS_SELECT && !IsSelectableSocket(hSocket))
     {
         LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
@@ -1098,6 +1149,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     CNode* pnode = new CNode(GetNewNodeId(), nLocalServices, GetBestHeight(), hSocket, addr, "", true);
     pnode->fWhitelisted = whitelisted;
     GetNodeSignals().InitializeNode(pnode, *this);
+    AddSocketEvents(pnode);
 
     LogPrint("net", "connection from %s accepted\n", addr.ToString());
 
@@ -1128,6 +1180,7 @@ void CConnman::ThreadSocketHandler()
 
                     // remove from vNodes
                     vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
+                    setNodesRecvPending.erase(pnode);
 
                     // release outbound grant (if any)
                     pnode->grantOutbound.Release();
@@ -1182,6 +1235,13 @@ void CConnman::ThreadSocketHandler()
                 clientInterface->NotifyNumConnectionsChanged(nPrevNodeCount);
         }
 
+#ifdef USE_EPOLL
+        if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+            SocketEventsEpoll();
+            continue;
+        }
+#endif
+
         //
         // Find which sockets have data to receive
         //
@@ -1286,56 +1346,7 @@ void CConnman::ThreadSocketHandler()
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
             if (FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError))
-            {
-                {
-                    {
-                        // typical socket buffer is 8K-64K
-                        char pchBuf[0x10000];
-                        int nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-                        if (nBytes > 0)
-                        {
-                            bool notify = false;
-                            if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
-                                pnode->CloseSocketDisconnect();
-                            RecordBytesRecv(nBytes);
-                            if (notify) {
-                                size_t nSizeAdded = 0;
-                                auto it(pnode->vRecvMsg.begin());
-                                for (; it != pnode->vRecvMsg.end(); ++it) {
-                                    if (!it->complete())
-                                        break;
-                                    nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
-                                }
-                                {
-                                    LOCK(pnode->cs_vProcessMsg);
-                                    pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
-                                    pnode->nProcessQueueSize += nSizeAdded;
-                                    pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
-                                }
-                                WakeMessageHandler();
-                            }
-                        }
-                        else if (nBytes == 0)
-                        {
-                            // socket closed gracefully
-                            if (!pnode->fDisconnect)
-                                LogPrint("net", "socket closed\n");
-                            pnode->CloseSocketDisconnect();
-                        }
-                        else if (nBytes < 0)
-                        {
-                            // error
-                            int nErr = WSAGetLastError();
-                            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
-                            {
-                                if (!pnode->fDisconnect)
-                                    LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
-                                pnode->CloseSocketDisconnect();
-                            }
-                        }
-                    }
-                }
-            }
+                SocketRecvData(pnode);
 
             //
             // Send
@@ -1353,37 +1364,232 @@ void CConnman::ThreadSocketHandler()
                 }
             }
 
-            //
-            // Inactivity checking
-            //
-            int64_t nTime = GetSystemTimeInSeconds();
-            if (nTime - pnode->nTimeConnected > 60)
+            InactivityCheck(pnode);
+        }
+        ReleaseNodeVector(vNodesCopy);
+    }
+}
+
+bool CConnman::SocketRecvData(CNode *pnode)
+{
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    int nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    if (nBytes > 0)
+    {
+        bool notify = false;
+        if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
+            pnode->CloseSocketDisconnect();
+        RecordBytesRecv(nBytes);
+        if (notify) {
+            size_t nSizeAdded = 0;
+            auto it(pnode->vRecvMsg.begin());
+            for (; it != pnode->vRecvMsg.end(); ++it) {
+                if (!it->complete())
+                    break;
+                nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
+            }
             {
-                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
-                {
-                    LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
-                {
-                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastRecv > (TIMEOUT_INTERVAL))
-                {
-                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
-                    pnode->fDisconnect = true;
-                }
-                else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
-                {
-                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
-                    pnode->fDisconnect = true;
-                }
+                LOCK(pnode->cs_vProcessMsg);
+                pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
+                pnode->nProcessQueueSize += nSizeAdded;
+                pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
             }
+            WakeMessageHandler();
+        }
+        return pnode->hSocket != INVALID_SOCKET;
+    }
+    else if (nBytes == 0)
+    {
+        // socket closed gracefully
+        if (!pnode->fDisconnect)
+            LogPrint("net", "socket closed\n");
+        pnode->CloseSocketDisconnect();
+    }
+    else if (nBytes < 0)
+    {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr == WSAEINTR)
+            return true;
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINPROGRESS)
+        {
+            if (!pnode->fDisconnect)
+                LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
+            pnode->CloseSocketDisconnect();
+        }
+    }
+    return false;
+}
+
+void CConnman::InactivityCheck(CNode *pnode)
+{
+    int64_t nTime = GetSystemTimeInSeconds();
+    if (nTime - pnode->nTimeConnected > 60)
+    {
+        if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
+        {
+            LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
+            pnode->fDisconnect = true;
         }
+        else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
+        {
+            LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastRecv > (TIMEOUT_INTERVAL))
+        {
+            LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
+            pnode->fDisconnect = true;
+        }
+        else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
+        {
+            LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
+            pnode->fDisconnect = true;
+        }
+    }
+}
+
+void CConnman::AddSocketEvents(CNode *pnode)
+{
+#ifdef USE_EPOLL
+    if (socketEventsMode != SOCKETEVENTS_EPOLL)
+        return;
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLET;
+    event.data.ptr = pnode;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, pnode->hSocket, &event) != 0) {
+        LogPrintf("epoll_ctl failed to add socket of peer=%d: %s\n", pnode->id, NetworkErrorString(WSAGetLastError()));
+        pnode->fDisconnect = true;
+    }
+#endif
+}
+
+void CConnman::RequestSocketSend(CNode *pnode, bool fSend)
+{
+    AssertLockHeld(pnode->cs_vSend);
+#ifdef USE_EPOLL
+    if (socketEventsMode != SOCKETEVENTS_EPOLL)
+        return;
+    // Hold the socket lock across the call so a concurrent disconnect cannot
+    // close the descriptor and let it be reused by an unrelated socket
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET)
+        return;
+    // Modifying the registration also re-arms the edge-triggered events, so a
+    // socket that is already writable reports it again right away
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLET;
+    if (fSend)
+        event.events |= EPOLLOUT;
+    event.data.ptr = pnode;
+    if (epoll_ctl(epollfd, EPOLL_CTL_MOD, pnode->hSocket, &event) == 0)
+        pnode->fSocketEventsSend = fSend;
+    else
+        LogPrint("net", "epoll_ctl failed to modify socket of peer=%d: %s\n", pnode->id, NetworkErrorString(WSAGetLastError()));
+#endif
+}
+
+#ifdef USE_EPOLL
+void CConnman::SocketEventsEpoll()
+{
+    // Sockets with unread data do not signal again, so keep reading them
+    // without sleeping until they are drained or the message handler is full
+    bool fRecvPending = false;
+    BOOST_FOREACH(CNode* pnode, setNodesRecvPending) {
+        if (!pnode->fPauseRecv) {
+            fRecvPending = true;
+            break;
+        }
+    }
+
+    // Outbound data registers writability and wakes the wait, the timeout
+    // only bounds how late disconnected nodes are noticed
+    struct epoll_event events[EPOLL_MAX_EVENTS];
+    int nEvents = epoll_wait(epollfd, events, EPOLL_MAX_EVENTS, fRecvPending ? 0 : 50);
+    if (interruptNet)
+        return;
+    if (nEvents < 0) {
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEINTR)
+            LogPrintf("socket epoll error %s\n", NetworkErrorString(nErr));
+        nEvents = 0;
+    }
+
+    bool fAccept = false;
+    std::vector<CNode*> vNodesSend;
+    for (int i = 0; i < nEvents; i++) {
+        // Nodes are only deleted by this thread, and their sockets leave the
+        // epoll set when closed, so every reported node is still alive
+        CNode* pnode = static_cast<CNode*>(events[i].data.ptr);
+        if (pnode == NULL) {
+            fAccept = true;
+            continue;
+        }
+        if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+            setNodesRecvPending.insert(pnode);
+        if (events[i].events & EPOLLOUT)
+            vNodesSend.push_back(pnode);
+    }
+
+    //
+    // Accept new connections
+    //
+    if (fAccept) {
+        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+            if (hListenSocket.socket != INVALID_SOCKET)
+                AcceptConnection(hListenSocket);
+    }
+
+    //
+    // Receive
+    //
+    for (std::set<CNode*>::iterator it = setNodesRecvPending.begin(); it != setNodesRecvPending.end();) {
+        if (interruptNet)
+            return;
+        CNode* pnode = *it;
+        if (pnode->fPauseRecv) {
+            ++it;
+            continue;
+        }
+        if (pnode->hSocket == INVALID_SOCKET || !SocketRecvData(pnode))
+            setNodesRecvPending.erase(it++);
+        else
+            ++it;
+    }
+
+    //
+    // Send
+    //
+    BOOST_FOREACH(CNode* pnode, vNodesSend) {
+        size_t nBytes = 0;
+        {
+            LOCK(pnode->cs_vSend);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+            nBytes = SocketSendData(pnode);
+            if (!pnode->vSendMsg.empty() || pnode->fSocketEventsSend)
+                RequestSocketSend(pnode, !pnode->vSendMsg.empty());
+        }
+        if (nBytes)
+            RecordBytesSent(nBytes);
+    }
+
+    //
+    // Inactivity checking, which does not need to visit every node each round
+    //
+    static int64_t nLastInactivityCheck = 0;
+    int64_t nTime = GetSystemTimeInSeconds();
+    if (nTime != nLastInactivityCheck) {
+        nLastInactivityCheck = nTime;
+        std::vector<CNode*> vNodesCopy = CopyNodeVector();
+        BOOST_FOREACH(CNode* pnode, vNodesCopy)
+            if (pnode->hSocket != INVALID_SOCKET)
+                InactivityCheck(pnode);
         ReleaseNodeVector(vNodesCopy);
     }
 }
+#endif
 
 void CConnman::WakeMessageHandler()
 {
@@ -1928,7 +2134,8 @@ void CConnman::ThreadMessageHandler()
 
         BOOST_FOREACH(CNode* pnode, vNodesCopy)
         {
-            if (pnode->fDisconnect)
+            // a node is owned by the pool while one of its messages runs there
+            if (pnode->fDisconnect || pnode->fProcessingOnPool)
                 continue;
 
             // Receive messages
@@ -1959,6 +2166,18 @@ void CConnman::ThreadMessageHandler()
 
 
 
+void CConnman::ProcessOnMessagePool(CNode* pnode, std::function<void()> func)
+{
+    pnode->AddRef();
+    pnode->fProcessingOnPool = true;
+    msgProcPool.Submit([this, pnode, func]() {
+        func();
+        pnode->fProcessingOnPool = false;
+        pnode->Release();
+        WakeMessageHandler();
+    }, pnode->id);
+}
+
 bool CConnman::BindListenPort(const CService &addrBind, std::string& strError, bool fWhitelisted)
 {
     strError = "";
@@ -2144,6 +2363,8 @@ CConnman::CConnman()
     nBestHeight = 0;
     clientInterface = NULL;
     flagInterruptMsgProc = false;
+    socketEventsMode = SOCKETEVENTS_SELECT;
+    epollfd = -1;
 }
 
 NodeId CConnman::GetNewNodeId()
@@ -2169,6 +2390,27 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
     nReceiveFloodSize = connOptions.nReceiveFloodSize;
 
+    socketEventsMode = connOptions.socketEventsMode;
+#ifdef USE_EPOLL
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        epollfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollfd == -1) {
+            strNodeError = strprintf("Failed to create epoll instance: %s", NetworkErrorString(WSAGetLastError()));
+            return false;
+        }
+        // Listening sockets stay level-triggered, events without a node mean accept
+        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
+            struct epoll_event event;
+            event.events = EPOLLIN;
+            event.data.ptr = NULL;
+            if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hListenSocket.socket, &event) != 0) {
+                strNodeError = strprintf("Failed to add listening socket to epoll: %s", NetworkErrorString(WSAGetLastError()));
+                return false;
+            }
+        }
+    }
+#endif
+
     SetBestHeight(connOptions.nBestHeight);
 
     clientInterface = connOptions.uiInterface;
@@ -2254,11 +2496,12 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     threadMnbRequestConnections = std::thread(&TraceThread<std::function<void()> >, "mnbcon", std::function<void()>(std::bind(&CConnman::ThreadMnbRequestConnections, this)));
 
     // Process messages
+    if (connOptions.nMsgProcThreads > 0) {
+        LogPrintf("Using %d message processing threads\n", connOptions.nMsgProcThreads);
+        msgProcPool.Start(connOptions.nMsgProcThreads, "msgproc");
+    }
     threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
 
-    // Process InfiniDEX
-    //threadInfiniDEX = std::thread(&TraceThread<std::function<void()> >, "infinidex", std::function<void()>(std::bind(&CConnman::ThreadInfiniDEXHandler, this)));
-
     // Process InfiniAPP
     //threadInfiniAPP = std::thread(&TraceThread<std::function<void()> >, "infiniapp", std::function<void()>(std::bind(&CConnman::ThreadInfiniAPPHandler, this)));
 
@@ -2311,6 +2554,7 @@ void CConnman::Stop()
 {
     if (threadMessageHandler.joinable())
         threadMessageHandler.join();
+    msgProcPool.Stop();
     if (threadMnbRequestConnections.joinable())
         threadMnbRequestConnections.join();
     if (threadOpenConnections.joinable())
@@ -2321,8 +2565,6 @@ void CConnman::Stop()
         threadDNSAddressSeed.join();
     if (threadSocketHandler.joinable())
         threadSocketHandler.join();
-    //if (threadInfiniDEX.joinable())
-        //threadInfiniDEX.join();
     //if (threadInfiniAPP.joinable())
         //threadInfiniAPP.join();        
 
@@ -2337,9 +2579,11 @@ void CConnman::Stop()
     }
 
     // Close sockets
-    BOOST_FOREACH(CNode* pnode, vNodes)
+    BOOST_FOREACH(CNode* pnode, vNodes) {
+        LOCK(pnode->cs_hSocket);
         if (pnode->hSocket != INVALID_SOCKET)
             CloseSocket(pnode->hSocket);
+    }
     BOOST_FOREACH(ListenSocket& hListenSocket, vhListenSocket)
         if (hListenSocket.socket != INVALID_SOCKET)
             if (!CloseSocket(hListenSocket.socket))
@@ -2354,7 +2598,13 @@ void CConnman::Stop()
     }
     vNodes.clear();
     vNodesDisconnected.clear();
+    setNodesRecvPending.clear();
     vhListenSocket.clear();
+#ifdef USE_EPOLL
+    if (epollfd != -1)
+        close(epollfd);
+    epollfd = -1;
+#endif
     delete semOutbound;
     semOutbound = NULL;
     delete semMasternodeOutbound;
@@ -2499,25 +2749,44 @@ void CConnman::RelayTransaction(const CTransaction& tx)
     RelayTransaction(tx, ss);
 }
 
+void AddRelayMessage(const CInv& inv, const CSerializedNetMsg& msg)
+{
+    LOCK(cs_mapRelay);
+    // Expire old relay messages
+    while (!vRelayExpiration.empty() && vRelayExpiration.front().first < GetTime())
+    {
+        mapRelay.erase(vRelayExpiration.front().second);
+        vRelayExpiration.pop_front();
+    }
+
+    // Save original serialized message so newer versions are preserved
+    if (mapRelay.insert(std::make_pair(inv, msg)).second)
+        vRelayExpiration.push_back(std::make_pair(GetTime() + 15 * 60, inv));
+}
+
+bool GetRelayMessage(const CInv& inv, CSerializedNetMsg& msg)
+{
+    LOCK(cs_mapRelay);
+    std::map<CInv, CSerializedNetMsg>::iterator mi = mapRelay.find(inv);
+    if (mi == mapRelay.end())
+        return false;
+    msg = mi->second;
+    return true;
+}
+
+void ForgetRelayMessage(const CInv& inv)
+{
+    LOCK(cs_mapRelay);
+    mapRelay.erase(inv);
+}
+
 void CConnman::RelayTransaction(const CTransaction& tx, const CDataStream& ss)
 {
     uint256 hash = tx.GetHash();
     int nInv = static_cast<bool>(CPrivateSend::GetDSTX(hash)) ? MSG_DSTX :
                 (instantsend.HasTxLockRequest(hash) ? MSG_TXLOCK_REQUEST : MSG_TX);
     CInv inv(nInv, hash);
-    {
-        LOCK(cs_mapRelay);
-        // Expire old relay messages
-        while (!vRelayExpiration.empty() && vRelayExpiration.front().first < GetTime())
-        {
-            mapRelay.erase(vRelayExpiration.front().second);
-            vRelayExpiration.pop_front();
-        }
-
-        // Save original serialized message so newer versions are preserved
-        mapRelay.insert(std::make_pair(inv, ss));
-        vRelayExpiration.push_back(std::make_pair(GetTime() + 15 * 60, inv));
-    }
+    AddRelayMessage(inv, MakeMessage(PROTOCOL_VERSION, inv.GetCommand(), ss));
     LOCK(cs_vNodes);
     BOOST_FOREACH(CNode* pnode, vNodes)
     {
@@ -2724,6 +2993,8 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nLocalServices = nLocalServicesIn;
     fPauseRecv = false;
     fPauseSend = false;
+    fSocketEventsSend = false;
+    fProcessingOnPool = false;
     nProcessQueueSize = 0;
 
     GetRandBytes((unsigned char*)&nLocalHostNonce, sizeof(nLocalHostNonce));
@@ -2824,7 +3095,12 @@ std::vector<unsigned char> CNode::CalculateKeyedNetGroup(CAddress& address)
 
 CDataStream CConnman::BeginMessage(CNode* pnode, int nVersion, int flags, const std::string& sCommand)
 {
-    return {SER_NETWORK, (nVersion ? nVersion : pnode->GetSendVersion()) | flags, CMessageHeader(Params().MessageStart(), sCommand.c_str(), 0) };
+    return BeginMessage((nVersion ? nVersion : pnode->GetSendVersion()) | flags, sCommand);
+}
+
+CDataStream CConnman::BeginMessage(int nVersion, const std::string& sCommand)
+{
+    return {SER_NETWORK, nVersion, CMessageHeader(Params().MessageStart(), sCommand.c_str(), 0) };
 }
 
 void CConnman::EndMessage(CDataStream& strm)
@@ -2844,8 +3120,16 @@ void CConnman::PushMessage(CNode* pnode, CDataStream& strm, const std::string& s
     if(strm.empty())
         return;
 
-    unsigned int nSize = strm.size() - CMessageHeader::HEADER_SIZE;
-    LogPrint("net", "sending %s (%d bytes) peer=%d\n",  SanitizeString(sCommand.c_str()), nSize, pnode->id);
+    PushMessage(pnode, CSerializedNetMsg(strm, sCommand));
+}
+
+void CConnman::PushMessage(CNode* pnode, const CSerializedNetMsg& msg)
+{
+    if(msg.IsNull())
+        return;
+
+    unsigned int nSize = msg.size() - CMessageHeader::HEADER_SIZE;
+    LogPrint("net", "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.sCommand.c_str()), nSize, pnode->id);
 
     size_t nBytesSent = 0;
     {
@@ -2854,11 +3138,11 @@ void CConnman::PushMessage(CNode* pnode, CDataStream& strm, const std::string& s
             return;
         }
         bool optimisticSend(pnode->vSendMsg.empty());
-        pnode->vSendMsg.emplace_back(strm.begin(), strm.end());
+        pnode->vSendMsg.push_back(msg.data);
 
         //log total amount of bytes per command
-        pnode->mapSendBytesPerMsgCmd[sCommand] += strm.size();
-        pnode->nSendSize += strm.size();
+        pnode->mapSendBytesPerMsgCmd[msg.sCommand] += msg.size();
+        pnode->nSendSize += msg.size();
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
@@ -2866,6 +3150,10 @@ void CConnman::PushMessage(CNode* pnode, CDataStream& strm, const std::string& s
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
             nBytesSent = SocketSendData(pnode);
+
+        // Have the socket handler finish what the optimistic write left
+        if (!pnode->vSendMsg.empty() && !pnode->fSocketEventsSend)
+            RequestSocketSend(pnode, true);
     }
     if (nBytesSent)
         RecordBytesSent(nBytesSent);
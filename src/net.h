@@ -19,6 +19,7 @@
 #include "uint256.h"
 #include "util.h"
 #include "threadinterrupt.h"
+#include "workpool.h"
 
 #include <atomic>
 #include <deque>
@@ -88,6 +89,16 @@ static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
 
 static const ServiceFlags REQUIRED_SERVICES = NODE_NETWORK;
 
+#ifdef HAVE_SYS_EPOLL_H
+#define USE_EPOLL 1
+#endif
+/** -socketevents default */
+static const char* const DEFAULT_SOCKETEVENTS = "select";
+/** -msgprocthreads default, 0 = auto */
+static const int DEFAULT_MSGPROC_THREADS = 0;
+/** Maximum number of message processing pool threads */
+static const int MAX_MSGPROC_THREADS = 16;
+
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 1;  // Default 1-hour ban
 
@@ -105,6 +116,22 @@ class CTransaction;
 class CNodeStats;
 class CClientUIInterface;
 
+/** A serialized message, header and payload. The buffer is immutable, so a
+ *  message serialized once can be queued to any number of peers without
+ *  copying it. */
+struct CSerializedNetMsg
+{
+    std::shared_ptr<const CSerializeData> data;
+    std::string sCommand;
+
+    CSerializedNetMsg() {}
+    CSerializedNetMsg(const CDataStream& strm, const std::string& sCommandIn) :
+        data(std::make_shared<const CSerializeData>(strm.begin(), strm.end())), sCommand(sCommandIn) {}
+
+    bool IsNull() const { return !data; }
+    size_t size() const { return data ? data->size() : 0; }
+};
+
 class CConnman
 {
 public:
@@ -116,6 +143,11 @@ public:
         CONNECTIONS_ALL = (CONNECTIONS_IN | CONNECTIONS_OUT),
     };
 
+    enum SocketEventsMode {
+        SOCKETEVENTS_SELECT = 0,
+        SOCKETEVENTS_EPOLL = 1,
+    };
+
     struct Options
     {
         ServiceFlags nLocalServices = NODE_NONE;
@@ -127,6 +159,8 @@ public:
         CClientUIInterface* uiInterface = nullptr;
         unsigned int nSendBufferMaxSize = 0;
         unsigned int nReceiveFloodSize = 0;
+        SocketEventsMode socketEventsMode = SOCKETEVENTS_SELECT;
+        int nMsgProcThreads = 0;
     };
     CConnman();
     ~CConnman();
@@ -201,6 +235,26 @@ public:
 		PushMessageWithVersionAndFlag(pnode, 0, 0, sCommand, std::forward<Args>(args)...);
 	}
 
+    /** Serialize a message once, for pushing it to many peers with PushMessage(pnode, msg) */
+    template <typename... Args>
+    CSerializedNetMsg MakeMessage(int nVersion, const std::string& sCommand, Args&&... args)
+    {
+        auto msg(BeginMessage(nVersion, sCommand));
+        ::SerializeMany(msg, msg.nType, msg.nVersion, std::forward<Args>(args)...);
+        EndMessage(msg);
+        return CSerializedNetMsg(msg, sCommand);
+    }
+
+    void PushMessage(CNode* pnode, const CSerializedNetMsg& msg);
+
+    bool IsMessagePoolRunning() const { return msgProcPool.IsRunning(); }
+    /**
+     * Process a message of pnode on the message processing pool. The message
+     * handler thread leaves the node alone until func returned, which keeps
+     * its messages in order.
+     */
+    void ProcessOnMessagePool(CNode* pnode, std::function<void()> func);
+
     template<typename Condition, typename Callable>
     bool ForEachNodeContinueIf(const Condition& cond, Callable&& func)
     {
@@ -401,9 +455,18 @@ private:
     void ThreadMessageHandler();
     void AcceptConnection(const ListenSocket& hListenSocket);
     void ThreadSocketHandler();
+    //! Read once from the socket, returns whether it may have more data
+    bool SocketRecvData(CNode *pnode);
+    void InactivityCheck(CNode *pnode);
+#ifdef USE_EPOLL
+    void SocketEventsEpoll();
+#endif
+    //! Watch the socket of a new node, with -socketevents=epoll
+    void AddSocketEvents(CNode *pnode);
+    //! Watch the socket for writability while the send queue is not empty
+    void RequestSocketSend(CNode *pnode, bool fSend);
     void ThreadDNSAddressSeed();
     void ThreadMnbRequestConnections();
-    //void ThreadInfiniDEXHandler();
     //void ThreadInfiniAPPHandler();
 
     void WakeMessageHandler();
@@ -432,6 +495,7 @@ private:
     void DumpBanlist();
 
     CDataStream BeginMessage(CNode* node, int nVersion, int flags, const std::string& sCommand);
+    CDataStream BeginMessage(int nVersion, const std::string& sCommand);
     void PushMessage(CNode* pnode, CDataStream& strm, const std::string& sCommand);
     void EndMessage(CDataStream& strm);
 
@@ -463,6 +527,12 @@ private:
     unsigned int nReceiveFloodSize;
 
     std::vector<ListenSocket> vhListenSocket;
+    SocketEventsMode socketEventsMode;
+    //! epoll instance watching the listening and peer sockets, -1 with select()
+    int epollfd;
+    //! Peers that may have unread data on an edge-triggered socket, only used
+    //! by the socket handler thread
+    std::set<CNode*> setNodesRecvPending;
     bool fNetworkActive;
     banmap_t setBanned;
     CCriticalSection cs_setBanned;
@@ -507,8 +577,10 @@ private:
     std::thread threadOpenConnections;
     std::thread threadMnbRequestConnections;
     std::thread threadMessageHandler;
-    //std::thread threadInfiniDEX;
     //std::thread threadInfiniAPP;
+
+    /** Threads for the messages that do not need to run on the message handler thread */
+    CWorkStealingPool msgProcPool;
 };
 extern std::unique_ptr<CConnman> g_connman;
 void Discover(boost::thread_group& threadGroup);
@@ -575,9 +647,15 @@ extern bool fDiscover;
 extern bool fListen;
 extern bool fRelayTxes;
 
-extern std::map<CInv, CDataStream> mapRelay;
+extern std::map<CInv, CSerializedNetMsg> mapRelay;
 extern std::deque<std::pair<int64_t, CInv> > vRelayExpiration;
 extern CCriticalSection cs_mapRelay;
+/** Keep the serialized message for an inventory item, so getdata requests from all peers are answered with the same buffer */
+void AddRelayMessage(const CInv& inv, const CSerializedNetMsg& msg);
+/** Look up the kept message of an inventory item */
+bool GetRelayMessage(const CInv& inv, CSerializedNetMsg& msg);
+/** Drop the kept message of an item whose serialization changed */
+void ForgetRelayMessage(const CInv& inv);
 extern limitedmap<uint256, int64_t> mapAlreadyAskedFor;
 
 /** Subversion as sent to the P2P network in `version` messages */
@@ -667,10 +745,11 @@ public:
     ServiceFlags nServices;
     ServiceFlags nServicesExpected;
     SOCKET hSocket;
+    CCriticalSection cs_hSocket; // guards closing hSocket against epoll re-arming
     size_t nSendSize; // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<CSerializeData> vSendMsg;
+    std::deque<std::shared_ptr<const CSerializeData> > vSendMsg;
     CCriticalSection cs_vSend;
 
     CCriticalSection cs_vProcessMsg;
@@ -720,6 +799,10 @@ public:
 
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+    // Whether the socket events include writability, protected by cs_vSend
+    bool fSocketEventsSend;
+    // Whether a message of this node is being processed on the message processing pool
+    std::atomic_bool fProcessingOnPool;
 protected:
 
     mapMsgCmdSize mapSendBytesPerMsgCmd;
@@ -37,6 +37,9 @@
 #include "masternodeman.h"
 #include "privatesend-client.h"
 #include "privatesend-server.h"
+#include "InfiniDEX/marketoverview.h"
+#include "InfiniDEX/orderbook.h"
+#include "InfiniDEX/trade.h"
 
 #include <boost/thread.hpp>
 
@@ -716,7 +719,10 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
         return instantsend.AlreadyHave(inv.hash);
 
     case MSG_SPORK:
-        return mapSporks.count(inv.hash);
+        {
+            CSporkMessage spork;
+            return sporkManager.GetSporkByHash(inv.hash, spork);
+        }
 
     case MSG_MASTERNODE_PAYMENT_VOTE:
         return mnpayments.mapMasternodePaymentVotes.count(inv.hash);
@@ -780,6 +786,16 @@ static void RelayAddress(const CAddress& addr, bool fReachable, CConnman& connma
     connman.ForEachNodeThen(std::move(sortfunc), std::move(pushfunc));
 }
 
+// Masternode and governance items can be erased or invalidated while their
+// message is still kept for relay, so they are only served from relay memory
+// after their own validity check
+static bool IsRevalidatedRelayType(int nType)
+{
+    return nType == MSG_TXLOCK_VOTE || nType == MSG_MASTERNODE_PAYMENT_VOTE ||
+           nType == MSG_MASTERNODE_ANNOUNCE || nType == MSG_MASTERNODE_PING ||
+           nType == MSG_GOVERNANCE_OBJECT_VOTE;
+}
+
 void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParams, CConnman& connman, std::atomic<bool>& interruptMsgProc)
 {
 	std::deque<CInv>::iterator it = pfrom->vRecvGetData.begin();
@@ -880,18 +896,11 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
 			{
 				// Send stream from relay memory
 				bool pushed = false;
-				{
-					CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-					{
-						LOCK(cs_mapRelay);
-						map<CInv, CDataStream>::iterator mi = mapRelay.find(inv);
-						if (mi != mapRelay.end()) {
-							ss += (*mi).second;
-							pushed = true;
-						}
-					}
+				if (!IsRevalidatedRelayType(inv.type)) {
+					CSerializedNetMsg msg;
+					pushed = GetRelayMessage(inv, msg);
 					if (pushed)
-						connman.PushMessage(pfrom, inv.GetCommand(), ss);
+						connman.PushMessage(pfrom, msg);
 				}
 
 				if (!pushed && inv.type == MSG_TX) {
@@ -919,19 +928,23 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
 				if (!pushed && inv.type == MSG_TXLOCK_VOTE) {
 					CTxLockVote vote;
 					if (instantsend.GetTxLockVote(inv.hash, vote)) {
-						CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-						ss.reserve(1000);
-						ss << vote;
-						connman.PushMessage(pfrom, NetMsgType::TXLOCKVOTE, ss);
+						// votes are requested by most peers, keep the message for the next ones
+						CSerializedNetMsg msg;
+						if (!GetRelayMessage(inv, msg)) {
+							msg = connman.MakeMessage(PROTOCOL_VERSION, NetMsgType::TXLOCKVOTE, vote);
+							AddRelayMessage(inv, msg);
+						}
+						connman.PushMessage(pfrom, msg);
 						pushed = true;
 					}
 				}
 
 				if (!pushed && inv.type == MSG_SPORK) {
-					if (mapSporks.count(inv.hash)) {
+					CSporkMessage spork;
+					if (sporkManager.GetSporkByHash(inv.hash, spork)) {
 						CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
 						ss.reserve(1000);
-						ss << mapSporks[inv.hash];
+						ss << spork;
 						connman.PushMessage(pfrom, NetMsgType::SPORK, ss);
 						pushed = true;
 					}
@@ -939,10 +952,12 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
 
 				if (!pushed && inv.type == MSG_MASTERNODE_PAYMENT_VOTE) {
 					if (mnpayments.HasVerifiedPaymentVote(inv.hash)) {
-						CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-						ss.reserve(1000);
-						ss << mnpayments.mapMasternodePaymentVotes[inv.hash];
-						connman.PushMessage(pfrom, NetMsgType::MASTERNODEPAYMENTVOTE, ss);
+						CSerializedNetMsg msg;
+						if (!GetRelayMessage(inv, msg)) {
+							msg = connman.MakeMessage(PROTOCOL_VERSION, NetMsgType::MASTERNODEPAYMENTVOTE, mnpayments.mapMasternodePaymentVotes[inv.hash]);
+							AddRelayMessage(inv, msg);
+						}
+						connman.PushMessage(pfrom, msg);
 						pushed = true;
 					}
 				}
@@ -968,20 +983,25 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
 
 				if (!pushed && inv.type == MSG_MASTERNODE_ANNOUNCE) {
 					if (mnodeman.mapSeenMasternodeBroadcast.count(inv.hash)) {
-						CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-						ss.reserve(1000);
-						ss << mnodeman.mapSeenMasternodeBroadcast[inv.hash].second;
-						connman.PushMessage(pfrom, NetMsgType::MNANNOUNCE, ss);
+						// forgotten again when a newer ping is stored into the broadcast
+						CSerializedNetMsg msg;
+						if (!GetRelayMessage(inv, msg)) {
+							msg = connman.MakeMessage(PROTOCOL_VERSION, NetMsgType::MNANNOUNCE, mnodeman.mapSeenMasternodeBroadcast[inv.hash].second);
+							AddRelayMessage(inv, msg);
+						}
+						connman.PushMessage(pfrom, msg);
 						pushed = true;
 					}
 				}
 
 				if (!pushed && inv.type == MSG_MASTERNODE_PING) {
 					if (mnodeman.mapSeenMasternodePing.count(inv.hash)) {
-						CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-						ss.reserve(1000);
-						ss << mnodeman.mapSeenMasternodePing[inv.hash];
-						connman.PushMessage(pfrom, NetMsgType::MNPING, ss);
+						CSerializedNetMsg msg;
+						if (!GetRelayMessage(inv, msg)) {
+							msg = connman.MakeMessage(PROTOCOL_VERSION, NetMsgType::MNPING, mnodeman.mapSeenMasternodePing[inv.hash]);
+							AddRelayMessage(inv, msg);
+						}
+						connman.PushMessage(pfrom, msg);
 						pushed = true;
 					}
 				}
@@ -1017,19 +1037,25 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
 				}
 
 				if (!pushed && inv.type == MSG_GOVERNANCE_OBJECT_VOTE) {
-					CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+					CSerializedNetMsg msg;
 					bool topush = false;
 					{
 						if (governance.HaveVoteForHash(inv.hash)) {
-							ss.reserve(1000);
-							if (governance.SerializeVoteForHash(inv.hash, ss)) {
-								topush = true;
+							topush = GetRelayMessage(inv, msg);
+							if (!topush) {
+								CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+								ss.reserve(1000);
+								if (governance.SerializeVoteForHash(inv.hash, ss)) {
+									msg = connman.MakeMessage(PROTOCOL_VERSION, NetMsgType::MNGOVERNANCEOBJECTVOTE, ss);
+									AddRelayMessage(inv, msg);
+									topush = true;
+								}
 							}
 						}
 					}
 					if (topush) {
 						LogPrint("net", "ProcessGetData -- pushing: inv = %s\n", inv.ToString());
-						connman.PushMessage(pfrom, NetMsgType::MNGOVERNANCEOBJECTVOTE, ss);
+						connman.PushMessage(pfrom, msg);
 						pushed = true;
 					}
 				}
@@ -1765,6 +1791,10 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
 
+        // Compute the Lyra2Z hashes of the whole batch in parallel before taking cs_main,
+        // the checks below and AcceptBlockHeader use the hashes cached in the headers
+        PrecomputeBlockHeaderHashes(headers);
+
         CBlockIndex *pindexLast = NULL;
         {
         LOCK(cs_main);
@@ -2156,6 +2186,9 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             sporkManager.ProcessSpork(pfrom, strCommand, vRecv, connman);
             masternodeSync.ProcessMessage(pfrom, strCommand, vRecv);
             governance.ProcessMessage(pfrom, strCommand, vRecv, connman);
+            orderBookManager.ProcessMessage(pfrom, strCommand, vRecv, connman);
+            marketOverviewManager.ProcessMessage(pfrom, strCommand, vRecv, connman);
+            userTradeManager.ProcessMessage(pfrom, strCommand, vRecv, connman);
         }
         else
         {
@@ -2167,6 +2200,54 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     return true;
 }
 
+// Messages that do not need cs_main for long, or only to look something up,
+// and can run on the message processing pool in parallel for different peers.
+// Their handlers take the locks they need themselves.
+static bool IsPoolMessage(const std::string& strCommand)
+{
+    return strCommand == NetMsgType::SPORK ||
+           strCommand == NetMsgType::MNPING ||
+           strCommand == NetMsgType::MNGOVERNANCEOBJECTVOTE;
+}
+
+// Processes a message, turning parse errors into reject messages
+static void HandleMessage(CNode* pfrom, const string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, unsigned int nMessageSize, CConnman& connman, std::atomic<bool>& interruptMsgProc)
+{
+    bool fRet = false;
+    try
+    {
+        fRet = ProcessMessage(pfrom, strCommand, vRecv, nTimeReceived, connman, interruptMsgProc);
+        if (interruptMsgProc)
+            return;
+    }
+    catch (const std::ios_base::failure& e)
+    {
+        connman.PushMessageWithVersion(pfrom, INIT_PROTO_VERSION, NetMsgType::REJECT, strCommand, REJECT_MALFORMED, string("error parsing message"));
+        if (strstr(e.what(), "end of data"))
+        {
+            // Allow exceptions from under-length message on vRecv
+            LogPrintf("%s(%s, %u bytes): Exception '%s' caught, normally caused by a message being shorter than its stated length\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
+        }
+        else if (strstr(e.what(), "size too large"))
+        {
+            // Allow exceptions from over-long size
+            LogPrintf("%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
+        }
+        else
+        {
+            PrintExceptionContinue(&e, "ProcessMessages()");
+        }
+    }
+    catch (const std::exception& e) {
+        PrintExceptionContinue(&e, "ProcessMessages()");
+    } catch (...) {
+        PrintExceptionContinue(NULL, "ProcessMessages()");
+    }
+
+    if (!fRet)
+        LogPrintf("%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->id);
+}
+
 bool ProcessMessages(CNode* pfrom, CConnman& connman, std::atomic<bool>& interruptMsgProc)
 {
     const CChainParams& chainparams = Params();
@@ -2238,42 +2319,21 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, std::atomic<bool>& interru
             return fMoreWork;
         }
 
-        // Process message
-        bool fRet = false;
-        try
-        {
-            fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, connman, interruptMsgProc);
-            if (interruptMsgProc)
-                return false;
-            if (!pfrom->vRecvGetData.empty())
-                fMoreWork = true;
-        }
-        catch (const std::ios_base::failure& e)
-        {
-            connman.PushMessageWithVersion(pfrom, INIT_PROTO_VERSION, NetMsgType::REJECT, strCommand, REJECT_MALFORMED, string("error parsing message"));
-            if (strstr(e.what(), "end of data"))
-            {
-                // Allow exceptions from under-length message on vRecv
-                LogPrintf("%s(%s, %u bytes): Exception '%s' caught, normally caused by a message being shorter than its stated length\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-            }
-            else if (strstr(e.what(), "size too large"))
-            {
-                // Allow exceptions from over-long size
-                LogPrintf("%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-            }
-            else
-            {
-                PrintExceptionContinue(&e, "ProcessMessages()");
-            }
-        }
-        catch (const std::exception& e) {
-            PrintExceptionContinue(&e, "ProcessMessages()");
-        } catch (...) {
-            PrintExceptionContinue(NULL, "ProcessMessages()");
+        if (connman.IsMessagePoolRunning() && pfrom->fSuccessfullyConnected && IsPoolMessage(strCommand)) {
+            // Nothing else of this peer is processed until the pool is done
+            // with the message, then the message handler is woken up again
+            std::shared_ptr<CNetMessage> pmsg = std::make_shared<CNetMessage>(std::move(msg));
+            connman.ProcessOnMessagePool(pfrom, [pfrom, pmsg, strCommand, nMessageSize, &connman, &interruptMsgProc]() {
+                HandleMessage(pfrom, strCommand, pmsg->vRecv, pmsg->nTime, nMessageSize, connman, interruptMsgProc);
+            });
+            return false;
         }
 
-        if (!fRet)
-            LogPrintf("%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->id);
+        HandleMessage(pfrom, strCommand, vRecv, msg.nTime, nMessageSize, connman, interruptMsgProc);
+        if (interruptMsgProc)
+            return false;
+        if (!pfrom->vRecvGetData.empty())
+            fMoreWork = true;
 
     return fMoreWork;
 }
@@ -11,7 +11,24 @@
 #include "crypto/common.h"
 #include "crypto/Lyra2Z.h"
 
+#include <stddef.h>
+
+// the hashed fields are the first BLOCK_HEADER_SIZE bytes of the object, in serialization order
+static_assert(offsetof(CBlockHeader, nNonce) + sizeof(uint32_t) == BLOCK_HEADER_SIZE, "CBlockHeader fields are not packed");
+
 uint256 CBlockHeader::GetHash() const
+{
+	if (fHashCached && memcmp(vchHashedHeader, BEGIN(nVersion), BLOCK_HEADER_SIZE) == 0)
+		return hashCached;
+
+	hashCached = ComputeHash();
+	memcpy(vchHashedHeader, BEGIN(nVersion), BLOCK_HEADER_SIZE);
+	fHashCached = true;
+	return hashCached;
+}
+
+//runs in the calling thread's Lyra2Z scratch memory, nothing is allocated
+uint256 CBlockHeader::ComputeHash() const
 {
 	uint256 powHash;
 	lyra2z_hash(BEGIN(nVersion), BEGIN(powHash));
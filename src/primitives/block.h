@@ -10,6 +10,11 @@
 #include "serialize.h"
 #include "uint256.h"
 
+#include <string.h>
+
+/** Size of the serialized header, which is also what the proof-of-work hash covers. */
+static const size_t BLOCK_HEADER_SIZE = 80;
+
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
  * requirements.  When they solve the proof-of-work, they broadcast the block
@@ -28,6 +33,15 @@ public:
     uint32_t nBits;
     uint32_t nNonce;
 
+    // memory only
+    // Lyra2Z hash of the header bytes it was computed for. GetHash() compares the
+    // fields against those bytes, so assigning any field invalidates it and copies
+    // carry it along. Like fChecked, it is not synchronized: hash an object once
+    // before handing it to other threads.
+    mutable bool fHashCached;
+    mutable unsigned char vchHashedHeader[BLOCK_HEADER_SIZE];
+    mutable uint256 hashCached;
+
     CBlockHeader()
     {
         SetNull();
@@ -54,6 +68,7 @@ public:
         nTime = 0;
         nBits = 0;
         nNonce = 0;
+        fHashCached = false;
     }
 
     bool IsNull() const
@@ -62,6 +77,7 @@ public:
     }
 
     uint256 GetHash() const;
+    uint256 ComputeHash() const;
 
     int64_t GetBlockTime() const
     {
@@ -111,14 +127,8 @@ public:
 
     CBlockHeader GetBlockHeader() const
     {
-        CBlockHeader block;
-        block.nVersion       = nVersion;
-        block.hashPrevBlock  = hashPrevBlock;
-        block.hashMerkleRoot = hashMerkleRoot;
-        block.nTime          = nTime;
-        block.nBits          = nBits;
-        block.nNonce         = nNonce;
-        return block;
+        // keeps the cached hash
+        return *this;
     }
 
     std::string ToString() const;
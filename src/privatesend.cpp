@@ -75,10 +75,11 @@ bool CDarksendQueue::CheckSignature(const CPubKey& pubKeyMasternode)
 
 bool CDarksendQueue::Relay(CConnman& connman)
 {
+    CSerializedNetMsg msg = connman.MakeMessage(PROTOCOL_VERSION, NetMsgType::DSQUEUE, (*this));
     std::vector<CNode*> vNodesCopy = connman.CopyNodeVector();
     BOOST_FOREACH(CNode* pnode, vNodesCopy)
         if(pnode->nVersion >= MIN_PRIVATESEND_PEER_PROTO_VERSION)
-            connman.PushMessage(pnode, NetMsgType::DSQUEUE, (*this));
+            connman.PushMessage(pnode, msg);
 
     connman.ReleaseNodeVector(vNodesCopy);
     return true;
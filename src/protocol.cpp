@@ -65,6 +65,9 @@ const char *DEXCOININFO="dexcoininfo";
 const char *DEXTRADEPAIR="dextradepair";
 const char *DEXORDERBIDBOOK="dexorderbidbook";
 const char *DEXORDERASKBOOK="dexorderaskbook";
+const char *DEXBIDDELTA="dexbiddelta";
+const char *DEXASKDELTA="dexaskdelta";
+const char *DEXGETBOOK="dexgetbook";
 const char *DEXMARKETOVERVIEW="dexmarketoverview";
 const char *DEXUSERCONNECTION="dexuserconnection";
 const char *DEXMNCONNECTION="dexmnconnection";
@@ -161,6 +164,9 @@ const static std::string allNetMessageTypes[] = {
     NetMsgType::DEXTRADEPAIR,
     NetMsgType::DEXORDERBIDBOOK,
     NetMsgType::DEXORDERASKBOOK,
+    NetMsgType::DEXBIDDELTA,
+    NetMsgType::DEXASKDELTA,
+    NetMsgType::DEXGETBOOK,
     NetMsgType::DEXMARKETOVERVIEW,
     NetMsgType::DEXUSERDEPOSIT,
     NetMsgType::DEXCHARTDATA,
@@ -248,6 +248,9 @@ extern const char *DEXCOININFO;
 extern const char *DEXTRADEPAIR;
 extern const char *DEXORDERBIDBOOK;
 extern const char *DEXORDERASKBOOK;
+extern const char *DEXBIDDELTA;
+extern const char *DEXASKDELTA;
+extern const char *DEXGETBOOK;
 extern const char *DEXMARKETOVERVIEW;
 extern const char *DEXUSERCONNECTION;
 extern const char *DEXMNCONNECTION;
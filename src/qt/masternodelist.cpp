@@ -273,12 +273,12 @@ void MasternodeList::updateNodeList()
     ui->tableWidgetMasternodes->setSortingEnabled(false);
     ui->tableWidgetMasternodes->clearContents();
     ui->tableWidgetMasternodes->setRowCount(0);
-    std::map<COutPoint, CMasternode> mapMasternodes = mnodeman.GetFullMasternodeMap();
+    CMasternodeRegistry::snapshot_t snapshot = mnodeman.GetMasternodeSnapshot();
     int offsetFromUtc = GetOffsetFromUtc();
 
-    for(auto& mnpair : mapMasternodes)
+    for(const auto& pmn : *snapshot)
     {
-        CMasternode mn = mnpair.second;
+        const CMasternode& mn = *pmn;
         // populate list
         // Address, Protocol, Status, Active Seconds, Last Seen, Pub Key
         QTableWidgetItem *addressItem = new QTableWidgetItem(QString::fromStdString(mn.addr.ToString()));
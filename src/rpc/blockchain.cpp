@@ -15,6 +15,7 @@
 #include "policy/policy.h"
 #include "primitives/transaction.h"
 #include "rpc/server.h"
+#include "script/sigcache.h"
 #include "streams.h"
 #include "sync.h"
 #include "txmempool.h"
@@ -980,6 +981,39 @@ UniValue getmempoolinfo(const UniValue& params, bool fHelp)
     return mempoolInfoToJSON();
 }
 
+UniValue getsigcacheinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getsigcacheinfo\n"
+            "\nReturns the size and usage counters of the script signature cache.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"bytes\": xxxxx,              (numeric) Memory allocated for the cache (see -maxsigcachesize)\n"
+            "  \"slots\": xxxxx,              (numeric) Number of signatures the cache can hold\n"
+            "  \"hits\": xxxxx,               (numeric) Signature checks answered by the cache\n"
+            "  \"misses\": xxxxx,             (numeric) Signature checks not found in the cache\n"
+            "  \"inserts\": xxxxx,            (numeric) Verified signatures added to the cache\n"
+            "  \"evictions\": xxxxx           (numeric) Entries dropped before they aged out\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getsigcacheinfo", "")
+            + HelpExampleRpc("getsigcacheinfo", "")
+        );
+
+    CSignatureCacheStats stats;
+    GetSignatureCacheStats(stats);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("bytes", (uint64_t)stats.nBytes));
+    ret.push_back(Pair("slots", (uint64_t)stats.nSlots));
+    ret.push_back(Pair("hits", stats.nHits));
+    ret.push_back(Pair("misses", stats.nMisses));
+    ret.push_back(Pair("inserts", stats.nInserts));
+    ret.push_back(Pair("evictions", stats.nEvictions));
+    return ret;
+}
+
 UniValue invalidateblock(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
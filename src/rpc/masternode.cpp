@@ -507,16 +507,16 @@ UniValue masternodelist(const UniValue& params, bool fHelp)
     if (strMode == "rank") {
         CMasternodeMan::rank_pair_vec_t vMasternodeRanks;
         mnodeman.GetMasternodeRanks(vMasternodeRanks);
-        BOOST_FOREACH(PAIRTYPE(int, CMasternode)& s, vMasternodeRanks) {
-            std::string strOutpoint = s.second.vin.prevout.ToStringShort();
+        BOOST_FOREACH(CMasternodeMan::rank_pair_t& s, vMasternodeRanks) {
+            std::string strOutpoint = s.second->vin.prevout.ToStringShort();
             if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
             obj.push_back(Pair(strOutpoint, s.first));
         }
     } else {
-        std::map<COutPoint, CMasternode> mapMasternodes = mnodeman.GetFullMasternodeMap();
-        for (auto& mnpair : mapMasternodes) {
-            CMasternode mn = mnpair.second;
-            std::string strOutpoint = mnpair.first.ToStringShort();
+        CMasternodeRegistry::snapshot_t snapshot = mnodeman.GetMasternodeSnapshot();
+        for (const auto& pmn : *snapshot) {
+            const CMasternode& mn = *pmn;
+            std::string strOutpoint = mn.vin.prevout.ToStringShort();
             if (strMode == "activeseconds") {
                 if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
                 obj.push_back(Pair(strOutpoint, (int64_t)(mn.lastPing.sigTime - mn.sigTime)));
@@ -249,6 +249,8 @@ UniValue getmininginfo(const UniValue& params, bool fHelp)
             "  \"errors\": \"...\"          (string) Current errors\n"
             "  \"generate\": true|false     (boolean) If the generation is on or off (see getgenerate or setgenerate calls)\n"
             "  \"genproclimit\": n          (numeric) The processor limit for generation. -1 if no generation. (see getgenerate or setgenerate calls)\n"
+            "  \"hashespersec\": n          (numeric) The hashes per second of the internal miner, 0 if it is not running\n"
+            "  \"shares\": n                (numeric) The shares found by the internal miner since it was started (see getminerstats)\n"
             "  \"pooledtx\": n              (numeric) The size of the mem pool\n"
             "  \"testnet\": true|false      (boolean) If using testnet or not\n"
             "  \"chain\": \"xxxx\",         (string) current network name as defined in BIP70 (main, test, regtest)\n"
@@ -259,6 +261,9 @@ UniValue getmininginfo(const UniValue& params, bool fHelp)
         );
 
 
+    CMinerStats minerstats;
+    GetMinerStats(minerstats);
+
     LOCK(cs_main);
 
     UniValue obj(UniValue::VOBJ);
@@ -268,6 +273,8 @@ UniValue getmininginfo(const UniValue& params, bool fHelp)
     obj.push_back(Pair("difficulty",       (double)GetDifficulty()));
     obj.push_back(Pair("errors",           GetWarnings("statusbar")));
     obj.push_back(Pair("genproclimit",     (int)GetArg("-genproclimit", DEFAULT_GENERATE_THREADS)));
+    obj.push_back(Pair("hashespersec",     minerstats.dHashesPerSec));
+    obj.push_back(Pair("shares",           minerstats.nShares));
     obj.push_back(Pair("networkhashps",    getnetworkhashps(params, false)));
     obj.push_back(Pair("pooledtx",         (uint64_t)mempool.size()));
     obj.push_back(Pair("testnet",          Params().TestnetToBeDeprecatedFieldRPC()));
@@ -277,6 +284,67 @@ UniValue getmininginfo(const UniValue& params, bool fHelp)
 }
 
 
+UniValue getminerstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getminerstats\n"
+            "\nReturns the statistics of the internal miner since it was last started."
+            "\nResult:\n"
+            "{\n"
+            "  \"generate\": true|false     (boolean) If the internal miner is running\n"
+            "  \"threads\": n               (numeric) The number of worker threads\n"
+            "  \"uptime\": n                (numeric) Seconds since the miner was started\n"
+            "  \"hashespersec\": n          (numeric) The hashes per second of all threads\n"
+            "  \"hashes\": n                (numeric) The hashes computed\n"
+            "  \"shares\": n                (numeric) The hashes meeting the block target times 2^" + itostr(MINER_SHARE_TARGET_SHIFT) + "\n"
+            "  \"blocks\": n                (numeric) The blocks found and accepted\n"
+            "  \"templates\": n             (numeric) The block templates created\n"
+            "  \"workers\": [               (array) Worker threads\n"
+            "    {\n"
+            "      \"thread\": n            (numeric) Index of the thread\n"
+            "      \"noncebegin\": n        (numeric) First nonce of the thread's range\n"
+            "      \"nonceend\": n          (numeric) Last nonce of the thread's range\n"
+            "      \"hashes\": n            (numeric) The hashes computed by the thread\n"
+            "      \"hashespersec\": n      (numeric) The hashes per second of the thread\n"
+            "    }\n"
+            "    ,...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getminerstats", "")
+            + HelpExampleRpc("getminerstats", "")
+        );
+
+    CMinerStats stats;
+    GetMinerStats(stats);
+
+    UniValue workers(UniValue::VARR);
+    for (size_t i = 0; i < stats.vThreads.size(); i++) {
+        const CMinerThreadStats& thread = stats.vThreads[i];
+        UniValue worker(UniValue::VOBJ);
+        worker.push_back(Pair("thread",       (uint64_t)i));
+        worker.push_back(Pair("noncebegin",   (uint64_t)thread.nNonceBegin));
+        worker.push_back(Pair("nonceend",     (uint64_t)thread.nNonceEnd));
+        worker.push_back(Pair("hashes",       thread.nHashes));
+        worker.push_back(Pair("hashespersec", thread.dHashesPerSec));
+        workers.push_back(worker);
+    }
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("generate",     stats.fRunning));
+    obj.push_back(Pair("threads",      (uint64_t)stats.vThreads.size()));
+    obj.push_back(Pair("uptime",       stats.fRunning ? GetTime() - stats.nStartTime : 0));
+    obj.push_back(Pair("hashespersec", stats.dHashesPerSec));
+    obj.push_back(Pair("hashes",       stats.nHashes));
+    obj.push_back(Pair("shares",       stats.nShares));
+    obj.push_back(Pair("blocks",       stats.nBlocks));
+    obj.push_back(Pair("templates",    stats.nTemplates));
+    obj.push_back(Pair("workers",      workers));
+    return obj;
+}
+
+
 // NOTE: Unlike wallet RPC (which use BTC values), mining RPCs follow GBT (BIP 22) in using satoshi amounts
 UniValue prioritisetransaction(const UniValue& params, bool fHelp)
 {
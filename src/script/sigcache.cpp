@@ -5,29 +5,14 @@
 
 #include "sigcache.h"
 
-#include "memusage.h"
+#include "cuckoocache.h"
 #include "pubkey.h"
 #include "random.h"
 #include "uint256.h"
 #include "util.h"
 
-#include <boost/thread.hpp>
-#include <boost/unordered_set.hpp>
-
 namespace {
 
-/**
- * We're hashing a nonce into the entries themselves, so we don't need extra
- * blinding in the set hash computation.
- */
-class CSignatureCacheHasher
-{
-public:
-    size_t operator()(const uint256& key) const {
-        return key.GetCheapHash();
-    }
-};
-
 /**
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
  * twice for every transaction (once when accepted into memory pool, and
@@ -38,10 +23,7 @@ class CSignatureCache
 private:
      //! Entries are SHA256(nonce || signature hash || public key || signature):
     uint256 nonce;
-    typedef boost::unordered_set<uint256, CSignatureCacheHasher> map_type;
-    map_type setValid;
-    boost::shared_mutex cs_sigcache;
-
+    CCuckooCache setValid;
 
 public:
     CSignatureCache()
@@ -56,52 +38,62 @@ public:
     }
 
     bool
-    Get(const uint256& entry)
+    Get(const uint256& entry, bool erase)
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
-        return setValid.count(entry);
+        return setValid.Contains(entry, erase);
     }
 
-    void Erase(const uint256& entry)
+    void Set(const uint256& entry)
     {
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
-        setValid.erase(entry);
+        setValid.Insert(entry);
     }
 
-    void Set(const uint256& entry)
+    size_t Setup(size_t nBytes)
+    {
+        return setValid.Setup(nBytes);
+    }
+
+    void GetStats(CCuckooCache::Stats& stats)
     {
-        size_t nMaxCacheSize = GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
-        if (nMaxCacheSize <= 0) return;
-
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
-        while (memusage::DynamicUsage(setValid) > nMaxCacheSize)
-        {
-            map_type::size_type s = GetRand(setValid.bucket_count());
-            map_type::local_iterator it = setValid.begin(s);
-            if (it != setValid.end(s)) {
-                setValid.erase(*it);
-            }
-        }
-
-        setValid.insert(entry);
+        setValid.GetStats(stats);
     }
 };
 
+/* In previous versions of this code, signatureCache was a local static
+ * variable in CachingTransactionSignatureChecker::VerifySignature. It is
+ * initialized explicitly now, so its size is only read from the arguments
+ * once and not on every insertion.
+ */
+static CSignatureCache signatureCache;
+
 }
 
-bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
+void InitSignatureCache()
+{
+    size_t nMaxCacheSize = std::max<int64_t>(0, GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE)) * ((size_t) 1 << 20);
+    size_t nBytes = signatureCache.Setup(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu MiB requested for signature cache\n", nBytes >> 20, nMaxCacheSize >> 20);
+}
+
+void GetSignatureCacheStats(CSignatureCacheStats& stats)
 {
-    static CSignatureCache signatureCache;
+    CCuckooCache::Stats cacheStats;
+    signatureCache.GetStats(cacheStats);
+    stats.nBytes = cacheStats.nBytes;
+    stats.nSlots = cacheStats.nSlots;
+    stats.nHits = cacheStats.nHits;
+    stats.nMisses = cacheStats.nMisses;
+    stats.nInserts = cacheStats.nInserts;
+    stats.nEvictions = cacheStats.nEvictions;
+}
 
+bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
+{
     uint256 entry;
     signatureCache.ComputeEntry(entry, sighash, vchSig, pubkey);
 
-    if (signatureCache.Get(entry)) {
-        if (!store) {
-            signatureCache.Erase(entry);
-        }
+    if (signatureCache.Get(entry, !store))
         return true;
-    }
 
     if (!TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash))
         return false;
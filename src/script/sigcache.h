@@ -10,12 +10,22 @@
 
 #include <vector>
 
-// DoS prevention: limit cache size to less than 40MB (over 500000
-// entries on 64-bit systems).
+// DoS prevention: limit cache size to 40MiB (about 1.2 million entries).
 static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 40;
 
 class CPubKey;
 
+/** Size and usage counters of the signature cache */
+struct CSignatureCacheStats
+{
+    size_t nBytes;
+    size_t nSlots;
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nInserts;
+    uint64_t nEvictions;
+};
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
@@ -27,4 +37,9 @@ public:
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 };
 
+/** Allocate the signature cache, sized by -maxsigcachesize */
+void InitSignatureCache();
+/** Get the size and hit/miss counters of the signature cache */
+void GetSignatureCacheStats(CSignatureCacheStats& stats);
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
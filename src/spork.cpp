@@ -38,18 +38,21 @@ void CSporkManager::ProcessSpork(CNode* pfrom, std::string& strCommand, CDataStr
 			strLogMsg = strprintf("SPORK -- hash: %s id: %d numeric value: %d text value: %s bestHeight: %d peer=%d", hash.ToString(), Spork.nSporkID, Spork.nNumericValue, Spork.nTextValue, chainActive.Height(), pfrom->id);
 		}
 
-		if (mapSporksActive.count(Spork.nSporkID)) {
-			if (mapSporksActive[Spork.nSporkID].nTimeSigned >= Spork.nTimeSigned) {
-				LogPrint("spork", "%s seen\n", strLogMsg);
-				return;
+		{
+			LOCK(cs);
+			if (mapSporksActive.count(Spork.nSporkID)) {
+				if (mapSporksActive[Spork.nSporkID].nTimeSigned >= Spork.nTimeSigned) {
+					LogPrint("spork", "%s seen\n", strLogMsg);
+					return;
+				}
+				else {
+					LogPrintf("%s updated\n", strLogMsg);
+				}
 			}
 			else {
-				LogPrintf("%s updated\n", strLogMsg);
+				LogPrintf("%s new\n", strLogMsg);
 			}
 		}
-		else {
-			LogPrintf("%s new\n", strLogMsg);
-		}
 
 		if (!Spork.CheckSignature()) {
 			LogPrintf("CSporkManager::ProcessSpork -- invalid signature\n");
@@ -57,8 +60,14 @@ void CSporkManager::ProcessSpork(CNode* pfrom, std::string& strCommand, CDataStr
 			return;
 		}
 
-		mapSporks[hash] = Spork;
-		mapSporksActive[Spork.nSporkID] = Spork;
+		{
+			LOCK(cs);
+			//another peer may have delivered the same or a newer spork meanwhile
+			if (mapSporksActive.count(Spork.nSporkID) && mapSporksActive[Spork.nSporkID].nTimeSigned >= Spork.nTimeSigned)
+				return;
+			mapSporks[hash] = Spork;
+			mapSporksActive[Spork.nSporkID] = Spork;
+		}
 		Spork.Relay(connman);
 		
 		int sporkType = GetSporkType(Spork.nSporkID);
@@ -71,12 +80,15 @@ void CSporkManager::ProcessSpork(CNode* pfrom, std::string& strCommand, CDataStr
 	}
 	else if (strCommand == NetMsgType::GETSPORKS) {
 
-		std::map<int, CSporkMessage>::iterator it = mapSporksActive.begin();
-
-		while (it != mapSporksActive.end()) {
-			connman.PushMessage(pfrom, NetMsgType::SPORK, it->second);
-			it++;
+		std::vector<CSporkMessage> vSporks;
+		{
+			LOCK(cs);
+			for (std::map<int, CSporkMessage>::iterator it = mapSporksActive.begin(); it != mapSporksActive.end(); ++it)
+				vSporks.push_back(it->second);
 		}
+
+		for (const CSporkMessage& spork : vSporks)
+			connman.PushMessage(pfrom, NetMsgType::SPORK, spork);
 	}
 }
 
@@ -138,6 +150,7 @@ bool CSporkManager::UpdateNumericSpork(int nSporkID, int64_t nValue, CConnman& c
 		return false;
 
 	spork.Relay(connman);
+	LOCK(cs);
 	mapSporks[spork.GetHash()] = spork;
 	mapSporksActive[nSporkID] = spork;
 	return true;
@@ -151,11 +164,22 @@ bool CSporkManager::UpdateTextSpork(int nSporkID, std::string nValue, CConnman&
 		return false;
 
 	spork.Relay(connman);
+	LOCK(cs);
 	mapSporks[spork.GetHash()] = spork;
 	mapSporksActive[nSporkID] = spork;
 	return true;
 }
 
+bool CSporkManager::GetSporkByHash(const uint256& hash, CSporkMessage& sporkRet) const
+{
+	LOCK(cs);
+	std::map<uint256, CSporkMessage>::const_iterator it = mapSporks.find(hash);
+	if (it == mapSporks.end())
+		return false;
+	sporkRet = it->second;
+	return true;
+}
+
 bool CSporkManager::IsSporkActive(int nSporkID)
 {
 	int sporkType = GetSporkType(nSporkID);
@@ -186,8 +210,11 @@ int64_t CSporkManager::GetNumericSporkValue(int nSporkID)
 		return -1;
 	}	
 
-	if (mapSporksActive.count(nSporkID))
-		return mapSporksActive[nSporkID].nNumericValue;
+	{
+		LOCK(cs);
+		if (mapSporksActive.count(nSporkID))
+			return mapSporksActive[nSporkID].nNumericValue;
+	}
 
 	switch (nSporkID)
 	{
@@ -217,8 +244,11 @@ std::string CSporkManager::GetTextSporkValue(int nSporkID)
 		return "";
 	}
 
-	if (mapSporksActive.count(nSporkID))
-		return mapSporksActive[nSporkID].nTextValue;
+	{
+		LOCK(cs);
+		if (mapSporksActive.count(nSporkID))
+			return mapSporksActive[nSporkID].nTextValue;
+	}
 
 	switch (nSporkID)
 	{
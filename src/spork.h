@@ -108,6 +108,8 @@ public:
 class CSporkManager
 {
 private:
+    // protects mapSporksActive and mapSporks, sporks arrive on the message processing pool
+    mutable CCriticalSection cs;
     std::vector<unsigned char> vchSig;
     std::string strMasterPrivKey;
     std::map<int, CSporkMessage> mapSporksActive;
@@ -122,6 +124,7 @@ public:
     bool UpdateNumericSpork(int nSporkID, int64_t nValue, CConnman& connman);
 	bool UpdateTextSpork(int nSporkID, std::string nValue, CConnman& connman);
 
+    bool GetSporkByHash(const uint256& hash, CSporkMessage& sporkRet) const;
     bool IsSporkActive(int nSporkID);
     int64_t GetNumericSporkValue(int nSporkID);
 	std::string GetTextSporkValue(int nSporkID);
@@ -0,0 +1,134 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "InfiniDEX/balanceledger.h"
+#include "InfiniDEX/userbalance.h"
+
+#include "test/test_infinex.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(balanceledger_tests, BasicTestingSetup)
+
+static const std::string strAlice = "02a1b2c3d4e5f60718293a4b5c6d7e8f90a1b2c3d4e5f60718293a4b5c6d7e8f90";
+static const std::string strBob = "03b1b2c3d4e5f60718293a4b5c6d7e8f90a1b2c3d4e5f60718293a4b5c6d7e8f90";
+
+static void CheckBalances(const CBalanceLedger& ledger)
+{
+    BOOST_CHECK_EQUAL(ledger.GetAccountCount(), 2);
+    BOOST_CHECK_EQUAL(ledger.GetBalance(1, strAlice, BALANCE_AVAILABLE), 700);
+    BOOST_CHECK_EQUAL(ledger.GetBalance(1, strAlice, BALANCE_IN_EXCHANGE), 300);
+    BOOST_CHECK_EQUAL(ledger.GetBalance(2, strBob, BALANCE_AVAILABLE), 50);
+    BOOST_CHECK_EQUAL(ledger.GetBalance(2, strBob, BALANCE_PENDING_DEPOSIT), 25);
+    BOOST_CHECK_EQUAL(ledger.GetBalance(1, strBob, BALANCE_AVAILABLE), 0);
+    BOOST_CHECK(!ledger.IsBalanceExist(1, strBob));
+}
+
+static void FillLedger(CBalanceLedger& ledger)
+{
+    ledger.Adjust(1, strAlice, BALANCE_AVAILABLE, 1000);
+    BOOST_CHECK(ledger.Move(1, strAlice, BALANCE_AVAILABLE, 400, BALANCE_IN_EXCHANGE, 400, true));
+    BOOST_CHECK(!ledger.Move(1, strAlice, BALANCE_AVAILABLE, 700, BALANCE_IN_EXCHANGE, 700, true));
+    BOOST_CHECK(ledger.Move(1, strAlice, BALANCE_IN_EXCHANGE, 100, BALANCE_AVAILABLE, 100, true));
+    ledger.Adjust(2, strBob, BALANCE_PENDING_DEPOSIT, 75);
+    BOOST_CHECK(ledger.Move(2, strBob, BALANCE_PENDING_DEPOSIT, 50, BALANCE_AVAILABLE, 50, true));
+}
+
+BOOST_AUTO_TEST_CASE(balanceledger_memory)
+{
+    CBalanceLedger ledger;
+    FillLedger(ledger);
+    CheckBalances(ledger);
+
+    CUserBalance userBalance;
+    BOOST_CHECK(ledger.GetUserBalance(1, strAlice, userBalance));
+    BOOST_CHECK_EQUAL(userBalance.nAvailableBalance, 700);
+    BOOST_CHECK_EQUAL(userBalance.nTotalBalance, 1000);
+    BOOST_CHECK(!ledger.GetUserBalance(2, strAlice, userBalance));
+
+    userBalance.nAvailableBalance = 5;
+    userBalance.nLastDepositID = 7;
+    BOOST_CHECK(ledger.SetUserBalance(userBalance));
+    BOOST_CHECK_EQUAL(ledger.GetBalance(1, strAlice, BALANCE_AVAILABLE), 5);
+    BOOST_CHECK_EQUAL(ledger.GetLastDepositID(1, strAlice), 7);
+}
+
+BOOST_AUTO_TEST_CASE(balanceledger_recovery)
+{
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    CBalanceLedger ledger;
+    BOOST_CHECK(ledger.Open(path));
+    FillLedger(ledger);
+
+    //replay of the log alone, as after a crash
+    {
+        CBalanceLedger recovered;
+        BOOST_CHECK(recovered.Open(path));
+        CheckBalances(recovered);
+    }
+
+    //a torn record at the end of the log is dropped
+    {
+        FILE* file = fopen((path / "balances.log").string().c_str(), "ab");
+        fwrite("\x40\x00\x00\x00garbage", 1, 11, file);
+        fclose(file);
+        CBalanceLedger recovered;
+        BOOST_CHECK(recovered.Open(path));
+        CheckBalances(recovered);
+        recovered.Close();
+    }
+
+    //the snapshot written on close, with the log started over
+    ledger.Close();
+    BOOST_CHECK(boost::filesystem::exists(path / "balances.dat"));
+    BOOST_CHECK_EQUAL(boost::filesystem::file_size(path / "balances.log"), 0);
+    BOOST_CHECK(ledger.Open(path));
+    CheckBalances(ledger);
+    ledger.Close();
+    boost::filesystem::remove_all(path);
+}
+
+BOOST_AUTO_TEST_CASE(balanceledger_snapshot_interval)
+{
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    CBalanceLedger ledger;
+    BOOST_CHECK(ledger.Open(path, 4));
+    FillLedger(ledger);
+    BOOST_CHECK(boost::filesystem::exists(path / "balances.dat"));
+
+    //snapshot and the records logged after it
+    CBalanceLedger recovered;
+    BOOST_CHECK(recovered.Open(path, 4));
+    CheckBalances(recovered);
+    recovered.Close();
+    ledger.Close();
+    boost::filesystem::remove_all(path);
+}
+
+BOOST_AUTO_TEST_CASE(balanceledger_invalid_record)
+{
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    CBalanceLedger ledger;
+    BOOST_CHECK(ledger.Open(path));
+    FillLedger(ledger);
+    uint64_t nLogSize = boost::filesystem::file_size(path / "balances.log");
+
+    //a record that would not replay is neither logged nor partly applied
+    std::vector<CBalanceChange> vChange;
+    vChange.push_back(CBalanceChange(1, strAlice, BALANCE_AVAILABLE, -700));
+    vChange.push_back(CBalanceChange(1, "", BALANCE_AVAILABLE, 700));
+    BOOST_CHECK(!ledger.Adjust(vChange));
+    BOOST_CHECK_EQUAL(boost::filesystem::file_size(path / "balances.log"), nLogSize);
+    CheckBalances(ledger);
+
+    CBalanceLedger recovered;
+    BOOST_CHECK(recovered.Open(path));
+    CheckBalances(recovered);
+    recovered.Close();
+    ledger.Close();
+    boost::filesystem::remove_all(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
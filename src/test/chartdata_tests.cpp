@@ -0,0 +1,77 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "InfiniDEX/chartdata.h"
+
+#include "test/test_infinex.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(chartdata_tests, BasicTestingSetup)
+
+static const uint64_t nMinute = 60;
+static const uint64_t nDayStart = 1514764800; // 2018-01-01 00:00 UTC, in seconds like CActualTrade::nTradeTime
+
+BOOST_AUTO_TEST_CASE(chartdata_rollup)
+{
+    CChartDataSeries series(1);
+    CChartData chartData;
+    BOOST_CHECK(!series.GetLastChartData(MINUTE_CHART_DATA, chartData));
+
+    series.InputNewTrade(100, 2, nDayStart + 1, 0);
+    series.InputNewTrade(120, 1, nDayStart + 2, 0);
+    series.InputNewTrade(90, 1, nDayStart + 6 * nMinute, 0);
+    series.InputNewTrade(110, 3, nDayStart + 16 * nMinute, 0);
+
+    BOOST_CHECK(series.GetLastChartData(MINUTE_CHART_DATA, chartData));
+    BOOST_CHECK_EQUAL(chartData.nStartTime, nDayStart + 16 * nMinute);
+    BOOST_CHECK_EQUAL(chartData.nEndTime, nDayStart + 17 * nMinute);
+    BOOST_CHECK_EQUAL(chartData.nNoOfTrades, 1);
+
+    BOOST_CHECK(series.GetLastChartData(FIVE_MINUTE_CHART_DATA, chartData));
+    BOOST_CHECK_EQUAL(chartData.nStartTime, nDayStart + 15 * nMinute);
+
+    // the first quarter hour has the first three trades
+    std::vector<CChartData> vChartData;
+    BOOST_CHECK_EQUAL(series.GetChartData(FIFTEEN_MINUTE_CHART_DATA, nDayStart, nDayStart + 60 * nMinute, vChartData), 2);
+    BOOST_CHECK_EQUAL(vChartData[0].nOpenPrice, 100);
+    BOOST_CHECK_EQUAL(vChartData[0].nHighPrice, 120);
+    BOOST_CHECK_EQUAL(vChartData[0].nLowPrice, 90);
+    BOOST_CHECK_EQUAL(vChartData[0].nClosePrice, 90);
+    BOOST_CHECK_EQUAL(vChartData[0].nQty, 4);
+    BOOST_CHECK_EQUAL(vChartData[0].nAmount, 410);
+    BOOST_CHECK_EQUAL(vChartData[1].nOpenPrice, 110);
+
+    for (chart_period_enum period : { HOUR_CHART_DATA, FOUR_HOUR_CHART_DATA, DAY_CHART_DATA }) {
+        BOOST_CHECK(series.GetLastChartData(period, chartData));
+        BOOST_CHECK_EQUAL(chartData.nStartTime, nDayStart);
+        BOOST_CHECK_EQUAL(chartData.nOpenPrice, 100);
+        BOOST_CHECK_EQUAL(chartData.nClosePrice, 110);
+        BOOST_CHECK_EQUAL(chartData.nNoOfTrades, 4);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(chartdata_retention)
+{
+    CChartDataSeries series(1);
+    // two days of one trade per minute, the minute ring only keeps the last day
+    for (uint64_t i = 0; i < 2 * 1440; i++)
+        series.InputNewTrade(100 + i, 1, nDayStart + i * nMinute, 0);
+
+    std::vector<CChartData> vChartData;
+    BOOST_CHECK_EQUAL(series.GetChartData(MINUTE_CHART_DATA, 0, nDayStart + 2 * 1440 * nMinute, vChartData), 1440);
+    BOOST_CHECK_EQUAL(vChartData.front().nStartTime, nDayStart + 1440 * nMinute);
+    BOOST_CHECK_EQUAL(vChartData.back().nStartTime, nDayStart + (2 * 1440 - 1) * nMinute);
+
+    // a trade older than the ring is ignored for minutes but still counts for days
+    series.InputNewTrade(1, 1, nDayStart, 0);
+    vChartData.clear();
+    BOOST_CHECK_EQUAL(series.GetChartData(MINUTE_CHART_DATA, nDayStart, nDayStart + nMinute, vChartData), 0);
+    vChartData.clear();
+    BOOST_CHECK_EQUAL(series.GetChartData(DAY_CHART_DATA, nDayStart, nDayStart, vChartData), 1);
+    BOOST_CHECK_EQUAL(vChartData[0].nLowPrice, 1);
+    BOOST_CHECK_EQUAL(vChartData[0].nNoOfTrades, 1441);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
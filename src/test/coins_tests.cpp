@@ -4,7 +4,9 @@
 
 #include "coins.h"
 #include "random.h"
+#include "txdb.h"
 #include "uint256.h"
+#include "util.h"
 #include "test/test_infinex.h"
 #include "validation.h"
 #include "consensus/validation.h"
@@ -12,6 +14,7 @@
 #include <vector>
 #include <map>
 
+#include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
 
 namespace
@@ -73,7 +76,7 @@ public:
     void SelfTest() const
     {
         // Manually recompute the dynamic usage of the whole data, and compare it.
-        size_t ret = memusage::DynamicUsage(cacheCoins);
+        size_t ret = cacheCoins.DynamicMemoryUsage();
         for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end(); it++) {
             ret += it->second.coins.DynamicMemoryUsage();
         }
@@ -97,7 +100,7 @@ static const unsigned int NUM_SIMULATION_ITERATIONS = 40000;
 //
 // During the process, booleans are kept to make sure that the randomized
 // operation hits all branches.
-BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
+static void SimulateCoinsCache()
 {
     // Various coverage trackers.
     bool removed_all_caches = false;
@@ -211,6 +214,20 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
     BOOST_CHECK(missed_an_entry);
 }
 
+BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
+{
+    SimulateCoinsCache();
+}
+
+BOOST_AUTO_TEST_CASE(coins_cache_simulation_flat_test)
+{
+    // The same simulation with every cache on the flat map
+    CCoinsMap::Implementation implPrev = CCoinsMap::GetDefaultImplementation();
+    CCoinsMap::SetDefaultImplementation(CCoinsMap::FLAT);
+    SimulateCoinsCache();
+    CCoinsMap::SetDefaultImplementation(implPrev);
+}
+
 // This test is similar to the previous test
 // except the emphasis is on testing the functionality of UpdateCoins
 // random txs are created and UpdateCoins is used to update the cache stack
@@ -347,4 +364,178 @@ BOOST_AUTO_TEST_CASE(updatecoins_simulation_test)
     BOOST_CHECK(spent_a_duplicate_coinbase);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_cache_prefetch)
+{
+    // Coins read from the base view on another thread and handed to
+    // CacheCoins must behave as if the cache had fetched them itself.
+    CCoinsViewTest base;
+    uint256 txid = GetRandHash();
+    {
+        CCoinsViewCacheTest writer(&base);
+        {
+            CCoinsModifier coins = writer.ModifyCoins(txid);
+            coins->vout.resize(2);
+            coins->vout[0].nValue = 5;
+            coins->vout[1].nValue = 7;
+            coins->nHeight = 10;
+        }
+        BOOST_CHECK(writer.Flush());
+    }
+
+    CCoinsViewCacheTest cache(&base);
+    CCoins prefetched;
+    BOOST_CHECK(cache.GetBackend()->GetCoins(txid, prefetched));
+    BOOST_CHECK(!cache.HaveCoinsInCache(txid));
+    cache.CacheCoins(txid, prefetched);
+    BOOST_CHECK(cache.HaveCoinsInCache(txid));
+    cache.SelfTest();
+
+    const CCoins* coins = cache.AccessCoins(txid);
+    BOOST_CHECK(coins != NULL);
+    BOOST_CHECK_EQUAL(coins->vout.size(), 2U);
+    BOOST_CHECK_EQUAL(coins->vout[1].nValue, 7);
+    BOOST_CHECK_EQUAL(coins->nHeight, 10);
+
+    // An entry already in the cache is never replaced
+    CCoins stale;
+    stale.vout.resize(1);
+    stale.nHeight = 1;
+    cache.CacheCoins(txid, stale);
+    BOOST_CHECK_EQUAL(cache.AccessCoins(txid)->nHeight, 10);
+    cache.SelfTest();
+
+    // Spending a prefetched output reaches the base view on flush
+    cache.ModifyCoins(txid)->Spend(0);
+    BOOST_CHECK(cache.Flush());
+    CCoins flushed;
+    BOOST_CHECK(base.GetCoins(txid, flushed));
+    BOOST_CHECK(!flushed.IsAvailable(0));
+    BOOST_CHECK(flushed.IsAvailable(1));
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_db_async_flush)
+{
+    // Every entry ends a batch, so the flushes take the multi-batch path
+    mapArgs["-dbbatchsize"] = "1";
+    {
+        CCoinsViewDB db(1 << 20, true, false, true);
+        std::vector<uint256> vTxid(100);
+        uint256 hashFirst = GetRandHash();
+        uint256 hashSecond = GetRandHash();
+        {
+            CCoinsViewCache cache(&db);
+            for (size_t i = 0; i < vTxid.size(); i++) {
+                vTxid[i] = GetRandHash();
+                CCoinsModifier coins = cache.ModifyNewCoins(vTxid[i]);
+                coins->vout.resize(1);
+                coins->vout[0].nValue = i + 1;
+                coins->nHeight = 1;
+            }
+            cache.SetBestBlock(hashFirst);
+            BOOST_CHECK(cache.Flush());
+
+            // Spending reaches the database while the first flush may still be written
+            for (size_t i = 0; i < vTxid.size(); i += 2)
+                cache.ModifyCoins(vTxid[i])->Spend(0);
+            cache.SetBestBlock(hashSecond);
+            BOOST_CHECK(cache.Flush());
+        }
+
+        // Lookups see the queued state whether or not it has been written
+        BOOST_CHECK(db.GetBestBlock() == hashSecond);
+        for (size_t i = 0; i < vTxid.size(); i++) {
+            CCoins coins;
+            BOOST_CHECK_EQUAL(db.GetCoins(vTxid[i], coins), i % 2 == 1);
+            BOOST_CHECK_EQUAL(db.HaveCoins(vTxid[i]), i % 2 == 1);
+            if (i % 2 == 1)
+                BOOST_CHECK_EQUAL(coins.vout[0].nValue, (CAmount)i + 1);
+        }
+
+        BOOST_CHECK(db.Sync());
+        BOOST_CHECK(!db.HasPartialFlush());
+        BOOST_CHECK(db.GetBestBlock() == hashSecond);
+        for (size_t i = 0; i < vTxid.size(); i++)
+            BOOST_CHECK_EQUAL(db.HaveCoins(vTxid[i]), i % 2 == 1);
+    }
+    mapArgs.erase("-dbbatchsize");
+}
+
+namespace
+{
+// Fails every flush batch after the first nBatchesLeft, like a crash would
+class CCoinsViewDBInterrupted : public CCoinsViewDB
+{
+public:
+    int nBatchesLeft;
+
+    CCoinsViewDBInterrupted() : CCoinsViewDB(1 << 20, false, true, true), nBatchesLeft(-1) {}
+
+protected:
+    bool WriteFlushBatch(CDBBatch &batch)
+    {
+        if (nBatchesLeft == 0) {
+            batch.Clear();
+            return false;
+        }
+        if (nBatchesLeft > 0)
+            nBatchesLeft--;
+        return CCoinsViewDB::WriteFlushBatch(batch);
+    }
+};
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_db_interrupted_flush)
+{
+    boost::filesystem::path pathTemp = GetTempPath() / strprintf("test_infinex_flush_%lu_%i", (unsigned long)GetTime(), (int)GetRand(100000));
+    boost::filesystem::create_directories(pathTemp);
+    mapArgs["-datadir"] = pathTemp.string();
+    ClearDatadirCache();
+    mapArgs["-dbbatchsize"] = "1";
+
+    // With one entry per batch the second flush of 50 spent entries writes 50
+    // journal batches, the journal marker, 50 coin batches, the best block and
+    // the journal cleanup
+    const int vInterrupt[] = {0, 25, 50, 51, 75, 101, 125};
+    for (unsigned int n = 0; n < sizeof(vInterrupt) / sizeof(vInterrupt[0]); n++) {
+        std::vector<uint256> vTxid(100);
+        uint256 hashFirst = GetRandHash();
+        uint256 hashSecond = GetRandHash();
+        {
+            CCoinsViewDBInterrupted db;
+            CCoinsViewCache cache(&db);
+            for (size_t i = 0; i < vTxid.size(); i++) {
+                vTxid[i] = GetRandHash();
+                CCoinsModifier coins = cache.ModifyNewCoins(vTxid[i]);
+                coins->vout.resize(1);
+                coins->vout[0].nValue = i + 1;
+                coins->nHeight = 1;
+            }
+            cache.SetBestBlock(hashFirst);
+            BOOST_CHECK(cache.Flush());
+            BOOST_CHECK(db.Sync());
+
+            db.nBatchesLeft = vInterrupt[n];
+            for (size_t i = 0; i < vTxid.size(); i += 2)
+                cache.ModifyCoins(vTxid[i])->Spend(0);
+            cache.SetBestBlock(hashSecond);
+            BOOST_CHECK(cache.Flush());
+            BOOST_CHECK(!db.Sync());
+        }
+
+        // Startup ends up on one block or the other, never on a mix
+        CCoinsViewDB db(1 << 20, false, false, false);
+        BOOST_CHECK(db.ReplayPartialFlush());
+        BOOST_CHECK(!db.HasPartialFlush());
+        bool fSecond = vInterrupt[n] > 50;
+        BOOST_CHECK(db.GetBestBlock() == (fSecond ? hashSecond : hashFirst));
+        for (size_t i = 0; i < vTxid.size(); i++)
+            BOOST_CHECK_EQUAL(db.HaveCoins(vTxid[i]), !fSecond || i % 2 == 1);
+    }
+
+    mapArgs.erase("-dbbatchsize");
+    mapArgs.erase("-datadir");
+    ClearDatadirCache();
+    boost::filesystem::remove_all(pathTemp);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
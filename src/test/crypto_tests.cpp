@@ -2,6 +2,8 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "crypto/Lyra2.h"
+#include "crypto/Lyra2Z.h"
 #include "crypto/ripemd160.h"
 #include "crypto/sha1.h"
 #include "crypto/sha256.h"
@@ -273,4 +275,65 @@ BOOST_AUTO_TEST_CASE(pbkdf2_hmac_sha512_test) {
     BOOST_CHECK(HexStr(k, k + 64) == "8c0511f4c6e597c6ac6315d8f0362e225f3c501495ba23b868c005174dc4ee71115b59f9e60cd9532fa33e0f75aefe30225c583a186cd82bd4daea9724a3d3b8");
 }
 
+static const char* const SPONGE_IMPLEMENTATIONS[] = {"generic", "sse2", "ssse3", "avx2"};
+
+static std::string Lyra2ZHex(const unsigned char (&header)[80])
+{
+    unsigned char hash[32];
+    lyra2z_hash((const char*)header, (char*)hash);
+    return HexStr(hash, hash + 32);
+}
+
+BOOST_AUTO_TEST_CASE(lyra2z_sponge_testvectors) {
+    // Lyra2Z of zero padded 80 byte headers, as computed by the generic sponge
+    static const char* const vectors[][2] = {
+        {"", "9b63bf262ec6f678d73e101f57dadcfe07b6d1f01c2b6ebfbc84ed3fa2be947d"},
+        {"abc", "e9e574372fe9296aca6ddae36f5287a41b7a67612344d6842175991d2a976ddb"},
+        {"The quick brown fox jumps over the lazy dog", "4ccba2e1500766396ef82fd00dfe1bef773f9a0e1dd55a190254ce0914492298"},
+    };
+    std::string strDefault = spongeImplementation();
+    for (const char* strImpl : SPONGE_IMPLEMENTATIONS) {
+        if (spongeSelect(strImpl) != 0) {
+            BOOST_TEST_MESSAGE("Lyra2 sponge " << strImpl << " not supported by this CPU, skipped");
+            continue;
+        }
+        for (const auto& vector : vectors) {
+            unsigned char header[80] = {};
+            memcpy(header, vector[0], strlen(vector[0]));
+            BOOST_CHECK_MESSAGE(Lyra2ZHex(header) == vector[1], strImpl << ": \"" << vector[0] << "\"");
+        }
+        unsigned char header[80];
+        for (int i = 0; i < 80; i++)
+            header[i] = i;
+        BOOST_CHECK_MESSAGE(Lyra2ZHex(header) == "6b0ded5afb3b27cf0e601243ffd9b37ee65331a2d46c7add2a6a826958ab1c0b", strImpl);
+    }
+    BOOST_CHECK(spongeSelect(strDefault.c_str()) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(lyra2_sponge_implementations_match) {
+    // other matrix shapes than Lyra2Z's, and squeezes of more than one block
+    std::string strDefault = spongeImplementation();
+    for (int i = 0; i < 200; i++) {
+        std::vector<unsigned char> pwd(insecure_rand() % 100), salt(insecure_rand() % 100);
+        for (unsigned char& c : pwd)
+            c = insecure_rand();
+        for (unsigned char& c : salt)
+            c = insecure_rand();
+        uint64_t nTimeCost = 1 + insecure_rand() % 3;
+        uint64_t nRows = 4 << (insecure_rand() % 3);
+        uint64_t nCols = 1 + insecure_rand() % 16;
+        std::vector<unsigned char> expected(1 + insecure_rand() % 300), result(expected.size());
+
+        BOOST_CHECK(spongeSelect("generic") == 0);
+        BOOST_CHECK(LYRA2(&expected[0], expected.size(), pwd.data(), pwd.size(), salt.data(), salt.size(), nTimeCost, nRows, nCols) == 0);
+        for (const char* strImpl : SPONGE_IMPLEMENTATIONS) {
+            if (spongeSelect(strImpl) != 0)
+                continue;
+            BOOST_CHECK(LYRA2(&result[0], result.size(), pwd.data(), pwd.size(), salt.data(), salt.size(), nTimeCost, nRows, nCols) == 0);
+            BOOST_CHECK_MESSAGE(result == expected, strImpl << " t=" << nTimeCost << " r=" << nRows << " c=" << nCols);
+        }
+    }
+    BOOST_CHECK(spongeSelect(strDefault.c_str()) == 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,138 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "cuckoocache.h"
+#include "random.h"
+
+#include "test/test_infinex.h"
+
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(cuckoocache_tests, BasicTestingSetup)
+
+static std::vector<uint256> RandomKeys(size_t nCount)
+{
+    std::vector<uint256> vKeys(nCount);
+    for (size_t i = 0; i < nCount; i++)
+        vKeys[i] = GetRandHash();
+    return vKeys;
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_insert_contains)
+{
+    CCuckooCache cache;
+    uint256 key = GetRandHash();
+
+    // an unallocated cache holds nothing
+    cache.Insert(key);
+    BOOST_CHECK(!cache.Contains(key, false));
+
+    size_t nBytes = cache.Setup(1 << 20);
+    BOOST_CHECK(nBytes > 0 && nBytes <= (1 << 20));
+
+    std::vector<uint256> vKeys = RandomKeys(1000);
+    for (size_t i = 0; i < vKeys.size(); i++)
+        cache.Insert(vKeys[i]);
+    for (size_t i = 0; i < vKeys.size(); i++)
+        BOOST_CHECK(cache.Contains(vKeys[i], false));
+    BOOST_CHECK(!cache.Contains(key, false));
+
+    CCuckooCache::Stats stats;
+    cache.GetStats(stats);
+    BOOST_CHECK_EQUAL(stats.nBytes, nBytes);
+    BOOST_CHECK_EQUAL(stats.nHits, 1000U);
+    BOOST_CHECK_EQUAL(stats.nMisses, 1U);
+    BOOST_CHECK_EQUAL(stats.nInserts, 1000U);
+
+    // inserting a key again does not use another slot
+    cache.Insert(vKeys[0]);
+    cache.GetStats(stats);
+    BOOST_CHECK_EQUAL(stats.nInserts, 1000U);
+
+    // Setup drops all entries
+    cache.Setup(1 << 20);
+    BOOST_CHECK(!cache.Contains(vKeys[0], false));
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_generations)
+{
+    CCuckooCache cache;
+    cache.Setup(64 << 10);
+    CCuckooCache::Stats stats;
+    cache.GetStats(stats);
+
+    // write the cache over several times: the latest entries must survive,
+    // the oldest ones are recycled first
+    std::vector<uint256> vKeys = RandomKeys(stats.nSlots * 4);
+    for (size_t i = 0; i < vKeys.size(); i++)
+        cache.Insert(vKeys[i]);
+
+    size_t nRecent = stats.nSlots / 4;
+    size_t nFound = 0;
+    for (size_t i = vKeys.size() - nRecent; i < vKeys.size(); i++)
+        nFound += cache.Contains(vKeys[i], false);
+    BOOST_CHECK(nFound > nRecent * 95 / 100);
+
+    size_t nOldFound = 0;
+    for (size_t i = 0; i < nRecent; i++)
+        nOldFound += cache.Contains(vKeys[i], false);
+    BOOST_CHECK(nOldFound < nRecent / 10);
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_erase)
+{
+    CCuckooCache cache;
+    cache.Setup(64 << 10);
+    CCuckooCache::Stats stats;
+    cache.GetStats(stats);
+
+    // fill a quarter of the cache, then erase those entries: they stay
+    // readable but are the first to be overwritten
+    std::vector<uint256> vErased = RandomKeys(stats.nSlots / 4);
+    for (size_t i = 0; i < vErased.size(); i++)
+        cache.Insert(vErased[i]);
+    for (size_t i = 0; i < vErased.size(); i++)
+        BOOST_CHECK(cache.Contains(vErased[i], true));
+    BOOST_CHECK(cache.Contains(vErased[0], false));
+
+    std::vector<uint256> vKept = RandomKeys(stats.nSlots / 2);
+    for (size_t i = 0; i < vKept.size(); i++)
+        cache.Insert(vKept[i]);
+    size_t nFound = 0;
+    for (size_t i = 0; i < vKept.size(); i++)
+        nFound += cache.Contains(vKept[i], false);
+    BOOST_CHECK_EQUAL(nFound, vKept.size());
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_concurrent)
+{
+    CCuckooCache cache;
+    cache.Setup(1 << 20);
+    std::vector<uint256> vKeys = RandomKeys(8000);
+
+    // writers insert disjoint ranges while readers look up all keys
+    std::vector<std::thread> vThreads;
+    for (int t = 0; t < 4; t++) {
+        vThreads.emplace_back([t, &cache, &vKeys]() {
+            for (size_t i = t; i < vKeys.size(); i += 4)
+                cache.Insert(vKeys[i]);
+        });
+        vThreads.emplace_back([&cache, &vKeys]() {
+            for (size_t i = 0; i < vKeys.size(); i++)
+                cache.Contains(vKeys[i], false);
+        });
+    }
+    for (size_t i = 0; i < vThreads.size(); i++)
+        vThreads[i].join();
+
+    size_t nFound = 0;
+    for (size_t i = 0; i < vKeys.size(); i++)
+        nFound += cache.Contains(vKeys[i], false);
+    BOOST_CHECK(nFound > vKeys.size() * 99 / 100);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
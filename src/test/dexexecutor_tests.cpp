@@ -0,0 +1,88 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "InfiniDEX/dexexecutor.h"
+
+#include "test/test_infinex.h"
+
+#include <map>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(dexexecutor_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(mpscqueue_multiple_producers)
+{
+    static const int nProducers = 4;
+    static const int nPerProducer = 10000;
+    CMPSCQueue<int> queue;
+    BOOST_CHECK(queue.Empty());
+
+    std::vector<std::thread> vProducers;
+    for (int p = 0; p < nProducers; p++) {
+        vProducers.emplace_back([&queue, p]() {
+            for (int i = 0; i < nPerProducer; i++)
+                queue.Push(p * nPerProducer + i);
+        });
+    }
+
+    // every producer's values must come out in the order it pushed them
+    std::vector<int> vLast(nProducers, -1);
+    int nReceived = 0;
+    while (nReceived < nProducers * nPerProducer) {
+        int value;
+        if (!queue.Pop(value))
+            continue;
+        int p = value / nPerProducer;
+        BOOST_CHECK(value % nPerProducer > vLast[p]);
+        vLast[p] = value % nPerProducer;
+        nReceived++;
+    }
+    for (size_t i = 0; i < vProducers.size(); i++)
+        vProducers[i].join();
+    BOOST_CHECK(queue.Empty());
+}
+
+BOOST_AUTO_TEST_CASE(dexexecutor_pair_order)
+{
+    static const int nPairs = 8;
+    static const int nTasks = 1000;
+    CDEXExecutor executor;
+    executor.Start(3);
+    BOOST_CHECK(executor.IsRunning());
+    BOOST_CHECK_EQUAL(executor.GetPairThreadCount(), 3);
+
+    // each pair is only touched by the worker owning it, so no lock is needed here
+    std::vector<std::vector<int>> vApplied(nPairs);
+    std::vector<int> vSettled;
+    for (int i = 0; i < nTasks; i++) {
+        for (int pair = 0; pair < nPairs; pair++) {
+            executor.PostTradePairTask(pair, [&executor, &vApplied, &vSettled, pair, i]() {
+                vApplied[pair].push_back(i);
+                if (pair == 0)
+                    executor.PostUserTask([&vSettled, i]() { vSettled.push_back(i); });
+            });
+        }
+    }
+    executor.Stop();
+    BOOST_CHECK(!executor.IsRunning());
+
+    for (int pair = 0; pair < nPairs; pair++) {
+        BOOST_CHECK_EQUAL(vApplied[pair].size(), nTasks);
+        for (int i = 0; i < nTasks; i++)
+            BOOST_CHECK_EQUAL(vApplied[pair][i], i);
+    }
+    BOOST_CHECK_EQUAL(vSettled.size(), nTasks);
+    for (int i = 0; i < nTasks; i++)
+        BOOST_CHECK_EQUAL(vSettled[i], i);
+
+    // not running, tasks execute in the caller
+    bool fRan = false;
+    executor.PostTradePairTask(1, [&fRan]() { fRan = true; });
+    BOOST_CHECK(fRan);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
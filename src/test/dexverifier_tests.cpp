@@ -0,0 +1,116 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "InfiniDEX/dexverifier.h"
+#include "key.h"
+#include "messagesigner.h"
+#include "random.h"
+
+#include "test/test_infinex.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(dexverifier_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(dexverifier_delivery_order)
+{
+    static const int nJobs = 2000;
+    CDEXVerifier verifier;
+    verifier.Start(4);
+    BOOST_CHECK(verifier.IsRunning());
+
+    // verifications finish out of order, deliveries must not
+    std::vector<int> vDelivered;
+    std::vector<bool> vValid;
+    for (int i = 0; i < nJobs; i++) {
+        int nDelay = GetRand(50);
+        verifier.Submit(0, [i, nDelay]() {
+            std::this_thread::sleep_for(std::chrono::microseconds(nDelay));
+            return i % 3 != 0;
+        }, [i, &vDelivered, &vValid](bool fValid) {
+            vDelivered.push_back(i);
+            vValid.push_back(fValid);
+        });
+    }
+    verifier.Stop();
+    BOOST_CHECK(!verifier.IsRunning());
+
+    BOOST_CHECK_EQUAL(vDelivered.size(), nJobs);
+    for (int i = 0; i < (int)vDelivered.size(); i++) {
+        BOOST_CHECK_EQUAL(vDelivered[i], i);
+        BOOST_CHECK_EQUAL(vValid[i], i % 3 != 0);
+    }
+
+    // without threads the job runs in the caller
+    bool fDelivered = false;
+    BOOST_CHECK(verifier.Submit(0, []() { return true; }, [&fDelivered](bool fValid) { fDelivered = fValid; }));
+    BOOST_CHECK(fDelivered);
+}
+
+BOOST_AUTO_TEST_CASE(dexverifier_queue_bound)
+{
+    CDEXVerifier verifier;
+    verifier.Start(1);
+    std::atomic<bool> fRelease(false);
+    std::atomic<int> nDelivered(0);
+    auto verify = [&fRelease]() {
+        while (!fRelease)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return true;
+    };
+    auto deliver = [&nDelivered](bool fValid) { ++nDelivered; };
+
+    // a peer filling its share is dropped, others still get through
+    for (size_t i = 0; i < MAX_DEX_VERIFY_QUEUE_PER_PEER; i++)
+        BOOST_CHECK(verifier.Submit(1, verify, deliver));
+    BOOST_CHECK(!verifier.Submit(1, verify, deliver));
+    BOOST_CHECK(verifier.Submit(2, verify, deliver));
+
+    fRelease = true;
+    verifier.Stop();
+    BOOST_CHECK_EQUAL(nDelivered, (int)MAX_DEX_VERIFY_QUEUE_PER_PEER + 1);
+
+    // delivered jobs no longer count against the peer
+    verifier.Start(1);
+    BOOST_CHECK(verifier.Submit(1, verify, deliver));
+    verifier.Stop();
+    BOOST_CHECK_EQUAL(nDelivered, (int)MAX_DEX_VERIFY_QUEUE_PER_PEER + 2);
+}
+
+BOOST_AUTO_TEST_CASE(dexverifier_signature_cache)
+{
+    CDEXVerifier verifier;
+    CKey key;
+    key.MakeNewKey(true);
+    CPubKey pubkey = key.GetPubKey();
+    std::string strMessage = "1100000200000";
+    std::vector<unsigned char> vchSig;
+    BOOST_CHECK(CMessageSigner::SignMessage(strMessage, vchSig, key));
+
+    std::string strError;
+    BOOST_CHECK(verifier.VerifyMessage(pubkey, vchSig, strMessage, strError));
+    BOOST_CHECK_EQUAL(verifier.GetCacheMisses(), 1);
+    BOOST_CHECK(verifier.VerifyMessage(pubkey, vchSig, strMessage, strError));
+    BOOST_CHECK_EQUAL(verifier.GetCacheHits(), 1);
+
+    // a changed message or signature is not answered from the cache
+    BOOST_CHECK(!verifier.VerifyMessage(pubkey, vchSig, strMessage + "0", strError));
+    std::vector<unsigned char> vchBadSig = vchSig;
+    vchBadSig[10] ^= 1;
+    BOOST_CHECK(!verifier.VerifyMessage(pubkey, vchBadSig, strMessage, strError));
+    BOOST_CHECK_EQUAL(verifier.GetCacheHits(), 1);
+
+    uint256 hash = GetRandHash();
+    BOOST_CHECK(CHashSigner::SignHash(hash, key, vchSig));
+    BOOST_CHECK(verifier.VerifyHash(hash, pubkey, vchSig, strError));
+    BOOST_CHECK(verifier.VerifyHash(hash, pubkey, vchSig, strError));
+    BOOST_CHECK_EQUAL(verifier.GetCacheHits(), 2);
+    BOOST_CHECK(!verifier.VerifyHash(GetRandHash(), pubkey, vchSig, strError));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,120 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "flatmap.h"
+#include "random.h"
+#include "uint256.h"
+
+#include "test/test_infinex.h"
+
+#include <map>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(flatmap_tests, BasicTestingSetup)
+
+namespace {
+struct CheapHasher
+{
+    size_t operator()(const uint256& key) const { return key.GetCheapHash(); }
+};
+
+typedef flatmap<uint256, std::string, CheapHasher> test_map;
+
+void CheckEqual(const test_map& map, const std::map<uint256, std::string>& expected)
+{
+    BOOST_CHECK_EQUAL(map.size(), expected.size());
+    size_t nIterated = 0;
+    for (test_map::const_iterator it = map.begin(); it != map.end(); ++it) {
+        std::map<uint256, std::string>::const_iterator itExpected = expected.find(it->first);
+        BOOST_CHECK(itExpected != expected.end() && itExpected->second == it->second);
+        nIterated++;
+    }
+    BOOST_CHECK_EQUAL(nIterated, expected.size());
+}
+}
+
+BOOST_AUTO_TEST_CASE(flatmap_random_operations)
+{
+    test_map map;
+    std::map<uint256, std::string> expected;
+
+    // a small key set so keys are inserted, found and erased repeatedly
+    std::vector<uint256> vKeys(500);
+    for (size_t i = 0; i < vKeys.size(); i++)
+        vKeys[i] = GetRandHash();
+
+    for (int i = 0; i < 20000; i++) {
+        const uint256& key = vKeys[insecure_rand() % vKeys.size()];
+        switch (insecure_rand() % 4) {
+        case 0: {
+            std::string value = std::to_string(i);
+            std::pair<test_map::iterator, bool> ret = map.insert(std::make_pair(key, value));
+            BOOST_CHECK_EQUAL(ret.second, expected.insert(std::make_pair(key, value)).second);
+            BOOST_CHECK(ret.first->second == expected[key]);
+            break;
+        }
+        case 1:
+            BOOST_CHECK_EQUAL(map.erase(key), expected.erase(key));
+            break;
+        case 2: {
+            test_map::iterator it = map.find(key);
+            BOOST_CHECK_EQUAL(it != map.end(), expected.count(key) == 1);
+            if (it != map.end())
+                map.erase(it);
+            expected.erase(key);
+            break;
+        }
+        case 3:
+            map[key] += "x";
+            expected[key] += "x";
+            break;
+        }
+        if (i % 1000 == 0)
+            CheckEqual(map, expected);
+    }
+    CheckEqual(map, expected);
+
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.begin() == map.end());
+    BOOST_CHECK_EQUAL(map.DynamicMemoryUsage(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(flatmap_stable_elements)
+{
+    test_map map;
+    uint256 first = GetRandHash();
+    std::string* pFirst = &map[first];
+    *pFirst = "first";
+
+    // growing the table and the arena does not move elements
+    for (int i = 0; i < 10000; i++)
+        map[GetRandHash()] = "other";
+    BOOST_CHECK(&map.find(first)->second == pFirst);
+    BOOST_CHECK(*pFirst == "first");
+
+    // erasing while iterating, as the coins views do in BatchWrite
+    size_t nErased = 0;
+    for (test_map::iterator it = map.begin(); it != map.end();) {
+        if (it->first != first) {
+            it = map.erase(it);
+            nErased++;
+        } else {
+            ++it;
+        }
+    }
+    BOOST_CHECK_EQUAL(nErased, 10000U);
+    BOOST_CHECK_EQUAL(map.size(), 1U);
+    BOOST_CHECK(&map.find(first)->second == pFirst);
+
+    // freed elements are reused instead of growing the arena
+    size_t nUsage = map.DynamicMemoryUsage();
+    for (int i = 0; i < 5000; i++)
+        map[GetRandHash()] = "again";
+    BOOST_CHECK_EQUAL(map.DynamicMemoryUsage(), nUsage);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,125 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "InfiniDEX/marketoverview.h"
+
+#include "test/test_infinex.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(marketoverview_tests, BasicTestingSetup)
+
+static const uint64_t nMinute = 60;
+static const uint64_t nDay = 1440 * nMinute;
+static const uint64_t nDayStart = 1514764800; // 2018-01-01 00:00 UTC
+
+BOOST_AUTO_TEST_CASE(marketoverview_rolling_window)
+{
+    CMarketTickerWindow window(1);
+    CMarketTicker ticker;
+    window.GetTicker(ticker);
+    BOOST_CHECK_EQUAL(ticker.nNoOfTrades, 0);
+    BOOST_CHECK_EQUAL(ticker.GetChange(), 0);
+
+    window.InputNewTrade(100, 2, nDayStart + 10);
+    window.InputNewTrade(150, 1, nDayStart + 2 * nMinute);
+    window.InputNewTrade(80, 1, nDayStart + 3 * nMinute);
+    window.InputNewTrade(120, 3, nDayStart + 12 * 60 * nMinute);
+    window.GetTicker(ticker);
+    BOOST_CHECK_EQUAL(ticker.nTradePairID, 1);
+    BOOST_CHECK_EQUAL(ticker.nOpenPrice, 100);
+    BOOST_CHECK_EQUAL(ticker.nLastPrice, 120);
+    BOOST_CHECK_EQUAL(ticker.nHighPrice, 150);
+    BOOST_CHECK_EQUAL(ticker.nLowPrice, 80);
+    BOOST_CHECK_EQUAL(ticker.nQty, 7);
+    BOOST_CHECK_EQUAL(ticker.nAmount, 790);
+    BOOST_CHECK_EQUAL(ticker.nNoOfTrades, 4);
+    BOOST_CHECK_EQUAL(ticker.GetChange(), 2000);
+
+    // the first minute ages out, the open moves to the next trade
+    BOOST_CHECK(window.Advance(nDayStart + nDay));
+    window.GetTicker(ticker);
+    BOOST_CHECK_EQUAL(ticker.nOpenPrice, 150);
+    BOOST_CHECK_EQUAL(ticker.nNoOfTrades, 3);
+    BOOST_CHECK_EQUAL(ticker.nQty, 5);
+
+    // the high and the low age out, both come from what is left
+    BOOST_CHECK(window.Advance(nDayStart + nDay + 3 * nMinute));
+    window.GetTicker(ticker);
+    BOOST_CHECK_EQUAL(ticker.nOpenPrice, 120);
+    BOOST_CHECK_EQUAL(ticker.nHighPrice, 120);
+    BOOST_CHECK_EQUAL(ticker.nLowPrice, 120);
+    BOOST_CHECK_EQUAL(ticker.nAmount, 360);
+    BOOST_CHECK_EQUAL(ticker.GetChange(), 0);
+    BOOST_CHECK(!window.Advance(nDayStart + nDay + 4 * nMinute));
+
+    // a trade older than the window is ignored, a late one inside it opens the window
+    window.InputNewTrade(1, 1, nDayStart + 4 * nMinute);
+    window.InputNewTrade(110, 1, nDayStart + 6 * nMinute);
+    window.GetTicker(ticker);
+    BOOST_CHECK_EQUAL(ticker.nNoOfTrades, 2);
+    BOOST_CHECK_EQUAL(ticker.nOpenPrice, 110);
+    BOOST_CHECK_EQUAL(ticker.nLowPrice, 110);
+    BOOST_CHECK_EQUAL(ticker.nLastPrice, 120);
+
+    // a quiet day empties the window but keeps the last price
+    BOOST_CHECK(window.Advance(nDayStart + 3 * nDay));
+    window.GetTicker(ticker);
+    BOOST_CHECK_EQUAL(ticker.nNoOfTrades, 0);
+    BOOST_CHECK_EQUAL(ticker.nQty, 0);
+    BOOST_CHECK_EQUAL(ticker.nLastPrice, 120);
+
+    window.InputNewTrade(90, 1, nDayStart + 3 * nDay + 5);
+    window.GetTicker(ticker);
+    BOOST_CHECK_EQUAL(ticker.nOpenPrice, 90);
+    BOOST_CHECK_EQUAL(ticker.nHighPrice, 90);
+    BOOST_CHECK_EQUAL(ticker.nNoOfTrades, 1);
+}
+
+BOOST_AUTO_TEST_CASE(marketoverview_matches_rescan)
+{
+    // running totals against a full recount of the last day after every trade
+    CMarketTickerWindow window(2);
+    std::vector<std::pair<uint64_t, std::pair<uint64_t, uint64_t>>> vTrades;
+    uint64_t nState = 0x9E3779B97F4A7C15ULL;
+    uint64_t nTime = nDayStart;
+    for (int i = 0; i < 5000; i++) {
+        nState ^= nState << 13;
+        nState ^= nState >> 7;
+        nState ^= nState << 17;
+        nTime += nState % (10 * nMinute);
+        uint64_t nPrice = 1000 + (nState >> 20) % 500;
+        uint64_t nQty = 1 + (nState >> 40) % 50;
+        window.InputNewTrade(nPrice, nQty, nTime);
+        vTrades.push_back(std::make_pair(nTime, std::make_pair(nPrice, nQty)));
+
+        uint64_t nCutoff = nTime - (nTime % nMinute) - (nDay - nMinute);
+        CMarketTicker expected;
+        for (const auto& trade : vTrades) {
+            if (trade.first < nCutoff)
+                continue;
+            if (expected.nNoOfTrades == 0) {
+                expected.nOpenPrice = trade.second.first;
+                expected.nHighPrice = expected.nLowPrice = trade.second.first;
+            }
+            expected.nHighPrice = std::max(expected.nHighPrice, trade.second.first);
+            expected.nLowPrice = std::min(expected.nLowPrice, trade.second.first);
+            expected.nQty += trade.second.second;
+            expected.nAmount += trade.second.first * trade.second.second;
+            ++expected.nNoOfTrades;
+        }
+
+        CMarketTicker ticker;
+        window.GetTicker(ticker);
+        BOOST_CHECK_EQUAL(ticker.nOpenPrice, expected.nOpenPrice);
+        BOOST_CHECK_EQUAL(ticker.nHighPrice, expected.nHighPrice);
+        BOOST_CHECK_EQUAL(ticker.nLowPrice, expected.nLowPrice);
+        BOOST_CHECK_EQUAL(ticker.nQty, expected.nQty);
+        BOOST_CHECK_EQUAL(ticker.nAmount, expected.nAmount);
+        BOOST_CHECK_EQUAL(ticker.nNoOfTrades, expected.nNoOfTrades);
+        BOOST_CHECK_EQUAL(ticker.nLastPrice, nPrice);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
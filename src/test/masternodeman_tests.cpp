@@ -0,0 +1,122 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternodeman.h"
+#include "netbase.h"
+#include "random.h"
+
+#include "test/test_infinex.h"
+
+#include <boost/test/unit_test.hpp>
+
+static CPubKey RandomPubKey()
+{
+    CKey key;
+    key.MakeNewKey(true);
+    return key.GetPubKey();
+}
+
+static CMasternode MakeMasternode(int nProtocolVersion)
+{
+    CService addr;
+    Lookup("1.2.3.4", addr, 10755, false);
+    return CMasternode(addr, COutPoint(GetRandHash(), 1), RandomPubKey(), RandomPubKey(), nProtocolVersion);
+}
+
+// the ordering ranks were calculated with before they were kept in tables
+static std::vector<const CMasternode*> RankByScore(const CMasternodeRegistry::masternode_vec_t& vecMasternodes, const uint256& nBlockHash, int nMinProtocol)
+{
+    std::vector<std::pair<arith_uint256, const CMasternode*> > vecScores;
+    for (const auto& pmn : vecMasternodes) {
+        if (pmn->nProtocolVersion >= nMinProtocol)
+            vecScores.push_back(std::make_pair(pmn->CalculateScore(nBlockHash), pmn.get()));
+    }
+    std::sort(vecScores.rbegin(), vecScores.rend(), [](const std::pair<arith_uint256, const CMasternode*>& t1, const std::pair<arith_uint256, const CMasternode*>& t2) {
+        return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->vin < t2.second->vin);
+    });
+
+    std::vector<const CMasternode*> vecRanked;
+    for (const auto& scorePair : vecScores)
+        vecRanked.push_back(scorePair.second);
+    return vecRanked;
+}
+
+// the payment queue winner as it was picked by rescoring the oldest masternodes
+static const CMasternode* FindHighestScore(const std::vector<std::pair<int, const CMasternode*> >& vecLastPaid, int nCount, const uint256& nBlockHash)
+{
+    int nChecked = 0;
+    arith_uint256 nHighest = 0;
+    const CMasternode* pBestMasternode = NULL;
+    for (const auto& s : vecLastPaid) {
+        arith_uint256 nScore = s.second->CalculateScore(nBlockHash);
+        if (nScore > nHighest) {
+            nHighest = nScore;
+            pBestMasternode = s.second;
+        }
+        nChecked++;
+        if (nChecked >= nCount) break;
+    }
+    return pBestMasternode;
+}
+
+BOOST_FIXTURE_TEST_SUITE(masternodeman_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(masternodeman_rank_table)
+{
+    const int nMinProtocol = PROTOCOL_VERSION;
+    CMasternodeRegistry registry;
+    for (int i = 0; i < 200; i++)
+        registry.Add(MakeMasternode(i % 5 == 0 ? nMinProtocol - 1 : nMinProtocol));
+    CMasternodeRegistry::snapshot_t snapshot = registry.GetSnapshot();
+
+    for (int nBlock = 0; nBlock < 10; nBlock++) {
+        uint256 nBlockHash = GetRandHash();
+        std::vector<const CMasternode*> vecRanked = RankByScore(*snapshot, nBlockHash, nMinProtocol);
+        std::shared_ptr<CMasternodeMan::CRankTable> pRankTable = CMasternodeMan::CalculateRankTable(*snapshot, nBlockHash, nMinProtocol);
+
+        BOOST_CHECK_EQUAL(vecRanked.size(), 160U);
+        BOOST_CHECK_EQUAL(pRankTable->vecOutpoints.size(), vecRanked.size());
+        BOOST_CHECK_EQUAL(pRankTable->mapRanks.size(), vecRanked.size());
+        for (size_t i = 0; i < vecRanked.size(); i++) {
+            BOOST_CHECK(pRankTable->vecOutpoints[i] == vecRanked[i]->vin.prevout);
+            BOOST_CHECK_EQUAL(pRankTable->mapRanks.at(vecRanked[i]->vin.prevout), (int)i + 1);
+        }
+    }
+
+    BOOST_CHECK(CMasternodeMan::CalculateRankTable(*snapshot, GetRandHash(), nMinProtocol + 1)->vecOutpoints.empty());
+}
+
+BOOST_AUTO_TEST_CASE(masternodeman_payment_winner)
+{
+    const int nMinProtocol = PROTOCOL_VERSION;
+    CMasternodeRegistry registry;
+    for (int i = 0; i < 100; i++)
+        registry.Add(MakeMasternode(nMinProtocol));
+    CMasternodeRegistry::snapshot_t snapshot = registry.GetSnapshot();
+
+    // sorted by last paid block like GetNextMasternodeInQueueForPayment does, with ties broken by vin
+    std::vector<std::pair<int, const CMasternode*> > vecLastPaid;
+    for (const auto& pmn : *snapshot)
+        vecLastPaid.push_back(std::make_pair(GetRandInt(50), pmn.get()));
+    std::sort(vecLastPaid.begin(), vecLastPaid.end(), [](const std::pair<int, const CMasternode*>& t1, const std::pair<int, const CMasternode*>& t2) {
+        return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->vin < t2.second->vin);
+    });
+
+    for (int nBlock = 0; nBlock < 20; nBlock++) {
+        uint256 nBlockHash = GetRandHash();
+        std::shared_ptr<CMasternodeMan::CRankTable> pRankTable = CMasternodeMan::CalculateRankTable(*snapshot, nBlockHash, nMinProtocol);
+        // a tenth of the network, none (the first one is still checked) and all of it
+        for (int nCount : {10, 0, 100}) {
+            const CMasternode* pmnExpected = FindHighestScore(vecLastPaid, nCount, nBlockHash);
+            BOOST_CHECK(pmnExpected != NULL);
+            BOOST_CHECK(CMasternodeMan::FindBestRanked(vecLastPaid, nCount, *pRankTable) == pmnExpected);
+        }
+    }
+
+    // masternodes missing from the table are never picked
+    CMasternodeMan::CRankTable rankTableEmpty;
+    BOOST_CHECK(CMasternodeMan::FindBestRanked(vecLastPaid, 10, rankTableEmpty) == NULL);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,187 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternoderegistry.h"
+#include "netbase.h"
+#include "script/standard.h"
+#include "streams.h"
+
+#include "test/test_infinex.h"
+
+#include <boost/test/unit_test.hpp>
+
+static CPubKey RandomPubKey()
+{
+    CKey key;
+    key.MakeNewKey(true);
+    return key.GetPubKey();
+}
+
+static CMasternode MakeMasternode(const std::string& strAddr, const CPubKey& pubKeyCollateral)
+{
+    CService addr;
+    Lookup(strAddr.c_str(), addr, 10755, false);
+    return CMasternode(addr, COutPoint(GetRandHash(), 1), pubKeyCollateral, RandomPubKey(), PROTOCOL_VERSION);
+}
+
+BOOST_FIXTURE_TEST_SUITE(masternoderegistry_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(masternoderegistry_indexes)
+{
+    CMasternodeRegistry registry;
+    CPubKey pubKeyShared = RandomPubKey();
+    CMasternode mn1 = MakeMasternode("1.2.3.4", pubKeyShared);
+    CMasternode mn2 = MakeMasternode("1.2.3.4", RandomPubKey());
+    CMasternode mn3 = MakeMasternode("5.6.7.8", pubKeyShared);
+
+    BOOST_CHECK(registry.Add(mn1));
+    BOOST_CHECK(registry.Add(mn2));
+    BOOST_CHECK(registry.Add(mn3));
+    BOOST_CHECK(!registry.Add(mn1));
+    BOOST_CHECK_EQUAL(registry.size(), 3U);
+
+    BOOST_CHECK(registry.Find(mn2.vin.prevout)->pubKeyMasternode == mn2.pubKeyMasternode);
+    BOOST_CHECK(registry.FindByPubKey(mn3.pubKeyMasternode)->vin == mn3.vin);
+    BOOST_CHECK(registry.FindByPubKey(RandomPubKey()) == NULL);
+    BOOST_CHECK_EQUAL(registry.FindByAddr(mn1.addr).size(), 2U);
+
+    // a shared collateral key pays the lowest outpoint first, like a scan of the sorted list did
+    const CMasternode* pmnPayee = registry.FindByPayee(GetScriptForDestination(pubKeyShared.GetID()));
+    BOOST_CHECK(pmnPayee->vin.prevout == std::min(mn1.vin.prevout, mn3.vin.prevout));
+    BOOST_CHECK(registry.FindByPayee(CScript() << OP_TRUE) == NULL);
+
+    // erasing moves the last entry, its index entries must follow
+    BOOST_CHECK(registry.Erase(mn1.vin.prevout));
+    BOOST_CHECK(!registry.Erase(mn1.vin.prevout));
+    BOOST_CHECK(registry.Find(mn1.vin.prevout) == NULL);
+    BOOST_CHECK(registry.FindByPubKey(mn3.pubKeyMasternode)->vin == mn3.vin);
+    BOOST_CHECK(registry.FindByPubKey(mn2.pubKeyMasternode)->vin == mn2.vin);
+    BOOST_CHECK_EQUAL(registry.FindByAddr(mn1.addr).size(), 1U);
+    BOOST_CHECK(registry.FindByPayee(GetScriptForDestination(pubKeyShared.GetID()))->vin == mn3.vin);
+
+    // changed keys are found once reindexed
+    CPubKey pubKeyNew = RandomPubKey();
+    registry.FindMutable(mn2.vin.prevout)->pubKeyMasternode = pubKeyNew;
+    registry.Reindex(mn2.vin.prevout);
+    BOOST_CHECK(registry.FindByPubKey(pubKeyNew)->vin == mn2.vin);
+    BOOST_CHECK(registry.FindByPubKey(mn2.pubKeyMasternode) == NULL);
+
+    registry.Clear();
+    BOOST_CHECK(registry.empty());
+    BOOST_CHECK(registry.FindByPubKey(mn3.pubKeyMasternode) == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(masternoderegistry_snapshot)
+{
+    CMasternodeRegistry registry;
+    for (int i = 0; i < 10; i++)
+        registry.Add(MakeMasternode("1.2.3.4", RandomPubKey()));
+
+    CMasternodeRegistry::snapshot_t snapshot = registry.GetSnapshot();
+    BOOST_CHECK_EQUAL(snapshot->size(), 10U);
+    for (size_t i = 1; i < snapshot->size(); i++)
+        BOOST_CHECK((*snapshot)[i - 1]->vin.prevout < (*snapshot)[i]->vin.prevout);
+    // shared until something changes
+    BOOST_CHECK(registry.GetSnapshot() == snapshot);
+
+    // writes copy the entries the snapshot holds instead of changing them
+    const COutPoint outpoint = (*snapshot)[0]->vin.prevout;
+    registry.FindMutable(outpoint)->nPoSeBanScore = 5;
+    registry.ForEachMutable([](CMasternode& mn) { mn.nBlockLastPaid = 42; });
+    registry.Erase((*snapshot)[1]->vin.prevout);
+    BOOST_CHECK_EQUAL((*snapshot)[0]->nPoSeBanScore, 0);
+    BOOST_CHECK_EQUAL((*snapshot)[0]->nBlockLastPaid, 0);
+    BOOST_CHECK_EQUAL(snapshot->size(), 10U);
+
+    CMasternodeRegistry::snapshot_t snapshotNew = registry.GetSnapshot();
+    BOOST_CHECK(snapshotNew != snapshot);
+    BOOST_CHECK_EQUAL(snapshotNew->size(), 9U);
+    BOOST_CHECK_EQUAL(registry.Find(outpoint)->nPoSeBanScore, 5);
+    BOOST_CHECK_EQUAL(registry.Find(outpoint)->nBlockLastPaid, 42);
+}
+
+BOOST_AUTO_TEST_CASE(masternoderegistry_copy_on_write)
+{
+    CMasternodeRegistry registry;
+    CMasternode mn = MakeMasternode("1.2.3.4", RandomPubKey());
+    registry.Add(mn);
+    const COutPoint& outpoint = mn.vin.prevout;
+
+    // nothing shares the entry, it is changed in place
+    const CMasternode* pmn = registry.Find(outpoint);
+    BOOST_CHECK(registry.FindMutable(outpoint) == pmn);
+
+    // reads keep the cached snapshot and the entries
+    CMasternodeRegistry::snapshot_t snapshot = registry.GetSnapshot();
+    registry.Find(outpoint);
+    registry.FindByPubKey(mn.pubKeyMasternode);
+    BOOST_CHECK(registry.GetSnapshot() == snapshot);
+    BOOST_CHECK(registry.Find(outpoint) == pmn);
+
+    // the entry is copied once for the snapshot, later writes change the copy
+    CMasternode* pmnCopy = registry.FindMutable(outpoint);
+    BOOST_CHECK(pmnCopy != pmn);
+    BOOST_CHECK(registry.FindMutable(outpoint) == pmnCopy);
+
+    // the snapshot is gone, still the entry is copied after it was shared alone
+    snapshot.reset();
+    std::shared_ptr<const CMasternode> pmnShared = registry.FindShared(outpoint);
+    BOOST_CHECK(pmnShared.get() == pmnCopy);
+    BOOST_CHECK(registry.FindMutable(outpoint) != pmnCopy);
+}
+
+BOOST_AUTO_TEST_CASE(masternoderegistry_list_version)
+{
+    CMasternodeRegistry registry;
+    CMasternode mn = MakeMasternode("1.2.3.4", RandomPubKey());
+    uint64_t nVersion = registry.GetListVersion();
+
+    BOOST_CHECK(registry.Add(mn));
+    BOOST_CHECK(registry.GetListVersion() != nVersion);
+    nVersion = registry.GetListVersion();
+
+    // ranks don't depend on the state of a masternode, changing it keeps the version
+    registry.FindMutable(mn.vin.prevout)->nPoSeBanScore = 3;
+    registry.Reindex(mn.vin.prevout);
+    BOOST_CHECK_EQUAL(registry.GetListVersion(), nVersion);
+
+    // a shared entry is not changed by later writes
+    std::shared_ptr<const CMasternode> pmnShared = registry.FindShared(mn.vin.prevout);
+    registry.FindMutable(mn.vin.prevout)->nProtocolVersion = PROTOCOL_VERSION + 1;
+    registry.Reindex(mn.vin.prevout);
+    BOOST_CHECK(registry.GetListVersion() != nVersion);
+    BOOST_CHECK_EQUAL(pmnShared->nProtocolVersion, PROTOCOL_VERSION);
+    nVersion = registry.GetListVersion();
+
+    BOOST_CHECK(registry.Erase(mn.vin.prevout));
+    BOOST_CHECK(registry.GetListVersion() != nVersion);
+    BOOST_CHECK(registry.FindShared(mn.vin.prevout) == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(masternoderegistry_serialization)
+{
+    CMasternodeRegistry registry;
+    std::map<COutPoint, CMasternode> mapMasternodes;
+    for (int i = 0; i < 5; i++) {
+        CMasternode mn = MakeMasternode("1.2.3.4", RandomPubKey());
+        registry.Add(mn);
+        mapMasternodes[mn.vin.prevout] = mn;
+    }
+
+    // same bytes as the std::map it replaced
+    CDataStream ssRegistry(SER_DISK, CLIENT_VERSION);
+    CDataStream ssMap(SER_DISK, CLIENT_VERSION);
+    ssRegistry << registry;
+    ssMap << mapMasternodes;
+    BOOST_CHECK(ssRegistry.str() == ssMap.str());
+    BOOST_CHECK_EQUAL(::GetSerializeSize(registry, SER_DISK, CLIENT_VERSION), ssMap.size());
+
+    CMasternodeRegistry registryRead;
+    ssRegistry >> registryRead;
+    BOOST_CHECK_EQUAL(registryRead.size(), 5U);
+    for (const auto& mnpair : mapMasternodes)
+        BOOST_CHECK(registryRead.FindByPubKey(mnpair.second.pubKeyMasternode)->vin == mnpair.second.vin);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -174,4 +174,30 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+BOOST_AUTO_TEST_CASE(cconnman_make_message)
+{
+    CConnman connman;
+    std::vector<uint256> vPayload(3, GetRandHash());
+    CSerializedNetMsg msg = connman.MakeMessage(PROTOCOL_VERSION, NetMsgType::MNPING, vPayload);
+    BOOST_CHECK_EQUAL(msg.sCommand, NetMsgType::MNPING);
+
+    CDataStream ss(msg.data->begin(), msg.data->end(), SER_NETWORK, PROTOCOL_VERSION);
+    CMessageHeader hdr(Params().MessageStart());
+    ss >> hdr;
+    BOOST_CHECK(hdr.IsValid(Params().MessageStart()));
+    BOOST_CHECK_EQUAL(hdr.GetCommand(), NetMsgType::MNPING);
+    BOOST_CHECK_EQUAL(hdr.nMessageSize, ss.size());
+    uint256 hash = Hash(ss.begin(), ss.end());
+    BOOST_CHECK(memcmp(hash.begin(), hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) == 0);
+
+    CDataStream ssPayload(SER_NETWORK, PROTOCOL_VERSION);
+    ssPayload << vPayload;
+    BOOST_CHECK(std::equal(ss.begin(), ss.end(), ssPayload.begin()) && ss.size() == ssPayload.size());
+
+    // copies share the serialized buffer instead of duplicating it
+    CSerializedNetMsg msgCopy = msg;
+    BOOST_CHECK(msgCopy.data == msg.data);
+    BOOST_CHECK_EQUAL(msg.data.use_count(), 2);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,99 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "InfiniDEX/orderbook.h"
+#include "utiltime.h"
+
+#include "test/test_infinex.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(orderbook_tests, BasicTestingSetup)
+
+static const int nPair = 9001;
+
+static COrderBookDelta MakeDelta(bool fSnapshot, uint64_t nEpoch, uint64_t nSequence, const std::string& strPublisher,
+    const std::vector<std::pair<uint64_t, uint64_t>>& vLevels)
+{
+    COrderBookDelta delta(nPair, true, fSnapshot, nEpoch, nSequence, 0, strPublisher);
+    delta.vLevels = vLevels;
+    return delta;
+}
+
+static uint64_t GetQty(COrderBookManager& manager, uint64_t nPrice)
+{
+    LOCK(manager.cs);
+    const PriceOrderBook& levels = mapOrderBidBook[nPair];
+    PriceOrderBook::const_iterator it = levels.find(nPrice);
+    return it == levels.end() ? 0 : it->second.nQty;
+}
+
+static size_t GetLevelCount(COrderBookManager& manager)
+{
+    LOCK(manager.cs);
+    return mapOrderBidBook[nPair].size();
+}
+
+BOOST_AUTO_TEST_CASE(orderbook_delta_sequence)
+{
+    COrderBookManager manager;
+    SetMockTime(1514764800);
+
+    // the first snapshot of a publisher starts its sequence
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(false, 1, 1, "mn1", {{100, 5}})), ORDERBOOK_DELTA_NEED_SNAPSHOT);
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(true, 1, 2, "mn1", {{100, 5}, {101, 7}})), ORDERBOOK_DELTA_APPLIED);
+    BOOST_CHECK_EQUAL(GetLevelCount(manager), 2U);
+
+    // in order deltas apply, replays and older snapshots are ignored
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(false, 1, 3, "mn1", {{100, 0}, {102, 1}})), ORDERBOOK_DELTA_APPLIED);
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(false, 1, 4, "mn1", {{101, 9}})), ORDERBOOK_DELTA_APPLIED);
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(false, 1, 4, "mn1", {{101, 1}})), ORDERBOOK_DELTA_IGNORED);
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(true, 1, 3, "mn1", {})), ORDERBOOK_DELTA_IGNORED);
+    BOOST_CHECK_EQUAL(GetQty(manager, 100), 0U);
+    BOOST_CHECK_EQUAL(GetQty(manager, 101), 9U);
+    BOOST_CHECK_EQUAL(GetQty(manager, 102), 1U);
+
+    // a gap asks for one snapshot per retry interval and leaves the book alone
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(false, 1, 6, "mn1", {{103, 1}})), ORDERBOOK_DELTA_NEED_SNAPSHOT);
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(false, 1, 7, "mn1", {{103, 1}})), ORDERBOOK_DELTA_IGNORED);
+    BOOST_CHECK_EQUAL(GetQty(manager, 103), 0U);
+    SetMockTime(1514764800 + ORDERBOOK_SNAPSHOT_RETRY_SECONDS);
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(false, 1, 7, "mn1", {{103, 1}})), ORDERBOOK_DELTA_NEED_SNAPSHOT);
+
+    // the snapshot replaces the book and the sequence continues from it
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(true, 1, 7, "mn1", {{103, 1}, {104, 2}})), ORDERBOOK_DELTA_APPLIED);
+    BOOST_CHECK_EQUAL(GetLevelCount(manager), 2U);
+    BOOST_CHECK_EQUAL(GetQty(manager, 101), 0U);
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(false, 1, 8, "mn1", {{104, 3}})), ORDERBOOK_DELTA_APPLIED);
+    BOOST_CHECK_EQUAL(GetQty(manager, 104), 3U);
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(orderbook_delta_new_publisher)
+{
+    COrderBookManager manager;
+    SetMockTime(1514764800);
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(true, 5, 40, "mn1", {{100, 5}})), ORDERBOOK_DELTA_APPLIED);
+
+    // a restarted publisher counts from zero again in a new epoch
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(false, 6, 1, "mn1", {{100, 1}})), ORDERBOOK_DELTA_NEED_SNAPSHOT);
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(true, 6, 0, "mn1", {{100, 2}})), ORDERBOOK_DELTA_APPLIED);
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(false, 6, 1, "mn1", {{100, 3}})), ORDERBOOK_DELTA_APPLIED);
+    BOOST_CHECK_EQUAL(GetQty(manager, 100), 3U);
+
+    // messages from before the restart are stale
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(true, 5, 41, "mn1", {})), ORDERBOOK_DELTA_IGNORED);
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(false, 5, 41, "mn1", {})), ORDERBOOK_DELTA_IGNORED);
+
+    // a masternode taking over the pair starts over with its own snapshot
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(true, 2, 10, "mn2", {{200, 1}})), ORDERBOOK_DELTA_APPLIED);
+    BOOST_CHECK_EQUAL(GetQty(manager, 100), 0U);
+    BOOST_CHECK_EQUAL(manager.InputOrderBookDelta(MakeDelta(false, 2, 11, "mn2", {{200, 4}})), ORDERBOOK_DELTA_APPLIED);
+    BOOST_CHECK_EQUAL(GetQty(manager, 200), 4U);
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,101 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "InfiniDEX/orderbookengine.h"
+#include "InfiniDEX/trade.h"
+
+#include "test/test_infinex.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(orderbookengine_tests, BasicTestingSetup)
+
+static std::shared_ptr<CUserTrade> MakeOrder(int nPairTradeID, bool fBid, uint64_t nPrice, uint64_t nQty)
+{
+    std::shared_ptr<CUserTrade> userTrade = std::make_shared<CUserTrade>(1, nPrice, nQty, fBid, 0, "", 0, "");
+    userTrade->nPairTradeID = nPairTradeID;
+    return userTrade;
+}
+
+BOOST_AUTO_TEST_CASE(orderbookengine_best_price)
+{
+    COrderBookEngine book(1);
+    BOOST_CHECK(book.IsEmpty(true));
+    BOOST_CHECK(book.IsEmpty(false));
+    BOOST_CHECK_EQUAL(book.GetBestPrice(true), 0);
+
+    BOOST_CHECK(book.AddOrder(MakeOrder(1, true, 100, 5)));
+    BOOST_CHECK(book.AddOrder(MakeOrder(2, true, 102, 5)));
+    BOOST_CHECK(book.AddOrder(MakeOrder(3, true, 101, 5)));
+    BOOST_CHECK(book.AddOrder(MakeOrder(4, false, 110, 5)));
+    BOOST_CHECK(book.AddOrder(MakeOrder(5, false, 108, 5)));
+    BOOST_CHECK(book.AddOrder(MakeOrder(6, false, 109, 5)));
+
+    // duplicate pair trade ids are rejected
+    BOOST_CHECK(!book.AddOrder(MakeOrder(6, false, 111, 5)));
+
+    BOOST_CHECK_EQUAL(book.GetBestPrice(true), 102);
+    BOOST_CHECK_EQUAL(book.GetBestPrice(false), 108);
+    BOOST_CHECK_EQUAL(book.GetLevelCount(true), 3);
+    BOOST_CHECK_EQUAL(book.GetLevelCount(false), 3);
+    BOOST_CHECK_EQUAL(book.GetOrderCount(), 6);
+}
+
+BOOST_AUTO_TEST_CASE(orderbookengine_price_time_priority)
+{
+    COrderBookEngine book(1);
+    book.AddOrder(MakeOrder(1, false, 105, 1));
+    book.AddOrder(MakeOrder(2, false, 104, 1));
+    book.AddOrder(MakeOrder(3, false, 105, 1));
+    book.AddOrder(MakeOrder(4, false, 104, 1));
+    book.AddOrder(MakeOrder(5, false, 106, 1));
+
+    // best price first, then arrival order within a price level
+    int expected[] = {2, 4, 1, 3, 5};
+    for (int i = 0; i < 5; i++) {
+        BOOST_CHECK(!book.IsEmpty(false));
+        BOOST_CHECK_EQUAL(book.GetBestOrder(false)->nPairTradeID, expected[i]);
+        book.PopBestOrder(false);
+    }
+    BOOST_CHECK(book.IsEmpty(false));
+    BOOST_CHECK_EQUAL(book.GetOrderCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(orderbookengine_cancel)
+{
+    COrderBookEngine book(1);
+    book.AddOrder(MakeOrder(1, true, 100, 1));
+    book.AddOrder(MakeOrder(2, true, 100, 1));
+    book.AddOrder(MakeOrder(3, true, 100, 1));
+    book.AddOrder(MakeOrder(4, true, 99, 1));
+
+    std::shared_ptr<CUserTrade> cancelled = book.CancelOrder(2);
+    BOOST_CHECK(cancelled);
+    BOOST_CHECK_EQUAL(cancelled->nPairTradeID, 2);
+    BOOST_CHECK(!book.HasOrder(2));
+    BOOST_CHECK(!book.CancelOrder(2));
+
+    std::vector<std::shared_ptr<CUserTrade>> orders;
+    book.GetLevelOrders(true, 100, orders);
+    BOOST_CHECK_EQUAL(orders.size(), 2);
+    BOOST_CHECK_EQUAL(orders[0]->nPairTradeID, 1);
+    BOOST_CHECK_EQUAL(orders[1]->nPairTradeID, 3);
+
+    // emptying a level removes it and exposes the next best price
+    book.CancelOrder(1);
+    book.CancelOrder(3);
+    BOOST_CHECK_EQUAL(book.GetBestPrice(true), 99);
+    BOOST_CHECK_EQUAL(book.GetLevelCount(true), 1);
+
+    // released nodes are reused and keep FIFO order
+    book.AddOrder(MakeOrder(5, true, 99, 1));
+    book.AddOrder(MakeOrder(6, true, 99, 1));
+    BOOST_CHECK_EQUAL(book.GetBestOrder(true)->nPairTradeID, 4);
+    book.PopBestOrder(true);
+    BOOST_CHECK_EQUAL(book.GetBestOrder(true)->nPairTradeID, 5);
+    book.PopBestOrder(true);
+    BOOST_CHECK_EQUAL(book.GetBestOrder(true)->nPairTradeID, 6);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
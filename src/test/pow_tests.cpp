@@ -6,10 +6,13 @@
 #include "chainparams.h"
 #include "pow.h"
 #include "random.h"
+#include "streams.h"
 #include "util.h"
+#include "validation.h"
 #include "test/test_infinex.h"
 
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
 
 using namespace std;
 
@@ -190,4 +193,71 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(BlockHeaderHashCache_test)
+{
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.hashPrevBlock = GetRandHash();
+    header.hashMerkleRoot = GetRandHash();
+    header.nTime = 1514764800;
+    header.nBits = 0x1e0ffff0;
+
+    uint256 hash = header.GetHash();
+    BOOST_CHECK(hash == header.ComputeHash());
+    BOOST_CHECK(header.fHashCached);
+
+    // copies keep the hash, a changed field is hashed again
+    CBlock block(header);
+    BOOST_CHECK(block.fHashCached);
+    BOOST_CHECK(block.GetHash() == hash);
+    BOOST_CHECK(block.GetBlockHeader().fHashCached);
+
+    block.nNonce++;
+    BOOST_CHECK(block.GetHash() != hash);
+    BOOST_CHECK(block.GetHash() == block.ComputeHash());
+    block.nNonce--;
+    BOOST_CHECK(block.GetHash() == hash);
+
+    header.hashMerkleRoot = GetRandHash();
+    BOOST_CHECK(header.GetHash() == header.ComputeHash());
+    BOOST_CHECK(header.GetHash() != hash);
+
+    // deserializing over a hashed header
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block.GetBlockHeader();
+    ss >> header;
+    BOOST_CHECK(header.GetHash() == hash);
+}
+
+BOOST_AUTO_TEST_CASE(PrecomputeBlockHeaderHashes_test)
+{
+    std::vector<CBlockHeader> headers(200);
+    for (size_t i = 0; i < headers.size(); i++) {
+        headers[i].nVersion = 4;
+        headers[i].hashMerkleRoot = GetRandHash();
+        headers[i].nNonce = i;
+    }
+
+    int nScriptCheckThreadsOld = nScriptCheckThreads;
+    nScriptCheckThreads = 4;
+    boost::thread_group threadGroup;
+    for (int i = 0; i < nScriptCheckThreads - 1; i++)
+        threadGroup.create_thread(&ThreadBlockHeaderHashCheck);
+
+    // twice, the queue is ready for the next batch once a batch returns
+    for (int nBatch = 0; nBatch < 2; nBatch++) {
+        PrecomputeBlockHeaderHashes(headers);
+        for (const CBlockHeader& header : headers) {
+            BOOST_CHECK(header.fHashCached);
+            BOOST_CHECK(header.hashCached == header.ComputeHash());
+        }
+        for (CBlockHeader& header : headers)
+            header.nTime++;
+    }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    nScriptCheckThreads = nScriptCheckThreadsOld;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
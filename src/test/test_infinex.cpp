@@ -9,12 +9,14 @@
 #include "chainparams.h"
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
+#include "crypto/Lyra2.h"
 #include "key.h"
 #include "validation.h"
 #include "miner.h"
 #include "net_processing.h"
 #include "pubkey.h"
 #include "random.h"
+#include "script/sigcache.h"
 #include "txdb.h"
 #include "txmempool.h"
 #include "ui_interface.h"
@@ -38,7 +40,9 @@ extern void noui_connect();
 
 BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
 {
+        spongeAutoDetect();
         ECC_Start();
+        InitSignatureCache();
         SetupEnvironment();
         SetupNetworking();
         fPrintToDebugLog = false; // don't want to write to debug.log file
@@ -0,0 +1,199 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "InfiniDEX/orderbookengine.h"
+#include "InfiniDEX/trade.h"
+#include "InfiniDEX/tradelog.h"
+
+#include "test/test_infinex.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(tradelog_tests, BasicTestingSetup)
+
+static boost::filesystem::path GetTempLogDir()
+{
+    return boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+}
+
+static std::vector<uint64_t> ReadLastIDs(const CTradeLog& log, size_t nCount)
+{
+    std::vector<uint64_t> vID;
+    log.ForEachLast(nCount, [&vID](const CTradeLogRecordHeader& header, const char* pData) {
+        vID.push_back(header.nID);
+        return true;
+    });
+    return vID;
+}
+
+BOOST_AUTO_TEST_CASE(tradelog_append_read)
+{
+    boost::filesystem::path path = GetTempLogDir();
+    {
+        CTradeLog log;
+        BOOST_CHECK(log.Open(path));
+        for (uint64_t i = 1; i <= 500; i++)
+            BOOST_CHECK(log.Append(i, i * 1000, strprintf("record %d", i)));
+        BOOST_CHECK(!log.Append(500, 500000, std::string("duplicate")));
+        BOOST_CHECK_EQUAL(log.GetLastID(), 500);
+
+        std::string str;
+        BOOST_CHECK(log.Read(1, str));
+        BOOST_CHECK_EQUAL(str, "record 1");
+        BOOST_CHECK(log.Read(130, str));
+        BOOST_CHECK_EQUAL(str, "record 130");
+        BOOST_CHECK(!log.Read(501, str));
+
+        std::vector<uint64_t> vID;
+        log.ForEachInTime(99000, 201000, [&vID](const CTradeLogRecordHeader& header, const char* pData) {
+            vID.push_back(header.nID);
+            return true;
+        });
+        BOOST_CHECK_EQUAL(vID.size(), 103);
+        BOOST_CHECK_EQUAL(vID.front(), 99);
+        BOOST_CHECK_EQUAL(vID.back(), 201);
+
+        vID = ReadLastIDs(log, 70);
+        BOOST_CHECK_EQUAL(vID.size(), 70);
+        BOOST_CHECK_EQUAL(vID.front(), 431);
+        BOOST_CHECK_EQUAL(vID.back(), 500);
+    }
+
+    //reopening only reads the index
+    {
+        CTradeLog log;
+        BOOST_CHECK(log.Open(path));
+        BOOST_CHECK_EQUAL(log.GetLastID(), 500);
+        BOOST_CHECK(log.Append(501, 501000, std::string("record 501")));
+        std::string str;
+        BOOST_CHECK(log.Read(450, str));
+        BOOST_CHECK_EQUAL(str, "record 450");
+        BOOST_CHECK_EQUAL(ReadLastIDs(log, 1000).size(), 501);
+    }
+    boost::filesystem::remove_all(path);
+}
+
+BOOST_AUTO_TEST_CASE(tradelog_torn_tail)
+{
+    boost::filesystem::path path = GetTempLogDir();
+    {
+        CTradeLog log;
+        BOOST_CHECK(log.Open(path));
+        for (uint64_t i = 1; i <= 200; i++)
+            BOOST_CHECK(log.Append(i, i, strprintf("record %d", i)));
+    }
+
+    //cut the last record in half
+    boost::filesystem::path pathSegment = path / "00000000.log";
+    boost::filesystem::resize_file(pathSegment, boost::filesystem::file_size(pathSegment) - 8);
+    {
+        CTradeLog log;
+        BOOST_CHECK(log.Open(path));
+        BOOST_CHECK_EQUAL(log.GetLastID(), 199);
+        std::string str;
+        BOOST_CHECK(!log.Read(200, str));
+        BOOST_CHECK(log.Append(200, 200, std::string("rewritten")));
+        BOOST_CHECK(log.Read(200, str));
+        BOOST_CHECK_EQUAL(str, "rewritten");
+    }
+
+    //cut back to the record of the last index entry
+    boost::filesystem::resize_file(pathSegment, boost::filesystem::file_size(pathSegment) - 30 * 8);
+    {
+        CTradeLog log;
+        BOOST_CHECK(log.Open(path));
+        uint64_t nLastID = log.GetLastID();
+        BOOST_CHECK(nLastID > 100 && nLastID < 200);
+        BOOST_CHECK(log.Append(nLastID + 1, nLastID + 1, std::string("next")));
+        BOOST_CHECK_EQUAL(ReadLastIDs(log, 1000).size(), nLastID + 1);
+    }
+    boost::filesystem::remove_all(path);
+}
+
+BOOST_AUTO_TEST_CASE(tradelog_user_history)
+{
+    boost::filesystem::path path = GetTempLogDir();
+    CTradeLogManager manager;
+    manager.Open(path);
+    for (int i = 0; i < 100; i++)
+    {
+        std::string strUser1 = (i % 2) ? "alice" : "bob";
+        std::string strUser2 = (i % 10) ? "carol" : "dave";
+        manager.AppendTradeHistory(std::make_shared<CUserTradeHistory>(1, strUser1, strUser2, 100 + i, 1, 100 + i, false, 1000 + i));
+    }
+
+    std::vector<CUserTradeHistory> vHistory;
+    BOOST_CHECK_EQUAL(manager.GetUserTradeHistory(1, "dave", 100, vHistory), 10);
+    BOOST_CHECK_EQUAL(vHistory.front().nPrice, 190);
+    BOOST_CHECK_EQUAL(vHistory.back().nPrice, 100);
+
+    vHistory.clear();
+    BOOST_CHECK_EQUAL(manager.GetUserTradeHistory(1, "alice", 5, vHistory), 5);
+    BOOST_CHECK_EQUAL(vHistory.front().nPrice, 199);
+    BOOST_CHECK_EQUAL(vHistory.back().nPrice, 191);
+
+    vHistory.clear();
+    BOOST_CHECK_EQUAL(manager.GetUserTradeHistory(2, "alice", 5, vHistory), 0);
+    manager.Close();
+
+    //the user map is restored from the snapshot written on close
+    manager.Open(path);
+    manager.AppendTradeHistory(std::make_shared<CUserTradeHistory>(1, "alice", "dave", 500, 1, 500, false, 2000));
+    vHistory.clear();
+    BOOST_CHECK_EQUAL(manager.GetUserTradeHistory(1, "dave", 100, vHistory), 11);
+    BOOST_CHECK_EQUAL(vHistory.front().nPrice, 500);
+    vHistory.clear();
+    BOOST_CHECK_EQUAL(manager.GetMarketTradeHistory(1, 3, vHistory), 3);
+    BOOST_CHECK_EQUAL(vHistory.front().nPrice, 198);
+    BOOST_CHECK_EQUAL(vHistory.back().nPrice, 500);
+    manager.Close();
+    boost::filesystem::remove_all(path);
+}
+
+BOOST_AUTO_TEST_CASE(tradelog_actual_trade_reopen)
+{
+    const int nPair = 9002;
+    boost::filesystem::path path = GetTempLogDir();
+    tradeLogManager.Open(path);
+    for (int i = 1; i <= 5; i++) {
+        CActualTrade actualTrade(nPair, i, i + 100, 100, 1, 100, 100, "alice", "bob", 0, 0, true, 1000 + i);
+        actualTrade.nActualTradeID = i;
+        BOOST_CHECK(tradeLogManager.AppendActualTrade(actualTrade));
+    }
+    tradeLogManager.Close();
+
+    //a restarted node numbers its trades after the logged ones and finds them again
+    tradeLogManager.Open(path);
+    userTradeManager.InitTradePair(nPair);
+    BOOST_CHECK_EQUAL(mapUserTradeSetting[nPair].nLastActualTradeID, 5);
+    BOOST_CHECK_EQUAL(mapUserTradeSetting[nPair].nLastActualTradeTime, 1005);
+    BOOST_CHECK_EQUAL(mapActualTradeByActualTradeID[nPair].size(), 5);
+    BOOST_CHECK_EQUAL(mapActualTradeByUserTradeID[nPair][103].size(), 1);
+
+    CActualTrade actualTrade(nPair, 6, 106, 100, 1, 100, 100, "alice", "bob", 0, 0, true, 1006);
+    actualTrade.nActualTradeID = 3;
+    BOOST_CHECK(!tradeLogManager.AppendActualTrade(actualTrade));
+    actualTrade.nActualTradeID = mapUserTradeSetting[nPair].nLastActualTradeID + 1;
+    BOOST_CHECK(tradeLogManager.AppendActualTrade(actualTrade));
+
+    std::vector<CActualTrade> vActualTrade;
+    BOOST_CHECK_EQUAL(tradeLogManager.GetLastActualTrades(nPair, 2, vActualTrade), 2);
+    BOOST_CHECK_EQUAL(vActualTrade.front().nActualTradeID, 5);
+    BOOST_CHECK_EQUAL(vActualTrade.back().nActualTradeID, 6);
+
+    {
+        LOCK(cs_mapTradePair);
+        mapUserTradeBook.erase(nPair);
+        mapUserTradeSetting.erase(nPair);
+        mapActualTradeByActualTradeID.erase(nPair);
+        mapActualTradeByUserTradeID.erase(nPair);
+        mapConflictTrade.erase(nPair);
+        mapActualTradeHash.erase(nPair);
+    }
+    tradeLogManager.Close();
+    boost::filesystem::remove_all(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
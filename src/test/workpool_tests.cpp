@@ -0,0 +1,85 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "workpool.h"
+#include "utiltime.h"
+
+#include "test/test_infinex.h"
+
+#include <atomic>
+#include <set>
+#include <stdexcept>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(workpool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(workpool_runs_all_tasks)
+{
+    CWorkStealingPool pool;
+    BOOST_CHECK(!pool.IsRunning());
+    pool.Start(4, "test");
+    BOOST_CHECK(pool.IsRunning());
+    BOOST_CHECK_EQUAL(pool.GetThreadCount(), 4U);
+
+    std::atomic<int> nDone(0);
+    for (int i = 0; i < 1000; i++)
+        pool.Submit([&nDone]() { nDone++; }, i);
+    for (int i = 0; i < 1000 && nDone < 1000; i++)
+        MilliSleep(10);
+    BOOST_CHECK_EQUAL(nDone, 1000);
+
+    // a throwing task does not take its thread down
+    pool.Submit([]() { throw std::runtime_error("workpool test"); }, 0);
+    pool.Submit([&nDone]() { nDone++; }, 0);
+    for (int i = 0; i < 1000 && nDone < 1001; i++)
+        MilliSleep(10);
+    BOOST_CHECK_EQUAL(nDone, 1001);
+
+    pool.Stop();
+    BOOST_CHECK(!pool.IsRunning());
+}
+
+BOOST_AUTO_TEST_CASE(workpool_steals_tasks)
+{
+    CWorkStealingPool pool;
+    pool.Start(4, "test");
+
+    // every task goes to the first queue; the other threads have to steal to help
+    std::mutex mutexThreads;
+    std::set<std::thread::id> setThreads;
+    std::atomic<int> nDone(0);
+    for (int i = 0; i < 64; i++) {
+        pool.Submit([&]() {
+            {
+                std::lock_guard<std::mutex> lock(mutexThreads);
+                setThreads.insert(std::this_thread::get_id());
+            }
+            MilliSleep(5);
+            nDone++;
+        }, 0);
+    }
+    for (int i = 0; i < 1000 && nDone < 64; i++)
+        MilliSleep(10);
+    BOOST_CHECK_EQUAL(nDone, 64);
+    BOOST_CHECK(setThreads.size() > 1);
+    pool.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(workpool_restart)
+{
+    CWorkStealingPool pool;
+    pool.Start(2, "test");
+    pool.Stop();
+    pool.Stop();
+
+    std::atomic<int> nDone(0);
+    pool.Start(1, "test");
+    pool.Submit([&nDone]() { nDone++; }, 7);
+    for (int i = 0; i < 1000 && nDone < 1; i++)
+        MilliSleep(10);
+    BOOST_CHECK_EQUAL(nDone, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -31,21 +31,67 @@ static const char DB_BEST_BLOCK = 'B';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_PARTIAL_FLUSH = 'H';
+static const char DB_FLUSH_COINS = 'J';
+static const char DB_FLUSH_ERASE = 'K';
 
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true) 
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe, bool fAsyncWriteIn) :
+    db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true),
+    fAsyncWrite(fAsyncWriteIn), nBatchSize(std::max(GetArg("-dbbatchsize", nDefaultDbBatchSize), (int64_t)1)),
+    pSnapshot(NULL), fWriteFailed(false), fStopWriter(false)
 {
+    if (fAsyncWrite)
+        threadWriter = boost::thread(boost::bind(&CCoinsViewDB::ThreadWriter, this));
+}
+
+CCoinsViewDB::~CCoinsViewDB()
+{
+    if (fAsyncWrite) {
+        {
+            boost::unique_lock<boost::mutex> lock(mutexWriter);
+            fStopWriter = true;
+        }
+        condWriter.notify_one();
+        threadWriter.join();
+    }
+    delete pSnapshot;
 }
 
 bool CCoinsViewDB::GetCoins(const uint256 &txid, CCoins &coins) const {
+    if (fAsyncWrite) {
+        boost::unique_lock<boost::mutex> lock(mutexWriter);
+        if (pSnapshot != NULL) {
+            CCoinsMap::const_iterator it = pSnapshot->find(txid);
+            if (it != pSnapshot->end()) {
+                if (it->second.coins.IsPruned())
+                    return false;
+                coins = it->second.coins;
+                return true;
+            }
+        }
+    }
     return db.Read(make_pair(DB_COINS, txid), coins);
 }
 
 bool CCoinsViewDB::HaveCoins(const uint256 &txid) const {
+    if (fAsyncWrite) {
+        boost::unique_lock<boost::mutex> lock(mutexWriter);
+        if (pSnapshot != NULL) {
+            CCoinsMap::const_iterator it = pSnapshot->find(txid);
+            if (it != pSnapshot->end())
+                return !it->second.coins.IsPruned();
+        }
+    }
     return db.Exists(make_pair(DB_COINS, txid));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    if (fAsyncWrite) {
+        boost::unique_lock<boost::mutex> lock(mutexWriter);
+        if (pSnapshot != NULL && !hashSnapshotBlock.IsNull())
+            return hashSnapshotBlock;
+    }
     uint256 hashBestChain;
     if (!db.Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
@@ -53,6 +99,34 @@ uint256 CCoinsViewDB::GetBestBlock() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    if (fAsyncWrite) {
+        // One snapshot at a time bounds the memory held outside the cache
+        int64_t nTimeStart = GetTimeMicros();
+        if (!WaitForWriter())
+            return false;
+        int64_t nTimeWaited = GetTimeMicros() - nTimeStart;
+
+        CCoinsMap* pmapSnapshot = new CCoinsMap();
+        pmapSnapshot->reserve(mapCoins.size());
+        size_t count = 0;
+        for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+            if (it->second.flags & CCoinsCacheEntry::DIRTY)
+                (*pmapSnapshot)[it->first].coins.swap(it->second.coins);
+            count++;
+            it = mapCoins.erase(it);
+        }
+
+        LogPrint("coindb", "Queueing %u changed transactions (out of %u) for the coin database, waited %.2fms for the previous flush\n",
+            (unsigned int)pmapSnapshot->size(), (unsigned int)count, nTimeWaited * 0.001);
+        {
+            boost::unique_lock<boost::mutex> lock(mutexWriter);
+            pSnapshot = pmapSnapshot;
+            hashSnapshotBlock = hashBlock;
+        }
+        condWriter.notify_one();
+        return true;
+    }
+
     CDBBatch batch(&db.GetObfuscateKey());
     size_t count = 0;
     size_t changed = 0;
@@ -75,6 +149,176 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     return db.WriteBatch(batch);
 }
 
+bool CCoinsViewDB::Sync() {
+    return WaitForWriter();
+}
+
+bool CCoinsViewDB::WaitForWriter() const {
+    if (!fAsyncWrite)
+        return true;
+    boost::unique_lock<boost::mutex> lock(mutexWriter);
+    while (pSnapshot != NULL && !fWriteFailed)
+        condWritten.wait(lock);
+    return !fWriteFailed;
+}
+
+bool CCoinsViewDB::HasPartialFlush() const {
+    return db.Exists(DB_PARTIAL_FLUSH);
+}
+
+bool CCoinsViewDB::WriteFlushBatch(CDBBatch &batch) {
+    bool fSuccess = db.WriteBatch(batch);
+    batch.Clear();
+    return fSuccess;
+}
+
+bool CCoinsViewDB::WriteSnapshot(const CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    // A snapshot that fits in one batch is written atomically with the best block
+    CDBBatch batch(&db.GetObfuscateKey());
+    CCoinsMap::const_iterator it = mapCoins.begin();
+    for (; it != mapCoins.end() && batch.SizeEstimate() < nBatchSize; ++it) {
+        if (it->second.coins.IsPruned())
+            batch.Erase(make_pair(DB_COINS, it->first));
+        else
+            batch.Write(make_pair(DB_COINS, it->first), it->second.coins);
+    }
+    if (it == mapCoins.end() && batch.SizeEstimate() < nBatchSize) {
+        if (!hashBlock.IsNull())
+            batch.Write(DB_BEST_BLOCK, hashBlock);
+        LogPrint("coindb", "Committing %u changed transactions to coin database...\n", (unsigned int)mapCoins.size());
+        return WriteFlushBatch(batch);
+    }
+    batch.Clear();
+
+    // A larger one is journaled first. Until the journal is complete the coins
+    // are untouched, after that startup can finish the flush from the journal.
+    size_t nBatches = 0;
+    for (it = mapCoins.begin(); it != mapCoins.end(); ++it) {
+        if (it->second.coins.IsPruned())
+            batch.Write(make_pair(DB_FLUSH_ERASE, it->first), '1');
+        else
+            batch.Write(make_pair(DB_FLUSH_COINS, it->first), it->second.coins);
+        if (batch.SizeEstimate() >= nBatchSize) {
+            if (!WriteFlushBatch(batch))
+                return false;
+            nBatches++;
+        }
+    }
+    if (batch.SizeEstimate() > 0 && !WriteFlushBatch(batch))
+        return false;
+    batch.Write(DB_PARTIAL_FLUSH, hashBlock);
+    if (!WriteFlushBatch(batch))
+        return false;
+
+    // Every batch below writes final values, so a replay may repeat any of them
+    for (it = mapCoins.begin(); it != mapCoins.end(); ++it) {
+        if (it->second.coins.IsPruned())
+            batch.Erase(make_pair(DB_COINS, it->first));
+        else
+            batch.Write(make_pair(DB_COINS, it->first), it->second.coins);
+        if (batch.SizeEstimate() >= nBatchSize && !WriteFlushBatch(batch))
+            return false;
+    }
+    if (batch.SizeEstimate() > 0 && !WriteFlushBatch(batch))
+        return false;
+    if (!FinishPartialFlush(hashBlock))
+        return false;
+
+    for (it = mapCoins.begin(); it != mapCoins.end(); ++it) {
+        batch.Erase(make_pair(it->second.coins.IsPruned() ? DB_FLUSH_ERASE : DB_FLUSH_COINS, it->first));
+        if (batch.SizeEstimate() >= nBatchSize && !WriteFlushBatch(batch))
+            return false;
+    }
+    LogPrint("coindb", "Committed %u changed transactions to coin database through a journal of %u batches\n", (unsigned int)mapCoins.size(), (unsigned int)nBatches + 1);
+    return batch.SizeEstimate() == 0 || WriteFlushBatch(batch);
+}
+
+// The best block goes last and on its own, together with the end of the flush
+bool CCoinsViewDB::FinishPartialFlush(const uint256 &hashBlock) {
+    CDBBatch batch(&db.GetObfuscateKey());
+    if (!hashBlock.IsNull())
+        batch.Write(DB_BEST_BLOCK, hashBlock);
+    batch.Erase(DB_PARTIAL_FLUSH);
+    return WriteFlushBatch(batch);
+}
+
+bool CCoinsViewDB::ReplayPartialFlush() {
+    if (!WaitForWriter())
+        return false;
+    uint256 hashBlock;
+    bool fComplete = db.Read(DB_PARTIAL_FLUSH, hashBlock);
+    if (fComplete)
+        LogPrintf("Finishing an interrupted flush of the coin database to block %s\n", hashBlock.ToString());
+
+    // A complete journal is applied, then every journal, complete or not, is removed
+    for (int nPass = fComplete ? 0 : 1; nPass < 2; nPass++) {
+        if (nPass == 1 && fComplete && !FinishPartialFlush(hashBlock))
+            return false;
+
+        CDBBatch batch(&db.GetObfuscateKey());
+        const char chKinds[] = {DB_FLUSH_COINS, DB_FLUSH_ERASE};
+        for (unsigned int i = 0; i < 2; i++) {
+            boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+            pcursor->Seek(make_pair(chKinds[i], uint256()));
+            std::pair<char, uint256> key;
+            for (; pcursor->Valid() && pcursor->GetKey(key) && key.first == chKinds[i]; pcursor->Next()) {
+                if (nPass == 1) {
+                    batch.Erase(key);
+                } else if (key.first == DB_FLUSH_ERASE) {
+                    batch.Erase(make_pair(DB_COINS, key.second));
+                } else {
+                    CCoins coins;
+                    if (!pcursor->GetValue(coins))
+                        return error("%s: unable to read journal entry %s", __func__, key.second.ToString());
+                    batch.Write(make_pair(DB_COINS, key.second), coins);
+                }
+                if (batch.SizeEstimate() >= nBatchSize && !WriteFlushBatch(batch))
+                    return false;
+            }
+        }
+        if (batch.SizeEstimate() > 0 && !WriteFlushBatch(batch))
+            return false;
+    }
+    return true;
+}
+
+void CCoinsViewDB::ThreadWriter() {
+    RenameThread("infinex-coinsdb");
+    boost::unique_lock<boost::mutex> lock(mutexWriter);
+    while (true) {
+        while (!fStopWriter && (pSnapshot == NULL || fWriteFailed))
+            condWriter.wait(lock);
+        // Finish a queued snapshot before stopping
+        if (pSnapshot == NULL || fWriteFailed)
+            return;
+
+        // Only this thread removes the snapshot, and nobody modifies it, so
+        // it can be read without the lock while lookups search it
+        const CCoinsMap* pmapSnapshot = pSnapshot;
+        uint256 hashBlock = hashSnapshotBlock;
+        lock.unlock();
+        bool fSuccess = false;
+        try {
+            int64_t nTimeStart = GetTimeMicros();
+            fSuccess = WriteSnapshot(*pmapSnapshot, hashBlock);
+            LogPrint("bench", "    - Background coins flush: %.2fms\n", (GetTimeMicros() - nTimeStart) * 0.001);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+        }
+        lock.lock();
+
+        if (fSuccess) {
+            delete pSnapshot;
+            pSnapshot = NULL;
+        } else {
+            // Keep the snapshot so lookups stay correct, the next flush reports the failure
+            LogPrintf("%s: failed to write to coin database\n", __func__);
+            fWriteFailed = true;
+        }
+        condWritten.notify_all();
+    }
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
 }
 
@@ -99,6 +343,10 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
 }
 
 bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
+    // The statistics are read from the database alone
+    if (!WaitForWriter())
+        return false;
+
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
@@ -335,6 +583,9 @@ bool CBlockTreeDB::LoadBlockIndexGuts()
                 pindexNew->nStatus        = diskindex.nStatus;
                 pindexNew->nTx            = diskindex.nTx;
 
+                // The stored hash is the one whose Lyra2Z proof of work was computed when the
+                // header was accepted, so only its target is checked here. -verifyindexpow
+                // recomputes the hashes from the headers.
                 if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, Params().GetConsensus()))
                     return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
 
@@ -14,6 +14,10 @@
 #include <utility>
 #include <vector>
 
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
 class CBlockFileInfo;
 class CBlockIndex;
 struct CDiskTxPos;
@@ -34,20 +38,67 @@ static const int64_t nDefaultDbCache = 100;
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache in (MiB)
 static const int64_t nMinDbCache = 4;
+//! -dbbatchsize default (bytes)
+static const int64_t nDefaultDbBatchSize = 16 << 20;
+//! -asyncflush default
+static const bool DEFAULT_ASYNC_FLUSH = false;
 
-/** CCoinsView backed by the coin database (chainstate/) */
+/**
+ * CCoinsView backed by the coin database (chainstate/)
+ *
+ * With fAsyncWrite, BatchWrite only moves the dirty entries into a snapshot
+ * and returns. A writer thread streams the snapshot into the database in
+ * batches of about -dbbatchsize bytes, and lookups see the snapshot before
+ * the database until it is written. A snapshot that fits in one batch is
+ * written with the best block marker. A larger one is first written to a
+ * journal, then a marker holding its target block commits the journal, then
+ * the coins and finally the best block marker are written in batches that can
+ * be repeated. ReplayPartialFlush finishes such a flush at startup, so a crash
+ * never leaves a chainstate that mixes two blocks.
+ */
 class CCoinsViewDB : public CCoinsView
 {
 protected:
     CDBWrapper db;
+
+private:
+    const bool fAsyncWrite;
+    const size_t nBatchSize;
+
+    mutable boost::mutex mutexWriter;
+    mutable boost::condition_variable condWriter;
+    mutable boost::condition_variable condWritten;
+    //! Entries handed to the writer thread but not yet in the database
+    CCoinsMap* pSnapshot;
+    uint256 hashSnapshotBlock;
+    bool fWriteFailed;
+    bool fStopWriter;
+    boost::thread threadWriter;
+
+    void ThreadWriter();
+    bool WriteSnapshot(const CCoinsMap &mapCoins, const uint256 &hashBlock);
+    bool FinishPartialFlush(const uint256 &hashBlock);
+    bool WaitForWriter() const;
+
+protected:
+    //! Writes and clears one batch of a flush, tests interrupt flushes here
+    virtual bool WriteFlushBatch(CDBBatch &batch);
+
 public:
-    CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool fAsyncWriteIn = false);
+    ~CCoinsViewDB();
 
     bool GetCoins(const uint256 &txid, CCoins &coins) const;
     bool HaveCoins(const uint256 &txid) const;
     uint256 GetBestBlock() const;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock);
+    bool Sync();
     bool GetStats(CCoinsStats &stats) const;
+
+    //! Whether a journaled flush was committed but not finished
+    bool HasPartialFlush() const;
+    //! Finish a flush interrupted after its journal was complete, drop an incomplete one
+    bool ReplayPartialFlush();
 };
 
 /** Access to the block database (blocks/index/) */
@@ -1788,6 +1788,88 @@ void ThreadScriptCheck()
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<CBlockHeaderHashCheck> headerhashqueue(8);
+
+void ThreadBlockHeaderHashCheck()
+{
+    RenameThread("infinex-hdrhash");
+    headerhashqueue.Thread();
+}
+
+void PrecomputeBlockHeaderHashes(const std::vector<CBlockHeader>& headers)
+{
+    // Without worker threads the headers are hashed one by one when they are checked
+    if (!nScriptCheckThreads || headers.size() < 2)
+        return;
+
+    std::vector<CBlockHeaderHashCheck> vChecks;
+    vChecks.reserve(headers.size());
+    for (const CBlockHeader& header : headers)
+        vChecks.push_back(CBlockHeaderHashCheck(&header));
+
+    // The calling thread hashes along and returns once every header is done
+    CCheckQueueControl<CBlockHeaderHashCheck> control(&headerhashqueue);
+    control.Add(vChecks);
+    control.Wait();
+}
+
+static CCheckQueue<CCoinsPrefetchCheck> coinsprefetchqueue(8);
+
+void ThreadCoinsPrefetch()
+{
+    RenameThread("infinex-prefetch");
+    coinsprefetchqueue.Thread();
+}
+
+/** Number of transactions whose inputs ConnectBlock reads ahead at once */
+static const unsigned int PREFETCH_WINDOW_TXS = 64;
+
+/**
+ * Read the coins spent by block.vtx[nBegin, nEnd) that neither the view nor
+ * the coins tip hold yet from the database on the prefetch threads, and add
+ * them to the coins tip. The script checks of the transactions before nBegin
+ * keep running on their own queue meanwhile. Returns the number of lookups.
+ */
+static unsigned int PrefetchBlockInputs(const CBlock& block, unsigned int nBegin, unsigned int nEnd, const CCoinsViewCache& view, const std::set<uint256>& setBlockTxids)
+{
+    std::vector<CCoinsPrefetch> vPrefetch;
+    std::set<uint256> setQueued;
+    for (unsigned int i = nBegin; i < nEnd; i++) {
+        const CTransaction& tx = block.vtx[i];
+        if (tx.IsCoinBase())
+            continue;
+        BOOST_FOREACH(const CTxIn& txin, tx.vin) {
+            const uint256& txid = txin.prevout.hash;
+            if (setBlockTxids.count(txid) || view.HaveCoinsInCache(txid) || pcoinsTip->HaveCoinsInCache(txid))
+                continue;
+            if (!setQueued.insert(txid).second)
+                continue;
+            vPrefetch.push_back(CCoinsPrefetch());
+            vPrefetch.back().txid = txid;
+        }
+    }
+    // A single lookup is cheaper done by ConnectBlock itself
+    if (vPrefetch.size() < 2)
+        return 0;
+
+    const CCoinsView* pbase = pcoinsTip->GetBackend();
+    std::vector<CCoinsPrefetchCheck> vChecks;
+    vChecks.reserve(vPrefetch.size());
+    BOOST_FOREACH(CCoinsPrefetch& prefetch, vPrefetch)
+        vChecks.push_back(CCoinsPrefetchCheck(pbase, &prefetch));
+    {
+        CCheckQueueControl<CCoinsPrefetchCheck> control(&coinsprefetchqueue);
+        control.Add(vChecks);
+        control.Wait();
+    }
+
+    BOOST_FOREACH(CCoinsPrefetch& prefetch, vPrefetch) {
+        if (prefetch.fFound)
+            pcoinsTip->CacheCoins(prefetch.txid, prefetch.coins);
+    }
+    return vPrefetch.size();
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -1864,6 +1946,8 @@ static int64_t nTimeCheck = 0;
 static int64_t nTimeForks = 0;
 static int64_t nTimeVerify = 0;
 static int64_t nTimeConnect = 0;
+static int64_t nTimePrefetch = 0;
+static int64_t nTimeScriptWait = 0;
 static int64_t nTimeIndex = 0;
 static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
@@ -1953,10 +2037,28 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
     std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
 
+    // Read the inputs of the next transactions from disk in parallel, while the
+    // script checks of the previous ones are verified. Only the coins tip sits
+    // on top of the database, other views are not read ahead.
+    bool fPrefetch = nScriptCheckThreads && view.GetBackend() == pcoinsTip && block.vtx.size() > 1;
+    std::set<uint256> setBlockTxids;
+    if (fPrefetch) {
+        BOOST_FOREACH(const CTransaction& tx, block.vtx)
+            setBlockTxids.insert(tx.GetHash());
+    }
+    unsigned int nPrefetched = 0;
+    int64_t nTimeBlockPrefetch = 0;
+
     for (unsigned int i = 0; i < block.vtx.size(); i++) {
         const CTransaction& tx = block.vtx[i];
         const uint256 txhash = tx.GetHash();
 
+        if (fPrefetch && i % PREFETCH_WINDOW_TXS == 0) {
+            int64_t nTimePrefetchStart = GetTimeMicros();
+            nPrefetched += PrefetchBlockInputs(block, i, std::min<unsigned int>(i + PREFETCH_WINDOW_TXS, block.vtx.size()), view, setBlockTxids);
+            nTimeBlockPrefetch += GetTimeMicros() - nTimePrefetchStart;
+        }
+
         nInputs += tx.vin.size();
         nSigOps += GetLegacySigOpCount(tx);
         if (nSigOps > MaxBlockSigOps())
@@ -2069,6 +2171,8 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     }
     
     int64_t nTime3 = GetTimeMicros();
+    nTimePrefetch += nTimeBlockPrefetch;
+    LogPrint("bench", "      - Prefetch %u coins: %.2fms [%.2fs]\n", nPrefetched, 0.001 * nTimeBlockPrefetch, nTimePrefetch * 0.000001);
     nTimeConnect += nTime3 - nTime2;
     LogPrint("bench", "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs]\n", (unsigned)block.vtx.size(), 0.001 * (nTime3 - nTime2), 0.001 * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : 0.001 * (nTime3 - nTime2) / (nInputs - 1), nTimeConnect * 0.000001);
 
@@ -2106,9 +2210,12 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     }
     // END INFINEX
 
+    int64_t nTimeWaitStart = GetTimeMicros();
     if (!control.Wait())
         return state.DoS(100, false);
     int64_t nTime4 = GetTimeMicros();
+    nTimeScriptWait += nTime4 - nTimeWaitStart;
+    LogPrint("bench", "      - Wait for script checks: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTimeWaitStart), nTimeScriptWait * 0.000001);
     nTimeVerify += nTime4 - nTime2;
     LogPrint("bench", "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, 0.001 * (nTime4 - nTime2), nInputs <= 1 ? 0 : 0.001 * (nTime4 - nTime2) / (nInputs - 1), nTimeVerify * 0.000001);
 
@@ -2265,6 +2372,11 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
             // Flush the chainstate (which may refer to block index entries).
             if (!pcoinsTip->Flush())
                 return AbortNode(state, "Failed to write to coin database");
+            // With -asyncflush the coins are written in the background. Wait for
+            // them when the caller relies on the database, and before the
+            // chainstate can fall behind the remaining block files.
+            if ((mode == FLUSH_STATE_ALWAYS || fFlushForPrune) && !pcoinsTip->Sync())
+                return AbortNode(state, "Failed to write to coin database");
             nLastFlush = nNow;
         }
         if (fDoFullFlush || ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) && nNow > nLastSetChain + (int64_t)DATABASE_WRITE_INTERVAL * 1000000)) {
@@ -3542,12 +3654,48 @@ CBlockIndex* InsertBlockIndex(uint256 hash)
     return pindexNew;
 }
 
+/**
+ * Recompute the proof-of-work hash of every loaded block index entry and compare it
+ * with the hash stored in the entry. Batches are hashed on the header hashing threads.
+ */
+static bool VerifyBlockIndexPoW()
+{
+    const size_t nBatchSize = 2000;
+    int64_t nStart = GetTimeMillis();
+    std::vector<CBlockIndex*> vIndexes;
+    std::vector<CBlockHeader> vHeaders;
+    vIndexes.reserve(nBatchSize);
+    vHeaders.reserve(nBatchSize);
+
+    BlockMap::const_iterator it = mapBlockIndex.begin();
+    while (it != mapBlockIndex.end()) {
+        boost::this_thread::interruption_point();
+        vIndexes.clear();
+        vHeaders.clear();
+        for (; it != mapBlockIndex.end() && vIndexes.size() < nBatchSize; ++it) {
+            vIndexes.push_back(it->second);
+            vHeaders.push_back(it->second->GetBlockHeader());
+        }
+        PrecomputeBlockHeaderHashes(vHeaders);
+        for (size_t i = 0; i < vIndexes.size(); i++) {
+            if (vHeaders[i].GetHash() != vIndexes[i]->GetBlockHash())
+                return error("%s: stored hash does not match the block header: %s", __func__, vIndexes[i]->ToString());
+        }
+    }
+
+    LogPrintf("%s: verified the proof of work of %u block index entries in %dms\n", __func__, mapBlockIndex.size(), GetTimeMillis() - nStart);
+    return true;
+}
+
 bool static LoadBlockIndexDB()
 {
     const CChainParams& chainparams = Params();
     if (!pblocktree->LoadBlockIndexGuts())
         return false;
 
+    if (GetBoolArg("-verifyindexpow", DEFAULT_VERIFY_INDEX_POW) && !VerifyBlockIndexPoW())
+        return false;
+
     boost::this_thread::interruption_point();
 
     // Calculate nChainWork
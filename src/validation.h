@@ -185,6 +185,8 @@ static const unsigned int MIN_BLOCKS_TO_KEEP = 288;
 
 static const signed int DEFAULT_CHECKBLOCKS = MIN_BLOCKS_TO_KEEP;
 static const unsigned int DEFAULT_CHECKLEVEL = 3;
+/** Recompute the proof-of-work hashes of the block index at startup */
+static const bool DEFAULT_VERIFY_INDEX_POW = false;
 
 // Require that user allocate at least 945MB for block & undo files (blk???.dat and rev???.dat)
 // At 2MB per block, 288 blocks = 576MB.
@@ -244,6 +246,12 @@ bool LoadBlockIndex();
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the block header hashing thread */
+void ThreadBlockHeaderHashCheck();
+/** Hash a batch of headers on the header hashing threads, before they are validated under cs_main */
+void PrecomputeBlockHeaderHashes(const std::vector<CBlockHeader>& headers);
+/** Run an instance of the coins prefetching thread used by ConnectBlock */
+void ThreadCoinsPrefetch();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Verify current tip chain work similar or exceed SPORK recorded minimum chain work */
@@ -713,6 +721,64 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure computing the proof-of-work hash of one header, which the header
+ * caches for the checks that follow. Only one thread may run it per header.
+ */
+class CBlockHeaderHashCheck
+{
+private:
+    const CBlockHeader* pheader;
+
+public:
+    CBlockHeaderHashCheck(): pheader(NULL) {}
+    CBlockHeaderHashCheck(const CBlockHeader* pheaderIn): pheader(pheaderIn) {}
+
+    bool operator()() {
+        pheader->GetHash();
+        return true;
+    }
+
+    void swap(CBlockHeaderHashCheck &check) {
+        std::swap(pheader, check.pheader);
+    }
+};
+
+/** Coins of one transaction read ahead of ConnectBlock */
+struct CCoinsPrefetch
+{
+    uint256 txid;
+    CCoins coins;
+    bool fFound;
+
+    CCoinsPrefetch(): fFound(false) {}
+};
+
+/**
+ * Closure reading the coins of one transaction from the view below the coins
+ * tip cache. The view must allow concurrent reads, like CCoinsViewDB.
+ */
+class CCoinsPrefetchCheck
+{
+private:
+    const CCoinsView* pbase;
+    CCoinsPrefetch* pprefetch;
+
+public:
+    CCoinsPrefetchCheck(): pbase(NULL), pprefetch(NULL) {}
+    CCoinsPrefetchCheck(const CCoinsView* pbaseIn, CCoinsPrefetch* pprefetchIn): pbase(pbaseIn), pprefetch(pprefetchIn) {}
+
+    bool operator()() {
+        pprefetch->fFound = pbase->GetCoins(pprefetch->txid, pprefetch->coins);
+        return true;
+    }
+
+    void swap(CCoinsPrefetchCheck &check) {
+        std::swap(pbase, check.pbase);
+        std::swap(pprefetch, check.pprefetch);
+    }
+};
+
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes);
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
 bool GetAddressIndex(uint160 addressHash, int type,
@@ -0,0 +1,104 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "workpool.h"
+
+#include "tinyformat.h"
+#include "util.h"
+
+#include <assert.h>
+
+CWorkStealingPool::~CWorkStealingPool()
+{
+    Stop();
+}
+
+bool CWorkStealingPool::PopTask(size_t nWorker, Task& task)
+{
+    // own queue first, oldest task first
+    {
+        Worker& worker = *vWorkers[nWorker];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+            nQueued--;
+            return true;
+        }
+    }
+    // then steal the newest task of another queue, leaving the owner the ones it is about to run
+    for (size_t i = 1; i < vWorkers.size(); i++) {
+        Worker& victim = *vWorkers[(nWorker + i) % vWorkers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            nQueued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void CWorkStealingPool::ThreadWorker(size_t nWorker, std::string strName)
+{
+    RenameThread(strName.c_str());
+    while (true) {
+        Task task;
+        if (PopTask(nWorker, task)) {
+            try {
+                task();
+            } catch (const std::exception& e) {
+                PrintExceptionContinue(&e, strName.c_str());
+            } catch (...) {
+                PrintExceptionContinue(NULL, strName.c_str());
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutexWake);
+        while (!fStop && nQueued == 0)
+            condWake.wait(lock);
+        if (fStop)
+            return;
+    }
+}
+
+void CWorkStealingPool::Start(int nThreads, const std::string& strName)
+{
+    assert(vThreads.empty());
+    fStop = false;
+    for (int i = 0; i < nThreads; i++)
+        vWorkers.emplace_back(new Worker());
+    for (int i = 0; i < nThreads; i++)
+        vThreads.push_back(std::thread(&CWorkStealingPool::ThreadWorker, this, i, strprintf("infinex-%s.%d", strName, i)));
+}
+
+void CWorkStealingPool::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutexWake);
+        fStop = true;
+    }
+    condWake.notify_all();
+    for (size_t i = 0; i < vThreads.size(); i++)
+        vThreads[i].join();
+    vThreads.clear();
+    vWorkers.clear();
+    nQueued = 0;
+}
+
+void CWorkStealingPool::Submit(Task task, size_t nHint)
+{
+    assert(!vWorkers.empty());
+    Worker& worker = *vWorkers[nHint % vWorkers.size()];
+    {
+        // counted before it can be taken, so the count never drops below the queued tasks
+        std::lock_guard<std::mutex> lockWake(mutexWake);
+        nQueued++;
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    condWake.notify_one();
+}
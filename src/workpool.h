@@ -0,0 +1,70 @@
+// Copyright (c) 2017-2018 The Infinex Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_WORKPOOL_H
+#define BITCOIN_WORKPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed pool of threads running independent tasks, with work stealing.
+ *
+ * Every thread has its own task queue. A task is queued to the thread picked
+ * by its hint, so tasks with the same hint tend to run on the same thread;
+ * a thread whose queue is empty takes tasks from the back of the others'
+ * queues before going to sleep. Tasks are not ordered against each other:
+ * callers that need an order must not submit the next task before the
+ * previous one finished.
+ */
+class CWorkStealingPool
+{
+public:
+    typedef std::function<void()> Task;
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker> > vWorkers;
+    std::vector<std::thread> vThreads;
+
+    std::mutex mutexWake;
+    std::condition_variable condWake;
+    //! Queued tasks, incremented under mutexWake so sleepers do not miss a task
+    std::atomic<size_t> nQueued;
+    bool fStop;
+
+    bool PopTask(size_t nWorker, Task& task);
+    void ThreadWorker(size_t nWorker, std::string strName);
+
+    CWorkStealingPool(const CWorkStealingPool&);
+    CWorkStealingPool& operator=(const CWorkStealingPool&);
+
+public:
+    CWorkStealingPool() : nQueued(0), fStop(false) {}
+    ~CWorkStealingPool();
+
+    //! Start nThreads threads named infinex-<strName>.<n>
+    void Start(int nThreads, const std::string& strName);
+    //! Let running tasks finish and join the threads. Tasks still queued are dropped.
+    void Stop();
+    bool IsRunning() const { return !vThreads.empty(); }
+    size_t GetThreadCount() const { return vThreads.size(); }
+
+    //! Queue a task, the pool must be running
+    void Submit(Task task, size_t nHint);
+};
+
+#endif // BITCOIN_WORKPOOL_H